@@ -56,6 +56,12 @@ public:
         logger->critical(fmt, args...);
     }
 
+    // Lets callers skip building a message which would be filtered out
+    static bool should_log(spdlog::level::level_enum level)
+    {
+        return logger->should_log(level);
+    }
+
     static void flush()
     {
         logger->flush();
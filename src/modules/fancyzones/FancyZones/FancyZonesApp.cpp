@@ -7,6 +7,7 @@
 #include <common/utils/UnhandledExceptionHandler_x64.h>
 
 #include <FancyZonesLib/Generated Files/resource.h>
+#include <FancyZonesLib/DragEventPipeline.h>
 #include <FancyZonesLib/FancyZonesData.h>
 #include <FancyZonesLib/FancyZonesWinHookEventIDs.h>
 #include <FancyZonesLib/trace.h>
@@ -124,15 +125,32 @@ void FancyZonesApp::HandleWinHookEvent(WinHookEvent* data) noexcept
     case EVENT_SYSTEM_MOVESIZESTART:
     {
         fzCallback->HandleWinHookEvent(data);
+
+        // The hook depends on the dragged window, replace the hook of a drag which didn't end properly
+        if (m_objectLocationWinEventHook && UnhookWinEvent(m_objectLocationWinEventHook))
+        {
+            m_objectLocationWinEventHook = nullptr;
+        }
+
         if (!m_objectLocationWinEventHook)
         {
+            // Only the outline moves when the window contents aren't shown while dragging, so the
+            // cursor location changes are needed, and they don't come from the dragged window's process
+            DWORD processId = 0;
+            DWORD flags = WINEVENT_OUTOFCONTEXT;
+            if (!DragEventPipeline::DragShowsOutline())
+            {
+                GetWindowThreadProcessId(data->hwnd, &processId);
+                flags |= WINEVENT_SKIPOWNPROCESS;
+            }
+
             m_objectLocationWinEventHook = SetWinEventHook(EVENT_OBJECT_LOCATIONCHANGE,
                                                            EVENT_OBJECT_LOCATIONCHANGE,
                                                            nullptr,
                                                            WinHookProc,
+                                                           processId,
                                                            0,
-                                                           0,
-                                                           WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+                                                           flags);
         }
     }
     break;
@@ -4,6 +4,7 @@
 #include <common/utils/window.h>
 #include <common/utils/UnhandledExceptionHandler_x64.h>
 
+#include <FancyZonesLib/CallTracer.h>
 #include <FancyZonesLib/trace.h>
 #include <FancyZonesLib/Generated Files/resource.h>
 
@@ -21,6 +22,8 @@
 const std::wstring moduleName = L"FancyZones";
 const std::wstring internalPath = L"";
 const std::wstring instanceMutexName = L"Local\\PowerToys_FancyZones_InstanceMutex";
+const wchar_t callProfileVariable[] = L"POWERTOYS_FANCYZONES_CALL_PROFILE";
+const std::wstring callProfileFileName = L"\\call-profile.json";
 
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ PWSTR lpCmdLine, _In_ int nCmdShow)
 {
@@ -60,6 +63,13 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         });
     }
 
+    // Traced scopes are recorded only on demand, the profile is saved on exit
+    const bool profileCalls = GetEnvironmentVariableW(callProfileVariable, nullptr, 0) > 0;
+    if (profileCalls)
+    {
+        CallTracer::StartProfiling();
+    }
+
     Trace::RegisterProvider();
 
     FancyZonesApp app(GET_RESOURCE_STRING(IDS_FANCYZONES), NonLocalizable::FancyZonesStr);
@@ -68,6 +78,11 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     run_message_loop();
 
     Trace::UnregisterProvider();
-    
+
+    if (profileCalls)
+    {
+        CallTracer::StopProfiling(PTSettingsHelper::get_module_save_folder_location(moduleName) + callProfileFileName);
+    }
+
     return 0;
 }
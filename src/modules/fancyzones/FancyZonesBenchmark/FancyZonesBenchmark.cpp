@@ -0,0 +1,579 @@
+#include "pch.h"
+
+#include <FancyZonesLib/AppZoneHistorySnapshot.h>
+#include <FancyZonesLib/JsonHelpers.h>
+#include <FancyZonesLib/LayoutEngine.h>
+#include <FancyZonesLib/ZoneNavigationGraph.h>
+#include <FancyZonesLib/ZoneSpatialIndex.h>
+#include <FancyZonesTests/UnitTests/FakeWindowBackend.h>
+
+#include <common/display/dpi_aware.h>
+
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+// Measures the zone geometry of LayoutEngine on synthetic layouts, without windows or monitors.
+// Usage: FancyZonesBenchmark.exe [--sizes 4,64,1024] [--layouts grid,canvas] [--out results.json]
+// Results are written as JSON, to stdout unless --out is given.  Returns 1 if a run failed.
+// "layout" is what a display change costs: the zones, the spatial index and the navigation graph.
+// "hitTest" and "combinedRange" are what every mouse move of a drag costs, "linearHitTest" is
+// the hit-test testing every zone that ZoneSet did before the spatial index.
+// "neighbourLookup" is what Win+arrow costs, "linearNeighbour" is the search of every zone it
+// did before the navigation graph.
+// "relayout" plans moving the zoned windows into the new zones and "relayoutApply" moves them,
+// against fake windows.
+// "appZoneHistory" loads the app zone history from its json file and from the snapshot, in a
+// temporary folder.
+
+namespace
+{
+    using Clock = std::chrono::high_resolution_clock;
+    using LayoutType = FancyZonesDataTypes::ZoneSetLayoutType;
+
+    // 4K work area, with the default sensitivity radius
+    const RECT WorkArea{ 0, 0, 3840, 2160 };
+    const int SensitivityRadius = 20;
+
+    const int LayoutRepeats = 20;
+    const int HitTestCount = 100000;
+    const int CombinedRangeCount = 10000;
+    const int NavigationCount = 100000;
+    const int RelayoutWindowCount = 64;
+
+    const int DefaultSizes[] = { 4, 16, 64, 256, 1024 };
+    const int HistoryAppCounts[] = { 1000, 10000 };
+
+    struct BenchmarkLayout
+    {
+        PCSTR name;
+        LayoutType type;
+        int spacing;
+        bool canvas;
+    };
+
+    const BenchmarkLayout Layouts[] = {
+        { "focus", LayoutType::Focus, 0, false },
+        // 1024 columns with spacing don't fit in the work area
+        { "columns", LayoutType::Columns, 0, false },
+        { "grid", LayoutType::Grid, 16, false },
+        { "priority_grid", LayoutType::PriorityGrid, 16, false },
+        // Overlapping zones at random positions, hit-tests choose between them
+        { "canvas", LayoutType::Custom, 0, true },
+    };
+
+    struct BenchmarkResult
+    {
+        PCSTR layout = nullptr;
+        int zoneCount = 0;
+        bool succeeded = false;
+        double layoutUs = 0;
+        double spatialIndexUs = 0;
+        double navigationGraphUs = 0;
+        double hitTestNs = 0;
+        double capturedZonesPerHitTest = 0;
+        double linearHitTestNs = 0;
+        double combinedRangeNs = 0;
+        double neighbourLookupNs = 0;
+        double linearNeighbourNs = 0;
+        double searchNs = 0;
+        double relayoutUs = 0;
+        double relayoutApplyUs = 0;
+    };
+
+    struct HistoryResult
+    {
+        int appCount = 0;
+        bool succeeded = false;
+        double jsonLoadMs = 0;
+        double snapshotLoadMs = 0;
+        uintmax_t jsonBytes = 0;
+        uintmax_t snapshotBytes = 0;
+    };
+
+    FancyZonesDataTypes::CanvasLayoutInfo MakeCanvasLayout(int zoneCount)
+    {
+        std::mt19937 random(zoneCount);
+        std::uniform_int_distribution<int> x(0, WorkArea.right - 1000);
+        std::uniform_int_distribution<int> y(0, WorkArea.bottom - 600);
+        std::uniform_int_distribution<int> size(200, 1000);
+
+        FancyZonesDataTypes::CanvasLayoutInfo info{ .lastWorkAreaWidth = WorkArea.right, .lastWorkAreaHeight = WorkArea.bottom, .zones = {}, .sensitivityRadius = SensitivityRadius };
+        for (int i = 0; i < zoneCount; i++)
+        {
+            const int width = size(random);
+            info.zones.push_back({ x(random), y(random), width, width * 3 / 5 });
+        }
+        return info;
+    }
+
+    bool CalculateZones(const BenchmarkLayout& layout, const FancyZonesDataTypes::CanvasLayoutInfo& canvasLayout, int zoneCount, LayoutEngine::Zones& zones)
+    {
+        if (layout.canvas)
+        {
+            return LayoutEngine::CalculateCanvasZones(canvasLayout, DPIAware::DEFAULT_DPI, zones);
+        }
+        else
+        {
+            return LayoutEngine::CalculateLayout(WorkArea, layout.type, zoneCount, layout.spacing, zones);
+        }
+    }
+
+    // Smallest algorithm of ZoneSet::ZonesFromPoint before the spatial index
+    std::vector<size_t> LinearZonesFromPoint(const LayoutEngine::Zones& zones, POINT pt)
+    {
+        std::vector<const LayoutEngine::Zone*> capturedZones;
+        size_t strictlyCapturedCount = 0;
+        for (const auto& zone : zones)
+        {
+            const RECT& rect = zone.rect;
+            if (rect.left - SensitivityRadius <= pt.x && pt.x <= rect.right + SensitivityRadius &&
+                rect.top - SensitivityRadius <= pt.y && pt.y <= rect.bottom + SensitivityRadius)
+            {
+                capturedZones.push_back(&zone);
+            }
+
+            if (rect.left <= pt.x && pt.x < rect.right && rect.top <= pt.y && pt.y < rect.bottom)
+            {
+                strictlyCapturedCount++;
+            }
+        }
+
+        if (capturedZones.size() == 1 && strictlyCapturedCount == 0)
+        {
+            return {};
+        }
+
+        for (size_t i = 0; i < capturedZones.size(); ++i)
+        {
+            for (size_t j = i + 1; j < capturedZones.size(); ++j)
+            {
+                const RECT& rectI = capturedZones[i]->rect;
+                const RECT& rectJ = capturedZones[j]->rect;
+                if (max(rectI.top, rectJ.top) + SensitivityRadius < min(rectI.bottom, rectJ.bottom) &&
+                    max(rectI.left, rectJ.left) + SensitivityRadius < min(rectI.right, rectJ.right))
+                {
+                    const auto smallest = std::min_element(capturedZones.begin(), capturedZones.end(), [](const LayoutEngine::Zone* a, const LayoutEngine::Zone* b) {
+                        return LayoutEngine::ZoneArea(a->rect) < LayoutEngine::ZoneArea(b->rect);
+                    });
+                    return { (*smallest)->id };
+                }
+            }
+        }
+
+        std::vector<size_t> zoneIds;
+        for (const auto* zone : capturedZones)
+        {
+            zoneIds.push_back(zone->id);
+        }
+        return zoneIds;
+    }
+
+    // Zone in the direction of the arrow key from the window, the way Win+arrow searched before
+    // the navigation graph. Returns zones.size() if there is none.
+    size_t LinearChooseNextZone(DWORD vkCode, RECT windowRect, const std::vector<RECT>& zoneRects)
+    {
+        using complex = std::complex<double>;
+        const double inf = 1e100;
+        const double eccentricity = 2.0;
+
+        auto rectCenter = [](RECT rect) {
+            return complex{ 0.5 * rect.left + 0.5 * rect.right, 0.5 * rect.top + 0.5 * rect.bottom };
+        };
+
+        auto distance = [&](complex arrowDirection, complex zoneDirection) {
+            double scalarProduct = (arrowDirection * conj(zoneDirection)).real();
+            if (scalarProduct <= 0.0)
+            {
+                return inf;
+            }
+
+            double cosAngle = scalarProduct / std::abs(zoneDirection);
+            double tanAngle = std::abs(std::tan(std::acos(cosAngle)));
+            if (tanAngle > 10)
+            {
+                return inf;
+            }
+
+            double intersectY = 2 * eccentricity / (1.0 + eccentricity * eccentricity * tanAngle * tanAngle);
+            double distanceEstimate = scalarProduct / intersectY;
+            return std::isfinite(distanceEstimate) ? distanceEstimate : inf;
+        };
+
+        complex directionVector;
+        switch (vkCode)
+        {
+        case VK_UP:
+            directionVector = { 0.0, -1.0 };
+            break;
+        case VK_DOWN:
+            directionVector = { 0.0, 1.0 };
+            break;
+        case VK_LEFT:
+            directionVector = { -1.0, 0.0 };
+            break;
+        case VK_RIGHT:
+            directionVector = { 1.0, 0.0 };
+            break;
+        }
+
+        size_t closestIdx = zoneRects.size();
+        double smallestDistance = inf;
+        for (size_t i = 0; i < zoneRects.size(); i++)
+        {
+            double dist = distance(directionVector, rectCenter(zoneRects[i]) + 0.001 * (i + 1) - rectCenter(windowRect));
+            if (dist < smallestDistance)
+            {
+                smallestDistance = dist;
+                closestIdx = i;
+            }
+        }
+
+        return closestIdx;
+    }
+
+    template<class F>
+    double MeasureUs(int repeats, F&& f)
+    {
+        auto start = Clock::now();
+        for (int i = 0; i < repeats; i++)
+        {
+            f();
+        }
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / repeats;
+    }
+
+    BenchmarkResult RunBenchmark(const BenchmarkLayout& layout, int zoneCount)
+    {
+        BenchmarkResult result;
+        result.layout = layout.name;
+        result.zoneCount = zoneCount;
+
+        const auto canvasLayout = layout.canvas ? MakeCanvasLayout(zoneCount) : FancyZonesDataTypes::CanvasLayoutInfo{};
+        const SIZE workAreaSize{ WorkArea.right - WorkArea.left, WorkArea.bottom - WorkArea.top };
+
+        LayoutEngine::Zones zones;
+        ZoneSpatialIndex index;
+        ZoneNavigationGraph graph;
+        bool calculated = true;
+        result.layoutUs = MeasureUs(LayoutRepeats, [&] { calculated = CalculateZones(layout, canvasLayout, zoneCount, zones) && calculated; });
+        result.spatialIndexUs = MeasureUs(LayoutRepeats, [&] { index.Build(zones, SensitivityRadius); });
+        result.navigationGraphUs = MeasureUs(LayoutRepeats, [&] { graph.Build(zones, workAreaSize); });
+        if (!calculated || zones.empty())
+        {
+            return result;
+        }
+
+        std::mt19937 random(42);
+        std::uniform_int_distribution<long> x(WorkArea.left, WorkArea.right - 1);
+        std::uniform_int_distribution<long> y(WorkArea.top, WorkArea.bottom - 1);
+        std::uniform_int_distribution<size_t> zoneIndex(0, zones.size() - 1);
+
+        std::vector<POINT> points(HitTestCount);
+        std::generate(points.begin(), points.end(), [&] { return POINT{ x(random), y(random) }; });
+        size_t capturedZones = 0;
+        auto start = Clock::now();
+        for (const auto& point : points)
+        {
+            capturedZones += LayoutEngine::ZonesFromPoint(index, point, Settings::OverlappingZonesAlgorithm::Smallest).size();
+        }
+        result.hitTestNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / HitTestCount;
+        result.capturedZonesPerHitTest = static_cast<double>(capturedZones) / HitTestCount;
+
+        start = Clock::now();
+        for (const auto& point : points)
+        {
+            capturedZones += LinearZonesFromPoint(zones, point).size();
+        }
+        result.linearHitTestNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / HitTestCount;
+
+        // The zone the drag started in and the zone under the cursor
+        std::vector<std::pair<size_t, size_t>> ranges(CombinedRangeCount);
+        std::generate(ranges.begin(), ranges.end(), [&] { return std::pair{ zones[zoneIndex(random)].id, zones[zoneIndex(random)].id }; });
+        size_t rangeZones = 0;
+        start = Clock::now();
+        for (const auto& [initialZone, finalZone] : ranges)
+        {
+            rangeZones += LayoutEngine::GetCombinedZoneRange(zones, { initialZone }, { finalZone }).size();
+        }
+        result.combinedRangeNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / CombinedRangeCount;
+
+        const DWORD keys[] = { VK_LEFT, VK_RIGHT, VK_UP, VK_DOWN };
+        size_t moves = 0;
+        start = Clock::now();
+        for (int i = 0; i < NavigationCount; i++)
+        {
+            const size_t zoneId = zones[i % zones.size()].id;
+            moves += graph.Neighbours(zoneId, keys[i % std::size(keys)]).size();
+        }
+        result.neighbourLookupNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / NavigationCount;
+
+        // The other zones are collected for every move, as they were
+        const int linearCount = NavigationCount / 10;
+        start = Clock::now();
+        for (int i = 0; i < linearCount; i++)
+        {
+            const size_t from = i % zones.size();
+            std::vector<RECT> zoneRects;
+            zoneRects.reserve(zones.size());
+            for (size_t j = 0; j < zones.size(); j++)
+            {
+                if (j != from)
+                {
+                    zoneRects.push_back(zones[j].rect);
+                }
+            }
+            moves += LinearChooseNextZone(keys[i % std::size(keys)], zones[from].rect, zoneRects) < zoneRects.size();
+        }
+        result.linearNeighbourNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / linearCount;
+
+        // Windows which aren't snapped to a single zone search from their rectangle
+        const int searchCount = NavigationCount / 10;
+        std::vector<RECT> windows(searchCount);
+        std::generate(windows.begin(), windows.end(), [&] {
+            const long left = x(random);
+            const long top = y(random);
+            return RECT{ left, top, left + 800, top + 600 };
+        });
+        start = Clock::now();
+        for (int i = 0; i < searchCount; i++)
+        {
+            moves += graph.Search(windows[i], keys[i % std::size(keys)]).has_value();
+        }
+        result.searchNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / searchCount;
+
+        // Windows snapped to random zones, some of them spanning two
+        FakeWindowBackend backend;
+        std::vector<HWND> zonedWindows;
+        for (int i = 0; i < RelayoutWindowCount; i++)
+        {
+            std::vector<size_t> zoneIds{ zones[zoneIndex(random)].id };
+            if (i % 4 == 0)
+            {
+                zoneIds.push_back(zones[zoneIndex(random)].id);
+            }
+            zonedWindows.push_back(backend.AddWindow({ .rect = { 0, 0, 800, 600 }, .zoneIds = zoneIds }));
+        }
+        const WindowRelayout::WorkAreaZones workAreaZones{ nullptr, zones };
+        size_t plannedMoves = 0;
+        result.relayoutUs = MeasureUs(LayoutRepeats, [&] {
+            const auto plan = WindowRelayout::PlanRelayout(backend, zonedWindows, [&](HWND) { return &workAreaZones; });
+            plannedMoves += plan.empty() ? 0 : plan[0].deferredMoves.size();
+        });
+
+        // The windows are in their zones once moved, so the moves are only applied once
+        const auto plan = WindowRelayout::PlanRelayout(backend, zonedWindows, [&](HWND) { return &workAreaZones; });
+        result.relayoutApplyUs = MeasureUs(1, [&] { WindowRelayout::ApplyPlan(backend, plan); });
+
+        // Keeps the measured calls from being optimized out
+        result.succeeded = rangeZones > 0 && moves > 0 && plannedMoves > 0;
+        return result;
+    }
+
+    // History of apps snapped on one to three virtual desktops
+    JSONHelpers::TAppZoneHistoryMap MakeHistory(int appCount)
+    {
+        JSONHelpers::TAppZoneHistoryMap result;
+        for (int app = 0; app < appCount; app++)
+        {
+            auto& history = result[L"C:\\Program Files\\App" + std::to_wstring(app) + L"\\app.exe"];
+            for (int desktop = 0; desktop <= app % 3; desktop++)
+            {
+                FancyZonesDataTypes::AppZoneHistoryData data{};
+                data.zoneSetUuid = L"{33A2B101-06E0-437B-A61E-CDBECF50228" + std::to_wstring(desktop) + L"}";
+                data.deviceId = L"AOC2460#4&fe3a015&0&UID65793_1920_1200_{39B25DD2-130D-4B5D-8851-4791D66B153" + std::to_wstring(desktop) + L"}";
+                data.zoneIndexSet = { static_cast<size_t>(app % 10), static_cast<size_t>(app % 70) };
+                history.push_back(data);
+            }
+        }
+        return result;
+    }
+
+    HistoryResult RunHistoryBenchmark(int appCount)
+    {
+        HistoryResult result;
+        result.appCount = appCount;
+
+        wchar_t tempPath[MAX_PATH]{};
+        if (GetTempPathW(MAX_PATH, tempPath) == 0)
+        {
+            return result;
+        }
+
+        std::error_code error;
+        const std::filesystem::path folder = std::filesystem::path(tempPath) / (L"FancyZonesBenchmark" + std::to_wstring(GetCurrentProcessId()));
+        if (!std::filesystem::create_directories(folder, error))
+        {
+            return result;
+        }
+
+        const std::wstring jsonFileName = (folder / L"app-zone-history.json").wstring();
+        const std::wstring snapshotFileName = (folder / L"app-zone-history.bin").wstring();
+        const auto history = MakeHistory(appCount);
+        JSONHelpers::SaveAppZoneHistory(jsonFileName, JSONHelpers::SerializeAppZoneHistoryJSON(history));
+        if (AppZoneHistorySnapshot::Save(snapshotFileName, jsonFileName, AppZoneHistorySnapshot::Serialize(history)))
+        {
+            auto start = Clock::now();
+            const auto fromJson = JSONHelpers::ParseAppZoneHistoryFile(jsonFileName);
+            auto json = Clock::now();
+            const auto fromSnapshot = AppZoneHistorySnapshot::Load(snapshotFileName, jsonFileName);
+            auto snapshot = Clock::now();
+
+            result.jsonLoadMs = std::chrono::duration<double, std::milli>(json - start).count();
+            result.snapshotLoadMs = std::chrono::duration<double, std::milli>(snapshot - json).count();
+            result.jsonBytes = std::filesystem::file_size(jsonFileName, error);
+            result.snapshotBytes = std::filesystem::file_size(snapshotFileName, error);
+            result.succeeded = fromJson.size() == history.size() && fromSnapshot.has_value() && fromSnapshot->size() == history.size();
+        }
+
+        std::filesystem::remove_all(folder, error);
+        return result;
+    }
+
+    std::vector<std::wstring> SplitList(PCWSTR list)
+    {
+        std::vector<std::wstring> values;
+        std::wstring value;
+        for (PCWSTR p = list;; p++)
+        {
+            if (*p == L',' || *p == L'\0')
+            {
+                if (!value.empty())
+                {
+                    values.push_back(value);
+                }
+                value.clear();
+                if (*p == L'\0')
+                {
+                    break;
+                }
+            }
+            else
+            {
+                value += *p;
+            }
+        }
+        return values;
+    }
+
+    void WriteResults(FILE* output, const std::vector<BenchmarkResult>& results, const std::vector<HistoryResult>& historyResults)
+    {
+        fprintf(output, "{\n  \"results\": [\n");
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const BenchmarkResult& result = results[i];
+            fprintf(output,
+                    "    { \"layout\": \"%s\", \"zones\": %d, \"succeeded\": %s, \"layoutUs\": %.3f, \"spatialIndexUs\": %.3f, "
+                    "\"navigationGraphUs\": %.3f, \"hitTestNs\": %.1f, \"capturedZonesPerHitTest\": %.3f, \"linearHitTestNs\": %.1f, \"combinedRangeNs\": %.1f, "
+                    "\"neighbourLookupNs\": %.1f, \"linearNeighbourNs\": %.1f, \"searchNs\": %.1f, \"relayoutUs\": %.3f, \"relayoutApplyUs\": %.3f }%s\n",
+                    result.layout,
+                    result.zoneCount,
+                    result.succeeded ? "true" : "false",
+                    result.layoutUs,
+                    result.spatialIndexUs,
+                    result.navigationGraphUs,
+                    result.hitTestNs,
+                    result.capturedZonesPerHitTest,
+                    result.linearHitTestNs,
+                    result.combinedRangeNs,
+                    result.neighbourLookupNs,
+                    result.linearNeighbourNs,
+                    result.searchNs,
+                    result.relayoutUs,
+                    result.relayoutApplyUs,
+                    (i + 1 < results.size()) ? "," : "");
+        }
+        fprintf(output, "  ],\n  \"appZoneHistory\": [\n");
+        for (size_t i = 0; i < historyResults.size(); i++)
+        {
+            const HistoryResult& result = historyResults[i];
+            fprintf(output,
+                    "    { \"apps\": %d, \"succeeded\": %s, \"jsonLoadMs\": %.3f, \"jsonBytes\": %ju, \"snapshotLoadMs\": %.3f, \"snapshotBytes\": %ju }%s\n",
+                    result.appCount,
+                    result.succeeded ? "true" : "false",
+                    result.jsonLoadMs,
+                    result.jsonBytes,
+                    result.snapshotLoadMs,
+                    result.snapshotBytes,
+                    (i + 1 < historyResults.size()) ? "," : "");
+        }
+        fprintf(output, "  ]\n}\n");
+    }
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+    std::vector<int> sizes(std::begin(DefaultSizes), std::end(DefaultSizes));
+    std::vector<const BenchmarkLayout*> layouts;
+    for (const auto& layout : Layouts)
+    {
+        layouts.push_back(&layout);
+    }
+    PCWSTR outputPath = nullptr;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (wcscmp(argv[i], L"--sizes") == 0)
+        {
+            sizes.clear();
+            for (const auto& size : SplitList(argv[i + 1]))
+            {
+                sizes.push_back(_wtoi(size.c_str()));
+            }
+        }
+        else if (wcscmp(argv[i], L"--layouts") == 0)
+        {
+            layouts.clear();
+            for (const auto& name : SplitList(argv[i + 1]))
+            {
+                for (const auto& layout : Layouts)
+                {
+                    if (name == std::wstring(layout.name, layout.name + strlen(layout.name)))
+                    {
+                        layouts.push_back(&layout);
+                    }
+                }
+            }
+        }
+        else if (wcscmp(argv[i], L"--out") == 0)
+        {
+            outputPath = argv[i + 1];
+        }
+    }
+
+    std::vector<BenchmarkResult> results;
+    bool succeeded = true;
+    for (int size : sizes)
+    {
+        for (const auto* layout : layouts)
+        {
+            results.push_back(RunBenchmark(*layout, size));
+            succeeded = succeeded && results.back().succeeded;
+        }
+    }
+
+    std::vector<HistoryResult> historyResults;
+    for (int appCount : HistoryAppCounts)
+    {
+        historyResults.push_back(RunHistoryBenchmark(appCount));
+        succeeded = succeeded && historyResults.back().succeeded;
+    }
+
+    FILE* output = stdout;
+    if (outputPath && _wfopen_s(&output, outputPath, L"w") != 0)
+    {
+        output = stdout;
+    }
+    WriteResults(output, results, historyResults);
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+
+    return succeeded ? 0 : 1;
+}
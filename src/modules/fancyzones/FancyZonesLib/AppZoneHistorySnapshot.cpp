@@ -0,0 +1,366 @@
+#include "pch.h"
+
+#include "AppZoneHistorySnapshot.h"
+#include "FancyZonesDataTypes.h"
+
+#include <common/logger/logger.h>
+#include <common/utils/winapi_error.h>
+
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    // Layout, all values little endian:
+    //   header
+    //   string table: length (uint32) and UTF-16 characters of each distinct string
+    //   apps: app path string, history count (uint32) and per history entry the zone set uuid
+    //         and device id strings, zone index count (uint32) and zone indexes (uint64)
+    // Strings are stored once and referenced by their index (uint32), since the same device ids
+    // and zone set uuids are repeated across the whole history.
+    constexpr uint32_t Magic = 0x53485A46; // "FZHS"
+    constexpr uint32_t Version = 2;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t jsonLastWriteTime;
+        uint64_t jsonSize;
+        uint64_t jsonContentHash;
+        uint64_t payloadSize;
+        uint32_t stringCount;
+        uint32_t appCount;
+    };
+
+    static_assert(sizeof(Header) == 48);
+    static_assert(sizeof(wchar_t) == sizeof(uint16_t));
+
+    // FNV-1a, the json file is small next to the cost of parsing it
+    uint64_t HashContent(const std::byte* data, size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ static_cast<uint64_t>(data[i])) * 0x100000001b3;
+        }
+
+        return hash;
+    }
+
+    class Writer
+    {
+    public:
+        template<typename T>
+        void Write(const T& value)
+        {
+            const auto offset = m_data.size();
+            m_data.resize(offset + sizeof(T));
+            memcpy(m_data.data() + offset, &value, sizeof(T));
+        }
+
+        void WriteString(const std::wstring& value)
+        {
+            Write(static_cast<uint32_t>(value.size()));
+            const auto offset = m_data.size();
+            m_data.resize(offset + value.size() * sizeof(wchar_t));
+            memcpy(m_data.data() + offset, value.data(), value.size() * sizeof(wchar_t));
+        }
+
+        std::vector<std::byte>& Data() { return m_data; }
+
+    private:
+        std::vector<std::byte> m_data;
+    };
+
+    // Every read is checked against the end of the data, a damaged snapshot fails to load
+    class Reader
+    {
+    public:
+        Reader(const std::byte* data, size_t size) :
+            m_data(data), m_size(size)
+        {
+        }
+
+        template<typename T>
+        bool Read(T& value)
+        {
+            if (m_size - m_pos < sizeof(T))
+            {
+                return false;
+            }
+
+            memcpy(&value, m_data + m_pos, sizeof(T));
+            m_pos += sizeof(T);
+            return true;
+        }
+
+        bool ReadString(std::wstring& value)
+        {
+            uint32_t length;
+            if (!Read(length) || (m_size - m_pos) / sizeof(wchar_t) < length)
+            {
+                return false;
+            }
+
+            value.resize(length);
+            memcpy(value.data(), m_data + m_pos, length * sizeof(wchar_t));
+            m_pos += length * sizeof(wchar_t);
+            return true;
+        }
+
+        // Upper bound for a count read from the data, so a damaged count can't make us reserve
+        // more items than the remaining data could hold
+        bool CanHold(uint32_t count, size_t itemSize) const { return (m_size - m_pos) / itemSize >= count; }
+
+        bool AtEnd() const { return m_pos == m_size; }
+
+    private:
+        const std::byte* m_data;
+        size_t m_size;
+        size_t m_pos = 0;
+    };
+
+    class StringTable
+    {
+    public:
+        uint32_t Add(const std::wstring& value)
+        {
+            auto [it, inserted] = m_indexes.try_emplace(value, static_cast<uint32_t>(m_strings.size()));
+            if (inserted)
+            {
+                m_strings.push_back(&it->first);
+            }
+
+            return it->second;
+        }
+
+        const std::vector<const std::wstring*>& Strings() const { return m_strings; }
+
+    private:
+        std::unordered_map<std::wstring, uint32_t> m_indexes;
+        std::vector<const std::wstring*> m_strings;
+    };
+}
+
+namespace AppZoneHistorySnapshot
+{
+    std::optional<JsonFileStamp> GetJsonFileStamp(const std::wstring& jsonFileName)
+    {
+        wil::unique_hfile file{ CreateFileW(jsonFileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+        BY_HANDLE_FILE_INFORMATION information;
+        if (!file || !GetFileInformationByHandle(file.get(), &information))
+        {
+            return std::nullopt;
+        }
+
+        JsonFileStamp stamp;
+        stamp.lastWriteTime = (static_cast<uint64_t>(information.ftLastWriteTime.dwHighDateTime) << 32) | information.ftLastWriteTime.dwLowDateTime;
+        stamp.size = (static_cast<uint64_t>(information.nFileSizeHigh) << 32) | information.nFileSizeLow;
+        if (stamp.size == 0)
+        {
+            stamp.contentHash = HashContent(nullptr, 0);
+            return stamp;
+        }
+
+        wil::unique_handle mapping{ CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+        if (!mapping)
+        {
+            return std::nullopt;
+        }
+
+        wil::unique_mapview_ptr<std::byte> view{ static_cast<std::byte*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)) };
+        if (!view)
+        {
+            return std::nullopt;
+        }
+
+        stamp.contentHash = HashContent(view.get(), static_cast<size_t>(stamp.size));
+        return stamp;
+    }
+
+    std::vector<std::byte> Serialize(const JSONHelpers::TAppZoneHistoryMap& appZoneHistoryMap)
+    {
+        StringTable strings;
+        Writer apps;
+        for (const auto& [appPath, history] : appZoneHistoryMap)
+        {
+            apps.Write(strings.Add(appPath));
+            apps.Write(static_cast<uint32_t>(history.size()));
+            for (const auto& data : history)
+            {
+                apps.Write(strings.Add(data.zoneSetUuid));
+                apps.Write(strings.Add(data.deviceId));
+                apps.Write(static_cast<uint32_t>(data.zoneIndexSet.size()));
+                for (size_t index : data.zoneIndexSet)
+                {
+                    apps.Write(static_cast<uint64_t>(index));
+                }
+            }
+        }
+
+        Writer snapshot;
+        snapshot.Write(Header{});
+        for (const std::wstring* value : strings.Strings())
+        {
+            snapshot.WriteString(*value);
+        }
+
+        auto& result = snapshot.Data();
+        result.insert(result.end(), apps.Data().begin(), apps.Data().end());
+
+        Header header{};
+        header.magic = Magic;
+        header.version = Version;
+        header.payloadSize = result.size() - sizeof(Header);
+        header.stringCount = static_cast<uint32_t>(strings.Strings().size());
+        header.appCount = static_cast<uint32_t>(appZoneHistoryMap.size());
+        memcpy(result.data(), &header, sizeof(Header));
+
+        return std::move(result);
+    }
+
+    std::optional<JSONHelpers::TAppZoneHistoryMap> Deserialize(const std::byte* data, size_t size, const JsonFileStamp& jsonFileStamp)
+    {
+        Reader reader(data, size);
+
+        Header header;
+        if (!reader.Read(header) ||
+            header.magic != Magic ||
+            header.version != Version ||
+            header.payloadSize != size - sizeof(Header) ||
+            JsonFileStamp{ header.jsonLastWriteTime, header.jsonSize, header.jsonContentHash } != jsonFileStamp ||
+            !reader.CanHold(header.stringCount, sizeof(uint32_t)))
+        {
+            return std::nullopt;
+        }
+
+        std::vector<std::wstring> strings(header.stringCount);
+        for (auto& value : strings)
+        {
+            if (!reader.ReadString(value))
+            {
+                return std::nullopt;
+            }
+        }
+
+        auto readString = [&](std::wstring& value) {
+            uint32_t index;
+            if (!reader.Read(index) || index >= strings.size())
+            {
+                return false;
+            }
+
+            value = strings[index];
+            return true;
+        };
+
+        JSONHelpers::TAppZoneHistoryMap result;
+        result.reserve(header.appCount);
+        for (uint32_t app = 0; app < header.appCount; app++)
+        {
+            std::wstring appPath;
+            uint32_t historyCount;
+            if (!readString(appPath) || !reader.Read(historyCount) || !reader.CanHold(historyCount, 3 * sizeof(uint32_t)))
+            {
+                return std::nullopt;
+            }
+
+            std::vector<FancyZonesDataTypes::AppZoneHistoryData> history(historyCount);
+            for (auto& entry : history)
+            {
+                uint32_t indexCount;
+                if (!readString(entry.zoneSetUuid) || !readString(entry.deviceId) || !reader.Read(indexCount) || !reader.CanHold(indexCount, sizeof(uint64_t)))
+                {
+                    return std::nullopt;
+                }
+
+                entry.zoneIndexSet.resize(indexCount);
+                for (size_t& index : entry.zoneIndexSet)
+                {
+                    uint64_t value;
+                    reader.Read(value);
+                    index = static_cast<size_t>(value);
+                }
+            }
+
+            result[std::move(appPath)] = std::move(history);
+        }
+
+        if (!reader.AtEnd())
+        {
+            return std::nullopt;
+        }
+
+        return result;
+    }
+
+    bool Save(const std::wstring& snapshotFileName, const std::wstring& jsonFileName, std::vector<std::byte> snapshot)
+    {
+        const auto stamp = GetJsonFileStamp(jsonFileName);
+        if (!stamp || snapshot.size() < sizeof(Header))
+        {
+            return false;
+        }
+
+        Header header;
+        memcpy(&header, snapshot.data(), sizeof(Header));
+        header.jsonLastWriteTime = stamp->lastWriteTime;
+        header.jsonSize = stamp->size;
+        header.jsonContentHash = stamp->contentHash;
+        memcpy(snapshot.data(), &header, sizeof(Header));
+
+        // Written next to the target and swapped in, so a reader never maps a partial snapshot
+        const std::wstring tempFileName = snapshotFileName + L".tmp";
+        {
+            wil::unique_hfile file{ CreateFileW(tempFileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr) };
+            DWORD written = 0;
+            if (!file || !WriteFile(file.get(), snapshot.data(), static_cast<DWORD>(snapshot.size()), &written, nullptr) || written != snapshot.size())
+            {
+                Logger::error(L"Failed to write {}: {}", tempFileName, get_last_error_or_default(GetLastError()));
+                file.reset();
+                DeleteFileW(tempFileName.c_str());
+                return false;
+            }
+        }
+
+        if (!MoveFileExW(tempFileName.c_str(), snapshotFileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        {
+            Logger::error(L"Failed to replace {}: {}", snapshotFileName, get_last_error_or_default(GetLastError()));
+            DeleteFileW(tempFileName.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    std::optional<JSONHelpers::TAppZoneHistoryMap> Load(const std::wstring& snapshotFileName, const std::wstring& jsonFileName)
+    {
+        const auto stamp = GetJsonFileStamp(jsonFileName);
+        if (!stamp)
+        {
+            return std::nullopt;
+        }
+
+        wil::unique_hfile file{ CreateFileW(snapshotFileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+        LARGE_INTEGER size;
+        if (!file || !GetFileSizeEx(file.get(), &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(Header)))
+        {
+            return std::nullopt;
+        }
+
+        wil::unique_handle mapping{ CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+        if (!mapping)
+        {
+            return std::nullopt;
+        }
+
+        wil::unique_mapview_ptr<std::byte> view{ static_cast<std::byte*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)) };
+        if (!view)
+        {
+            return std::nullopt;
+        }
+
+        return Deserialize(view.get(), static_cast<size_t>(size.QuadPart), *stamp);
+    }
+}
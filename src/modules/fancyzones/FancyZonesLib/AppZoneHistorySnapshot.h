@@ -0,0 +1,36 @@
+#pragma once
+
+#include "JsonHelpers.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Binary snapshot of app-zone-history.json. The json file remains the source of truth, the
+// snapshot only spares parsing it through WinRT when FancyZones starts. Each snapshot records the
+// json file it was made from, including a hash of its content so a change that keeps the write
+// time and size is noticed too, and is ignored once that file changes.
+namespace AppZoneHistorySnapshot
+{
+    struct JsonFileStamp
+    {
+        uint64_t lastWriteTime = 0;
+        uint64_t size = 0;
+        uint64_t contentHash = 0;
+
+        bool operator==(const JsonFileStamp&) const = default;
+    };
+
+    std::optional<JsonFileStamp> GetJsonFileStamp(const std::wstring& jsonFileName);
+
+    // The stamp of the json file is left empty and filled in by Save, after the json file is written
+    std::vector<std::byte> Serialize(const JSONHelpers::TAppZoneHistoryMap& appZoneHistoryMap);
+    std::optional<JSONHelpers::TAppZoneHistoryMap> Deserialize(const std::byte* data, size_t size, const JsonFileStamp& jsonFileStamp);
+
+    bool Save(const std::wstring& snapshotFileName, const std::wstring& jsonFileName, std::vector<std::byte> snapshot);
+
+    // Returns nullopt if the snapshot is missing, damaged or was not made from the current json file
+    std::optional<JSONHelpers::TAppZoneHistoryMap> Load(const std::wstring& snapshotFileName, const std::wstring& jsonFileName);
+}
@@ -1,21 +1,38 @@
 #include "pch.h"
 #include "CallTracer.h"
-#include <thread>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <vector>
 
 namespace
 {
     // Non-localizable
-    const std::string entering = " Enter";
-    const std::string exiting = " Exit";
+    const char entering[] = " Enter";
+    const char exiting[] = " Exit";
+
+    // Recording stops once the profile holds that many scopes
+    constexpr size_t MaxProfiledScopes = 1 << 16;
 
-    std::mutex indentLevelMutex;
-    std::map<std::thread::id, int> indentLevel;
+    thread_local int indentLevel = 0;
 
-    std::string GetIndentation()
+    struct ProfiledScope
     {
-        std::unique_lock lock(indentLevelMutex);
-        int level = indentLevel[std::this_thread::get_id()];
+        const char* functionName;
+        DWORD threadId;
+        std::chrono::steady_clock::time_point enterTime;
+        std::chrono::steady_clock::time_point exitTime;
+    };
+
+    std::atomic<bool> profiling = false;
+    std::mutex profileMutex;
+    std::vector<ProfiledScope> profile;
+    std::chrono::steady_clock::time_point profileStart;
 
+    std::string GetIndentation(int level)
+    {
         if (level <= 0)
         {
             return {};
@@ -26,28 +43,110 @@ namespace
         }
     }
 
-    void Indent()
+    void WriteJsonString(std::ofstream& stream, const char* value)
     {
-        std::unique_lock lock(indentLevelMutex);
-        indentLevel[std::this_thread::get_id()]++;
-    }
-
-    void Unindent()
-    {
-        std::unique_lock lock(indentLevelMutex);
-        indentLevel[std::this_thread::get_id()]--;
+        stream << '"';
+        for (const char* c = value; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                stream << '\\';
+            }
+            stream << *c;
+        }
+        stream << '"';
     }
 }
 
 CallTracer::CallTracer(const char* functionName) :
     functionName(functionName)
 {
-    Logger::trace((GetIndentation() + functionName + entering).c_str());
-    Indent();
+    logged = Logger::should_log(spdlog::level::trace);
+    profiled = profiling.load(std::memory_order_relaxed);
+    if (!logged && !profiled)
+    {
+        return;
+    }
+
+    if (logged)
+    {
+        Logger::trace("{}{}{}", GetIndentation(indentLevel), functionName, entering);
+    }
+    indentLevel++;
+
+    if (profiled)
+    {
+        enterTime = std::chrono::steady_clock::now();
+    }
 }
 
 CallTracer::~CallTracer()
 {
-    Unindent();
-    Logger::trace((GetIndentation() + functionName + exiting).c_str());
+    if (!logged && !profiled)
+    {
+        return;
+    }
+
+    if (profiled)
+    {
+        const auto exitTime = std::chrono::steady_clock::now();
+        std::scoped_lock lock{ profileMutex };
+        if (profiling && profile.size() < MaxProfiledScopes)
+        {
+            profile.push_back({ functionName, GetCurrentThreadId(), enterTime, exitTime });
+        }
+    }
+
+    indentLevel--;
+    if (logged)
+    {
+        Logger::trace("{}{}{}", GetIndentation(indentLevel), functionName, exiting);
+    }
+}
+
+void CallTracer::StartProfiling()
+{
+    std::scoped_lock lock{ profileMutex };
+    profile.clear();
+    profileStart = std::chrono::steady_clock::now();
+    profiling = true;
+}
+
+bool CallTracer::StopProfiling(const std::wstring& fileName)
+{
+    std::vector<ProfiledScope> scopes;
+    std::chrono::steady_clock::time_point start;
+    {
+        std::scoped_lock lock{ profileMutex };
+        profiling = false;
+        scopes.swap(profile);
+        start = profileStart;
+    }
+
+    std::ofstream stream(std::filesystem::path(fileName), std::ios::binary);
+    if (!stream)
+    {
+        Logger::error(L"Failed to write the call profile to {}", fileName);
+        return false;
+    }
+
+    // Complete events of the Trace Event Format, times in microseconds
+    auto microseconds = [](std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    };
+
+    const DWORD processId = GetCurrentProcessId();
+    stream << "{\"traceEvents\":[";
+    for (size_t i = 0; i < scopes.size(); i++)
+    {
+        const auto& scope = scopes[i];
+        stream << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        WriteJsonString(stream, scope.functionName);
+        stream << ",\"ph\":\"X\",\"ts\":" << microseconds(scope.enterTime - start)
+               << ",\"dur\":" << microseconds(scope.exitTime - scope.enterTime)
+               << ",\"pid\":" << processId << ",\"tid\":" << scope.threadId << "}";
+    }
+    stream << "\n]}\n";
+
+    return static_cast<bool>(stream);
 }
@@ -2,12 +2,35 @@
 
 #include "common/logger/logger.h"
 
+#include <chrono>
+#include <string>
+
+// Define DISABLE_CALL_TRACER to compile the tracing out
+#if defined(DISABLE_CALL_TRACER)
+#define _TRACER_
+#else
 #define _TRACER_ CallTracer callTracer(__FUNCTION__)
+#endif
 
+// Logs entering and leaving a scope at trace level, indented by the call depth of the thread. When
+// neither trace logging nor profiling is enabled, a traced scope only costs that check.
 class CallTracer
 {
-    std::string functionName;
+    // Points to __FUNCTION__, which is never freed
+    const char* functionName;
+    bool logged = false;
+    bool profiled = false;
+    std::chrono::steady_clock::time_point enterTime;
+
 public:
     CallTracer(const char* functionName);
     ~CallTracer();
+
+    CallTracer(const CallTracer&) = delete;
+    CallTracer& operator=(const CallTracer&) = delete;
+
+    // Record the enter and exit time of the traced scopes, on all threads
+    static void StartProfiling();
+    // Stop recording and save the recorded scopes as a Chrome trace (chrome://tracing, Perfetto)
+    static bool StopProfiling(const std::wstring& fileName);
 };
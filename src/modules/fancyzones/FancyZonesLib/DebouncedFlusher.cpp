@@ -0,0 +1,120 @@
+#include "pch.h"
+
+#include "DebouncedFlusher.h"
+#include "CallTracer.h"
+
+#include <utility>
+
+DebouncedFlusher::DebouncedFlusher(std::function<void()> flush, std::chrono::milliseconds delay, std::chrono::milliseconds maxDelay) :
+    m_flush(std::move(flush)), m_delay(delay), m_maxDelay(maxDelay)
+{
+}
+
+DebouncedFlusher::~DebouncedFlusher()
+{
+    stop();
+}
+
+void DebouncedFlusher::Schedule()
+{
+    std::lock_guard lock{ m_mutex };
+    if (m_stopped)
+    {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!m_pending)
+    {
+        m_pending = true;
+        m_firstChange = now;
+    }
+    m_lastChange = now;
+
+    // The thread is started lazily, so an idle or stopped flusher costs no thread
+    if (!m_thread.joinable())
+    {
+        m_shutdown = false;
+        m_thread = std::thread{ [this] { worker_thread(); } };
+    }
+    m_cv.notify_one();
+}
+
+void DebouncedFlusher::Flush()
+{
+    stop();
+
+    bool pending;
+    {
+        std::lock_guard lock{ m_mutex };
+        pending = std::exchange(m_pending, false);
+    }
+
+    if (pending)
+    {
+        m_flush();
+    }
+}
+
+void DebouncedFlusher::Stop()
+{
+    {
+        std::lock_guard lock{ m_mutex };
+        m_stopped = true;
+    }
+
+    Flush();
+}
+
+bool DebouncedFlusher::IsPending() const
+{
+    std::lock_guard lock{ m_mutex };
+    return m_pending;
+}
+
+void DebouncedFlusher::worker_thread()
+{
+    std::unique_lock lock{ m_mutex };
+    while (true)
+    {
+        m_cv.wait(lock, [this] { return m_pending || m_shutdown; });
+
+        // Wait until no change arrived for the delay, or the first change is due
+        auto due = [this] { return (std::min)(m_lastChange + m_delay, m_firstChange + m_maxDelay); };
+        while (!m_shutdown && m_pending && std::chrono::steady_clock::now() < due())
+        {
+            m_cv.wait_until(lock, due());
+        }
+
+        if (m_shutdown)
+        {
+            return;
+        }
+
+        if (std::exchange(m_pending, false))
+        {
+            lock.unlock();
+            {
+                CallTracer callTracer(__FUNCTION__ "(flush)");
+                m_flush();
+            }
+            lock.lock();
+        }
+    }
+}
+
+void DebouncedFlusher::stop()
+{
+    std::thread thread;
+    {
+        std::lock_guard lock{ m_mutex };
+        m_shutdown = true;
+        thread = std::move(m_thread);
+    }
+    m_cv.notify_one();
+
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
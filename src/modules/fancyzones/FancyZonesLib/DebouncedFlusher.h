@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// DebouncedFlusher runs a flush callback on a background thread once scheduled changes have
+// settled for a short delay, so a burst of changes results in a single flush. Changes which keep
+// postponing the flush are flushed after the maximum delay at the latest.
+
+class DebouncedFlusher final
+{
+public:
+    DebouncedFlusher(std::function<void()> flush, std::chrono::milliseconds delay, std::chrono::milliseconds maxDelay);
+
+    // Stops the background thread without flushing, call Stop first to keep pending changes
+    ~DebouncedFlusher();
+
+    // Request a flush. Never waits for the flush itself, and does nothing once stopped.
+    void Schedule();
+
+    // Run a pending flush on the calling thread and stop the background thread until the next
+    // Schedule call.
+    void Flush();
+
+    // Run a pending flush on the calling thread and stop the background thread for good. Owners
+    // with static lifetime call it on shutdown, so the thread isn't joined during static
+    // destruction, under the loader lock.
+    void Stop();
+
+    bool IsPending() const;
+
+private:
+    void worker_thread();
+    void stop();
+
+    const std::function<void()> m_flush;
+    const std::chrono::milliseconds m_delay;
+    const std::chrono::milliseconds m_maxDelay;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_pending = false;
+    bool m_shutdown = false;
+    bool m_stopped = false;
+    std::chrono::steady_clock::time_point m_firstChange;
+    std::chrono::steady_clock::time_point m_lastChange;
+    std::thread m_thread;
+};
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "DragEventPipeline.h"
+
+namespace
+{
+    // Used when DWM doesn't report the refresh rate
+    constexpr auto DefaultRefreshInterval = std::chrono::microseconds(16667);
+}
+
+void DragEventPipeline::Start(HWND window, Clock::duration minUpdateInterval, bool followCursor) noexcept
+{
+    m_followCursor = followCursor;
+    m_window = window;
+    m_pending = false;
+    m_minUpdateInterval = minUpdateInterval;
+    m_lastUpdate = {};
+
+    m_received = 0;
+    m_dropped = 0;
+    m_processed = 0;
+}
+
+DragEventPipeline::Counters DragEventPipeline::Stop() noexcept
+{
+    m_window = nullptr;
+    m_pending = false;
+    return GetCounters();
+}
+
+bool DragEventPipeline::Push(HWND window, LONG idObject) noexcept
+{
+    m_received++;
+
+    // The cursor moves the outline of the window, the window itself stays in place
+    if (idObject == OBJID_CURSOR && m_followCursor && m_window != nullptr)
+    {
+        return Request();
+    }
+
+    // Location changes of other windows, or of objects inside the dragged window
+    if (window == nullptr || window != m_window || idObject != OBJID_WINDOW)
+    {
+        m_dropped++;
+        return false;
+    }
+
+    return Request();
+}
+
+bool DragEventPipeline::Request() noexcept
+{
+    // An update is pending already, it'll use the latest cursor position
+    if (m_pending)
+    {
+        m_dropped++;
+        return false;
+    }
+
+    m_pending = true;
+    return true;
+}
+
+DragEventPipeline::Clock::duration DragEventPipeline::TimeUntilUpdate(Clock::time_point now) const noexcept
+{
+    const auto nextUpdate = m_lastUpdate + m_minUpdateInterval;
+    return nextUpdate > now ? nextUpdate - now : Clock::duration::zero();
+}
+
+void DragEventPipeline::Updated(Clock::time_point now) noexcept
+{
+    m_lastUpdate = now;
+    m_processed++;
+    m_pending = false;
+}
+
+void DragEventPipeline::Discarded() noexcept
+{
+    m_pending = false;
+}
+
+DragEventPipeline::Counters DragEventPipeline::GetCounters() const noexcept
+{
+    return Counters{ .received = m_received, .dropped = m_dropped, .processed = m_processed };
+}
+
+DragEventPipeline::Clock::duration DragEventPipeline::DisplayRefreshInterval() noexcept
+{
+    DWM_TIMING_INFO timingInfo{};
+    timingInfo.cbSize = sizeof(timingInfo);
+    if (FAILED(DwmGetCompositionTimingInfo(nullptr, &timingInfo)) || timingInfo.rateRefresh.uiNumerator == 0)
+    {
+        return DefaultRefreshInterval;
+    }
+
+    // uiNumerator / uiDenominator frames per second
+    const auto interval = std::chrono::duration<double>(static_cast<double>(timingInfo.rateRefresh.uiDenominator) / timingInfo.rateRefresh.uiNumerator);
+    return std::chrono::duration_cast<Clock::duration>(interval);
+}
+
+bool DragEventPipeline::DragShowsOutline() noexcept
+{
+    BOOL dragFullWindows = TRUE;
+    return SystemParametersInfoW(SPI_GETDRAGFULLWINDOWS, 0, &dragFullWindows, 0) && !dragFullWindows;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// While a window is dragged, EVENT_OBJECT_LOCATIONCHANGE is raised for every object which moves,
+// carets and tooltips included, and as often as the mouse reports. DragEventPipeline keeps only the
+// events of the dragged window and coalesces them: a single zone update is pending at a time and
+// it uses the cursor position from when it runs, so the latest position wins. Updates are at
+// least one display refresh apart. When the window contents aren't shown while dragging only an
+// outline moves, so the cursor location changes are followed instead. The events, the keyboard hook
+// and the updates are all handled on the FancyZones thread, so the pipeline isn't synchronized.
+class DragEventPipeline
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Counters
+    {
+        uint64_t received = 0;
+        uint64_t dropped = 0;
+        uint64_t processed = 0;
+    };
+
+    // A window started moving, only its location changes, or the cursor ones, are kept from now on
+    void Start(HWND window, Clock::duration minUpdateInterval, bool followCursor) noexcept;
+    // The window stopped moving, returns the counters of the drag
+    Counters Stop() noexcept;
+
+    // Returns whether an update must be scheduled for the event, false if it's dropped
+    bool Push(HWND window, LONG idObject) noexcept;
+    // Same as Push, for an update which doesn't come from a location change, ex: a key was pressed
+    bool Request() noexcept;
+
+    // Time left before the pending update can run, zero if it can run now
+    Clock::duration TimeUntilUpdate(Clock::time_point now) const noexcept;
+    // The pending update ran, the next event schedules a new one
+    void Updated(Clock::time_point now) noexcept;
+    // The pending update didn't run as no window is moving, the next event schedules a new one
+    void Discarded() noexcept;
+
+    Counters GetCounters() const noexcept;
+
+    // Interval between two frames of the display, as reported by DWM
+    static Clock::duration DisplayRefreshInterval() noexcept;
+    // Whether "Show window contents while dragging" is off, the dragged window doesn't move then
+    static bool DragShowsOutline() noexcept;
+
+private:
+    HWND m_window = nullptr;
+    bool m_followCursor = false;
+    bool m_pending = false;
+    Clock::duration m_minUpdateInterval{};
+    Clock::time_point m_lastUpdate{};
+
+    uint64_t m_received = 0;
+    uint64_t m_dropped = 0;
+    uint64_t m_processed = 0;
+};
@@ -14,7 +14,10 @@
 #include "FancyZonesLib/ZoneWindow.h"
 #include "FancyZonesLib/FancyZonesData.h"
 #include "FancyZonesLib/ZoneSet.h"
+#include "FancyZonesLib/DragEventPipeline.h"
+#include "FancyZonesLib/ZoneNavigationGraph.h"
 #include "FancyZonesLib/WindowMoveHandler.h"
+#include "FancyZonesLib/WindowRelayout.h"
 #include "FancyZonesLib/FancyZonesWinHookEventIDs.h"
 #include "FancyZonesLib/util.h"
 #include "on_thread_executor.h"
@@ -71,6 +74,12 @@ namespace NonLocalizable
     const wchar_t SplashClassName[] = L"MsoSplash";
 }
 
+namespace
+{
+    // Fires when the zones can be updated again after the last update of a drag
+    constexpr UINT_PTR DragUpdateTimerId = 1;
+}
+
 struct FancyZones : public winrt::implements<FancyZones, IFancyZones, IFancyZonesCallback, IZoneWindowHost>
 {
 public:
@@ -78,7 +87,10 @@ public:
         m_hinstance(hinstance),
         m_settings(settings),
         m_windowMoveHandler(settings, [this]() {
-            PostMessageW(m_window, WM_PRIV_LOCATIONCHANGE, NULL, NULL);
+            if (m_dragEvents.Request())
+            {
+                PostMessageW(m_window, WM_PRIV_LOCATIONCHANGE, NULL, NULL);
+            }
         }),
         m_zonesSettingsFileWatcher(FancyZonesDataInstance().GetZonesSettingsFileName(), [this]() {
             PostMessageW(m_window, WM_PRIV_FILE_UPDATE, NULL, NULL);
@@ -118,11 +130,24 @@ public:
         m_windowMoveHandler.MoveSizeUpdate(monitor, ptScreen, m_workAreaHandler.GetWorkAreasByDesktopId(m_currentDesktopId));
     }
 
+    void OnDragUpdate(POINT const& ptScreen) noexcept
+    {
+        m_dragEvents.Updated(DragEventPipeline::Clock::now());
+        if (auto monitor = MonitorFromPoint(ptScreen, MONITOR_DEFAULTTONULL))
+        {
+            MoveSizeUpdate(monitor, ptScreen);
+        }
+    }
+
     void MoveSizeEnd(HWND window, POINT const& ptScreen) noexcept
     {
         _TRACER_;
         std::unique_lock writeLock(m_lock);
         m_windowMoveHandler.MoveSizeEnd(window, ptScreen, m_workAreaHandler.GetWorkAreasByDesktopId(m_currentDesktopId));
+
+        KillTimer(m_window, DragUpdateTimerId);
+        const auto counters = m_dragEvents.Stop();
+        Logger::trace(L"Drag events: {} received, {} dropped, {} processed", counters.received, counters.dropped, counters.processed);
     }
 
     IFACEMETHODIMP_(void)
@@ -134,13 +159,18 @@ public:
         switch (data->event)
         {
         case EVENT_SYSTEM_MOVESIZESTART:
+            // Filter the location changes from the first one, the start message is handled later
+            m_dragEvents.Start(data->hwnd, DragEventPipeline::DisplayRefreshInterval(), DragEventPipeline::DragShowsOutline());
             PostMessageW(m_window, WM_PRIV_MOVESIZESTART, wparam, lparam);
             break;
         case EVENT_SYSTEM_MOVESIZEEND:
             PostMessageW(m_window, WM_PRIV_MOVESIZEEND, wparam, lparam);
             break;
         case EVENT_OBJECT_LOCATIONCHANGE:
-            PostMessageW(m_window, WM_PRIV_LOCATIONCHANGE, wparam, lparam);
+            if (m_dragEvents.Push(data->hwnd, data->idObject))
+            {
+                PostMessageW(m_window, WM_PRIV_LOCATIONCHANGE, wparam, lparam);
+            }
             break;
         case EVENT_OBJECT_NAMECHANGE:
             PostMessageW(m_window, WM_PRIV_NAMECHANGE, wparam, lparam);
@@ -251,6 +281,7 @@ private:
 
     mutable std::shared_mutex m_lock;
     HWND m_window{};
+    DragEventPipeline m_dragEvents;
     WindowMoveHandler m_windowMoveHandler;
     MonitorWorkAreaHandler m_workAreaHandler;
 
@@ -361,6 +392,8 @@ FancyZones::Destroy() noexcept
     }
 
     m_settings->ResetCallback();
+
+    FancyZonesDataInstance().StopSaving();
 }
 
 // IFancyZonesCallback
@@ -385,7 +418,7 @@ bool FancyZones::ShouldProcessNewWindow(HWND window) noexcept
     // Avoid processing splash screens, already stamped (zoned) windows, or those windows
     // that belong to excluded applications list.
     if (IsSplashScreen(window) ||
-        (reinterpret_cast<size_t>(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneID)) != 0) ||
+        IsZoneIndexSetStamped(window) ||
         !IsCandidateForLastKnownZone(window, m_settings->GetSettings()->excludedAppsArray))
     {
         return false;
@@ -748,6 +781,7 @@ void FancyZones::ToggleEditor() noexcept
     params += monitorsDataStr;
 
     FancyZonesDataInstance().SaveFancyZonesEditorParameters(spanZonesAcrossMonitors, virtualDesktopId.get(), targetMonitor, allMonitors); /* Write parameters to json file */
+    FancyZonesDataInstance().FlushPendingSaves(); /* The editor reads the zone settings on start */
 
     if (showDpiWarning)
     {
@@ -840,6 +874,25 @@ LRESULT FancyZones::WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lpa
     }
     break;
 
+    case WM_TIMER:
+    {
+        if (wparam == DragUpdateTimerId)
+        {
+            KillTimer(window, DragUpdateTimerId);
+            if (InMoveSize())
+            {
+                POINT ptScreen;
+                GetPhysicalCursorPos(&ptScreen);
+                OnDragUpdate(ptScreen);
+            }
+            else
+            {
+                m_dragEvents.Discarded();
+            }
+        }
+    }
+    break;
+
     case WM_SETTINGCHANGE:
     {
         if (wparam == SPI_SETWORKAREA)
@@ -918,10 +971,25 @@ LRESULT FancyZones::WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lpa
         }
         else if (message == WM_PRIV_LOCATIONCHANGE && InMoveSize())
         {
-            if (auto monitor = MonitorFromPoint(ptScreen, MONITOR_DEFAULTTONULL))
+            // Updates are a display refresh apart, the events coming meanwhile are coalesced.
+            // WM_TIMER only comes on a system timer tick, 15.6 ms by default, so the deferred
+            // update runs up to a tick after the wait: at worst about two refreshes apart at
+            // 60 Hz.
+            const auto wait = m_dragEvents.TimeUntilUpdate(DragEventPipeline::Clock::now());
+            if (wait > DragEventPipeline::Clock::duration::zero())
             {
-                MoveSizeUpdate(monitor, ptScreen);
+                const auto waitMillis = std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+                SetTimer(window, DragUpdateTimerId, static_cast<UINT>(waitMillis), nullptr);
             }
+            else
+            {
+                OnDragUpdate(ptScreen);
+            }
+        }
+        else if (message == WM_PRIV_LOCATIONCHANGE)
+        {
+            // The drag ended before the update ran
+            m_dragEvents.Discarded();
         }
         else if (message == WM_PRIV_WINDOWCREATED)
         {
@@ -970,6 +1038,9 @@ void FancyZones::OnDisplayChange(DisplayChangeType changeType, require_write_loc
         }
         if (changeType == DisplayChangeType::Initialization)
         {
+            // Windows zoned before FancyZones started are moved with the others on display changes
+            FancyZonesUtils::RegisterStampedWindows();
+
             std::vector<std::wstring> ids{};
             if (VirtualDesktopUtils::GetVirtualDesktopIds(ids) && !ids.empty())
             {
@@ -1077,30 +1148,54 @@ void FancyZones::UpdateZoneWindows(require_write_lock lock) noexcept
 
 void FancyZones::UpdateWindowsPositions(require_write_lock) noexcept
 {
-    auto callback = [](HWND window, LPARAM data) -> BOOL {
-        size_t bitmask = reinterpret_cast<size_t>(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneID));
+    _TRACER_;
+    // Zones of each work area, and the work area of each window, looked up once per relayout
+    std::unordered_map<IZoneWindow*, WindowRelayout::WorkAreaZones> workAreaZones;
+    std::unordered_map<HWND, winrt::com_ptr<IZoneWindow>> windowWorkAreas;
+    const bool spanZonesAcrossMonitors = m_settings->GetSettings()->spanZonesAcrossMonitors;
+
+    const HWND movedWindow = m_windowMoveHandler.MovedWindow();
+
+    auto getWorkArea = [&](HWND window) -> const WindowRelayout::WorkAreaZones* {
+        if (window == movedWindow)
+        {
+            return nullptr;
+        }
+
+        auto zoneWindow = m_workAreaHandler.GetWorkArea(window);
+        if (!zoneWindow)
+        {
+            return nullptr;
+        }
+
+        auto it = workAreaZones.find(zoneWindow.get());
+        if (it == workAreaZones.end())
+        {
+            HMONITOR monitor = spanZonesAcrossMonitors ? nullptr : MonitorFromWindow(window, MONITOR_DEFAULTTONULL);
+            it = workAreaZones.emplace(zoneWindow.get(), WindowRelayout::WorkAreaZones{ monitor, zoneWindow->GetScreenZones() }).first;
+        }
+
+        windowWorkAreas[window] = zoneWindow;
+        return &it->second;
+    };
 
-        if (bitmask != 0)
+    WindowRelayout::DesktopBackend backend;
+    const auto plan = WindowRelayout::PlanRelayout(backend, FancyZonesUtils::GetStampedWindows(), getWorkArea);
+    WindowRelayout::ApplyPlan(backend, plan);
+
+    for (const auto& batch : plan)
+    {
+        for (const auto* moves : { &batch.deferredMoves, &batch.placements, &batch.unchanged })
         {
-            std::vector<size_t> indexSet;
-            for (int i = 0; i < std::numeric_limits<size_t>::digits; i++)
+            for (const auto& move : *moves)
             {
-                if ((1ull << i) & bitmask)
+                if (auto zoneSet = windowWorkAreas[move.window]->ActiveZoneSet())
                 {
-                    indexSet.push_back(i);
+                    zoneSet->AssignWindowToZones(move.window, move.zoneIds);
                 }
             }
-
-            auto strongThis = reinterpret_cast<FancyZones*>(data);
-            auto zoneWindow = strongThis->m_workAreaHandler.GetWorkArea(window);
-            if (zoneWindow)
-            {
-                strongThis->m_windowMoveHandler.MoveWindowIntoZoneByIndexSet(window, indexSet, zoneWindow);
-            }
         }
-        return TRUE;
-    };
-    EnumWindows(callback, reinterpret_cast<LPARAM>(this));
+    }
 }
 
 bool FancyZones::OnSnapHotkeyBasedOnZoneNumber(HWND window, DWORD vkCode) noexcept
@@ -1179,8 +1274,8 @@ bool FancyZones::OnSnapHotkeyBasedOnPosition(HWND window, DWORD vkCode) noexcept
         }
 
         // If that didn't work, extract zones from all other monitors and target one of them
-        std::vector<RECT> zoneRects;
-        std::vector<std::pair<size_t, winrt::com_ptr<IZoneWindow>>> zoneRectsInfo;
+        std::vector<ZoneNavigationGraph::Node> zoneNodes;
+        std::vector<winrt::com_ptr<IZoneWindow>> zoneNodesWorkArea;
         RECT currentMonitorRect{ .top = 0, .bottom = -1 };
 
         for (const auto& [monitor, monitorRect] : allMonitors)
@@ -1197,18 +1292,13 @@ bool FancyZones::OnSnapHotkeyBasedOnPosition(HWND window, DWORD vkCode) noexcept
                     auto zoneSet = workArea->ActiveZoneSet();
                     if (zoneSet)
                     {
-                        const auto zones = zoneSet->GetZones();
-                        for (const auto& [zoneId, zone] : zones)
+                        for (auto node : zoneSet->GetNavigationGraph().Nodes())
                         {
-                            RECT zoneRect = zone->GetZoneRect();
-
-                            zoneRect.left += monitorRect.left;
-                            zoneRect.right += monitorRect.left;
-                            zoneRect.top += monitorRect.top;
-                            zoneRect.bottom += monitorRect.top;
+                            node.x += monitorRect.left;
+                            node.y += monitorRect.top;
 
-                            zoneRects.emplace_back(zoneRect);
-                            zoneRectsInfo.emplace_back(zoneId, workArea);
+                            zoneNodes.emplace_back(node);
+                            zoneNodesWorkArea.emplace_back(workArea);
                         }
                     }
                 }
@@ -1222,19 +1312,18 @@ bool FancyZones::OnSnapHotkeyBasedOnPosition(HWND window, DWORD vkCode) noexcept
             return false;
         }
 
-        size_t chosenIdx = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, windowRect, zoneRects);
+        size_t chosenIdx = ZoneNavigationGraph::ChooseNextNode(vkCode, windowRect, zoneNodes);
 
-        if (chosenIdx < zoneRects.size())
+        if (chosenIdx < zoneNodes.size())
         {
             // Moving to another monitor succeeded
-            const auto& [trueZoneIdx, zoneWindow] = zoneRectsInfo[chosenIdx];
-            m_windowMoveHandler.MoveWindowIntoZoneByIndexSet(window, { trueZoneIdx }, zoneWindow);
+            m_windowMoveHandler.MoveWindowIntoZoneByIndexSet(window, { zoneNodes[chosenIdx].id }, zoneNodesWorkArea[chosenIdx]);
             return true;
         }
 
         // We reached the end of all monitors.
         // Try again, cycling on all monitors.
-        // First, add zones from the origin monitor to zoneRects
+        // First, add zones from the origin monitor to zoneNodes
         // Sanity check: the current monitor is valid
         if (currentMonitorRect.top <= currentMonitorRect.bottom)
         {
@@ -1244,18 +1333,13 @@ bool FancyZones::OnSnapHotkeyBasedOnPosition(HWND window, DWORD vkCode) noexcept
                 auto zoneSet = workArea->ActiveZoneSet();
                 if (zoneSet)
                 {
-                    const auto zones = zoneSet->GetZones();
-                    for (const auto& [zoneId, zone] : zones)
+                    for (auto node : zoneSet->GetNavigationGraph().Nodes())
                     {
-                        RECT zoneRect = zone->GetZoneRect();
-
-                        zoneRect.left += currentMonitorRect.left;
-                        zoneRect.right += currentMonitorRect.left;
-                        zoneRect.top += currentMonitorRect.top;
-                        zoneRect.bottom += currentMonitorRect.top;
+                        node.x += currentMonitorRect.left;
+                        node.y += currentMonitorRect.top;
 
-                        zoneRects.emplace_back(zoneRect);
-                        zoneRectsInfo.emplace_back(zoneId, workArea);
+                        zoneNodes.emplace_back(node);
+                        zoneNodesWorkArea.emplace_back(workArea);
                     }
                 }
             }
@@ -1267,12 +1351,11 @@ bool FancyZones::OnSnapHotkeyBasedOnPosition(HWND window, DWORD vkCode) noexcept
 
         RECT combinedRect = FancyZonesUtils::GetAllMonitorsCombinedRect<&MONITORINFOEX::rcWork>();
         windowRect = FancyZonesUtils::PrepareRectForCycling(windowRect, combinedRect, vkCode);
-        chosenIdx = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, windowRect, zoneRects);
-        if (chosenIdx < zoneRects.size())
+        chosenIdx = ZoneNavigationGraph::ChooseNextNode(vkCode, windowRect, zoneNodes);
+        if (chosenIdx < zoneNodes.size())
         {
             // Moving to another monitor succeeded
-            const auto& [trueZoneIdx, zoneWindow] = zoneRectsInfo[chosenIdx];
-            m_windowMoveHandler.MoveWindowIntoZoneByIndexSet(window, { trueZoneIdx }, zoneWindow);
+            m_windowMoveHandler.MoveWindowIntoZoneByIndexSet(window, { zoneNodes[chosenIdx].id }, zoneNodesWorkArea[chosenIdx]);
             return true;
         }
         else
@@ -1,7 +1,9 @@
 #include "pch.h"
 #include "FancyZonesData.h"
+#include "AppZoneHistorySnapshot.h"
 #include "FancyZonesDataTypes.h"
 #include "JsonHelpers.h"
+#include "ProcessPathCache.h"
 #include "ZoneSet.h"
 #include "Settings.h"
 #include "CallTracer.h"
@@ -17,7 +19,7 @@
 #include <regex>
 #include <sstream>
 #include <unordered_set>
-#include <common/utils/process_path.h>
+#include <utility>
 #include <common/logger/logger.h>
 
 // Non-localizable strings
@@ -28,11 +30,19 @@ namespace NonLocalizable
     const wchar_t FancyZonesSettingsFile[] = L"settings.json";
     const wchar_t FancyZonesDataFile[] = L"zones-settings.json";
     const wchar_t FancyZonesAppZoneHistoryFile[] = L"app-zone-history.json";
+    const wchar_t FancyZonesAppZoneHistorySnapshotFile[] = L"app-zone-history.bin";
     const wchar_t FancyZonesEditorParametersFile[] = L"editor-parameters.json";
     const wchar_t DefaultGuid[] = L"{00000000-0000-0000-0000-000000000000}";
     const wchar_t RegistryPath[] = L"Software\\SuperFancyZones";
 }
 
+namespace
+{
+    // Snapping often changes the data in bursts, write it once the burst is over
+    constexpr auto SaveDelay = std::chrono::milliseconds(500);
+    constexpr auto MaxSaveDelay = std::chrono::seconds(3);
+}
+
 namespace
 {
     std::wstring ExtractVirtualDesktopId(const std::wstring& deviceId)
@@ -146,13 +156,15 @@ FancyZonesData& FancyZonesDataInstance()
     return instance;
 }
 
-FancyZonesData::FancyZonesData()
+FancyZonesData::FancyZonesData() :
+    flusher([this] { WritePendingData(); }, SaveDelay, MaxSaveDelay)
 {
     std::wstring saveFolderPath = PTSettingsHelper::get_module_save_folder_location(NonLocalizable::FancyZonesStr);
 
     settingsFileName = saveFolderPath + L"\\" + std::wstring(NonLocalizable::FancyZonesSettingsFile);
     zonesSettingsFileName = saveFolderPath + L"\\" + std::wstring(NonLocalizable::FancyZonesDataFile);
     appZoneHistoryFileName = saveFolderPath + L"\\" + std::wstring(NonLocalizable::FancyZonesAppZoneHistoryFile);
+    appZoneHistorySnapshotFileName = saveFolderPath + L"\\" + std::wstring(NonLocalizable::FancyZonesAppZoneHistorySnapshotFile);
     editorParametersFileName = saveFolderPath + L"\\" + std::wstring(NonLocalizable::FancyZonesEditorParametersFile);
 }
 
@@ -312,14 +324,15 @@ void FancyZonesData::RemoveDeletedDesktops(const std::vector<std::wstring>& acti
 
     if (dirtyFlag)
     {
-        SaveAppZoneHistoryAndZoneSettings();
+        SaveZoneSettings();
+        SaveAppZoneHistory();
     }
 }
 
 bool FancyZonesData::IsAnotherWindowOfApplicationInstanceZoned(HWND window, const std::wstring_view& deviceId) const
 {
     std::scoped_lock lock{ dataLock };
-    auto processPath = get_process_path(window);
+    auto processPath = ProcessPathCacheInstance().GetProcessPath(window);
     if (!processPath.empty())
     {
         auto history = appZoneHistoryMap.find(processPath);
@@ -354,7 +367,7 @@ bool FancyZonesData::IsAnotherWindowOfApplicationInstanceZoned(HWND window, cons
 void FancyZonesData::UpdateProcessIdToHandleMap(HWND window, const std::wstring_view& deviceId)
 {
     std::scoped_lock lock{ dataLock };
-    auto processPath = get_process_path(window);
+    auto processPath = ProcessPathCacheInstance().GetProcessPath(window);
     if (!processPath.empty())
     {
         auto history = appZoneHistoryMap.find(processPath);
@@ -378,7 +391,7 @@ void FancyZonesData::UpdateProcessIdToHandleMap(HWND window, const std::wstring_
 std::vector<size_t> FancyZonesData::GetAppLastZoneIndexSet(HWND window, const std::wstring_view& deviceId, const std::wstring_view& zoneSetId) const
 {
     std::scoped_lock lock{ dataLock };
-    auto processPath = get_process_path(window);
+    auto processPath = ProcessPathCacheInstance().GetProcessPath(window);
     if (!processPath.empty())
     {
         auto history = appZoneHistoryMap.find(processPath);
@@ -402,7 +415,7 @@ bool FancyZonesData::RemoveAppLastZone(HWND window, const std::wstring_view& dev
 {
     _TRACER_;
     std::scoped_lock lock{ dataLock };
-    auto processPath = get_process_path(window);
+    auto processPath = ProcessPathCacheInstance().GetProcessPath(window);
     if (!processPath.empty())
     {
         auto history = appZoneHistoryMap.find(processPath);
@@ -422,11 +435,9 @@ bool FancyZonesData::RemoveAppLastZone(HWND window, const std::wstring_view& dev
                     }
 
                     // if there is another instance of same application placed in the same zone don't erase history
-                    size_t windowZoneStamp = reinterpret_cast<size_t>(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneID));
                     for (auto placedWindow : data->processIdToHandleMap)
                     {
-                        size_t placedWindowZoneStamp = reinterpret_cast<size_t>(::GetProp(placedWindow.second, ZonedWindowProperties::PropertyMultipleZoneID));
-                        if (IsWindow(placedWindow.second) && (windowZoneStamp == placedWindowZoneStamp))
+                        if (IsWindow(placedWindow.second) && FancyZonesUtils::ZoneIndexSetStampsEqual(window, placedWindow.second))
                         {
                             return false;
                         }
@@ -461,7 +472,7 @@ bool FancyZonesData::SetAppLastZones(HWND window, const std::wstring& deviceId,
         return false;
     }
 
-    auto processPath = get_process_path(window);
+    auto processPath = ProcessPathCacheInstance().GetProcessPath(window);
     if (processPath.empty())
     {
         return false;
@@ -556,33 +567,139 @@ void FancyZonesData::LoadFancyZonesData()
     }
     else
     {
-        json::JsonObject fancyZonesDataJSON = GetPersistFancyZonesJSON();
+        // The file watcher also reports the writes of pending changes, write them first so the file
+        // has every change made before the reload
+        FlushPendingSaves();
+
+        json::JsonObject fancyZonesDataJSON = JSONHelpers::GetZoneSettingsJSON(zonesSettingsFileName);
+
+        // The app zone history is written by FancyZones only, so pending changes are newer than the file
+        bool keepAppZoneHistory;
+        {
+            std::scoped_lock lock{ dataLock };
+            keepAppZoneHistory = appZoneHistoryDirty;
+        }
+
+        std::optional<JSONHelpers::TAppZoneHistoryMap> appZoneHistory;
+        if (!keepAppZoneHistory)
+        {
+            appZoneHistory = LoadAppZoneHistory(fancyZonesDataJSON);
+        }
+
+        std::scoped_lock lock{ dataLock };
+
+        if (appZoneHistory && !appZoneHistoryDirty)
+        {
+            appZoneHistoryMap = std::move(*appZoneHistory);
+        }
 
-        appZoneHistoryMap = JSONHelpers::ParseAppZoneHistory(fancyZonesDataJSON);
-        deviceInfoMap = JSONHelpers::ParseDeviceInfos(fancyZonesDataJSON);
-        customZoneSetsMap = JSONHelpers::ParseCustomZoneSets(fancyZonesDataJSON);
-        quickKeysMap = JSONHelpers::ParseQuickKeys(fancyZonesDataJSON);
+        // The zone settings on disk win, e.g. when the editor saved them, unless they changed while
+        // the file was read. Those changes are written next, and the write reloads the file again.
+        if (!zoneSettingsDirty)
+        {
+            deviceInfoMap = JSONHelpers::ParseDeviceInfos(fancyZonesDataJSON);
+            customZoneSetsMap = JSONHelpers::ParseCustomZoneSets(fancyZonesDataJSON);
+            quickKeysMap = JSONHelpers::ParseQuickKeys(fancyZonesDataJSON);
+        }
     }
 }
 
+JSONHelpers::TAppZoneHistoryMap FancyZonesData::LoadAppZoneHistory(const json::JsonObject& fancyZonesDataJSON) const
+{
+    _TRACER_;
+    if (JSONHelpers::HasAppZoneHistory(fancyZonesDataJSON))
+    {
+        return JSONHelpers::ParseAppZoneHistory(fancyZonesDataJSON);
+    }
+
+    if (auto snapshot = AppZoneHistorySnapshot::Load(appZoneHistorySnapshotFileName, appZoneHistoryFileName))
+    {
+        return std::move(*snapshot);
+    }
+
+    auto result = JSONHelpers::ParseAppZoneHistoryFile(appZoneHistoryFileName);
+
+    // Regenerate the snapshot, so the next start doesn't parse the json again
+    if (std::filesystem::exists(appZoneHistoryFileName))
+    {
+        std::scoped_lock saveLock{ writeLock };
+        AppZoneHistorySnapshot::Save(appZoneHistorySnapshotFileName, appZoneHistoryFileName, AppZoneHistorySnapshot::Serialize(result));
+    }
+
+    return result;
+}
+
 void FancyZonesData::SaveAppZoneHistoryAndZoneSettings() const
 {
     SaveZoneSettings();
     SaveAppZoneHistory();
+    FlushPendingSaves();
 }
 
 void FancyZonesData::SaveZoneSettings() const
 {
-    _TRACER_;
     std::scoped_lock lock{ dataLock };
-    JSONHelpers::SaveZoneSettings(zonesSettingsFileName, deviceInfoMap, customZoneSetsMap, quickKeysMap);
+    zoneSettingsDirty = true;
+    flusher.Schedule();
 }
 
 void FancyZonesData::SaveAppZoneHistory() const
 {
-    _TRACER_;
     std::scoped_lock lock{ dataLock };
-    JSONHelpers::SaveAppZoneHistory(appZoneHistoryFileName, appZoneHistoryMap);
+    appZoneHistoryDirty = true;
+    flusher.Schedule();
+}
+
+void FancyZonesData::FlushPendingSaves() const
+{
+    _TRACER_;
+    flusher.Flush();
+}
+
+void FancyZonesData::StopSaving() const
+{
+    _TRACER_;
+    flusher.Stop();
+}
+
+void FancyZonesData::WritePendingData() const
+{
+    _TRACER_;
+    std::scoped_lock saveLock{ writeLock };
+
+    // Serialize under the data lock, but touch the disk without it
+    std::optional<json::JsonObject> zoneSettings;
+    std::optional<json::JsonObject> appZoneHistory;
+    std::vector<std::byte> appZoneHistorySnapshot;
+    {
+        std::scoped_lock lock{ dataLock };
+        if (std::exchange(zoneSettingsDirty, false))
+        {
+            zoneSettings = JSONHelpers::SerializeZoneSettings(deviceInfoMap, customZoneSetsMap, quickKeysMap);
+        }
+
+        if (std::exchange(appZoneHistoryDirty, false))
+        {
+            appZoneHistory = JSONHelpers::SerializeAppZoneHistoryJSON(appZoneHistoryMap);
+            appZoneHistorySnapshot = AppZoneHistorySnapshot::Serialize(appZoneHistoryMap);
+        }
+    }
+
+    if (zoneSettings)
+    {
+        JSONHelpers::SaveZoneSettings(zonesSettingsFileName, *zoneSettings);
+    }
+
+    if (appZoneHistory)
+    {
+        std::wstring serialized{ appZoneHistory->Stringify() };
+        if (serialized != savedAppZoneHistory || !std::filesystem::exists(appZoneHistoryFileName))
+        {
+            JSONHelpers::SaveAppZoneHistory(appZoneHistoryFileName, *appZoneHistory);
+            AppZoneHistorySnapshot::Save(appZoneHistorySnapshotFileName, appZoneHistoryFileName, std::move(appZoneHistorySnapshot));
+            savedAppZoneHistory = std::move(serialized);
+        }
+    }
 }
 
 void FancyZonesData::SaveFancyZonesEditorParameters(bool spanZonesAcrossMonitors, const std::wstring& virtualDesktopId, const HMONITOR& targetMonitor, const std::vector<std::pair<HMONITOR, MONITORINFOEX>>& allMonitors) const
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "DebouncedFlusher.h"
 #include "JsonHelpers.h"
 
 #include <common/SettingsAPI/settings_helpers.h>
@@ -86,10 +87,23 @@ public:
     json::JsonObject GetPersistFancyZonesJSON();
 
     void LoadFancyZonesData();
+
+    // Writes both files before returning. Must not be called with the data lock held.
     void SaveAppZoneHistoryAndZoneSettings() const;
+
+    // Mark the data as changed. The files are written on a background thread once the
+    // changes settle, so callers never wait for the disk.
     void SaveZoneSettings() const;
     void SaveAppZoneHistory() const;
 
+    // Write pending changes before returning, e.g. before the editor reads the files or on
+    // shutdown. Must not be called with the data lock held.
+    void FlushPendingSaves() const;
+
+    // Write pending changes and stop saving in the background, changes made afterwards aren't
+    // written. Called when FancyZones is destroyed. Must not be called with the data lock held.
+    void StopSaving() const;
+
     void SaveFancyZonesEditorParameters(bool spanZonesAcrossMonitors, const std::wstring& virtualDesktopId, const HMONITOR& targetMonitor, const std::vector<std::pair<HMONITOR, MONITORINFOEX>>& allMonitors) const;
 
 private:
@@ -128,9 +142,12 @@ private:
         std::wstring result = PTSettingsHelper::get_module_save_folder_location(moduleName);
         zonesSettingsFileName = result + L"\\" + std::wstring(L"zones-settings.json");
         appZoneHistoryFileName = result + L"\\" + std::wstring(L"app-zone-history.json");
+        appZoneHistorySnapshotFileName = result + L"\\" + std::wstring(L"app-zone-history.bin");
     }
 #endif
     void RemoveDesktopAppZoneHistory(const std::wstring& desktopId);
+    void WritePendingData() const;
+    JSONHelpers::TAppZoneHistoryMap LoadAppZoneHistory(const json::JsonObject& fancyZonesDataJSON) const;
 
     // Maps app path to app's zone history data
     std::unordered_map<std::wstring, std::vector<FancyZonesDataTypes::AppZoneHistoryData>> appZoneHistoryMap{};
@@ -144,9 +161,20 @@ private:
     std::wstring settingsFileName;
     std::wstring zonesSettingsFileName;
     std::wstring appZoneHistoryFileName;
+    std::wstring appZoneHistorySnapshotFileName;
     std::wstring editorParametersFileName;
 
     mutable std::recursive_mutex dataLock;
+
+    // Changes not written yet, guarded by dataLock
+    mutable bool zoneSettingsDirty = false;
+    mutable bool appZoneHistoryDirty = false;
+
+    // Serializes the writes, so an older snapshot never overwrites a newer one. Always taken before dataLock.
+    mutable std::mutex writeLock;
+    // Last app zone history written, guarded by writeLock. FancyZones is the only writer of that file.
+    mutable std::wstring savedAppZoneHistory;
+    mutable DebouncedFlusher flusher;
 };
 
 FancyZonesData& FancyZonesDataInstance();
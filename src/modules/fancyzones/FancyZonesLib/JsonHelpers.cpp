@@ -7,6 +7,7 @@
 #include "util.h"
 
 #include <common/logger/logger.h>
+#include <common/utils/winapi_error.h>
 
 #include <filesystem>
 #include <optional>
@@ -71,6 +72,20 @@ namespace NonLocalizable
 
 namespace
 {
+    // Write to a file next to the target and swap it in, so the editor and the file
+    // watcher never see a partially written file
+    void SaveFileAtomically(const std::wstring& fileName, const json::JsonObject& root)
+    {
+        const std::wstring tempFileName = fileName + L".tmp";
+        json::to_file(tempFileName, root);
+
+        if (!MoveFileExW(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        {
+            Logger::error(L"Failed to replace {}: {}", fileName, get_last_error_or_default(GetLastError()));
+            DeleteFileW(tempFileName.c_str());
+        }
+    }
+
     json::JsonArray NumVecToJsonArray(const std::vector<int>& vec)
     {
         json::JsonArray arr;
@@ -566,11 +581,48 @@ namespace JSONHelpers
         }
     }
 
-    void SaveZoneSettings(const std::wstring& zonesSettingsFileName, const TDeviceInfoMap& deviceInfoMap, const TCustomZoneSetsMap& customZoneSetsMap, const TLayoutQuickKeysMap& quickKeysMap)
+    json::JsonObject GetZoneSettingsJSON(const std::wstring& zonesSettingsFileName)
     {
-        auto before = json::from_file(zonesSettingsFileName);
+        auto result = json::from_file(zonesSettingsFileName);
+        return result ? *result : json::JsonObject();
+    }
+
+    bool HasAppZoneHistory(const json::JsonObject& fancyZonesDataJSON)
+    {
+        // Files from older versions keep the app zone history in the zone settings
+        return fancyZonesDataJSON.HasKey(NonLocalizable::AppZoneHistoryStr);
+    }
+
+    TAppZoneHistoryMap ParseAppZoneHistoryFile(const std::wstring& appZoneHistoryFileName)
+    {
+        auto appZoneHistory = json::from_file(appZoneHistoryFileName);
+        return appZoneHistory ? ParseAppZoneHistory(*appZoneHistory) : TAppZoneHistoryMap{};
+    }
+
+    json::JsonObject SerializeZoneSettings(const TDeviceInfoMap& deviceInfoMap, const TCustomZoneSetsMap& customZoneSetsMap, const TLayoutQuickKeysMap& quickKeysMap)
+    {
+        json::JsonObject root{};
+
+        root.SetNamedValue(NonLocalizable::DevicesStr, JSONHelpers::SerializeDeviceInfos(deviceInfoMap));
+        root.SetNamedValue(NonLocalizable::CustomZoneSetsStr, JSONHelpers::SerializeCustomZoneSets(customZoneSetsMap));
+        root.SetNamedValue(NonLocalizable::QuickLayoutKeys, JSONHelpers::SerializeQuickKeys(quickKeysMap));
+
+        return root;
+    }
 
+    json::JsonObject SerializeAppZoneHistoryJSON(const TAppZoneHistoryMap& appZoneHistoryMap)
+    {
         json::JsonObject root{};
+
+        root.SetNamedValue(NonLocalizable::AppZoneHistoryStr, JSONHelpers::SerializeAppZoneHistory(appZoneHistoryMap));
+
+        return root;
+    }
+
+    void SaveZoneSettings(const std::wstring& zonesSettingsFileName, json::JsonObject root)
+    {
+        auto before = json::from_file(zonesSettingsFileName);
+
         json::JsonArray templates{};
 
         try
@@ -584,30 +636,20 @@ namespace JSONHelpers
         {
         
         }
-               
-        root.SetNamedValue(NonLocalizable::DevicesStr, JSONHelpers::SerializeDeviceInfos(deviceInfoMap));
-        root.SetNamedValue(NonLocalizable::CustomZoneSetsStr, JSONHelpers::SerializeCustomZoneSets(customZoneSetsMap));
+
+        // Templates are owned by the editor, keep the ones it saved
         root.SetNamedValue(NonLocalizable::Templates, templates);
-        root.SetNamedValue(NonLocalizable::QuickLayoutKeys, JSONHelpers::SerializeQuickKeys(quickKeysMap));
-        
+
         if (!before.has_value() || before.value().Stringify() != root.Stringify())
         {
             Trace::FancyZones::DataChanged();
-            json::to_file(zonesSettingsFileName, root);
+            SaveFileAtomically(zonesSettingsFileName, root);
         }
     }
 
-    void SaveAppZoneHistory(const std::wstring& appZoneHistoryFileName, const TAppZoneHistoryMap& appZoneHistoryMap)
+    void SaveAppZoneHistory(const std::wstring& appZoneHistoryFileName, const json::JsonObject& root)
     {
-        json::JsonObject root{};
-
-        root.SetNamedValue(NonLocalizable::AppZoneHistoryStr, JSONHelpers::SerializeAppZoneHistory(appZoneHistoryMap));
-
-        auto before = json::from_file(appZoneHistoryFileName);
-        if (!before.has_value() || before.value().Stringify() != root.Stringify())
-        {
-            json::to_file(appZoneHistoryFileName, root);
-        }
+        SaveFileAtomically(appZoneHistoryFileName, root);
     }
 
     TAppZoneHistoryMap ParseAppZoneHistory(const json::JsonObject& fancyZonesDataJSON)
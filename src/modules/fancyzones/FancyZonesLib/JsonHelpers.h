@@ -92,9 +92,16 @@ namespace JSONHelpers
     };
 
     json::JsonObject GetPersistFancyZonesJSON(const std::wstring& zonesSettingsFileName, const std::wstring& appZoneHistoryFileName);
+    json::JsonObject GetZoneSettingsJSON(const std::wstring& zonesSettingsFileName);
+    bool HasAppZoneHistory(const json::JsonObject& fancyZonesDataJSON);
+    TAppZoneHistoryMap ParseAppZoneHistoryFile(const std::wstring& appZoneHistoryFileName);
 
-    void SaveZoneSettings(const std::wstring& zonesSettingsFileName, const TDeviceInfoMap& deviceInfoMap, const TCustomZoneSetsMap& customZoneSetsMap, const TLayoutQuickKeysMap& quickKeysMap);
-    void SaveAppZoneHistory(const std::wstring& appZoneHistoryFileName, const TAppZoneHistoryMap& appZoneHistoryMap);
+    json::JsonObject SerializeZoneSettings(const TDeviceInfoMap& deviceInfoMap, const TCustomZoneSetsMap& customZoneSetsMap, const TLayoutQuickKeysMap& quickKeysMap);
+    json::JsonObject SerializeAppZoneHistoryJSON(const TAppZoneHistoryMap& appZoneHistoryMap);
+
+    // Write serialized data to disk. Called without holding the data lock, since they touch the disk.
+    void SaveZoneSettings(const std::wstring& zonesSettingsFileName, json::JsonObject root);
+    void SaveAppZoneHistory(const std::wstring& appZoneHistoryFileName, const json::JsonObject& root);
 
     TAppZoneHistoryMap ParseAppZoneHistory(const json::JsonObject& fancyZonesDataJSON);
     json::JsonArray SerializeAppZoneHistory(const TAppZoneHistoryMap& appZoneHistoryMap);
@@ -0,0 +1,570 @@
+#include "pch.h"
+
+#include "LayoutEngine.h"
+
+#include "Zone.h"
+#include "ZoneSpatialIndex.h"
+
+#include <common/display/dpi_aware.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    constexpr int C_MULTIPLIER = 10000;
+    constexpr int OVERLAPPING_CENTERS_SENSITIVITY = 75;
+
+    // PriorityGrid layout is unique for zoneCount <= 11. For zoneCount > 11 PriorityGrid is same as Grid
+    const FancyZonesDataTypes::GridLayoutInfo predefinedPriorityGridLayouts[11] = {
+        /* 1 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 1,
+            .columns = 1,
+            .rowsPercents = { 10000 },
+            .columnsPercents = { 10000 },
+            .cellChildMap = { { 0 } } }),
+        /* 2 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 1,
+            .columns = 2,
+            .rowsPercents = { 10000 },
+            .columnsPercents = { 6667, 3333 },
+            .cellChildMap = { { 0, 1 } } }),
+        /* 3 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 1,
+            .columns = 3,
+            .rowsPercents = { 10000 },
+            .columnsPercents = { 2500, 5000, 2500 },
+            .cellChildMap = { { 0, 1, 2 } } }),
+        /* 4 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 2,
+            .columns = 3,
+            .rowsPercents = { 5000, 5000 },
+            .columnsPercents = { 2500, 5000, 2500 },
+            .cellChildMap = { { 0, 1, 2 }, { 0, 1, 3 } } }),
+        /* 5 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 2,
+            .columns = 3,
+            .rowsPercents = { 5000, 5000 },
+            .columnsPercents = { 2500, 5000, 2500 },
+            .cellChildMap = { { 0, 1, 2 }, { 3, 1, 4 } } }),
+        /* 6 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 3,
+            .columns = 3,
+            .rowsPercents = { 3333, 3334, 3333 },
+            .columnsPercents = { 2500, 5000, 2500 },
+            .cellChildMap = { { 0, 1, 2 }, { 0, 1, 3 }, { 4, 1, 5 } } }),
+        /* 7 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 3,
+            .columns = 3,
+            .rowsPercents = { 3333, 3334, 3333 },
+            .columnsPercents = { 2500, 5000, 2500 },
+            .cellChildMap = { { 0, 1, 2 }, { 3, 1, 4 }, { 5, 1, 6 } } }),
+        /* 8 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 3,
+            .columns = 4,
+            .rowsPercents = { 3333, 3334, 3333 },
+            .columnsPercents = { 2500, 2500, 2500, 2500 },
+            .cellChildMap = { { 0, 1, 2, 3 }, { 4, 1, 2, 5 }, { 6, 1, 2, 7 } } }),
+        /* 9 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 3,
+            .columns = 4,
+            .rowsPercents = { 3333, 3334, 3333 },
+            .columnsPercents = { 2500, 2500, 2500, 2500 },
+            .cellChildMap = { { 0, 1, 2, 3 }, { 4, 1, 2, 5 }, { 6, 1, 7, 8 } } }),
+        /* 10 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 3,
+            .columns = 4,
+            .rowsPercents = { 3333, 3334, 3333 },
+            .columnsPercents = { 2500, 2500, 2500, 2500 },
+            .cellChildMap = { { 0, 1, 2, 3 }, { 4, 1, 5, 6 }, { 7, 1, 8, 9 } } }),
+        /* 11 */
+        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
+            .rows = 3,
+            .columns = 4,
+            .rowsPercents = { 3333, 3334, 3333 },
+            .columnsPercents = { 2500, 2500, 2500, 2500 },
+            .cellChildMap = { { 0, 1, 2, 3 }, { 4, 1, 5, 6 }, { 7, 8, 9, 10 } } }),
+    };
+
+    // Keeps the first zone of each id, the same as adding the zones one by one to a ZoneSet
+    bool Finish(LayoutEngine::Zones& zones)
+    {
+        for (const auto& zone : zones)
+        {
+            if (!LayoutEngine::IsValidZoneRect(zone.rect))
+            {
+                // All zones within zone set should be valid in order to use its functionality.
+                zones.clear();
+                return false;
+            }
+        }
+
+        auto byId = [](const LayoutEngine::Zone& first, const LayoutEngine::Zone& second) { return first.id < second.id; };
+        std::stable_sort(zones.begin(), zones.end(), byId);
+        zones.erase(std::unique(zones.begin(), zones.end(), [](const auto& first, const auto& second) { return first.id == second.id; }), zones.end());
+        return true;
+    }
+
+    void CalculateFocusLayout(long width, long height, int zoneCount, LayoutEngine::Zones& zones)
+    {
+        long left{ 100 };
+        long top{ 100 };
+        long right{ left + long(width * 0.4) };
+        long bottom{ top + long(height * 0.4) };
+
+        RECT focusZoneRect{ left, top, right, bottom };
+
+        long focusRectXIncrement = (zoneCount <= 1) ? 0 : 50;
+        long focusRectYIncrement = (zoneCount <= 1) ? 0 : 50;
+
+        for (int i = 0; i < zoneCount; i++)
+        {
+            zones.push_back({ zones.size(), focusZoneRect });
+
+            focusZoneRect.left += focusRectXIncrement;
+            focusZoneRect.right += focusRectXIncrement;
+            focusZoneRect.bottom += focusRectYIncrement;
+            focusZoneRect.top += focusRectYIncrement;
+        }
+    }
+
+    void CalculateColumnsAndRowsLayout(long width, long height, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing, LayoutEngine::Zones& zones)
+    {
+        long totalWidth;
+        long totalHeight;
+
+        if (type == FancyZonesDataTypes::ZoneSetLayoutType::Columns)
+        {
+            totalWidth = width - (spacing * (zoneCount + 1));
+            totalHeight = height - (spacing * 2);
+        }
+        else
+        { //Rows
+            totalWidth = width - (spacing * 2);
+            totalHeight = height - (spacing * (zoneCount + 1));
+        }
+
+        long top = spacing;
+        long left = spacing;
+        long bottom;
+        long right;
+
+        // Note: The expressions below are NOT equal to total{Width|Height} / zoneCount and are done
+        // like this to make the sum of all zones' sizes exactly total{Width|Height}.
+        for (int zoneIndex = 0; zoneIndex < zoneCount; ++zoneIndex)
+        {
+            if (type == FancyZonesDataTypes::ZoneSetLayoutType::Columns)
+            {
+                right = left + (zoneIndex + 1) * totalWidth / zoneCount - zoneIndex * totalWidth / zoneCount;
+                bottom = totalHeight + spacing;
+            }
+            else
+            { //Rows
+                right = totalWidth + spacing;
+                bottom = top + (zoneIndex + 1) * totalHeight / zoneCount - zoneIndex * totalHeight / zoneCount;
+            }
+
+            zones.push_back({ zones.size(), RECT{ left, top, right, bottom } });
+
+            if (type == FancyZonesDataTypes::ZoneSetLayoutType::Columns)
+            {
+                left = right + spacing;
+            }
+            else
+            { //Rows
+                top = bottom + spacing;
+            }
+        }
+    }
+
+    FancyZonesDataTypes::GridLayoutInfo MakeGridLayoutInfo(int zoneCount)
+    {
+        int rows = 1, columns = 1;
+        while (zoneCount / rows >= rows)
+        {
+            rows++;
+        }
+        rows--;
+        columns = zoneCount / rows;
+        if (zoneCount % rows == 0)
+        {
+            // even grid
+        }
+        else
+        {
+            columns++;
+        }
+
+        FancyZonesDataTypes::GridLayoutInfo gridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Minimal{ .rows = rows, .columns = columns });
+
+        // Note: The expressions below are NOT equal to C_MULTIPLIER / {rows|columns} and are done
+        // like this to make the sum of all percents exactly C_MULTIPLIER
+        for (int row = 0; row < rows; row++)
+        {
+            gridLayoutInfo.rowsPercents()[row] = C_MULTIPLIER * (row + 1) / rows - C_MULTIPLIER * row / rows;
+        }
+        for (int col = 0; col < columns; col++)
+        {
+            gridLayoutInfo.columnsPercents()[col] = C_MULTIPLIER * (col + 1) / columns - C_MULTIPLIER * col / columns;
+        }
+
+        for (int i = 0; i < rows; ++i)
+        {
+            gridLayoutInfo.cellChildMap()[i] = std::vector<int>(columns);
+        }
+
+        int index = 0;
+        for (int row = 0; row < rows; row++)
+        {
+            for (int col = 0; col < columns; col++)
+            {
+                gridLayoutInfo.cellChildMap()[row][col] = index++;
+                if (index == zoneCount)
+                {
+                    index--;
+                }
+            }
+        }
+
+        return gridLayoutInfo;
+    }
+
+    void AppendGridZones(long totalWidth, long totalHeight, const FancyZonesDataTypes::GridLayoutInfo& gridLayoutInfo, int spacing, LayoutEngine::Zones& zones)
+    {
+        struct Info
+        {
+            long Extent;
+            long Start;
+            long End;
+        };
+        std::vector<Info> rowInfo(gridLayoutInfo.rows());
+        std::vector<Info> columnInfo(gridLayoutInfo.columns());
+
+        // Note: The expressions below are carefully written to
+        // make the sum of all zones' sizes exactly total{Width|Height}
+        int totalPercents = 0;
+        for (int row = 0; row < gridLayoutInfo.rows(); row++)
+        {
+            rowInfo[row].Start = totalPercents * totalHeight / C_MULTIPLIER;
+            totalPercents += gridLayoutInfo.rowsPercents()[row];
+            rowInfo[row].End = totalPercents * totalHeight / C_MULTIPLIER;
+            rowInfo[row].Extent = rowInfo[row].End - rowInfo[row].Start;
+        }
+
+        totalPercents = 0;
+        for (int col = 0; col < gridLayoutInfo.columns(); col++)
+        {
+            columnInfo[col].Start = totalPercents * totalWidth / C_MULTIPLIER;
+            totalPercents += gridLayoutInfo.columnsPercents()[col];
+            columnInfo[col].End = totalPercents * totalWidth / C_MULTIPLIER;
+            columnInfo[col].Extent = columnInfo[col].End - columnInfo[col].Start;
+        }
+
+        const auto& cellChildMap = gridLayoutInfo.cellChildMap();
+        for (int row = 0; row < gridLayoutInfo.rows(); row++)
+        {
+            for (int col = 0; col < gridLayoutInfo.columns(); col++)
+            {
+                int i = cellChildMap[row][col];
+                if (((row == 0) || (cellChildMap[row - 1][col] != i)) &&
+                    ((col == 0) || (cellChildMap[row][col - 1] != i)))
+                {
+                    long left = columnInfo[col].Start;
+                    long top = rowInfo[row].Start;
+
+                    int maxRow = row;
+                    while (((maxRow + 1) < gridLayoutInfo.rows()) && (cellChildMap[maxRow + 1][col] == i))
+                    {
+                        maxRow++;
+                    }
+                    int maxCol = col;
+                    while (((maxCol + 1) < gridLayoutInfo.columns()) && (cellChildMap[row][maxCol + 1] == i))
+                    {
+                        maxCol++;
+                    }
+
+                    long right = columnInfo[maxCol].End;
+                    long bottom = rowInfo[maxRow].End;
+
+                    top += row == 0 ? spacing : spacing / 2;
+                    bottom -= maxRow == gridLayoutInfo.rows() - 1 ? spacing : spacing / 2;
+                    left += col == 0 ? spacing : spacing / 2;
+                    right -= maxCol == gridLayoutInfo.columns() - 1 ? spacing : spacing / 2;
+
+                    zones.push_back({ static_cast<size_t>(i), RECT{ left, top, right, bottom } });
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> ZoneSelectSubregion(const LayoutEngine::Zones& zones, const std::vector<size_t>& capturedZones, POINT pt, int sensitivityRadius)
+    {
+        auto expand = [&](RECT& rect) {
+            rect.top -= sensitivityRadius / 2;
+            rect.bottom += sensitivityRadius / 2;
+            rect.left -= sensitivityRadius / 2;
+            rect.right += sensitivityRadius / 2;
+        };
+
+        // Compute the overlapped rectangle.
+        RECT overlap = LayoutEngine::FindZone(zones, capturedZones[0])->rect;
+        expand(overlap);
+
+        for (size_t i = 1; i < capturedZones.size(); ++i)
+        {
+            RECT current = LayoutEngine::FindZone(zones, capturedZones[i])->rect;
+            expand(current);
+
+            overlap.top = max(overlap.top, current.top);
+            overlap.left = max(overlap.left, current.left);
+            overlap.bottom = min(overlap.bottom, current.bottom);
+            overlap.right = min(overlap.right, current.right);
+        }
+
+        // Avoid division by zero
+        int width = max(overlap.right - overlap.left, 1);
+        int height = max(overlap.bottom - overlap.top, 1);
+
+        bool verticalSplit = height > width;
+        size_t zoneIndex;
+
+        if (verticalSplit)
+        {
+            zoneIndex = (pt.y - overlap.top) * capturedZones.size() / height;
+        }
+        else
+        {
+            zoneIndex = (pt.x - overlap.left) * capturedZones.size() / width;
+        }
+
+        zoneIndex = std::clamp(zoneIndex, size_t(0), capturedZones.size() - 1);
+
+        return { capturedZones[zoneIndex] };
+    }
+
+    // `compare` should return true if the first argument is a better choice than the second argument.
+    template<class CompareF>
+    std::vector<size_t> ZoneSelectPriority(const LayoutEngine::Zones& zones, const std::vector<size_t>& capturedZones, CompareF compare)
+    {
+        size_t chosen = 0;
+        const RECT* chosenRect = &LayoutEngine::FindZone(zones, capturedZones[0])->rect;
+
+        for (size_t i = 1; i < capturedZones.size(); ++i)
+        {
+            const RECT* rect = &LayoutEngine::FindZone(zones, capturedZones[i])->rect;
+            if (compare(*rect, *chosenRect))
+            {
+                chosen = i;
+                chosenRect = rect;
+            }
+        }
+
+        return { capturedZones[chosen] };
+    }
+
+    std::vector<size_t> ZoneSelectClosestCenter(const LayoutEngine::Zones& zones, const std::vector<size_t>& capturedZones, POINT pt)
+    {
+        auto getCenter = [](const RECT& rect) {
+            return POINT{ (rect.right + rect.left) / 2, (rect.top + rect.bottom) / 2 };
+        };
+        auto pointDifference = [](POINT pt1, POINT pt2) {
+            return (pt1.x - pt2.x) * (pt1.x - pt2.x) + (pt1.y - pt2.y) * (pt1.y - pt2.y);
+        };
+        auto distanceFromCenter = [&](const RECT& rect) {
+            POINT center = getCenter(rect);
+            return pointDifference(center, pt);
+        };
+        auto closerToCenter = [&](const RECT& rect1, const RECT& rect2) {
+            if (pointDifference(getCenter(rect1), getCenter(rect2)) > OVERLAPPING_CENTERS_SENSITIVITY)
+            {
+                return distanceFromCenter(rect1) < distanceFromCenter(rect2);
+            }
+            else
+            {
+                return LayoutEngine::ZoneArea(rect1) < LayoutEngine::ZoneArea(rect2);
+            }
+        };
+        return ZoneSelectPriority(zones, capturedZones, closerToCenter);
+    }
+}
+
+namespace LayoutEngine
+{
+    bool IsValidZoneRect(const RECT& rect) noexcept
+    {
+        int width  = rect.right - rect.left;
+        int height = rect.bottom - rect.top;
+        return rect.left   >= ZoneConstants::MAX_NEGATIVE_SPACING &&
+               rect.right  >= ZoneConstants::MAX_NEGATIVE_SPACING &&
+               rect.top    >= ZoneConstants::MAX_NEGATIVE_SPACING &&
+               rect.bottom >= ZoneConstants::MAX_NEGATIVE_SPACING &&
+               width >= 0 && height >= 0;
+    }
+
+    long ZoneArea(const RECT& rect) noexcept
+    {
+        return max(rect.bottom - rect.top, 0) * max(rect.right - rect.left, 0);
+    }
+
+    const Zone* FindZone(const Zones& zones, size_t zoneId) noexcept
+    {
+        // Layouts usually number their zones from 0
+        if (zoneId < zones.size() && zones[zoneId].id == zoneId)
+        {
+            return &zones[zoneId];
+        }
+
+        auto it = std::lower_bound(zones.begin(), zones.end(), zoneId, [](const Zone& zone, size_t id) { return zone.id < id; });
+        return it != zones.end() && it->id == zoneId ? &*it : nullptr;
+    }
+
+    bool CalculateLayout(RECT workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing, Zones& zones)
+    {
+        zones.clear();
+
+        const long width = workArea.right - workArea.left;
+        const long height = workArea.bottom - workArea.top;
+        if (width == 0 || height == 0 || zoneCount <= 0)
+        {
+            return false;
+        }
+
+        switch (type)
+        {
+        case FancyZonesDataTypes::ZoneSetLayoutType::Focus:
+            CalculateFocusLayout(width, height, zoneCount, zones);
+            return Finish(zones);
+        case FancyZonesDataTypes::ZoneSetLayoutType::Columns:
+        case FancyZonesDataTypes::ZoneSetLayoutType::Rows:
+            CalculateColumnsAndRowsLayout(width, height, type, zoneCount, spacing, zones);
+            return Finish(zones);
+        case FancyZonesDataTypes::ZoneSetLayoutType::PriorityGrid:
+            if (zoneCount < static_cast<int>(std::size(predefinedPriorityGridLayouts)))
+            {
+                return CalculateGridZones(workArea, predefinedPriorityGridLayouts[zoneCount - 1], spacing, zones);
+            }
+            [[fallthrough]];
+        case FancyZonesDataTypes::ZoneSetLayoutType::Grid:
+            return CalculateGridZones(workArea, MakeGridLayoutInfo(zoneCount), spacing, zones);
+        case FancyZonesDataTypes::ZoneSetLayoutType::Blank:
+            return true;
+        case FancyZonesDataTypes::ZoneSetLayoutType::Custom:
+            // Custom layouts are calculated with CalculateGridZones or CalculateCanvasZones
+            return false;
+        }
+
+        return false;
+    }
+
+    bool CalculateGridZones(RECT workArea, const FancyZonesDataTypes::GridLayoutInfo& gridLayoutInfo, int spacing, Zones& zones)
+    {
+        zones.clear();
+        AppendGridZones(workArea.right - workArea.left, workArea.bottom - workArea.top, gridLayoutInfo, spacing, zones);
+        return Finish(zones);
+    }
+
+    bool CalculateCanvasZones(const FancyZonesDataTypes::CanvasLayoutInfo& canvasLayoutInfo, UINT dpi, Zones& zones)
+    {
+        zones.clear();
+        zones.reserve(canvasLayoutInfo.zones.size());
+        for (const auto& zone : canvasLayoutInfo.zones)
+        {
+            const int scale = static_cast<int>(dpi);
+            const int x = zone.x * scale / DPIAware::DEFAULT_DPI;
+            const int y = zone.y * scale / DPIAware::DEFAULT_DPI;
+            const int width = zone.width * scale / DPIAware::DEFAULT_DPI;
+            const int height = zone.height * scale / DPIAware::DEFAULT_DPI;
+
+            zones.push_back({ zones.size(), RECT{ x, y, x + width, y + height } });
+        }
+
+        return Finish(zones);
+    }
+
+    std::vector<size_t> ZonesFromPoint(const ZoneSpatialIndex& index, POINT pt, Settings::OverlappingZonesAlgorithm algorithm)
+    {
+        auto [capturedZones, strictlyCapturedCount, overlap] = index.HitTest(pt);
+
+        // If only one zone is captured, but it's not strictly captured
+        // don't consider it as captured
+        if (capturedZones.size() == 1 && strictlyCapturedCount == 0)
+        {
+            return {};
+        }
+
+        // If captured zones do not overlap, return all of them
+        // Otherwise, return one of them based on the chosen selection algorithm.
+        if (overlap)
+        {
+            using Algorithm = Settings::OverlappingZonesAlgorithm;
+
+            const auto& zones = index.Zones();
+            switch (algorithm)
+            {
+            case Algorithm::Smallest:
+                return ZoneSelectPriority(zones, capturedZones, [&](const RECT& rect1, const RECT& rect2) { return ZoneArea(rect1) < ZoneArea(rect2); });
+            case Algorithm::Largest:
+                return ZoneSelectPriority(zones, capturedZones, [&](const RECT& rect1, const RECT& rect2) { return ZoneArea(rect1) > ZoneArea(rect2); });
+            case Algorithm::Positional:
+                return ZoneSelectSubregion(zones, capturedZones, pt, index.SensitivityRadius());
+            case Algorithm::ClosestCenter:
+                return ZoneSelectClosestCenter(zones, capturedZones, pt);
+            }
+        }
+
+        return capturedZones;
+    }
+
+    std::vector<size_t> GetCombinedZoneRange(const Zones& zones, const std::vector<size_t>& initialZones, const std::vector<size_t>& finalZones)
+    {
+        std::vector<size_t> combinedZones, result;
+        std::set_union(begin(initialZones), end(initialZones), begin(finalZones), end(finalZones), std::back_inserter(combinedZones));
+
+        RECT boundingRect;
+        bool boundingRectEmpty = true;
+
+        for (size_t zoneId : combinedZones)
+        {
+            if (const Zone* zone = FindZone(zones, zoneId))
+            {
+                const RECT& rect = zone->rect;
+                if (boundingRectEmpty)
+                {
+                    boundingRect = rect;
+                    boundingRectEmpty = false;
+                }
+                else
+                {
+                    boundingRect.left = min(boundingRect.left, rect.left);
+                    boundingRect.top = min(boundingRect.top, rect.top);
+                    boundingRect.right = max(boundingRect.right, rect.right);
+                    boundingRect.bottom = max(boundingRect.bottom, rect.bottom);
+                }
+            }
+        }
+
+        if (!boundingRectEmpty)
+        {
+            for (const auto& [zoneId, rect] : zones)
+            {
+                if (boundingRect.left <= rect.left && rect.right <= boundingRect.right &&
+                    boundingRect.top <= rect.top && rect.bottom <= boundingRect.bottom)
+                {
+                    result.push_back(zoneId);
+                }
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "FancyZonesDataTypes.h"
+#include "Settings.h"
+
+#include <vector>
+
+class ZoneSpatialIndex;
+
+/**
+ * Geometry of the zone layouts, without windows, monitors or IZone objects. ZoneSet calculates its
+ * zones, hit-tests the cursor and combines zone ranges with it, and the benchmark runs it headless.
+ */
+namespace LayoutEngine
+{
+    struct Zone
+    {
+        size_t id;
+        RECT rect;
+    };
+
+    // Zones of a layout in zone id order, with unique ids
+    using Zones = std::vector<Zone>;
+
+    /**
+     * @returns Whether a zone can have the given coordinates.
+     */
+    bool IsValidZoneRect(const RECT& rect) noexcept;
+    /**
+     * @returns Area of the zone, 0 for an empty rectangle.
+     */
+    long ZoneArea(const RECT& rect) noexcept;
+    /**
+     * @returns The zone with the given id, or nullptr.
+     */
+    const Zone* FindZone(const Zones& zones, size_t zoneId) noexcept;
+
+    /**
+     * Calculate the zones of a predefined layout (Focus, Columns, Rows, Grid, PriorityGrid).
+     *
+     * @param   workArea  Work area the zones are calculated for, zones are relative to its top-left corner.
+     * @param   type      Layout type.
+     * @param   zoneCount Number of zones, must be positive.
+     * @param   spacing   Space between the zones and around them.
+     * @param   zones     Receives the zones, empty if a zone is invalid.
+     * @returns Whether the zones were calculated.
+     */
+    bool CalculateLayout(RECT workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing, Zones& zones);
+    /**
+     * Calculate the zones of a grid layout, predefined or custom.
+     */
+    bool CalculateGridZones(RECT workArea, const FancyZonesDataTypes::GridLayoutInfo& gridLayoutInfo, int spacing, Zones& zones);
+    /**
+     * Calculate the zones of a custom canvas layout.
+     *
+     * @param   dpi Effective DPI of the monitor, zones of the layout are stored for 96 DPI.
+     */
+    bool CalculateCanvasZones(const FancyZonesDataTypes::CanvasLayoutInfo& canvasLayoutInfo, UINT dpi, Zones& zones);
+
+    /**
+     * Get the zones to snap to when the cursor is at the given point.
+     *
+     * @param   index     Spatial index of the zones.
+     * @param   pt        Cursor coordinates, relative to the work area.
+     * @param   algorithm How to choose between overlapping zones.
+     * @returns Zone ids, empty if no zone is captured.
+     */
+    std::vector<size_t> ZonesFromPoint(const ZoneSpatialIndex& index, POINT pt, Settings::OverlappingZonesAlgorithm algorithm);
+    /**
+     * Get the zones inside the bounding rectangle of both zone sets, used when a window is dragged
+     * over several zones.
+     */
+    std::vector<size_t> GetCombinedZoneRange(const Zones& zones, const std::vector<size_t>& initialZones, const std::vector<size_t>& finalZones);
+}
@@ -0,0 +1,183 @@
+#include "pch.h"
+#include "ProcessPathCache.h"
+
+namespace NonLocalizable
+{
+    const wchar_t ApplicationFrameHost[] = L"ApplicationFrameHost.exe";
+}
+
+struct ProcessPathCache::Entry
+{
+    ProcessPathCache* owner = nullptr;
+    DWORD pid = 0;
+    std::wstring path;
+    std::wstring upperCasePath;
+    bool isApplicationFrameHost = false;
+    wil::unique_handle process;
+    PTP_WAIT wait = nullptr;
+};
+
+ProcessPathCache::~ProcessPathCache()
+{
+    std::unordered_map<DWORD, std::shared_ptr<Entry>> entries;
+    {
+        std::scoped_lock lock{ m_lock };
+        entries.swap(m_entries);
+    }
+
+    for (auto& [pid, entry] : entries)
+    {
+        SetThreadpoolWait(entry->wait, nullptr, nullptr);
+        WaitForThreadpoolWaitCallbacks(entry->wait, TRUE);
+        CloseThreadpoolWait(entry->wait);
+    }
+}
+
+std::wstring ProcessPathCache::GetProcessPath(HWND window)
+{
+    return GetEntry(window)->path;
+}
+
+std::wstring ProcessPathCache::GetProcessPath(DWORD pid)
+{
+    return GetEntry(pid)->path;
+}
+
+std::wstring ProcessPathCache::GetUpperCaseProcessPath(HWND window)
+{
+    return GetEntry(window)->upperCasePath;
+}
+
+size_t ProcessPathCache::Size() const
+{
+    std::scoped_lock lock{ m_lock };
+    return m_entries.size();
+}
+
+std::shared_ptr<const ProcessPathCache::Entry> ProcessPathCache::GetEntry(HWND window)
+{
+    DWORD pid{};
+    GetWindowThreadProcessId(window, &pid);
+    auto entry = GetEntry(pid);
+    if (entry->isApplicationFrameHost)
+    {
+        // It is a UWP app. Same as get_process_path, look for a child window created by
+        // something with a different PID.
+        DWORD newPid = pid;
+        EnumChildWindows(
+            window, [](HWND hwnd, LPARAM param) -> BOOL {
+                auto newPidPtr = reinterpret_cast<DWORD*>(param);
+                DWORD pid;
+                GetWindowThreadProcessId(hwnd, &pid);
+                if (pid != *newPidPtr)
+                {
+                    *newPidPtr = pid;
+                    return FALSE;
+                }
+                return TRUE;
+            },
+            reinterpret_cast<LPARAM>(&newPid));
+
+        if (newPid != pid)
+        {
+            return GetEntry(newPid);
+        }
+    }
+
+    return entry;
+}
+
+std::shared_ptr<const ProcessPathCache::Entry> ProcessPathCache::GetEntry(DWORD pid)
+{
+    {
+        std::scoped_lock lock{ m_lock };
+        auto it = m_entries.find(pid);
+        if (it != std::end(m_entries))
+        {
+            return it->second;
+        }
+    }
+
+    // Query the process outside of the lock, it's the slow part
+    auto entry = std::make_shared<Entry>();
+    entry->owner = this;
+    entry->pid = pid;
+    if (pid == 0)
+    {
+        return entry;
+    }
+
+    entry->process.reset(OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ | SYNCHRONIZE, FALSE, pid));
+    if (entry->process)
+    {
+        entry->path.resize(MAX_PATH);
+        DWORD length = static_cast<DWORD>(entry->path.length());
+        if (QueryFullProcessImageNameW(entry->process.get(), 0, entry->path.data(), &length) == 0)
+        {
+            length = 0;
+        }
+        entry->path.resize(length);
+    }
+    else
+    {
+        // get_process_path can't read the path of this process either (e.g. it's elevated),
+        // but the process can still be watched, so the empty path is cached too
+        entry->process.reset(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, pid));
+        if (!entry->process)
+        {
+            return entry;
+        }
+    }
+
+    entry->upperCasePath = entry->path;
+    CharUpperBuffW(entry->upperCasePath.data(), static_cast<DWORD>(entry->upperCasePath.length()));
+    entry->isApplicationFrameHost = entry->path.ends_with(NonLocalizable::ApplicationFrameHost);
+
+    entry->wait = CreateThreadpoolWait(OnProcessExited, entry.get(), nullptr);
+    if (!entry->wait)
+    {
+        return entry;
+    }
+
+    std::scoped_lock lock{ m_lock };
+    auto [it, inserted] = m_entries.try_emplace(pid, entry);
+    if (!inserted)
+    {
+        // Another thread cached the process meanwhile
+        CloseThreadpoolWait(entry->wait);
+        return it->second;
+    }
+
+    // Fires right away if the process has already exited
+    SetThreadpoolWait(entry->wait, entry->process.get(), nullptr);
+    return entry;
+}
+
+void CALLBACK ProcessPathCache::OnProcessExited(PTP_CALLBACK_INSTANCE /*instance*/, PVOID context, PTP_WAIT wait, TP_WAIT_RESULT /*result*/)
+{
+    // The entry stays alive while it's cached and the cache waits for the callbacks before
+    // it drops its entries, so it can be used here
+    auto entry = static_cast<Entry*>(context);
+    std::shared_ptr<Entry> evicted;
+    {
+        std::scoped_lock lock{ entry->owner->m_lock };
+        auto it = entry->owner->m_entries.find(entry->pid);
+        if (it != std::end(entry->owner->m_entries) && it->second.get() == entry)
+        {
+            evicted = std::move(it->second);
+            entry->owner->m_entries.erase(it);
+        }
+    }
+
+    if (evicted)
+    {
+        // A wait may be closed from its own callback, it's freed once the callback returns
+        CloseThreadpoolWait(wait);
+    }
+}
+
+ProcessPathCache& ProcessPathCacheInstance()
+{
+    static ProcessPathCache instance;
+    return instance;
+}
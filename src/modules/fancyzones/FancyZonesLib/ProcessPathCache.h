@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Executable paths of the processes owning windows, so window events don't open the process and
+// query its image name again and again. A cached process is kept open, which keeps its id from
+// being reused, and is dropped from the cache as soon as it exits.
+class ProcessPathCache
+{
+public:
+    ProcessPathCache() = default;
+    ~ProcessPathCache();
+
+    ProcessPathCache(const ProcessPathCache&) = delete;
+    ProcessPathCache& operator=(const ProcessPathCache&) = delete;
+
+    // Same results as get_process_path
+    std::wstring GetProcessPath(HWND window);
+    std::wstring GetProcessPath(DWORD pid);
+
+    // Upper-cased process path, for matching against the excluded apps
+    std::wstring GetUpperCaseProcessPath(HWND window);
+
+    size_t Size() const;
+
+private:
+    struct Entry;
+
+    std::shared_ptr<const Entry> GetEntry(HWND window);
+    std::shared_ptr<const Entry> GetEntry(DWORD pid);
+    static void CALLBACK OnProcessExited(PTP_CALLBACK_INSTANCE instance, PVOID context, PTP_WAIT wait, TP_WAIT_RESULT result);
+
+    mutable std::mutex m_lock;
+    std::unordered_map<DWORD, std::shared_ptr<Entry>> m_entries;
+};
+
+ProcessPathCache& ProcessPathCacheInstance();
@@ -6,6 +6,7 @@
 namespace ZonedWindowProperties
 {
     const wchar_t PropertyMultipleZoneID[]  = L"FancyZones_zones";
+    const wchar_t PropertyMultipleZoneWordsID[] = L"FancyZones_zonesWords";
     const wchar_t PropertyRestoreSizeID[]   = L"FancyZones_RestoreSize";
     const wchar_t PropertyRestoreOriginID[] = L"FancyZones_RestoreOrigin";
 
@@ -255,7 +255,7 @@ void WindowMoveHandler::MoveSizeEnd(HWND window, POINT const& ptScreen, const st
                 }
             }
         }
-        ::RemoveProp(window, ZonedWindowProperties::PropertyMultipleZoneID);
+        FancyZonesUtils::RemoveZoneIndexSetStamp(window);
     }
 
     m_inMoveSize = false;
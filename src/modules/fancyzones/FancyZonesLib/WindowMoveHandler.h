@@ -38,6 +38,12 @@ public:
         return m_inMoveSize;
     }
 
+    // The window being moved or resized, nullptr if there is none
+    inline HWND MovedWindow() const noexcept
+    {
+        return m_windowMoveSize;
+    }
+
 private:
     struct WindowTransparencyProperties
     {
@@ -0,0 +1,278 @@
+#include "pch.h"
+
+#include "WindowRelayout.h"
+
+#include <common/logger/logger.h>
+#include <common/utils/winapi_error.h>
+
+#include "util.h"
+
+#include <unordered_map>
+
+namespace
+{
+    bool SameRect(const RECT& first, const RECT& second) noexcept
+    {
+        return first.left == second.left && first.top == second.top && first.right == second.right && first.bottom == second.bottom;
+    }
+
+    // Bounding rectangle of the window in the zones it is stamped with, nothing if none of them is in the layout
+    std::optional<WindowRelayout::WindowMove> PlanWindowMove(const WindowRelayout::IWindowBackend& backend, HWND window, const LayoutEngine::Zones& zones, RECT& windowRect)
+    {
+        const std::vector<size_t> zoneIds = backend.GetZoneIndexSet(window);
+        if (zoneIds.empty())
+        {
+            return std::nullopt;
+        }
+
+        backend.GetWindowRect(window, windowRect);
+        RECT frameBounds{};
+        const bool hasFrameBounds = backend.GetFrameBounds(window, frameBounds);
+        const bool resizable = backend.IsResizable(window);
+
+        WindowRelayout::WindowMove move{ .window = window, .rect = {}, .zoneIds = {} };
+        for (size_t id : zoneIds)
+        {
+            const LayoutEngine::Zone* zone = LayoutEngine::FindZone(zones, id);
+            if (!zone)
+            {
+                continue;
+            }
+
+            const RECT rect = WindowRelayout::WindowRectInZone(zone->rect, windowRect, hasFrameBounds ? &frameBounds : nullptr, resizable);
+            if (move.zoneIds.empty())
+            {
+                move.rect = rect;
+            }
+            else
+            {
+                move.rect.left = min(move.rect.left, rect.left);
+                move.rect.top = min(move.rect.top, rect.top);
+                move.rect.right = max(move.rect.right, rect.right);
+                move.rect.bottom = max(move.rect.bottom, rect.bottom);
+            }
+
+            move.zoneIds.push_back(id);
+        }
+
+        if (move.zoneIds.empty())
+        {
+            return std::nullopt;
+        }
+
+        return move;
+    }
+}
+
+namespace WindowRelayout
+{
+    DesktopBackend::DesktopBackend() :
+        m_sameDpiScaling(FancyZonesUtils::allMonitorsHaveSameDpiScaling())
+    {
+    }
+
+    bool DesktopBackend::IsWindow(HWND window) const
+    {
+        return ::IsWindow(window);
+    }
+
+    std::vector<size_t> DesktopBackend::GetZoneIndexSet(HWND window) const
+    {
+        return FancyZonesUtils::GetZoneIndexSetStamp(window);
+    }
+
+    bool DesktopBackend::GetWindowRect(HWND window, RECT& rect) const
+    {
+        return ::GetWindowRect(window, &rect);
+    }
+
+    bool DesktopBackend::GetFrameBounds(HWND window, RECT& rect) const
+    {
+        return SUCCEEDED(DwmGetWindowAttribute(window, DWMWA_EXTENDED_FRAME_BOUNDS, &rect, sizeof(rect)));
+    }
+
+    bool DesktopBackend::IsResizable(HWND window) const
+    {
+        return (::GetWindowLong(window, GWL_STYLE) & WS_SIZEBOX) != 0;
+    }
+
+    bool DesktopBackend::CanDeferMove(HWND window) const
+    {
+        return m_sameDpiScaling && !IsIconic(window) && !IsZoomed(window) && !IsHungAppWindow(window);
+    }
+
+    bool DesktopBackend::MoveWindows(const std::vector<WindowMove>& moves)
+    {
+        // Only our own windows go in the transaction, a window of another process could stop
+        // responding after CanDeferMove checked it and block EndDeferWindowPos
+        const DWORD currentProcessId = GetCurrentProcessId();
+        std::vector<WindowMove> transaction;
+        for (const auto& move : moves)
+        {
+            DWORD processId = 0;
+            GetWindowThreadProcessId(move.window, &processId);
+            if (processId == currentProcessId)
+            {
+                transaction.push_back(move);
+            }
+            else
+            {
+                MoveWindowAsync(move);
+            }
+        }
+
+        return transaction.empty() || MoveOwnWindows(transaction);
+    }
+
+    void DesktopBackend::MoveWindowAsync(const WindowMove& move)
+    {
+        FancyZonesUtils::SaveWindowSizeAndOrigin(move.window);
+
+        // Posted to the thread of the window, which positions it when it gets to it
+        if (!SetWindowPos(move.window, nullptr, move.rect.left, move.rect.top, move.rect.right - move.rect.left, move.rect.bottom - move.rect.top, SWP_NOZORDER | SWP_NOOWNERZORDER | SWP_NOACTIVATE | SWP_ASYNCWINDOWPOS))
+        {
+            Logger::error(L"Failed to move a window: {}", get_last_error_or_default(GetLastError()));
+            PlaceWindow(move);
+        }
+    }
+
+    bool DesktopBackend::MoveOwnWindows(const std::vector<WindowMove>& moves)
+    {
+        HDWP positions = BeginDeferWindowPos(static_cast<int>(moves.size()));
+        if (!positions)
+        {
+            Logger::error(L"Failed to begin moving {} windows: {}", moves.size(), get_last_error_or_default(GetLastError()));
+            return false;
+        }
+
+        for (const auto& move : moves)
+        {
+            FancyZonesUtils::SaveWindowSizeAndOrigin(move.window);
+
+            // On failure the transaction is already freed
+            positions = DeferWindowPos(positions, move.window, nullptr, move.rect.left, move.rect.top, move.rect.right - move.rect.left, move.rect.bottom - move.rect.top, SWP_NOZORDER | SWP_NOOWNERZORDER | SWP_NOACTIVATE);
+            if (!positions)
+            {
+                Logger::error(L"Failed to defer moving a window: {}", get_last_error_or_default(GetLastError()));
+                return false;
+            }
+        }
+
+        if (!EndDeferWindowPos(positions))
+        {
+            Logger::error(L"Failed to move {} windows: {}", moves.size(), get_last_error_or_default(GetLastError()));
+            return false;
+        }
+
+        return true;
+    }
+
+    void DesktopBackend::PlaceWindow(const WindowMove& move)
+    {
+        FancyZonesUtils::SaveWindowSizeAndOrigin(move.window);
+        FancyZonesUtils::SizeWindowToRect(move.window, move.rect);
+    }
+
+    void DesktopBackend::StampZoneIndexSet(HWND window, const std::vector<size_t>& zoneIds)
+    {
+        FancyZonesUtils::StampZoneIndexSet(window, zoneIds);
+    }
+
+    RECT WindowRectInZone(const RECT& zoneRect, const RECT& windowRect, const RECT* frameBounds, bool resizable) noexcept
+    {
+        RECT rect = zoneRect;
+
+        // Take care of 1px border
+        if (frameBounds)
+        {
+            rect.left -= frameBounds->left - windowRect.left;
+            rect.right -= frameBounds->right - windowRect.right;
+            rect.bottom -= frameBounds->bottom - windowRect.bottom;
+        }
+
+        if (!resizable)
+        {
+            rect.right = rect.left + (windowRect.right - windowRect.left);
+            rect.bottom = rect.top + (windowRect.bottom - windowRect.top);
+        }
+
+        return rect;
+    }
+
+    Plan PlanRelayout(const IWindowBackend& backend, const std::vector<HWND>& windows, const std::function<const WorkAreaZones*(HWND)>& getWorkArea)
+    {
+        Plan plan;
+        std::unordered_map<const WorkAreaZones*, size_t> batchIndex;
+
+        for (HWND window : windows)
+        {
+            if (!backend.IsWindow(window))
+            {
+                continue;
+            }
+
+            const WorkAreaZones* workArea = getWorkArea(window);
+            if (!workArea)
+            {
+                continue;
+            }
+
+            RECT windowRect{};
+            auto move = PlanWindowMove(backend, window, workArea->zones, windowRect);
+            if (!move)
+            {
+                continue;
+            }
+
+            const auto [index, added] = batchIndex.emplace(workArea, plan.size());
+            if (added)
+            {
+                plan.push_back({ .monitor = workArea->monitor, .deferredMoves = {}, .placements = {}, .unchanged = {} });
+            }
+
+            MonitorBatch& batch = plan[index->second];
+            if (!backend.CanDeferMove(window))
+            {
+                batch.placements.push_back(std::move(*move));
+            }
+            else if (SameRect(windowRect, move->rect))
+            {
+                batch.unchanged.push_back(std::move(*move));
+            }
+            else
+            {
+                batch.deferredMoves.push_back(std::move(*move));
+            }
+        }
+
+        return plan;
+    }
+
+    void ApplyPlan(IWindowBackend& backend, const Plan& plan)
+    {
+        for (const auto& batch : plan)
+        {
+            if (!batch.deferredMoves.empty() && !backend.MoveWindows(batch.deferredMoves))
+            {
+                for (const auto& move : batch.deferredMoves)
+                {
+                    backend.PlaceWindow(move);
+                }
+            }
+
+            for (const auto& move : batch.placements)
+            {
+                backend.PlaceWindow(move);
+            }
+
+            // Zones of the stamp missing from the layout are dropped, as when the window was snapped
+            for (const auto* moves : { &batch.deferredMoves, &batch.placements, &batch.unchanged })
+            {
+                for (const auto& move : *moves)
+                {
+                    backend.StampZoneIndexSet(move.window, move.zoneIds);
+                }
+            }
+        }
+    }
+}
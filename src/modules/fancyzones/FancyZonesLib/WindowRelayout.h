@@ -0,0 +1,140 @@
+#pragma once
+
+#include "LayoutEngine.h"
+
+#include <functional>
+#include <vector>
+
+/**
+ * Moves the zoned windows into the zones of their work area after the layout or the displays changed.
+ * All window rectangles are planned first, then the windows of each monitor are moved together in
+ * deferred positioning transactions, instead of repainting the desktop once per window.
+ */
+namespace WindowRelayout
+{
+    struct WindowMove
+    {
+        HWND window;
+        // Screen coordinates
+        RECT rect;
+        // Zones of the active layout the window is assigned to
+        std::vector<size_t> zoneIds;
+    };
+
+    struct MonitorBatch
+    {
+        // nullptr when the zones span all monitors
+        HMONITOR monitor;
+        // Restored windows, moved together
+        std::vector<WindowMove> deferredMoves;
+        // Windows which can't be moved in a transaction, moved one at a time with their placement
+        std::vector<WindowMove> placements;
+        // Windows already in their zones
+        std::vector<WindowMove> unchanged;
+    };
+
+    using Plan = std::vector<MonitorBatch>;
+
+    // Zones of a work area, in screen coordinates
+    struct WorkAreaZones
+    {
+        HMONITOR monitor;
+        LayoutEngine::Zones zones;
+    };
+
+    /**
+     * The window operations of a relayout. DesktopBackend moves the real windows, tests and the
+     * benchmark plan against a FakeWindowBackend.
+     */
+    class IWindowBackend
+    {
+    public:
+        virtual ~IWindowBackend() = default;
+
+        virtual bool IsWindow(HWND window) const = 0;
+        /**
+         * @returns Zone index set stamp of the window, empty if it isn't zoned.
+         */
+        virtual std::vector<size_t> GetZoneIndexSet(HWND window) const = 0;
+        virtual bool GetWindowRect(HWND window, RECT& rect) const = 0;
+        /**
+         * @returns Whether the window has DWM extended frame bounds, which leave out its invisible borders.
+         */
+        virtual bool GetFrameBounds(HWND window, RECT& rect) const = 0;
+        virtual bool IsResizable(HWND window) const = 0;
+        /**
+         * @returns Whether the window can be positioned in a deferred transaction.
+         */
+        virtual bool CanDeferMove(HWND window) const = 0;
+
+        /**
+         * Position the windows in transactions.
+         *
+         * @returns Whether the windows were moved, false leaves them to be placed one at a time.
+         */
+        virtual bool MoveWindows(const std::vector<WindowMove>& moves) = 0;
+        virtual void PlaceWindow(const WindowMove& move) = 0;
+        // Stamp the window with the zones it was moved into
+        virtual void StampZoneIndexSet(HWND window, const std::vector<size_t>& zoneIds) = 0;
+    };
+
+    /**
+     * Moves the windows of the desktop.
+     *
+     * EndDeferWindowPos waits for every window of the transaction to be positioned by its own thread,
+     * while SizeWindowToRect only posts the placement (WPF_ASYNCWINDOWPLACEMENT). So that a window of
+     * another process which stops responding can't block FancyZones, only the windows of FancyZones go
+     * in a transaction, the windows of other processes are positioned with SWP_ASYNCWINDOWPOS and hung
+     * windows are placed. Minimized and maximized windows need their placement changed, and when the
+     * monitors have different DPI scaling all windows are placed, as setting the placement twice lets
+     * the window rescale to the DPI of its new monitor (issue #365).
+     */
+    class DesktopBackend : public IWindowBackend
+    {
+    public:
+        DesktopBackend();
+
+        bool IsWindow(HWND window) const override;
+        std::vector<size_t> GetZoneIndexSet(HWND window) const override;
+        bool GetWindowRect(HWND window, RECT& rect) const override;
+        bool GetFrameBounds(HWND window, RECT& rect) const override;
+        bool IsResizable(HWND window) const override;
+        bool CanDeferMove(HWND window) const override;
+        bool MoveWindows(const std::vector<WindowMove>& moves) override;
+        void PlaceWindow(const WindowMove& move) override;
+        void StampZoneIndexSet(HWND window, const std::vector<size_t>& zoneIds) override;
+
+    private:
+        void MoveWindowAsync(const WindowMove& move);
+        bool MoveOwnWindows(const std::vector<WindowMove>& moves);
+
+        bool m_sameDpiScaling;
+    };
+
+    /**
+     * Calculate the rectangle of a window in a zone. The invisible borders of the window are kept out
+     * of the zone, and a window which can't be resized keeps its size.
+     *
+     * @param   zoneRect    Zone rectangle, in the coordinates of windowRect.
+     * @param   windowRect  Current window rectangle.
+     * @param   frameBounds DWM extended frame bounds of the window, or nullptr.
+     * @param   resizable   Whether the window has a sizing border.
+     */
+    RECT WindowRectInZone(const RECT& zoneRect, const RECT& windowRect, const RECT* frameBounds, bool resizable) noexcept;
+
+    /**
+     * Plan moving the zoned windows into their zones, grouped by monitor. A window spanning several zones
+     * is moved to their bounding rectangle, a window stamped with no zone of its layout isn't moved.
+     *
+     * @param   windows     Zoned windows, see FancyZonesUtils::GetStampedWindows.
+     * @param   getWorkArea Zones of the work area the window belongs to, nullptr if it has none. The pointer
+     *                      must stay valid until planning returns, work areas are compared by address.
+     */
+    Plan PlanRelayout(const IWindowBackend& backend, const std::vector<HWND>& windows, const std::function<const WorkAreaZones*(HWND)>& getWorkArea);
+
+    /**
+     * Move the windows of the plan, one MoveWindows call per monitor, and stamp each window with the zones
+     * of its layout it was moved into.
+     */
+    void ApplyPlan(IWindowBackend& backend, const Plan& plan);
+}
@@ -6,23 +6,11 @@
 #include <common/display/dpi_aware.h>
 #include <common/display/monitors.h>
 #include "Zone.h"
+#include "LayoutEngine.h"
 #include "Settings.h"
+#include "WindowRelayout.h"
 #include "util.h"
 
-namespace
-{
-    bool ValidateZoneRect(const RECT& rect)
-    {
-        int width  = rect.right - rect.left;
-        int height = rect.bottom - rect.top;
-        return rect.left   >= ZoneConstants::MAX_NEGATIVE_SPACING &&
-               rect.right  >= ZoneConstants::MAX_NEGATIVE_SPACING &&
-               rect.top    >= ZoneConstants::MAX_NEGATIVE_SPACING &&
-               rect.bottom >= ZoneConstants::MAX_NEGATIVE_SPACING &&
-               width >= 0 && height >= 0;
-    }
-}
-
 struct Zone : winrt::implements<Zone, IZone>
 {
 public:
@@ -33,7 +21,7 @@ public:
     }
 
     IFACEMETHODIMP_(RECT) GetZoneRect() const noexcept { return m_zoneRect; }
-    IFACEMETHODIMP_(long) GetZoneArea() const noexcept { return max(m_zoneRect.bottom - m_zoneRect.top, 0) * max(m_zoneRect.right - m_zoneRect.left, 0); }
+    IFACEMETHODIMP_(long) GetZoneArea() const noexcept { return LayoutEngine::ZoneArea(m_zoneRect); }
     IFACEMETHODIMP_(size_t) Id() const noexcept { return m_id; }
     IFACEMETHODIMP_(RECT) ComputeActualZoneRect(HWND window, HWND zoneWindow) const noexcept;
 
@@ -45,39 +33,23 @@ private:
 
 RECT Zone::ComputeActualZoneRect(HWND window, HWND zoneWindow) const noexcept
 {
-    // Take care of 1px border
-    RECT newWindowRect = m_zoneRect;
-
     RECT windowRect{};
     ::GetWindowRect(window, &windowRect);
 
     RECT frameRect{};
-
-    if (SUCCEEDED(DwmGetWindowAttribute(window, DWMWA_EXTENDED_FRAME_BOUNDS, &frameRect, sizeof(frameRect))))
-    {
-        LONG leftMargin = frameRect.left - windowRect.left;
-        LONG rightMargin = frameRect.right - windowRect.right;
-        LONG bottomMargin = frameRect.bottom - windowRect.bottom;
-        newWindowRect.left -= leftMargin;
-        newWindowRect.right -= rightMargin;
-        newWindowRect.bottom -= bottomMargin;
-    }
+    const bool hasFrameRect = SUCCEEDED(DwmGetWindowAttribute(window, DWMWA_EXTENDED_FRAME_BOUNDS, &frameRect, sizeof(frameRect)));
+    const bool resizable = (::GetWindowLong(window, GWL_STYLE) & WS_SIZEBOX) != 0;
 
     // Map to screen coords
-    MapWindowRect(zoneWindow, nullptr, &newWindowRect);
-
-    if ((::GetWindowLong(window, GWL_STYLE) & WS_SIZEBOX) == 0)
-    {
-        newWindowRect.right = newWindowRect.left + (windowRect.right - windowRect.left);
-        newWindowRect.bottom = newWindowRect.top + (windowRect.bottom - windowRect.top);
-    }
+    RECT zoneRect = m_zoneRect;
+    MapWindowRect(zoneWindow, nullptr, &zoneRect);
 
-    return newWindowRect;
+    return WindowRelayout::WindowRectInZone(zoneRect, windowRect, hasFrameRect ? &frameRect : nullptr, resizable);
 }
 
 winrt::com_ptr<IZone> MakeZone(const RECT& zoneRect, const size_t zoneId) noexcept
 {
-    if (ValidateZoneRect(zoneRect) && zoneId >= 0)
+    if (LayoutEngine::IsValidZoneRect(zoneRect) && zoneId >= 0)
     {
         return winrt::make_self<Zone>(zoneRect, zoneId);
     }
@@ -0,0 +1,243 @@
+#include "pch.h"
+
+#include "ZoneNavigationGraph.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double Infinity = 1e100;
+    constexpr double Eccentricity = 2.0;
+    // Candidates further off the arrow direction than atan(10), ~84 degrees, are ignored
+    constexpr double MaxTanAngle = 10.0;
+
+    struct Direction
+    {
+        double x;
+        double y;
+    };
+
+    std::optional<size_t> DirectionIndex(DWORD vkCode) noexcept
+    {
+        switch (vkCode)
+        {
+        case VK_LEFT:
+            return 0;
+        case VK_UP:
+            return 1;
+        case VK_RIGHT:
+            return 2;
+        case VK_DOWN:
+            return 3;
+        default:
+            return std::nullopt;
+        }
+    }
+
+    constexpr std::array<Direction, 4> Directions{ Direction{ -1.0, 0.0 }, Direction{ 0.0, -1.0 }, Direction{ 1.0, 0.0 }, Direction{ 0.0, 1.0 } };
+    constexpr std::array<DWORD, 4> DirectionKeys{ VK_LEFT, VK_UP, VK_RIGHT, VK_DOWN };
+
+    double CenterX(const RECT& rect) noexcept
+    {
+        return 0.5 * rect.left + 0.5 * rect.right;
+    }
+
+    double CenterY(const RECT& rect) noexcept
+    {
+        return 0.5 * rect.top + 0.5 * rect.bottom;
+    }
+
+    // Distance to a candidate in the direction of the arrow, stretched by how far the candidate is
+    // off that direction: the candidate is placed on an ellipse with the given eccentricity and its
+    // major axis along the arrow. Plain arithmetic form of tan(acos(cos angle)).
+    double Distance(const Direction& direction, double dx, double dy) noexcept
+    {
+        const double along = direction.x * dx + direction.y * dy;
+        if (along <= 0.0)
+        {
+            return Infinity;
+        }
+
+        const double across = std::abs(direction.x * dy - direction.y * dx);
+        if (across > MaxTanAngle * along)
+        {
+            return Infinity;
+        }
+
+        const double result = (along + Eccentricity * Eccentricity * across * across / along) / (2 * Eccentricity);
+        return std::isfinite(result) ? result : Infinity;
+    }
+}
+
+void ZoneNavigationGraph::Build(const LayoutEngine::Zones& zones, SIZE workAreaSize)
+{
+    Clear();
+    m_built = true;
+    m_workAreaSize = workAreaSize;
+
+    m_nodes.reserve(zones.size());
+    m_rects.reserve(zones.size());
+    for (const auto& [zoneId, rect] : zones)
+    {
+        const size_t position = m_nodes.size();
+        m_nodes.push_back({ zoneId, CenterX(rect) + 0.001 * (position + 1), CenterY(rect) });
+        m_rects.push_back(rect);
+        m_nodeIndexes[zoneId] = position;
+    }
+
+    const RECT workArea{ 0, 0, workAreaSize.cx, workAreaSize.cy };
+    std::vector<std::pair<double, size_t>> candidates;
+    m_links.resize(m_nodes.size());
+    for (size_t from = 0; from < m_nodes.size(); from++)
+    {
+        const double x = CenterX(m_rects[from]);
+        const double y = CenterY(m_rects[from]);
+
+        for (size_t direction = 0; direction < DirectionCount; direction++)
+        {
+            candidates.clear();
+            for (size_t to = 0; to < m_nodes.size(); to++)
+            {
+                if (to == from)
+                {
+                    continue;
+                }
+
+                const double distance = Distance(Directions[direction], m_nodes[to].x - x, m_nodes[to].y - y);
+                if (distance < Infinity)
+                {
+                    candidates.emplace_back(distance, to);
+                }
+            }
+
+            // Ties go to the lowest zone id, like the linear search
+            const size_t count = min(candidates.size(), MaxNeighbours);
+            std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+
+            auto& neighbours = m_links[from].neighbours[direction];
+            neighbours.reserve(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                neighbours.push_back(m_nodes[candidates[i].second].id);
+            }
+
+            const RECT cycleRect = FancyZonesUtils::PrepareRectForCycling(m_rects[from], workArea, DirectionKeys[direction]);
+            const size_t target = ChooseNextNode(DirectionKeys[direction], cycleRect, m_nodes);
+            if (target < m_nodes.size())
+            {
+                m_links[from].wrapTargets[direction] = m_nodes[target].id;
+            }
+        }
+    }
+}
+
+void ZoneNavigationGraph::Clear() noexcept
+{
+    m_built = false;
+    m_workAreaSize = {};
+    m_nodes.clear();
+    m_rects.clear();
+    m_links.clear();
+    m_nodeIndexes.clear();
+}
+
+bool ZoneNavigationGraph::IsBuiltFor(SIZE workAreaSize) const noexcept
+{
+    return m_built && m_workAreaSize.cx == workAreaSize.cx && m_workAreaSize.cy == workAreaSize.cy;
+}
+
+const std::vector<size_t>& ZoneNavigationGraph::Neighbours(size_t zoneId, DWORD vkCode) const
+{
+    static const std::vector<size_t> none;
+
+    const auto direction = DirectionIndex(vkCode);
+    const auto links = FindLinks(zoneId);
+    if (!direction || !links)
+    {
+        return none;
+    }
+
+    return links->neighbours[*direction];
+}
+
+std::optional<size_t> ZoneNavigationGraph::WrapTarget(size_t zoneId, DWORD vkCode) const
+{
+    const auto direction = DirectionIndex(vkCode);
+    const auto links = FindLinks(zoneId);
+    if (!direction || !links)
+    {
+        return std::nullopt;
+    }
+
+    return links->wrapTargets[*direction];
+}
+
+std::optional<size_t> ZoneNavigationGraph::Search(RECT rect, DWORD vkCode, const std::vector<bool>& excluded) const
+{
+    const auto direction = DirectionIndex(vkCode);
+    if (!direction)
+    {
+        return std::nullopt;
+    }
+
+    const double x = CenterX(rect);
+    const double y = CenterY(rect);
+
+    std::optional<size_t> result;
+    double smallestDistance = Infinity;
+    for (const auto& node : m_nodes)
+    {
+        if (node.id < excluded.size() && excluded[node.id])
+        {
+            continue;
+        }
+
+        const double distance = Distance(Directions[*direction], node.x - x, node.y - y);
+        if (distance < smallestDistance)
+        {
+            smallestDistance = distance;
+            result = node.id;
+        }
+    }
+
+    return result;
+}
+
+size_t ZoneNavigationGraph::ChooseNextNode(DWORD vkCode, RECT rect, const std::vector<Node>& nodes) noexcept
+{
+    const auto direction = DirectionIndex(vkCode);
+    if (!direction)
+    {
+        return nodes.size();
+    }
+
+    const double x = CenterX(rect);
+    const double y = CenterY(rect);
+
+    size_t result = nodes.size();
+    double smallestDistance = Infinity;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        const double distance = Distance(Directions[*direction], nodes[i].x - x, nodes[i].y - y);
+        if (distance < smallestDistance)
+        {
+            smallestDistance = distance;
+            result = i;
+        }
+    }
+
+    return result;
+}
+
+const ZoneNavigationGraph::Links* ZoneNavigationGraph::FindLinks(size_t zoneId) const
+{
+    const auto it = m_nodeIndexes.find(zoneId);
+    if (it == m_nodeIndexes.end())
+    {
+        return nullptr;
+    }
+
+    return &m_links[it->second];
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "LayoutEngine.h"
+
+#include <array>
+#include <optional>
+#include <unordered_map>
+
+/**
+ * Neighbours of the zones of a zone layout, used to move windows with Win+arrows based on the
+ * zone position. For each zone and arrow direction, the closest zones in that direction and the
+ * zone reached when cycling past the edge of the work area are computed once, when the graph is
+ * built, so extending a window from the last zone it was extended to is a lookup. Windows are moved
+ * by searching from their rect over the precomputed zone centers.
+ */
+class ZoneNavigationGraph
+{
+public:
+    struct Node
+    {
+        size_t id;
+        // Center of the zone, offset slightly by the zone position to differentiate overlapping zones
+        double x;
+        double y;
+    };
+
+    /**
+     * Build the graph for the given zones. Replaces the previous graph.
+     *
+     * @param   zones        Zones of the zone layout.
+     * @param   workAreaSize Size of the work area, by which the zones are shifted when cycling.
+     */
+    void Build(const LayoutEngine::Zones& zones, SIZE workAreaSize);
+    /**
+     * Forget the zones, ex: when zones are added to the layout.
+     */
+    void Clear() noexcept;
+    /**
+     * @returns Whether Build was called since the graph was created or cleared.
+     */
+    bool IsBuilt() const noexcept { return m_built; }
+    /**
+     * @returns Whether the graph was built for a work area of the given size.
+     */
+    bool IsBuiltFor(SIZE workAreaSize) const noexcept;
+    /**
+     * @returns Zone centers, in zone id order.
+     */
+    const std::vector<Node>& Nodes() const noexcept { return m_nodes; }
+    /**
+     * Get the zones next to a zone, closest first.
+     *
+     * @param   zoneId Zone the window is snapped to.
+     * @param   vkCode Pressed arrow key.
+     */
+    const std::vector<size_t>& Neighbours(size_t zoneId, DWORD vkCode) const;
+    /**
+     * Get the zone reached from a zone when there is no neighbour in the direction of the arrow
+     * key, by looking from the opposite edge of the work area.
+     *
+     * @param   zoneId Zone the window is snapped to.
+     * @param   vkCode Pressed arrow key.
+     */
+    std::optional<size_t> WrapTarget(size_t zoneId, DWORD vkCode) const;
+    /**
+     * Find the closest zone in the direction of the arrow key from any rectangle, ex: from a window
+     * which isn't snapped to a single zone.
+     *
+     * @param   rect     Rectangle to move from, relative to the work area.
+     * @param   vkCode   Pressed arrow key.
+     * @param   excluded Zones which can't be chosen, by zone id. May be shorter than the zone count.
+     */
+    std::optional<size_t> Search(RECT rect, DWORD vkCode, const std::vector<bool>& excluded = {}) const;
+
+    /**
+     * Find the closest node in the direction of the arrow key from a rectangle.
+     *
+     * @returns Index into nodes, or nodes.size() if no node is in that direction.
+     */
+    static size_t ChooseNextNode(DWORD vkCode, RECT rect, const std::vector<Node>& nodes) noexcept;
+
+private:
+    static constexpr size_t DirectionCount = 4;
+    // Longest ranked list kept per zone and direction
+    static constexpr size_t MaxNeighbours = 8;
+
+    struct Links
+    {
+        std::array<std::vector<size_t>, DirectionCount> neighbours;
+        std::array<std::optional<size_t>, DirectionCount> wrapTargets;
+    };
+
+    const Links* FindLinks(size_t zoneId) const;
+
+    bool m_built = false;
+    SIZE m_workAreaSize{};
+    std::vector<Node> m_nodes;
+    std::vector<RECT> m_rects;
+    // Same order as m_nodes
+    std::vector<Links> m_links;
+    std::unordered_map<size_t, size_t> m_nodeIndexes;
+};
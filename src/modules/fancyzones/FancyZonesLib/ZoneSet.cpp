@@ -4,111 +4,20 @@
 
 #include "FancyZonesData.h"
 #include "FancyZonesDataTypes.h"
+#include "LayoutEngine.h"
 #include "Settings.h"
 #include "Zone.h"
+#include "ZoneNavigationGraph.h"
+#include "ZoneSpatialIndex.h"
 #include "util.h"
 
 #include <common/logger/logger.h>
 #include <common/display/dpi_aware.h>
 
-#include <limits>
 #include <map>
-#include <utility>
 
 using namespace FancyZonesUtils;
 
-namespace
-{
-    constexpr int C_MULTIPLIER = 10000;
-    constexpr int OVERLAPPING_CENTERS_SENSITIVITY = 75;
-
-    // PriorityGrid layout is unique for zoneCount <= 11. For zoneCount > 11 PriorityGrid is same as Grid
-    FancyZonesDataTypes::GridLayoutInfo predefinedPriorityGridLayouts[11] = {
-        /* 1 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 1,
-            .columns = 1,
-            .rowsPercents = { 10000 },
-            .columnsPercents = { 10000 },
-            .cellChildMap = { { 0 } } }),
-        /* 2 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 1,
-            .columns = 2,
-            .rowsPercents = { 10000 },
-            .columnsPercents = { 6667, 3333 },
-            .cellChildMap = { { 0, 1 } } }),
-        /* 3 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 1,
-            .columns = 3,
-            .rowsPercents = { 10000 },
-            .columnsPercents = { 2500, 5000, 2500 },
-            .cellChildMap = { { 0, 1, 2 } } }),
-        /* 4 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 2,
-            .columns = 3,
-            .rowsPercents = { 5000, 5000 },
-            .columnsPercents = { 2500, 5000, 2500 },
-            .cellChildMap = { { 0, 1, 2 }, { 0, 1, 3 } } }),
-        /* 5 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 2,
-            .columns = 3,
-            .rowsPercents = { 5000, 5000 },
-            .columnsPercents = { 2500, 5000, 2500 },
-            .cellChildMap = { { 0, 1, 2 }, { 3, 1, 4 } } }),
-        /* 6 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 3,
-            .columns = 3,
-            .rowsPercents = { 3333, 3334, 3333 },
-            .columnsPercents = { 2500, 5000, 2500 },
-            .cellChildMap = { { 0, 1, 2 }, { 0, 1, 3 }, { 4, 1, 5 } } }),
-        /* 7 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 3,
-            .columns = 3,
-            .rowsPercents = { 3333, 3334, 3333 },
-            .columnsPercents = { 2500, 5000, 2500 },
-            .cellChildMap = { { 0, 1, 2 }, { 3, 1, 4 }, { 5, 1, 6 } } }),
-        /* 8 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 3,
-            .columns = 4,
-            .rowsPercents = { 3333, 3334, 3333 },
-            .columnsPercents = { 2500, 2500, 2500, 2500 },
-            .cellChildMap = { { 0, 1, 2, 3 }, { 4, 1, 2, 5 }, { 6, 1, 2, 7 } } }),
-        /* 9 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 3,
-            .columns = 4,
-            .rowsPercents = { 3333, 3334, 3333 },
-            .columnsPercents = { 2500, 2500, 2500, 2500 },
-            .cellChildMap = { { 0, 1, 2, 3 }, { 4, 1, 2, 5 }, { 6, 1, 7, 8 } } }),
-        /* 10 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 3,
-            .columns = 4,
-            .rowsPercents = { 3333, 3334, 3333 },
-            .columnsPercents = { 2500, 2500, 2500, 2500 },
-            .cellChildMap = { { 0, 1, 2, 3 }, { 4, 1, 5, 6 }, { 7, 1, 8, 9 } } }),
-        /* 11 */
-        FancyZonesDataTypes::GridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Full{
-            .rows = 3,
-            .columns = 4,
-            .rowsPercents = { 3333, 3334, 3333 },
-            .columnsPercents = { 2500, 2500, 2500, 2500 },
-            .cellChildMap = { { 0, 1, 2, 3 }, { 4, 1, 5, 6 }, { 7, 8, 9, 10 } } }),
-    };
-
-    inline void StampWindow(HWND window, size_t bitmask) noexcept
-    {
-        SetProp(window, ZonedWindowProperties::PropertyMultipleZoneID, reinterpret_cast<HANDLE>(bitmask));
-    }
-}
-
 struct ZoneSet : winrt::implements<ZoneSet, IZoneSet>
 {
 public:
@@ -121,6 +30,10 @@ public:
         m_config(config),
         m_zones(zones)
     {
+        for (const auto& [zoneId, zone] : m_zones)
+        {
+            m_zoneRects.push_back({ zoneId, zone->GetZoneRect() });
+        }
     }
 
     IFACEMETHODIMP_(GUID)
@@ -132,12 +45,16 @@ public:
     ZonesFromPoint(POINT pt) const noexcept;
     IFACEMETHODIMP_(std::vector<size_t>)
     GetZoneIndexSetFromWindow(HWND window) const noexcept;
-    IFACEMETHODIMP_(ZonesMap)
+    IFACEMETHODIMP_(const ZonesMap&)
     GetZones()const noexcept override { return m_zones; }
+    IFACEMETHODIMP_(const ZoneNavigationGraph&)
+    GetNavigationGraph() const noexcept override { return m_navigationGraph.IsBuilt() ? m_navigationGraph : GetNavigationGraph(m_workAreaSize); }
     IFACEMETHODIMP_(void)
     MoveWindowIntoZoneByIndex(HWND window, HWND workAreaWindow, size_t index) noexcept;
     IFACEMETHODIMP_(void)
     MoveWindowIntoZoneByIndexSet(HWND window, HWND workAreaWindow, const std::vector<size_t>& indexSet) noexcept;
+    IFACEMETHODIMP_(void)
+    AssignWindowToZones(HWND window, const std::vector<size_t>& indexSet) noexcept;
     IFACEMETHODIMP_(bool)
     MoveWindowIntoZoneByDirectionAndIndex(HWND window, HWND workAreaWindow, DWORD vkCode, bool cycle) noexcept;
     IFACEMETHODIMP_(bool)
@@ -154,20 +71,20 @@ public:
     GetCombinedZoneRange(const std::vector<size_t>& initialZones, const std::vector<size_t>& finalZones) const noexcept;
 
 private:
-    bool CalculateFocusLayout(Rect workArea, int zoneCount) noexcept;
-    bool CalculateColumnsAndRowsLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing) noexcept;
-    bool CalculateGridLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing) noexcept;
-    bool CalculateUniquePriorityGridLayout(Rect workArea, int zoneCount, int spacing) noexcept;
-    bool CalculateCustomLayout(Rect workArea, int spacing) noexcept;
-    bool CalculateGridZones(Rect workArea, FancyZonesDataTypes::GridLayoutInfo gridLayoutInfo, int spacing);
-    std::vector<size_t> ZoneSelectSubregion(const std::vector<size_t>& capturedZones, POINT pt) const;
-    std::vector<size_t> ZoneSelectClosestCenter(const std::vector<size_t>& capturedZones, POINT pt) const;
-
-    // `compare` should return true if the first argument is a better choice than the second argument.
-    template<class CompareF>
-    std::vector<size_t> ZoneSelectPriority(const std::vector<size_t>& capturedZones, CompareF compare) const;
+    bool CalculateCustomLayout(RECT workArea, int spacing, LayoutEngine::Zones& zones) const noexcept;
+
+    const ZoneSpatialIndex& GetSpatialIndex() const;
+    const ZoneNavigationGraph& GetNavigationGraph(SIZE workAreaSize) const;
 
     ZonesMap m_zones;
+    // Same zones as m_zones, as plain rectangles
+    LayoutEngine::Zones m_zoneRects;
+    // Built by CalculateZones, or on the first hit-test after zones were added with AddZone
+    mutable ZoneSpatialIndex m_spatialIndex;
+    // Built by CalculateZones, or on the first move by position after zones were added with AddZone
+    // or the work area was resized
+    mutable ZoneNavigationGraph m_navigationGraph;
+    SIZE m_workAreaSize{};
     std::map<HWND, std::vector<size_t>> m_windowIndexSet;
 
     // Needed for ExtendWindowByDirectionAndPosition
@@ -187,95 +104,36 @@ IFACEMETHODIMP ZoneSet::AddZone(winrt::com_ptr<IZone> zone) noexcept
     }
     m_zones[zoneId] = zone;
 
+    auto position = std::upper_bound(m_zoneRects.begin(), m_zoneRects.end(), zoneId, [](size_t id, const LayoutEngine::Zone& zone) { return id < zone.id; });
+    m_zoneRects.insert(position, { zoneId, zone->GetZoneRect() });
+    m_spatialIndex.Clear();
+    m_navigationGraph.Clear();
+
     return S_OK;
 }
 
-IFACEMETHODIMP_(std::vector<size_t>)
-ZoneSet::ZonesFromPoint(POINT pt) const noexcept
+const ZoneSpatialIndex& ZoneSet::GetSpatialIndex() const
 {
-    std::vector<size_t> capturedZones;
-    std::vector<size_t> strictlyCapturedZones;
-    for (const auto& [zoneId, zone] : m_zones)
+    if (!m_spatialIndex.IsBuilt())
     {
-        const RECT& zoneRect = zone->GetZoneRect();
-        if (zoneRect.left - m_config.SensitivityRadius <= pt.x && pt.x <= zoneRect.right + m_config.SensitivityRadius &&
-            zoneRect.top - m_config.SensitivityRadius <= pt.y && pt.y <= zoneRect.bottom + m_config.SensitivityRadius)
-        {
-            capturedZones.emplace_back(zoneId);
-        }
-            
-        if (zoneRect.left <= pt.x && pt.x < zoneRect.right &&
-            zoneRect.top <= pt.y && pt.y < zoneRect.bottom)
-        {
-            strictlyCapturedZones.emplace_back(zoneId);
-        }
-    }
-
-    // If only one zone is captured, but it's not strictly captured
-    // don't consider it as captured
-    if (capturedZones.size() == 1 && strictlyCapturedZones.size() == 0)
-    {
-        return {};
-    }
-
-    // If captured zones do not overlap, return all of them
-    // Otherwise, return one of them based on the chosen selection algorithm.
-    bool overlap = false;
-    for (size_t i = 0; i < capturedZones.size(); ++i)
-    {
-        for (size_t j = i + 1; j < capturedZones.size(); ++j)
-        {
-            RECT rectI;
-            RECT rectJ;
-            try
-            {
-                rectI = m_zones.at(capturedZones[i])->GetZoneRect();
-                rectJ = m_zones.at(capturedZones[j])->GetZoneRect();
-            }
-            catch (std::out_of_range)
-            {
-                return {};
-            }
-
-            if (max(rectI.top, rectJ.top) + m_config.SensitivityRadius < min(rectI.bottom, rectJ.bottom) &&
-                max(rectI.left, rectJ.left) + m_config.SensitivityRadius < min(rectI.right, rectJ.right))
-            {
-                overlap = true;
-                break;
-            }
-        }
-        if (overlap)
-        {
-            break;
-        }
+        m_spatialIndex.Build(m_zoneRects, m_config.SensitivityRadius);
     }
+    return m_spatialIndex;
+}
 
-    if (overlap)
+const ZoneNavigationGraph& ZoneSet::GetNavigationGraph(SIZE workAreaSize) const
+{
+    if (!m_navigationGraph.IsBuiltFor(workAreaSize))
     {
-        try
-        {
-            using Algorithm = Settings::OverlappingZonesAlgorithm;
-
-            switch (m_config.SelectionAlgorithm)
-            {
-            case Algorithm::Smallest:
-                return ZoneSelectPriority(capturedZones, [&](auto zone1, auto zone2) { return zone1->GetZoneArea() < zone2->GetZoneArea(); });
-            case Algorithm::Largest:
-                return ZoneSelectPriority(capturedZones, [&](auto zone1, auto zone2) { return zone1->GetZoneArea() > zone2->GetZoneArea(); });
-            case Algorithm::Positional:
-                return ZoneSelectSubregion(capturedZones, pt);
-            case Algorithm::ClosestCenter:
-                return ZoneSelectClosestCenter(capturedZones, pt);
-            }
-        }
-        catch (std::out_of_range)
-        {
-            Logger::error("Exception out_of_range was thrown in ZoneSet::ZonesFromPoint");
-            return { capturedZones[0] };
-        }
+        m_navigationGraph.Build(m_zoneRects, workAreaSize);
     }
+    return m_navigationGraph;
+}
 
-    return capturedZones;
+IFACEMETHODIMP_(std::vector<size_t>)
+ZoneSet::ZonesFromPoint(POINT pt) const noexcept
+{
+    return LayoutEngine::ZonesFromPoint(GetSpatialIndex(), pt, m_config.SelectionAlgorithm);
 }
 
 std::vector<size_t> ZoneSet::GetZoneIndexSetFromWindow(HWND window) const noexcept
@@ -314,7 +172,6 @@ ZoneSet::MoveWindowIntoZoneByIndexSet(HWND window, HWND workAreaWindow, const st
 
     RECT size;
     bool sizeEmpty = true;
-    size_t bitmask = 0;
 
     m_windowIndexSet[window] = {};
 
@@ -339,21 +196,25 @@ ZoneSet::MoveWindowIntoZoneByIndexSet(HWND window, HWND workAreaWindow, const st
 
             m_windowIndexSet[window].push_back(id);
         }
-
-        if (id < std::numeric_limits<size_t>::digits)
-        {
-            bitmask |= 1ull << id;
-        }
     }
 
     if (!sizeEmpty)
     {
         SaveWindowSizeAndOrigin(window);
         SizeWindowToRect(window, size);
-        StampWindow(window, bitmask);
+        // Only the zones of the layout the window was moved into
+        StampZoneIndexSet(window, m_windowIndexSet[window]);
     }
 }
 
+IFACEMETHODIMP_(void)
+ZoneSet::AssignWindowToZones(HWND window, const std::vector<size_t>& indexSet) noexcept
+{
+    m_windowFinalIndex.erase(window);
+    m_windowInitialIndexSet.erase(window);
+    m_windowIndexSet[window] = indexSet;
+}
+
 IFACEMETHODIMP_(bool)
 ZoneSet::MoveWindowIntoZoneByDirectionAndIndex(HWND window, HWND workAreaWindow, DWORD vkCode, bool cycle) noexcept
 {
@@ -409,53 +270,39 @@ ZoneSet::MoveWindowIntoZoneByDirectionAndPosition(HWND window, HWND workAreaWind
         return false;
     }
 
-    std::vector<bool> usedZoneIndices(m_zones.size(), false);
-    for (size_t id : GetZoneIndexSetFromWindow(window))
+    RECT windowRect, windowZoneRect;
+    if (GetWindowRect(window, &windowRect) && GetWindowRect(workAreaWindow, &windowZoneRect))
     {
-        usedZoneIndices[id] = true;
-    }
-
-    std::vector<RECT> zoneRects;
-    std::vector<size_t> freeZoneIndices;
+        const auto& graph = GetNavigationGraph(SIZE{ windowZoneRect.right - windowZoneRect.left, windowZoneRect.bottom - windowZoneRect.top });
+        const auto indexSet = GetZoneIndexSetFromWindow(window);
 
-    for (const auto& [zoneId, zone] : m_zones)
-    {
-        if (!usedZoneIndices[zoneId])
+        // Searched from the window rect, not from the center of its zone: the window can be
+        // offset from its zone, ex: by its invisible borders
+        std::vector<bool> usedZoneIndices(m_zones.size(), false);
+        for (size_t id : indexSet)
         {
-            zoneRects.emplace_back(m_zones[zoneId]->GetZoneRect());
-            freeZoneIndices.emplace_back(zoneId);
+            usedZoneIndices[id] = true;
         }
-    }
 
-    RECT windowRect, windowZoneRect;
-    if (GetWindowRect(window, &windowRect) && GetWindowRect(workAreaWindow, &windowZoneRect))
-    {
         // Move to coordinates relative to windowZone
         windowRect.top -= windowZoneRect.top;
         windowRect.bottom -= windowZoneRect.top;
         windowRect.left -= windowZoneRect.left;
         windowRect.right -= windowZoneRect.left;
 
-        size_t result = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, windowRect, zoneRects);
-        if (result < zoneRects.size())
-        {
-            MoveWindowIntoZoneByIndex(window, workAreaWindow, freeZoneIndices[result]);
-            return true;
-        }
-        else if (cycle)
+        std::optional<size_t> result = graph.Search(windowRect, vkCode, usedZoneIndices);
+        if (!result && cycle)
         {
             // Try again from the position off the screen in the opposite direction to vkCode
             // Consider all zones as available
-            zoneRects.resize(m_zones.size());
-            std::transform(m_zones.begin(), m_zones.end(), zoneRects.begin(), [](auto zone) { return zone.second->GetZoneRect(); });
             windowRect = FancyZonesUtils::PrepareRectForCycling(windowRect, windowZoneRect, vkCode);
-            result = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, windowRect, zoneRects);
+            result = graph.Search(windowRect, vkCode);
+        }
 
-            if (result < zoneRects.size())
-            {
-                MoveWindowIntoZoneByIndex(window, workAreaWindow, result);
-                return true;
-            }
+        if (result)
+        {
+            MoveWindowIntoZoneByIndex(window, workAreaWindow, *result);
+            return true;
         }
     }
 
@@ -473,21 +320,24 @@ ZoneSet::ExtendWindowByDirectionAndPosition(HWND window, HWND workAreaWindow, DW
     RECT windowRect, windowZoneRect;
     if (GetWindowRect(window, &windowRect) && GetWindowRect(workAreaWindow, &windowZoneRect))
     {
+        const auto& graph = GetNavigationGraph(SIZE{ windowZoneRect.right - windowZoneRect.left, windowZoneRect.bottom - windowZoneRect.top });
         auto oldZones = GetZoneIndexSetFromWindow(window);
-        std::vector<bool> usedZoneIndices(m_zones.size(), false);
-        std::vector<RECT> zoneRects;
-        std::vector<size_t> freeZoneIndices;
+        std::optional<size_t> result;
 
         // If selectManyZones = true for the second time, use the last zone into which we moved
         // instead of the window rect and enable moving to all zones except the old one
         auto finalIndexIt = m_windowFinalIndex.find(window);
         if (finalIndexIt != m_windowFinalIndex.end())
         {
-            usedZoneIndices[finalIndexIt->second] = true;
-            windowRect = m_zones[finalIndexIt->second]->GetZoneRect();
+            const auto& neighbours = graph.Neighbours(finalIndexIt->second, vkCode);
+            if (!neighbours.empty())
+            {
+                result = neighbours.front();
+            }
         }
         else
         {
+            std::vector<bool> usedZoneIndices(m_zones.size(), false);
             for (size_t idx : oldZones)
             {
                 usedZoneIndices[idx] = true;
@@ -497,21 +347,13 @@ ZoneSet::ExtendWindowByDirectionAndPosition(HWND window, HWND workAreaWindow, DW
             windowRect.bottom -= windowZoneRect.top;
             windowRect.left -= windowZoneRect.left;
             windowRect.right -= windowZoneRect.left;
-        }
 
-        for (size_t i = 0; i < m_zones.size(); i++)
-        {
-            if (!usedZoneIndices[i])
-            {
-                zoneRects.emplace_back(m_zones[i]->GetZoneRect());
-                freeZoneIndices.emplace_back(i);
-            }
+            result = graph.Search(windowRect, vkCode, usedZoneIndices);
         }
 
-        size_t result = FancyZonesUtils::ChooseNextZoneByPosition(vkCode, windowRect, zoneRects);
-        if (result < zoneRects.size())
+        if (result)
         {
-            size_t targetZone = freeZoneIndices[result];
+            size_t targetZone = *result;
             std::vector<size_t> resultIndexSet;
 
             // First time with selectManyZones = true for this window?
@@ -571,205 +413,52 @@ ZoneSet::CalculateZones(RECT workAreaRect, int zoneCount, int spacing) noexcept
         return false;
     }
 
+    LayoutEngine::Zones zones;
     bool success = true;
-    switch (m_config.LayoutType)
+    if (m_config.LayoutType == FancyZonesDataTypes::ZoneSetLayoutType::Custom)
     {
-    case FancyZonesDataTypes::ZoneSetLayoutType::Focus:
-        success = CalculateFocusLayout(workArea, zoneCount);
-        break;
-    case FancyZonesDataTypes::ZoneSetLayoutType::Columns:
-    case FancyZonesDataTypes::ZoneSetLayoutType::Rows:
-        success = CalculateColumnsAndRowsLayout(workArea, m_config.LayoutType, zoneCount, spacing);
-        break;
-    case FancyZonesDataTypes::ZoneSetLayoutType::Grid:
-    case FancyZonesDataTypes::ZoneSetLayoutType::PriorityGrid:
-        success = CalculateGridLayout(workArea, m_config.LayoutType, zoneCount, spacing);
-        break;
-    case FancyZonesDataTypes::ZoneSetLayoutType::Custom:
-        success = CalculateCustomLayout(workArea, spacing);
-        break;
+        success = CalculateCustomLayout(workAreaRect, spacing, zones);
     }
-
-    return success;
-}
-
-bool ZoneSet::IsZoneEmpty(int zoneIndex) const noexcept
-{
-    for (auto& [window, zones] : m_windowIndexSet)
+    else
     {
-        if (find(begin(zones), end(zones), zoneIndex) != end(zones))
-        {
-            return false;
-        }
+        success = LayoutEngine::CalculateLayout(workAreaRect, m_config.LayoutType, zoneCount, spacing, zones);
     }
 
-    return true;
-}
-
-bool ZoneSet::CalculateFocusLayout(Rect workArea, int zoneCount) noexcept
-{
-    long left{ 100 };
-    long top{ 100 };
-    long right{ left + long(workArea.width() * 0.4) };
-    long bottom{ top + long(workArea.height() * 0.4) };
-
-    RECT focusZoneRect{ left, top, right, bottom };
-
-    long focusRectXIncrement = (zoneCount <= 1) ? 0 : 50;
-    long focusRectYIncrement = (zoneCount <= 1) ? 0 : 50;
-
-    for (int i = 0; i < zoneCount; i++)
+    if (success)
     {
-        auto zone = MakeZone(focusZoneRect, m_zones.size());
-        if (zone)
-        {
-            AddZone(zone);
-        }
-        else
+        for (const auto& [zoneId, rect] : zones)
         {
-            // All zones within zone set should be valid in order to use its functionality.
-            m_zones.clear();
-            return false;
+            AddZone(MakeZone(rect, zoneId));
         }
-        focusZoneRect.left += focusRectXIncrement;
-        focusZoneRect.right += focusRectXIncrement;
-        focusZoneRect.bottom += focusRectYIncrement;
-        focusZoneRect.top += focusRectYIncrement;
-    }
-
-    return true;
-}
-
-bool ZoneSet::CalculateColumnsAndRowsLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing) noexcept
-{
-    long totalWidth;
-    long totalHeight;
-
-    if (type == FancyZonesDataTypes::ZoneSetLayoutType::Columns)
-    {
-        totalWidth = workArea.width() - (spacing * (zoneCount + 1));
-        totalHeight = workArea.height() - (spacing * 2);
     }
     else
-    { //Rows
-        totalWidth = workArea.width() - (spacing * 2);
-        totalHeight = workArea.height() - (spacing * (zoneCount + 1));
-    }
-
-    long top = spacing;
-    long left = spacing;
-    long bottom;
-    long right;
-
-    // Note: The expressions below are NOT equal to total{Width|Height} / zoneCount and are done
-    // like this to make the sum of all zones' sizes exactly total{Width|Height}.
-    for (int zoneIndex = 0; zoneIndex < zoneCount; ++zoneIndex)
     {
-        if (type == FancyZonesDataTypes::ZoneSetLayoutType::Columns)
-        {
-            right = left + (zoneIndex + 1) * totalWidth / zoneCount - zoneIndex * totalWidth / zoneCount;
-            bottom = totalHeight + spacing;
-        }
-        else
-        { //Rows
-            right = totalWidth + spacing;
-            bottom = top + (zoneIndex + 1) * totalHeight / zoneCount - zoneIndex * totalHeight / zoneCount;
-        }
-
-
-        auto zone = MakeZone(RECT{ left, top, right, bottom }, m_zones.size());
-        if (zone)
-        {
-            AddZone(zone);
-        }
-        else
-        {
-            // All zones within zone set should be valid in order to use its functionality.
-            m_zones.clear();
-            return false;
-        }
-
-        if (type == FancyZonesDataTypes::ZoneSetLayoutType::Columns)
-        {
-            left = right + spacing;
-        }
-        else
-        { //Rows
-            top = bottom + spacing;
-        }
+        // All zones within zone set should be valid in order to use its functionality.
+        m_zones.clear();
+        m_zoneRects.clear();
     }
 
-    return true;
+    m_spatialIndex.Build(m_zoneRects, m_config.SensitivityRadius);
+    m_workAreaSize = SIZE{ workAreaRect.right - workAreaRect.left, workAreaRect.bottom - workAreaRect.top };
+    m_navigationGraph.Build(m_zoneRects, m_workAreaSize);
+
+    return success;
 }
 
-bool ZoneSet::CalculateGridLayout(Rect workArea, FancyZonesDataTypes::ZoneSetLayoutType type, int zoneCount, int spacing) noexcept
+bool ZoneSet::IsZoneEmpty(int zoneIndex) const noexcept
 {
-    const auto count = sizeof(predefinedPriorityGridLayouts) / sizeof(FancyZonesDataTypes::GridLayoutInfo);
-    if (type == FancyZonesDataTypes::ZoneSetLayoutType::PriorityGrid && zoneCount < count)
-    {
-        return CalculateUniquePriorityGridLayout(workArea, zoneCount, spacing);
-    }
-
-    int rows = 1, columns = 1;
-    while (zoneCount / rows >= rows)
-    {
-        rows++;
-    }
-    rows--;
-    columns = zoneCount / rows;
-    if (zoneCount % rows == 0)
-    {
-        // even grid
-    }
-    else
-    {
-        columns++;
-    }
-
-    FancyZonesDataTypes::GridLayoutInfo gridLayoutInfo(FancyZonesDataTypes::GridLayoutInfo::Minimal{ .rows = rows, .columns = columns });
-
-    // Note: The expressions below are NOT equal to C_MULTIPLIER / {rows|columns} and are done
-    // like this to make the sum of all percents exactly C_MULTIPLIER
-    for (int row = 0; row < rows; row++)
-    {
-        gridLayoutInfo.rowsPercents()[row] = C_MULTIPLIER * (row + 1) / rows - C_MULTIPLIER * row / rows;
-    }
-    for (int col = 0; col < columns; col++)
-    {
-        gridLayoutInfo.columnsPercents()[col] = C_MULTIPLIER * (col + 1) / columns - C_MULTIPLIER * col / columns;
-    }
-
-    for (int i = 0; i < rows; ++i)
-    {
-        gridLayoutInfo.cellChildMap()[i] = std::vector<int>(columns);
-    }
-
-    int index = 0;
-    for (int row = 0; row < rows; row++)
+    for (auto& [window, zones] : m_windowIndexSet)
     {
-        for (int col = 0; col < columns; col++)
+        if (find(begin(zones), end(zones), zoneIndex) != end(zones))
         {
-            gridLayoutInfo.cellChildMap()[row][col] = index++;
-            if (index == zoneCount)
-            {
-                index--;
-            }
+            return false;
         }
     }
-    return CalculateGridZones(workArea, gridLayoutInfo, spacing);
-}
 
-bool ZoneSet::CalculateUniquePriorityGridLayout(Rect workArea, int zoneCount, int spacing) noexcept
-{
-    if (zoneCount <= 0 || zoneCount >= sizeof(predefinedPriorityGridLayouts))
-    {
-        return false;
-    }
-
-    return CalculateGridZones(workArea, predefinedPriorityGridLayouts[zoneCount - 1], spacing);
+    return true;
 }
 
-bool ZoneSet::CalculateCustomLayout(Rect workArea, int spacing) noexcept
+bool ZoneSet::CalculateCustomLayout(RECT workArea, int spacing, LayoutEngine::Zones& zones) const noexcept
 {
     wil::unique_cotaskmem_string guidStr;
     if (SUCCEEDED(StringFromCLSID(m_config.Id, &guidStr)))
@@ -786,252 +475,33 @@ bool ZoneSet::CalculateCustomLayout(Rect workArea, int spacing) noexcept
         const auto& zoneSet = *zoneSetSearchResult;
         if (zoneSet.type == FancyZonesDataTypes::CustomLayoutType::Canvas && std::holds_alternative<FancyZonesDataTypes::CanvasLayoutInfo>(zoneSet.info))
         {
-            const auto& zoneSetInfo = std::get<FancyZonesDataTypes::CanvasLayoutInfo>(zoneSet.info);
-            for (const auto& zone : zoneSetInfo.zones)
+            HMONITOR monitor = m_config.Monitor;
+            if (monitor == nullptr)
             {
-                int x = zone.x;
-                int y = zone.y;
-                int width = zone.width;
-                int height = zone.height;
-
-                DPIAware::Convert(m_config.Monitor, x, y);
-                DPIAware::Convert(m_config.Monitor, width, height);
+                monitor = MonitorFromPoint(POINT{ 0, 0 }, MONITOR_DEFAULTTOPRIMARY);
+            }
 
-                auto zone = MakeZone(RECT{ x, y, x + width, y + height }, m_zones.size());
-                if (zone)
-                {
-                    AddZone(zone);
-                }
-                else
-                {
-                    // All zones within zone set should be valid in order to use its functionality.
-                    m_zones.clear();
-                    return false;
-                }
+            UINT dpi = DPIAware::DEFAULT_DPI;
+            if (FAILED(DPIAware::GetScreenDPIForMonitor(monitor, dpi)))
+            {
+                dpi = DPIAware::DEFAULT_DPI;
             }
 
-            return true;
+            return LayoutEngine::CalculateCanvasZones(std::get<FancyZonesDataTypes::CanvasLayoutInfo>(zoneSet.info), dpi, zones);
         }
         else if (zoneSet.type == FancyZonesDataTypes::CustomLayoutType::Grid && std::holds_alternative<FancyZonesDataTypes::GridLayoutInfo>(zoneSet.info))
         {
             const auto& info = std::get<FancyZonesDataTypes::GridLayoutInfo>(zoneSet.info);
-            return CalculateGridZones(workArea, info, spacing);
+            return LayoutEngine::CalculateGridZones(workArea, info, spacing, zones);
         }
     }
 
     return false;
 }
 
-bool ZoneSet::CalculateGridZones(Rect workArea, FancyZonesDataTypes::GridLayoutInfo gridLayoutInfo, int spacing)
-{
-    long totalWidth = workArea.width();
-    long totalHeight = workArea.height();
-    struct Info
-    {
-        long Extent;
-        long Start;
-        long End;
-    };
-    std::vector<Info> rowInfo(gridLayoutInfo.rows());
-    std::vector<Info> columnInfo(gridLayoutInfo.columns());
-
-    // Note: The expressions below are carefully written to 
-    // make the sum of all zones' sizes exactly total{Width|Height}
-    int totalPercents = 0;
-    for (int row = 0; row < gridLayoutInfo.rows(); row++)
-    {
-        rowInfo[row].Start = totalPercents * totalHeight / C_MULTIPLIER;
-        totalPercents += gridLayoutInfo.rowsPercents()[row];
-        rowInfo[row].End = totalPercents * totalHeight / C_MULTIPLIER;
-        rowInfo[row].Extent = rowInfo[row].End - rowInfo[row].Start;
-    }
-
-    totalPercents = 0;
-    for (int col = 0; col < gridLayoutInfo.columns(); col++)
-    {
-        columnInfo[col].Start = totalPercents * totalWidth / C_MULTIPLIER;
-        totalPercents += gridLayoutInfo.columnsPercents()[col];
-        columnInfo[col].End = totalPercents * totalWidth / C_MULTIPLIER;
-        columnInfo[col].Extent = columnInfo[col].End - columnInfo[col].Start;
-    }
-
-    for (int row = 0; row < gridLayoutInfo.rows(); row++)
-    {
-        for (int col = 0; col < gridLayoutInfo.columns(); col++)
-        {
-            int i = gridLayoutInfo.cellChildMap()[row][col];
-            if (((row == 0) || (gridLayoutInfo.cellChildMap()[row - 1][col] != i)) &&
-                ((col == 0) || (gridLayoutInfo.cellChildMap()[row][col - 1] != i)))
-            {
-                long left = columnInfo[col].Start;
-                long top = rowInfo[row].Start;
-
-                int maxRow = row;
-                while (((maxRow + 1) < gridLayoutInfo.rows()) && (gridLayoutInfo.cellChildMap()[maxRow + 1][col] == i))
-                {
-                    maxRow++;
-                }
-                int maxCol = col;
-                while (((maxCol + 1) < gridLayoutInfo.columns()) && (gridLayoutInfo.cellChildMap()[row][maxCol + 1] == i))
-                {
-                    maxCol++;
-                }
-
-                long right = columnInfo[maxCol].End;
-                long bottom = rowInfo[maxRow].End;
-
-                top += row == 0 ? spacing : spacing / 2;
-                bottom -= maxRow == gridLayoutInfo.rows() - 1 ? spacing : spacing / 2;
-                left += col == 0 ? spacing : spacing / 2;
-                right -= maxCol == gridLayoutInfo.columns() - 1 ? spacing : spacing / 2;
-
-                auto zone = MakeZone(RECT{ left, top, right, bottom }, i);
-                if (zone)
-                {
-                    AddZone(zone);
-                }
-                else
-                {
-                    // All zones within zone set should be valid in order to use its functionality.
-                    m_zones.clear();
-                    return false;
-                }
-            }
-        }
-    }
-
-    return true;
-}
-
 std::vector<size_t> ZoneSet::GetCombinedZoneRange(const std::vector<size_t>& initialZones, const std::vector<size_t>& finalZones) const noexcept
 {
-    std::vector<size_t> combinedZones, result;
-    std::set_union(begin(initialZones), end(initialZones), begin(finalZones), end(finalZones), std::back_inserter(combinedZones));
-
-    RECT boundingRect;
-    bool boundingRectEmpty = true;
-
-    for (size_t zoneId : combinedZones)
-    {
-        if (m_zones.contains(zoneId))
-        {
-            const RECT rect = m_zones.at(zoneId)->GetZoneRect();
-            if (boundingRectEmpty)
-            {
-                boundingRect = rect;
-                boundingRectEmpty = false;
-            }
-            else
-            {
-                boundingRect.left = min(boundingRect.left, rect.left);
-                boundingRect.top = min(boundingRect.top, rect.top);
-                boundingRect.right = max(boundingRect.right, rect.right);
-                boundingRect.bottom = max(boundingRect.bottom, rect.bottom);
-            }
-        }
-    }
-
-    if (!boundingRectEmpty)
-    {
-        for (const auto& [zoneId, zone] : m_zones)
-        {
-            const RECT rect = zone->GetZoneRect();
-            if (boundingRect.left <= rect.left && rect.right <= boundingRect.right &&
-                boundingRect.top <= rect.top && rect.bottom <= boundingRect.bottom)
-            {
-                result.push_back(zoneId);
-            }
-        }
-    }
-
-    return result;
-}
-
-std::vector<size_t> ZoneSet::ZoneSelectSubregion(const std::vector<size_t>& capturedZones, POINT pt) const
-{
-    auto expand = [&](RECT& rect) {
-        rect.top -= m_config.SensitivityRadius / 2;
-        rect.bottom += m_config.SensitivityRadius / 2;
-        rect.left -= m_config.SensitivityRadius / 2;
-        rect.right += m_config.SensitivityRadius / 2;
-    };
-
-    // Compute the overlapped rectangle.
-    RECT overlap = m_zones.at(capturedZones[0])->GetZoneRect();
-    expand(overlap);
-
-    for (size_t i = 1; i < capturedZones.size(); ++i)
-    {
-        RECT current = m_zones.at(capturedZones[i])->GetZoneRect();
-        expand(current);
-
-        overlap.top = max(overlap.top, current.top);
-        overlap.left = max(overlap.left, current.left);
-        overlap.bottom = min(overlap.bottom, current.bottom);
-        overlap.right = min(overlap.right, current.right);
-    }
-
-    // Avoid division by zero
-    int width = max(overlap.right - overlap.left, 1);
-    int height = max(overlap.bottom - overlap.top, 1);
-
-    bool verticalSplit = height > width;
-    size_t zoneIndex;
-
-    if (verticalSplit)
-    {
-        zoneIndex = (pt.y - overlap.top) * capturedZones.size() / height;
-    }
-    else
-    {
-        zoneIndex = (pt.x - overlap.left) * capturedZones.size() / width;
-    }
-
-    zoneIndex = std::clamp(zoneIndex, size_t(0), capturedZones.size() - 1);
-
-    return { capturedZones[zoneIndex] };
-}
-
-std::vector<size_t> ZoneSet::ZoneSelectClosestCenter(const std::vector<size_t>& capturedZones, POINT pt) const
-{
-    auto getCenter = [](auto zone) {
-        RECT rect = zone->GetZoneRect();
-        return POINT{ (rect.right + rect.left) / 2, (rect.top + rect.bottom) / 2 };
-    };
-    auto pointDifference = [](POINT pt1, POINT pt2) {
-        return (pt1.x - pt2.x) * (pt1.x - pt2.x) + (pt1.y - pt2.y) * (pt1.y - pt2.y);
-    };
-    auto distanceFromCenter = [&](auto zone) {
-        POINT center = getCenter(zone);
-        return pointDifference(center, pt);
-    };
-    auto closerToCenter = [&](auto zone1, auto zone2) {
-        if (pointDifference(getCenter(zone1), getCenter(zone2)) > OVERLAPPING_CENTERS_SENSITIVITY)
-        {
-            return distanceFromCenter(zone1) < distanceFromCenter(zone2);
-        }
-        else
-        {
-            return zone1->GetZoneArea() < zone2->GetZoneArea();
-        };
-    };
-    return ZoneSelectPriority(capturedZones, closerToCenter);
-}
-
-template<class CompareF>
-std::vector<size_t> ZoneSet::ZoneSelectPriority(const std::vector<size_t>& capturedZones, CompareF compare) const
-{
-    size_t chosen = 0;
-
-    for (size_t i = 1; i < capturedZones.size(); ++i)
-    {
-        if (compare(m_zones.at(capturedZones[i]), m_zones.at(capturedZones[chosen])))
-        {
-            chosen = i;
-        }
-    }
-
-    return { capturedZones[chosen] };
+    return LayoutEngine::GetCombinedZoneRange(m_zoneRects, initialZones, finalZones);
 }
 
 winrt::com_ptr<IZoneSet> MakeZoneSet(ZoneSetConfig const& config) noexcept
@@ -7,6 +7,9 @@ namespace FancyZonesDataTypes
 {
     enum class ZoneSetLayoutType;
 }
+
+class ZoneNavigationGraph;
+
 /**
  * Class representing single zone layout. ZoneSet is responsible for actual calculation of rectangle coordinates
  * (whether is grid or canvas layout) and moving windows through them.
@@ -48,7 +51,11 @@ interface __declspec(uuid("{E4839EB7-669D-49CF-84A9-71A2DFD851A3}")) IZoneSet :
     /**
      * @returns Array of zone objects (defining coordinates of the zone) inside this zone layout.
      */
-    IFACEMETHOD_(ZonesMap, GetZones) () const = 0;
+    IFACEMETHOD_(const ZonesMap&, GetZones) () const = 0;
+    /**
+     * @returns Centers and neighbours of the zones, used to move windows based on zone position.
+     */
+    IFACEMETHOD_(const ZoneNavigationGraph&, GetNavigationGraph) () const = 0;
     /**
      * Assign window to the zone based on zone index inside zone layout.
      *
@@ -69,6 +76,14 @@ interface __declspec(uuid("{E4839EB7-669D-49CF-84A9-71A2DFD851A3}")) IZoneSet :
      */
     IFACEMETHOD_(void, MoveWindowIntoZoneByIndexSet)
     (HWND window, HWND workAreaWindow, const std::vector<size_t>& indexSet) = 0;
+    /**
+     * Assign window to the zones without moving it, for windows moved together by WindowRelayout.
+     *
+     * @param   window   Handle of window which was moved into the zones.
+     * @param   indexSet The set of zone indices within zone layout, all of them existing zones.
+     */
+    IFACEMETHOD_(void, AssignWindowToZones)
+    (HWND window, const std::vector<size_t>& indexSet) = 0;
     /**
      * Assign window to the zone based on direction (using WIN + LEFT/RIGHT arrow), based on zone index numbers,
      * not their on-screen position.
@@ -0,0 +1,170 @@
+#include "pch.h"
+
+#include "ZoneSpatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Cells per zone along each axis, a zone usually spans a few cells
+    constexpr size_t CELLS_PER_ZONE = 2;
+    constexpr size_t MAX_CELLS_PER_AXIS = 64;
+}
+
+void ZoneSpatialIndex::Build(const LayoutEngine::Zones& zones, int sensitivityRadius)
+{
+    Clear();
+    m_sensitivityRadius = sensitivityRadius;
+    m_built = true;
+
+    if (zones.empty())
+    {
+        return;
+    }
+
+    m_zones = zones;
+
+    m_bounds = RECT{ LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN };
+    for (const auto& zone : m_zones)
+    {
+        m_bounds.left = min(m_bounds.left, zone.rect.left - sensitivityRadius);
+        m_bounds.top = min(m_bounds.top, zone.rect.top - sensitivityRadius);
+        m_bounds.right = max(m_bounds.right, zone.rect.right + sensitivityRadius);
+        m_bounds.bottom = max(m_bounds.bottom, zone.rect.bottom + sensitivityRadius);
+    }
+
+    const size_t cellsPerAxis = min(MAX_CELLS_PER_AXIS, static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(m_zones.size())))) * CELLS_PER_ZONE);
+    m_columns = cellsPerAxis;
+    m_rows = cellsPerAxis;
+
+    // Cells are filled in two passes, counting first, so the zones of all cells fit in one vector
+    std::vector<size_t> counts(m_columns * m_rows + 1, 0);
+    auto forEachCell = [&](const RECT& rect, auto&& callback) {
+        const size_t firstColumn = CellColumn(rect.left - sensitivityRadius);
+        const size_t lastColumn = CellColumn(rect.right + sensitivityRadius);
+        const size_t firstRow = CellRow(rect.top - sensitivityRadius);
+        const size_t lastRow = CellRow(rect.bottom + sensitivityRadius);
+        for (size_t row = firstRow; row <= lastRow; ++row)
+        {
+            for (size_t column = firstColumn; column <= lastColumn; ++column)
+            {
+                callback(row * m_columns + column);
+            }
+        }
+    };
+
+    for (const auto& zone : m_zones)
+    {
+        forEachCell(zone.rect, [&](size_t cell) { counts[cell]++; });
+    }
+
+    m_cellOffsets.assign(counts.size(), 0);
+    for (size_t cell = 1; cell < counts.size(); ++cell)
+    {
+        m_cellOffsets[cell] = m_cellOffsets[cell - 1] + counts[cell - 1];
+    }
+
+    m_cellZones.resize(m_cellOffsets.back());
+    std::vector<size_t> next(m_cellOffsets.begin(), m_cellOffsets.end() - 1);
+    for (size_t i = 0; i < m_zones.size(); ++i)
+    {
+        forEachCell(m_zones[i].rect, [&](size_t cell) { m_cellZones[next[cell]++] = i; });
+    }
+
+    m_overlaps.assign(m_zones.size(), std::vector<bool>(m_zones.size(), false));
+    for (size_t i = 0; i < m_zones.size(); ++i)
+    {
+        for (size_t j = i + 1; j < m_zones.size(); ++j)
+        {
+            const RECT& rectI = m_zones[i].rect;
+            const RECT& rectJ = m_zones[j].rect;
+            if (max(rectI.top, rectJ.top) + sensitivityRadius < min(rectI.bottom, rectJ.bottom) &&
+                max(rectI.left, rectJ.left) + sensitivityRadius < min(rectI.right, rectJ.right))
+            {
+                m_overlaps[i][j] = true;
+                m_overlaps[j][i] = true;
+            }
+        }
+    }
+}
+
+void ZoneSpatialIndex::Clear() noexcept
+{
+    m_built = false;
+    m_zones.clear();
+    m_columns = 0;
+    m_rows = 0;
+    m_cellOffsets.clear();
+    m_cellZones.clear();
+    m_overlaps.clear();
+}
+
+ZoneSpatialIndex::HitTestResult ZoneSpatialIndex::HitTest(POINT pt) const
+{
+    HitTestResult result;
+    if (m_zones.empty() ||
+        pt.x < m_bounds.left || pt.x > m_bounds.right ||
+        pt.y < m_bounds.top || pt.y > m_bounds.bottom)
+    {
+        return result;
+    }
+
+    const size_t cell = CellRow(pt.y) * m_columns + CellColumn(pt.x);
+    std::vector<size_t> captured;
+    for (size_t offset = m_cellOffsets[cell]; offset < m_cellOffsets[cell + 1]; ++offset)
+    {
+        const size_t index = m_cellZones[offset];
+        const RECT& zoneRect = m_zones[index].rect;
+        if (zoneRect.left - m_sensitivityRadius <= pt.x && pt.x <= zoneRect.right + m_sensitivityRadius &&
+            zoneRect.top - m_sensitivityRadius <= pt.y && pt.y <= zoneRect.bottom + m_sensitivityRadius)
+        {
+            captured.push_back(index);
+
+            if (zoneRect.left <= pt.x && pt.x < zoneRect.right &&
+                zoneRect.top <= pt.y && pt.y < zoneRect.bottom)
+            {
+                result.strictlyCapturedCount++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < captured.size() && !result.overlap; ++i)
+    {
+        for (size_t j = i + 1; j < captured.size(); ++j)
+        {
+            if (Overlap(captured[i], captured[j]))
+            {
+                result.overlap = true;
+                break;
+            }
+        }
+    }
+
+    result.capturedZones.reserve(captured.size());
+    for (size_t index : captured)
+    {
+        result.capturedZones.push_back(m_zones[index].id);
+    }
+
+    return result;
+}
+
+size_t ZoneSpatialIndex::CellColumn(long x) const noexcept
+{
+    const long long width = static_cast<long long>(m_bounds.right) - m_bounds.left + 1;
+    const long long column = (static_cast<long long>(x) - m_bounds.left) * static_cast<long long>(m_columns) / width;
+    return static_cast<size_t>(std::clamp(column, 0ll, static_cast<long long>(m_columns) - 1));
+}
+
+size_t ZoneSpatialIndex::CellRow(long y) const noexcept
+{
+    const long long height = static_cast<long long>(m_bounds.bottom) - m_bounds.top + 1;
+    const long long row = (static_cast<long long>(y) - m_bounds.top) * static_cast<long long>(m_rows) / height;
+    return static_cast<size_t>(std::clamp(row, 0ll, static_cast<long long>(m_rows) - 1));
+}
+
+bool ZoneSpatialIndex::Overlap(size_t first, size_t second) const noexcept
+{
+    return m_overlaps[first][second];
+}
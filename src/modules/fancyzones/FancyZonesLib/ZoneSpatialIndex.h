@@ -0,0 +1,73 @@
+#pragma once
+
+#include "LayoutEngine.h"
+
+/**
+ * Uniform grid over the zones of a zone layout, used to hit-test the cursor during drags.
+ * Each cell lists the zones whose rectangle, extended by the sensitivity radius, touches it,
+ * so a point is only tested against the few zones of its cell. Which zones overlap each
+ * other is computed once, when the index is built.
+ */
+class ZoneSpatialIndex
+{
+public:
+    struct HitTestResult
+    {
+        // Zones whose rectangle extended by the sensitivity radius contains the point, by zone id
+        std::vector<size_t> capturedZones;
+        // Number of captured zones whose rectangle contains the point
+        size_t strictlyCapturedCount = 0;
+        // Whether two of the captured zones overlap by more than the sensitivity radius
+        bool overlap = false;
+    };
+
+    /**
+     * Build the index for the given zones. Replaces the previous index.
+     *
+     * @param   zones             Zones of the zone layout.
+     * @param   sensitivityRadius Distance from a zone at which the cursor still captures it.
+     */
+    void Build(const LayoutEngine::Zones& zones, int sensitivityRadius);
+    /**
+     * Forget the zones, ex: when zones are added to the layout.
+     */
+    void Clear() noexcept;
+    /**
+     * @returns Whether Build was called since the index was created or cleared.
+     */
+    bool IsBuilt() const noexcept { return m_built; }
+    /**
+     * @returns Indexed zones, in zone id order.
+     */
+    const LayoutEngine::Zones& Zones() const noexcept { return m_zones; }
+    /**
+     * @returns Sensitivity radius the index was built with.
+     */
+    int SensitivityRadius() const noexcept { return m_sensitivityRadius; }
+    /**
+     * Get the zones captured by the cursor.
+     *
+     * @param   pt Cursor coordinates.
+     */
+    HitTestResult HitTest(POINT pt) const;
+
+private:
+    size_t CellColumn(long x) const noexcept;
+    size_t CellRow(long y) const noexcept;
+    bool Overlap(size_t first, size_t second) const noexcept;
+
+    bool m_built = false;
+    int m_sensitivityRadius = 0;
+    LayoutEngine::Zones m_zones;
+
+    // Area covered by the grid, every zone extended by the sensitivity radius is inside it
+    RECT m_bounds{};
+    size_t m_columns = 0;
+    size_t m_rows = 0;
+    // Zones of cell c are m_cellZones[m_cellOffsets[c]] to m_cellZones[m_cellOffsets[c + 1] - 1],
+    // as indexes into m_zones in zone id order
+    std::vector<size_t> m_cellOffsets;
+    std::vector<size_t> m_cellZones;
+    // Row i, bit j is set if zones i and j overlap by more than the sensitivity radius
+    std::vector<std::vector<bool>> m_overlaps;
+};
@@ -130,6 +130,8 @@ public:
     SaveWindowProcessToZoneIndex(HWND window) noexcept;
     IFACEMETHODIMP_(IZoneSet*)
     ActiveZoneSet() noexcept { return m_activeZoneSet.get(); }
+    IFACEMETHODIMP_(LayoutEngine::Zones)
+    GetScreenZones() noexcept;
     IFACEMETHODIMP_(void)
     ShowZoneWindow() noexcept;
     IFACEMETHODIMP_(void)
@@ -311,6 +313,22 @@ ZoneWindow::MoveWindowIntoZoneByIndexSet(HWND window, const std::vector<size_t>&
     }
 }
 
+IFACEMETHODIMP_(LayoutEngine::Zones)
+ZoneWindow::GetScreenZones() noexcept
+{
+    LayoutEngine::Zones zones;
+    if (m_activeZoneSet)
+    {
+        for (const auto& [id, zone] : m_activeZoneSet->GetZones())
+        {
+            RECT rect = zone->GetZoneRect();
+            MapWindowRect(m_window, nullptr, &rect);
+            zones.push_back({ id, rect });
+        }
+    }
+    return zones;
+}
+
 IFACEMETHODIMP_(bool)
 ZoneWindow::MoveWindowIntoZoneByDirectionAndIndex(HWND window, DWORD vkCode, bool cycle) noexcept
 {
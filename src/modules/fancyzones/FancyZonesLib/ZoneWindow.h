@@ -1,6 +1,7 @@
 #pragma once
 #include "FancyZones.h"
 #include "FancyZonesLib/ZoneSet.h"
+#include "FancyZonesLib/LayoutEngine.h"
 
 /**
  * Class representing single work area, which is defined by monitor and virtual desktop.
@@ -101,6 +102,10 @@ interface __declspec(uuid("{7F017528-8110-4FB3-BE41-F472969C2560}")) IZoneWindow
      * @returns Active zone layout for this work area.
      */
     IFACEMETHOD_(IZoneSet*, ActiveZoneSet)() = 0;
+    /**
+     * @returns Zones of the active zone layout in screen coordinates, empty if there is no active layout.
+     */
+    IFACEMETHOD_(LayoutEngine::Zones, GetScreenZones)() = 0;
     IFACEMETHOD_(void, ShowZoneWindow)() = 0;
     IFACEMETHOD_(void, HideZoneWindow)() = 0;
     /**
@@ -3,6 +3,7 @@
 #include "CallTracer.h"
 
 #include <algorithm>
+#include <cstring>
 #include <map>
 #include <string>
 #include <vector>
@@ -74,11 +75,17 @@ D2D1_RECT_F ZoneWindowDrawing::ConvertRect(RECT rect)
     return D2D1::RectF((float)rect.left + 0.5f, (float)rect.top + 0.5f, (float)rect.right - 0.5f, (float)rect.bottom - 0.5f);
 }
 
+bool ZoneWindowDrawing::DrawableRect::operator==(const DrawableRect& other) const
+{
+    return memcmp(&rect, &other.rect, sizeof(rect)) == 0 &&
+           memcmp(&borderColor, &other.borderColor, sizeof(borderColor)) == 0 &&
+           memcmp(&fillColor, &other.fillColor, sizeof(fillColor)) == 0 &&
+           label == other.label;
+}
+
 ZoneWindowDrawing::ZoneWindowDrawing(HWND window)
 {
-    HRESULT hr;
     m_window = window;
-    m_renderTarget = nullptr;
     m_shouldRender = false;
 
     // Obtain the size of the drawing area.
@@ -88,6 +95,29 @@ ZoneWindowDrawing::ZoneWindowDrawing(HWND window)
         return;
     }
 
+    if (!CreateDeviceResources())
+    {
+        return;
+    }
+
+    auto writeFactory = GetWriteFactory();
+
+    if (writeFactory)
+    {
+        writeFactory->CreateTextFormat(NonLocalizable::SegoeUiFont, nullptr, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL, DWRITE_FONT_STRETCH_NORMAL, 80.f, L"en-US", m_textFormat.put());
+    }
+
+    if (m_textFormat)
+    {
+        m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
+        m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+    }
+
+    m_renderThread = std::thread([this]() { RenderLoop(); });
+}
+
+bool ZoneWindowDrawing::CreateDeviceResources()
+{
     // Create a Direct2D render target
     // We should always use the DPI value of 96 since we're running in DPI aware mode
     auto renderTargetProperties = D2D1::RenderTargetProperties(
@@ -97,99 +127,131 @@ ZoneWindowDrawing::ZoneWindowDrawing(HWND window)
         96.f);
 
     auto renderTargetSize = D2D1::SizeU(m_clientRect.right - m_clientRect.left, m_clientRect.bottom - m_clientRect.top);
-    auto hwndRenderTargetProperties = D2D1::HwndRenderTargetProperties(window, renderTargetSize);
+    auto hwndRenderTargetProperties = D2D1::HwndRenderTargetProperties(m_window, renderTargetSize);
 
-    hr = GetD2DFactory()->CreateHwndRenderTarget(renderTargetProperties, hwndRenderTargetProperties, &m_renderTarget);
+    HRESULT hr = GetD2DFactory()->CreateHwndRenderTarget(renderTargetProperties, hwndRenderTargetProperties, m_renderTarget.put());
 
     if (!SUCCEEDED(hr))
     {
         Logger::error("couldn't initialize ZoneWindowDrawing: CreateHwndRenderTarget failed with {}", hr);
-        return;
+        return false;
     }
 
-    m_renderThread = std::thread([this]() { RenderLoop(); });
+    // The scene layer is compatible with the render target, so it can share the brush
+    hr = m_renderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Black), m_brush.put());
+
+    if (!SUCCEEDED(hr))
+    {
+        Logger::error("couldn't initialize ZoneWindowDrawing: CreateSolidColorBrush failed with {}", hr);
+        m_renderTarget = nullptr;
+        return false;
+    }
+
+    m_sceneChanged = true;
+    return true;
 }
 
-ZoneWindowDrawing::RenderResult ZoneWindowDrawing::Render()
+void ZoneWindowDrawing::DiscardDeviceResources()
 {
-    std::unique_lock lock(m_mutex);
+    m_sceneLayer = nullptr;
+    m_brush = nullptr;
+    m_renderTarget = nullptr;
+}
+
+bool ZoneWindowDrawing::RenderSceneLayer()
+{
+    // Lock is held by the caller
 
-    if (!m_renderTarget)
+    if (!m_sceneLayer)
     {
-        return RenderResult::Failed;
+        HRESULT hr = m_renderTarget->CreateCompatibleRenderTarget(m_sceneLayer.put());
+
+        if (!SUCCEEDED(hr))
+        {
+            Logger::error("couldn't create the zones layer: CreateCompatibleRenderTarget failed with {}", hr);
+            return false;
+        }
     }
 
-    float animationAlpha = GetAnimationAlpha();
+    // The zones are drawn fully opaque, the animation only changes the opacity of the layer
+    m_sceneLayer->BeginDraw();
+    m_sceneLayer->Clear(D2D1::ColorF(0.f, 0.f, 0.f, 0.f));
 
-    if (animationAlpha <= 0.f)
+    for (const auto& drawableRect : m_sceneRects)
     {
-        return RenderResult::AnimationEnded;
-    }
+        m_brush->SetColor(drawableRect.fillColor);
+        m_sceneLayer->FillRectangle(drawableRect.rect, m_brush.get());
 
-    m_renderTarget->BeginDraw();
-
-    // Draw backdrop
-    m_renderTarget->Clear(D2D1::ColorF(0.f, 0.f, 0.f, 0.f));
+        m_brush->SetColor(drawableRect.borderColor);
+        m_sceneLayer->DrawRectangle(drawableRect.rect, m_brush.get());
 
-    ID2D1SolidColorBrush* textBrush = nullptr;
-    IDWriteTextFormat* textFormat = nullptr;
+        if (m_textFormat)
+        {
+            m_brush->SetColor(D2D1::ColorF(D2D1::ColorF::Black));
+            m_sceneLayer->DrawTextW(drawableRect.label.c_str(), (UINT32)drawableRect.label.size(), m_textFormat.get(), drawableRect.rect, m_brush.get());
+        }
+    }
 
-    m_renderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Black, animationAlpha), &textBrush);
-    auto writeFactory = GetWriteFactory();
+    HRESULT hr = m_sceneLayer->EndDraw();
 
-    if (writeFactory)
+    if (!SUCCEEDED(hr))
     {
-        writeFactory->CreateTextFormat(NonLocalizable::SegoeUiFont, nullptr, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL, DWRITE_FONT_STRETCH_NORMAL, 80.f, L"en-US", &textFormat);
+        Logger::error("couldn't draw the zones layer: EndDraw failed with {}", hr);
+        return false;
     }
 
-    for (auto drawableRect : m_sceneRects)
-    {
-        ID2D1SolidColorBrush* borderBrush = nullptr;
-        ID2D1SolidColorBrush* fillBrush = nullptr;
-
-        // Need to copy the rect from m_sceneRects
-        drawableRect.borderColor.a *= animationAlpha;
-        drawableRect.fillColor.a *= animationAlpha;
+    m_sceneChanged = false;
+    return true;
+}
 
-        m_renderTarget->CreateSolidColorBrush(drawableRect.borderColor, &borderBrush);
-        m_renderTarget->CreateSolidColorBrush(drawableRect.fillColor, &fillBrush);
+ZoneWindowDrawing::RenderResult ZoneWindowDrawing::Render()
+{
+    std::unique_lock lock(m_mutex);
 
-        if (fillBrush)
-        {
-            m_renderTarget->FillRectangle(drawableRect.rect, fillBrush);
-            fillBrush->Release();
-        }
+    if (!m_renderTarget && !CreateDeviceResources())
+    {
+        return RenderResult::Failed;
+    }
 
-        if (borderBrush)
-        {
-            m_renderTarget->DrawRectangle(drawableRect.rect, borderBrush);
-            borderBrush->Release();
-        }
+    float animationAlpha = GetAnimationAlpha();
 
-        std::wstring idStr = std::to_wstring(drawableRect.id + 1);
+    if (animationAlpha <= 0.f)
+    {
+        return RenderResult::AnimationEnded;
+    }
 
-        if (textFormat && textBrush)
+    // Zones are only redrawn when the scene changed, every other frame just blends the cached layer
+    if (m_sceneChanged || !m_sceneLayer)
+    {
+        if (!RenderSceneLayer())
         {
-            textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
-            textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
-            m_renderTarget->DrawTextW(idStr.c_str(), (UINT32)idStr.size(), textFormat, drawableRect.rect, textBrush);
+            DiscardDeviceResources();
+            return RenderResult::Failed;
         }
     }
 
-    if (textFormat)
-    {
-        textFormat->Release();
-    }
+    winrt::com_ptr<ID2D1Bitmap> sceneBitmap;
+    m_sceneLayer->GetBitmap(sceneBitmap.put());
 
-    if (textBrush)
-    {
-        textBrush->Release();
-    }
+    m_renderTarget->BeginDraw();
+
+    // Draw backdrop
+    m_renderTarget->Clear(D2D1::ColorF(0.f, 0.f, 0.f, 0.f));
+
+    m_renderTarget->DrawBitmap(sceneBitmap.get(), nullptr, animationAlpha, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
 
     // The lock must be released here, as EndDraw() will wait for vertical sync
     lock.unlock();
 
-    m_renderTarget->EndDraw();
+    HRESULT hr = m_renderTarget->EndDraw();
+
+    if (hr == D2DERR_RECREATE_TARGET)
+    {
+        // The device was lost, the resources are created again for the next frame
+        lock.lock();
+        DiscardDeviceResources();
+    }
+
     return RenderResult::Ok;
 }
 
@@ -208,6 +270,10 @@ void ZoneWindowDrawing::RenderLoop()
         if (result == RenderResult::AnimationEnded || result == RenderResult::Failed)
         {
             Hide();
+
+            // Don't keep a monitor sized bitmap around while the zones aren't shown
+            std::unique_lock lock(m_mutex);
+            m_sceneLayer = nullptr;
         }
     }
 }
@@ -282,9 +348,8 @@ void ZoneWindowDrawing::DrawActiveZoneSet(const IZoneSet::ZonesMap& zones,
                                           winrt::com_ptr<IZoneWindowHost> host)
 {
     _TRACER_;
-    std::unique_lock lock(m_mutex);
-
-    m_sceneRects = {};
+    std::vector<DrawableRect> sceneRects;
+    sceneRects.reserve(zones.size());
 
     auto borderColor = ConvertColor(host->GetZoneBorderColor());
     auto inactiveColor = ConvertColor(host->GetZoneColor());
@@ -313,10 +378,10 @@ void ZoneWindowDrawing::DrawActiveZoneSet(const IZoneSet::ZonesMap& zones,
                 .rect = ConvertRect(zone->GetZoneRect()),
                 .borderColor = borderColor,
                 .fillColor = inactiveColor,
-                .id = zone->Id()
+                .label = std::to_wstring(zone->Id() + 1)
             };
 
-            m_sceneRects.push_back(drawableRect);
+            sceneRects.push_back(std::move(drawableRect));
         }
     }
 
@@ -334,12 +399,20 @@ void ZoneWindowDrawing::DrawActiveZoneSet(const IZoneSet::ZonesMap& zones,
                 .rect = ConvertRect(zone->GetZoneRect()),
                 .borderColor = borderColor,
                 .fillColor = highlightColor,
-                .id = zone->Id()
+                .label = std::to_wstring(zone->Id() + 1)
             };
 
-            m_sceneRects.push_back(drawableRect);
+            sceneRects.push_back(std::move(drawableRect));
         }
     }
+
+    std::unique_lock lock(m_mutex);
+
+    if (sceneRects != m_sceneRects)
+    {
+        m_sceneRects = std::move(sceneRects);
+        m_sceneChanged = true;
+    }
 }
 
 ZoneWindowDrawing::~ZoneWindowDrawing()
@@ -351,9 +424,4 @@ ZoneWindowDrawing::~ZoneWindowDrawing()
     }
     m_cv.notify_all();
     m_renderThread.join();
-
-    if (m_renderTarget)
-    {
-        m_renderTarget->Release();
-    }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <string>
 #include <vector>
 #include <wil\resource.h>
 #include <winrt/base.h>
@@ -19,7 +20,9 @@ class ZoneWindowDrawing
         D2D1_RECT_F rect;
         D2D1_COLOR_F borderColor;
         D2D1_COLOR_F fillColor;
-        size_t id;
+        std::wstring label;
+
+        bool operator==(const DrawableRect& other) const;
     };
 
     struct AnimationInfo
@@ -37,17 +40,27 @@ class ZoneWindowDrawing
 
     HWND m_window = nullptr;
     RECT m_clientRect{};
-    ID2D1HwndRenderTarget* m_renderTarget = nullptr;
+    winrt::com_ptr<ID2D1HwndRenderTarget> m_renderTarget;
     std::optional<AnimationInfo> m_animation;
 
+    // Device dependent resources, used by the render thread only. They're created along with the
+    // render target and dropped when the device is lost.
+    winrt::com_ptr<ID2D1SolidColorBrush> m_brush;
+    winrt::com_ptr<ID2D1BitmapRenderTarget> m_sceneLayer;
+    winrt::com_ptr<IDWriteTextFormat> m_textFormat;
+
     std::mutex m_mutex;
     std::vector<DrawableRect> m_sceneRects;
+    bool m_sceneChanged = true;
 
     float GetAnimationAlpha();
     static ID2D1Factory* GetD2DFactory();
     static IDWriteFactory* GetWriteFactory();
     static D2D1_COLOR_F ConvertColor(COLORREF color);
     static D2D1_RECT_F ConvertRect(RECT rect);
+    bool CreateDeviceResources();
+    void DiscardDeviceResources();
+    bool RenderSceneLayer();
     RenderResult Render();
     void RenderLoop();
 
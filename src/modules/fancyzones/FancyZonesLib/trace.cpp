@@ -80,7 +80,7 @@ ZoneSetInfo GetZoneSetInfo(_In_opt_ winrt::com_ptr<IZoneSet> set) noexcept
     ZoneSetInfo info;
     if (set)
     {
-        auto zones = set->GetZones();
+        const auto& zones = set->GetZones();
         info.NumberOfZones = zones.size();
         info.NumberOfWindows = 0;
         for (int i = 0; i < static_cast<int>(zones.size()); i++)
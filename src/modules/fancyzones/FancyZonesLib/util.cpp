@@ -1,14 +1,16 @@
 #include "pch.h"
 #include "util.h"
+#include "ProcessPathCache.h"
 #include "Settings.h"
 
 #include <common/display/dpi_aware.h>
-#include <common/utils/process_path.h>
 #include <common/utils/window.h>
 
 #include <array>
+#include <bit>
+#include <limits>
+#include <mutex>
 #include <sstream>
-#include <complex>
 #include <wil/Resource.h>
 
 #include <fancyzones/FancyZonesLib/FancyZonesDataTypes.h>
@@ -38,8 +40,7 @@ namespace
 {
     bool IsZonableByProcessPath(const std::wstring& processPath, const std::vector<std::wstring>& excludedApps)
     {
-        // Filter out user specified apps
-        CharUpperBuffW(const_cast<std::wstring&>(processPath).data(), (DWORD)processPath.length());
+        // Filter out user specified apps, processPath is upper-cased already
         if (find_app_name_in_path(processPath, excludedApps))
         {
             return false;
@@ -54,6 +55,40 @@ namespace
         }
         return true;
     }
+
+    // Windows stamped by StampZoneIndexSet, see GetStampedWindows
+    std::mutex stampedWindowsMutex;
+    std::unordered_set<HWND> stampedWindows;
+
+    constexpr size_t BitmaskWordBits = std::numeric_limits<size_t>::digits;
+    // Far more zones than a layout has, the stamp properties can be set by any process
+    constexpr size_t MaxBitmaskWords = 64;
+
+    // Word 0 is the legacy PropertyMultipleZoneID property, the other words are stored
+    // in properties named after it.
+    std::wstring BitmaskWordPropertyName(size_t word)
+    {
+        return std::wstring(ZonedWindowProperties::PropertyMultipleZoneID) + L"#" + std::to_wstring(word);
+    }
+
+    size_t GetBitmaskWordCount(HWND window) noexcept
+    {
+        // Windows stamped with a single word have no word count
+        size_t words = reinterpret_cast<size_t>(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneWordsID));
+        return words > 1 ? min(words, MaxBitmaskWords) : 1;
+    }
+
+    std::vector<size_t> GetBitmask(HWND window) noexcept
+    {
+        std::vector<size_t> bitmask(GetBitmaskWordCount(window));
+        bitmask[0] = reinterpret_cast<size_t>(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneID));
+        for (size_t word = 1; word < bitmask.size(); word++)
+        {
+            bitmask[word] = reinterpret_cast<size_t>(::GetProp(window, BitmaskWordPropertyName(word).c_str()));
+        }
+
+        return bitmask;
+    }
 }
 
 namespace FancyZonesUtils
@@ -474,7 +509,7 @@ namespace FancyZonesUtils
         {
             return false;
         }
-        auto process_path = get_process_path(window);
+        auto process_path = ProcessPathCacheInstance().GetProcessPath(window);
         // Check for Cortana:
         if (strcmp(class_name.data(), "Windows.UI.Core.CoreWindow") == 0 &&
             process_path.ends_with(L"SearchUI.exe"))
@@ -493,7 +528,7 @@ namespace FancyZonesUtils
             return false;
         }
 
-        return IsZonableByProcessPath(get_process_path(window), excludedApps);
+        return IsZonableByProcessPath(ProcessPathCacheInstance().GetUpperCaseProcessPath(window), excludedApps);
     }
 
     bool IsCandidateForZoning(HWND window, const std::vector<std::wstring>& excludedApps) noexcept
@@ -503,7 +538,7 @@ namespace FancyZonesUtils
             return false;
         }
 
-        return IsZonableByProcessPath(get_process_path(window), excludedApps);
+        return IsZonableByProcessPath(ProcessPathCacheInstance().GetUpperCaseProcessPath(window), excludedApps);
     }
 
     bool IsWindowMaximized(HWND window) noexcept
@@ -598,6 +633,138 @@ namespace FancyZonesUtils
         }
     }
 
+    std::vector<size_t> ZoneIndexSetToBitmask(const std::vector<size_t>& indexSet)
+    {
+        std::vector<size_t> bitmask;
+        for (size_t id : indexSet)
+        {
+            const size_t word = id / BitmaskWordBits;
+            if (word >= MaxBitmaskWords)
+            {
+                continue;
+            }
+
+            if (word >= bitmask.size())
+            {
+                bitmask.resize(word + 1);
+            }
+
+            bitmask[word] |= size_t{ 1 } << (id % BitmaskWordBits);
+        }
+
+        return bitmask;
+    }
+
+    std::vector<size_t> ZoneIndexSetFromBitmask(const std::vector<size_t>& bitmask)
+    {
+        std::vector<size_t> indexSet;
+        for (size_t word = 0; word < bitmask.size(); word++)
+        {
+            // Visit only the set bits of each word
+            for (size_t bits = bitmask[word]; bits != 0; bits &= bits - 1)
+            {
+                indexSet.push_back(word * BitmaskWordBits + std::countr_zero(bits));
+            }
+        }
+
+        return indexSet;
+    }
+
+    void StampZoneIndexSet(HWND window, const std::vector<size_t>& indexSet) noexcept
+    {
+        const std::vector<size_t> bitmask = ZoneIndexSetToBitmask(indexSet);
+        if (bitmask.empty())
+        {
+            RemoveZoneIndexSetStamp(window);
+            return;
+        }
+
+        const size_t previousWords = GetBitmaskWordCount(window);
+        for (size_t word = bitmask.size(); word < previousWords; word++)
+        {
+            ::RemoveProp(window, BitmaskWordPropertyName(word).c_str());
+        }
+
+        SetProp(window, ZonedWindowProperties::PropertyMultipleZoneID, reinterpret_cast<HANDLE>(bitmask[0]));
+        for (size_t word = 1; word < bitmask.size(); word++)
+        {
+            const auto name = BitmaskWordPropertyName(word);
+            if (bitmask[word] != 0)
+            {
+                SetProp(window, name.c_str(), reinterpret_cast<HANDLE>(bitmask[word]));
+            }
+            else
+            {
+                ::RemoveProp(window, name.c_str());
+            }
+        }
+
+        if (bitmask.size() > 1)
+        {
+            SetProp(window, ZonedWindowProperties::PropertyMultipleZoneWordsID, reinterpret_cast<HANDLE>(bitmask.size()));
+        }
+        else
+        {
+            ::RemoveProp(window, ZonedWindowProperties::PropertyMultipleZoneWordsID);
+        }
+
+        std::scoped_lock lock{ stampedWindowsMutex };
+        stampedWindows.insert(window);
+    }
+
+    std::vector<size_t> GetZoneIndexSetStamp(HWND window) noexcept
+    {
+        return ZoneIndexSetFromBitmask(GetBitmask(window));
+    }
+
+    bool IsZoneIndexSetStamped(HWND window) noexcept
+    {
+        // The last word of a stamp is never empty, so a window stamped only with zones
+        // above 63 has a word count even though its legacy bitmask is zero
+        return ::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneID) != nullptr ||
+               ::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneWordsID) != nullptr;
+    }
+
+    bool ZoneIndexSetStampsEqual(HWND first, HWND second) noexcept
+    {
+        return GetBitmask(first) == GetBitmask(second);
+    }
+
+    void RemoveZoneIndexSetStamp(HWND window) noexcept
+    {
+        const size_t words = GetBitmaskWordCount(window);
+        for (size_t word = 1; word < words; word++)
+        {
+            ::RemoveProp(window, BitmaskWordPropertyName(word).c_str());
+        }
+
+        ::RemoveProp(window, ZonedWindowProperties::PropertyMultipleZoneWordsID);
+        ::RemoveProp(window, ZonedWindowProperties::PropertyMultipleZoneID);
+
+        std::scoped_lock lock{ stampedWindowsMutex };
+        stampedWindows.erase(window);
+    }
+
+    std::vector<HWND> GetStampedWindows() noexcept
+    {
+        std::scoped_lock lock{ stampedWindowsMutex };
+        std::erase_if(stampedWindows, [](HWND window) { return !::IsWindow(window); });
+        return { stampedWindows.begin(), stampedWindows.end() };
+    }
+
+    void RegisterStampedWindows() noexcept
+    {
+        auto callback = [](HWND window, LPARAM) -> BOOL {
+            if (IsZoneIndexSetStamped(window))
+            {
+                std::scoped_lock lock{ stampedWindowsMutex };
+                stampedWindows.insert(window);
+            }
+            return TRUE;
+        };
+        EnumWindows(callback, 0);
+    }
+
     bool IsValidGuid(const std::wstring& str)
     {
         GUID id;
@@ -711,103 +878,6 @@ namespace FancyZonesUtils
         return result;
     }
 
-    size_t ChooseNextZoneByPosition(DWORD vkCode, RECT windowRect, const std::vector<RECT>& zoneRects) noexcept
-    {
-        using complex = std::complex<double>;
-        const size_t invalidResult = zoneRects.size();
-        const double inf = 1e100;
-        const double eccentricity = 2.0;
-
-        auto rectCenter = [](RECT rect) {
-            return complex{
-                0.5 * rect.left + 0.5 * rect.right,
-                0.5 * rect.top + 0.5 * rect.bottom
-            };
-        };
-
-        auto distance = [&](complex arrowDirection, complex zoneDirection) {
-            double result = inf;
-
-            try
-            {
-                double scalarProduct = (arrowDirection * conj(zoneDirection)).real();
-                if (scalarProduct <= 0.0)
-                {
-                    return inf;
-                }
-
-                // no need to divide by abs(arrowDirection) because it's = 1
-                double cosAngle = scalarProduct / abs(zoneDirection);
-                double tanAngle = abs(tan(acos(cosAngle)));
-
-                if (tanAngle > 10)
-                {
-                    // The angle is too wide
-                    return inf;
-                }
-
-                // find the intersection with the ellipse with given eccentricity and major axis along arrowDirection
-                double intersectY = 2 * eccentricity / (1.0 + eccentricity * eccentricity * tanAngle * tanAngle);
-                double distanceEstimate = scalarProduct / intersectY;
-
-                if (std::isfinite(distanceEstimate))
-                {
-                    result = distanceEstimate;
-                }
-            }
-            catch (...)
-            {
-            }
-
-            return result;
-        };
-        std::vector<std::pair<size_t, complex>> candidateCenters;
-        for (size_t i = 0; i < zoneRects.size(); i++)
-        {
-            auto center = rectCenter(zoneRects[i]);
-
-            // Offset the zone slightly, to differentiate in case there are overlapping zones
-            center += 0.001 * (i + 1);
-
-            candidateCenters.emplace_back(i, center);
-        }
-
-        complex directionVector, windowCenter = rectCenter(windowRect);
-
-        switch (vkCode)
-        {
-        case VK_UP:
-            directionVector = { 0.0, -1.0 };
-            break;
-        case VK_DOWN:
-            directionVector = { 0.0, 1.0 };
-            break;
-        case VK_LEFT:
-            directionVector = { -1.0, 0.0 };
-            break;
-        case VK_RIGHT:
-            directionVector = { 1.0, 0.0 };
-            break;
-        default:
-            return invalidResult;
-        }
-
-        size_t closestIdx = invalidResult;
-        double smallestDistance = inf;
-
-        for (auto [zoneIdx, zoneCenter] : candidateCenters)
-        {
-            double dist = distance(directionVector, zoneCenter - windowCenter);
-            if (dist < smallestDistance)
-            {
-                smallestDistance = dist;
-                closestIdx = zoneIdx;
-            }
-        }
-
-        return closestIdx;
-    }
-
     RECT PrepareRectForCycling(RECT windowRect, RECT zoneWindowRect, DWORD vkCode) noexcept
     {
         LONG deltaX = 0, deltaY = 0;
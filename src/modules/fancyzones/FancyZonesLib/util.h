@@ -189,6 +189,8 @@ namespace FancyZonesUtils
     UINT GetDpiForMonitor(HMONITOR monitor) noexcept;
     void OrderMonitors(std::vector<std::pair<HMONITOR, RECT>>& monitorInfo);
 
+    bool allMonitorsHaveSameDpiScaling();
+
     // Parameter rect must be in screen coordinates (e.g. obtained from GetWindowRect)
     void SizeWindowToRect(HWND window, RECT rect) noexcept;
 
@@ -202,6 +204,24 @@ namespace FancyZonesUtils
     void RestoreWindowSize(HWND window) noexcept;
     void RestoreWindowOrigin(HWND window) noexcept;
 
+    // Zone index set stamp of a zoned window. Zones 0-63 are kept in the PropertyMultipleZoneID
+    // bitmask, as they always were, and higher zones in additional bitmask words, so layouts
+    // with more than 64 zones round-trip without dropping zones. Zones from 4096 on are
+    // never in a layout and are not stamped.
+    std::vector<size_t> ZoneIndexSetToBitmask(const std::vector<size_t>& indexSet);
+    std::vector<size_t> ZoneIndexSetFromBitmask(const std::vector<size_t>& bitmask);
+    void StampZoneIndexSet(HWND window, const std::vector<size_t>& indexSet) noexcept;
+    std::vector<size_t> GetZoneIndexSetStamp(HWND window) noexcept;
+    bool IsZoneIndexSetStamped(HWND window) noexcept;
+    bool ZoneIndexSetStampsEqual(HWND first, HWND second) noexcept;
+    void RemoveZoneIndexSetStamp(HWND window) noexcept;
+
+    // Windows with a zone index set stamp. The stamp functions keep the list, so zoned windows are
+    // found without enumerating all top-level windows. Destroyed windows are dropped from it.
+    std::vector<HWND> GetStampedWindows() noexcept;
+    // Add the windows stamped before FancyZones started (or restarted) to the stamped windows
+    void RegisterStampedWindows() noexcept;
+
     bool IsValidGuid(const std::wstring& str);
 
     std::wstring GenerateUniqueId(HMONITOR monitor, const std::wstring& devideId, const std::wstring& virtualDesktopId);
@@ -212,7 +232,6 @@ namespace FancyZonesUtils
     bool IsValidDeviceId(const std::wstring& str);
 
     RECT PrepareRectForCycling(RECT windowRect, RECT zoneWindowRect, DWORD vkCode) noexcept;
-    size_t ChooseNextZoneByPosition(DWORD vkCode, RECT windowRect, const std::vector<RECT>& zoneRects) noexcept;
 
     // If HWND is already dead, we assume it wasn't elevated
     bool IsProcessOfWindowElevated(HWND window);
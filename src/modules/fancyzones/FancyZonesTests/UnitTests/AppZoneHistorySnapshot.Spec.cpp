@@ -0,0 +1,179 @@
+#include "pch.h"
+#include "FancyZonesLib\AppZoneHistorySnapshot.h"
+#include "FancyZonesLib\FancyZonesDataTypes.h"
+#include "FancyZonesLib\JsonHelpers.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include "Util.h"
+#include <common/SettingsAPI/settings_helpers.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FancyZonesDataTypes;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (AppZoneHistorySnapshotUnitTests)
+    {
+        const std::wstring_view m_moduleName = L"FancyZonesUnitTests";
+        std::wstring m_jsonFileName;
+        std::wstring m_snapshotFileName;
+
+        static JSONHelpers::TAppZoneHistoryMap MakeHistory(int appCount)
+        {
+            JSONHelpers::TAppZoneHistoryMap result;
+            for (int app = 0; app < appCount; app++)
+            {
+                auto& history = result[L"C:\\Program Files\\App" + std::to_wstring(app) + L"\\app.exe"];
+                for (int desktop = 0; desktop <= app % 3; desktop++)
+                {
+                    AppZoneHistoryData data{};
+                    data.zoneSetUuid = L"{33A2B101-06E0-437B-A61E-CDBECF50228" + std::to_wstring(desktop) + L"}";
+                    data.deviceId = L"AOC2460#4&fe3a015&0&UID65793_1920_1200_{39B25DD2-130D-4B5D-8851-4791D66B153" + std::to_wstring(desktop) + L"}";
+                    data.zoneIndexSet = { static_cast<size_t>(app % 10), static_cast<size_t>(app % 70) };
+                    history.push_back(data);
+                }
+            }
+
+            return result;
+        }
+
+        static void AreEqual(const JSONHelpers::TAppZoneHistoryMap& expected, const JSONHelpers::TAppZoneHistoryMap& actual)
+        {
+            Assert::AreEqual(expected.size(), actual.size());
+            for (const auto& [appPath, expectedHistory] : expected)
+            {
+                Assert::IsTrue(actual.contains(appPath));
+                const auto& actualHistory = actual.at(appPath);
+                Assert::AreEqual(expectedHistory.size(), actualHistory.size());
+                for (size_t i = 0; i < expectedHistory.size(); i++)
+                {
+                    Assert::AreEqual(expectedHistory[i].zoneSetUuid, actualHistory[i].zoneSetUuid);
+                    Assert::AreEqual(expectedHistory[i].deviceId, actualHistory[i].deviceId);
+                    Assert::IsTrue(expectedHistory[i].zoneIndexSet == actualHistory[i].zoneIndexSet);
+                }
+            }
+        }
+
+        void SaveJson(const JSONHelpers::TAppZoneHistoryMap& history)
+        {
+            JSONHelpers::SaveAppZoneHistory(m_jsonFileName, JSONHelpers::SerializeAppZoneHistoryJSON(history));
+        }
+
+        TEST_METHOD_INITIALIZE(Init)
+        {
+            const std::wstring folder = PTSettingsHelper::get_module_save_folder_location(m_moduleName);
+            m_jsonFileName = folder + L"\\app-zone-history.json";
+            m_snapshotFileName = folder + L"\\app-zone-history.bin";
+        }
+
+        TEST_METHOD_CLEANUP(CleanUp)
+        {
+            std::filesystem::remove_all(PTSettingsHelper::get_module_save_folder_location(m_moduleName));
+        }
+
+        TEST_METHOD (SerializeRoundTrip)
+        {
+            auto expected = MakeHistory(10);
+            expected[L"app-with-negative-index"].push_back(AppZoneHistoryData{ .zoneSetUuid = L"uuid", .deviceId = L"device", .zoneIndexSet = { static_cast<size_t>(-1) } });
+
+            const auto snapshot = AppZoneHistorySnapshot::Serialize(expected);
+            const auto actual = AppZoneHistorySnapshot::Deserialize(snapshot.data(), snapshot.size(), {});
+
+            Assert::IsTrue(actual.has_value());
+            AreEqual(expected, *actual);
+        }
+
+        TEST_METHOD (SerializeEmpty)
+        {
+            const auto snapshot = AppZoneHistorySnapshot::Serialize({});
+            const auto actual = AppZoneHistorySnapshot::Deserialize(snapshot.data(), snapshot.size(), {});
+
+            Assert::IsTrue(actual.has_value());
+            Assert::IsTrue(actual->empty());
+        }
+
+        TEST_METHOD (DeserializeTruncated)
+        {
+            const auto snapshot = AppZoneHistorySnapshot::Serialize(MakeHistory(10));
+            for (size_t size = 0; size < snapshot.size(); size++)
+            {
+                Assert::IsFalse(AppZoneHistorySnapshot::Deserialize(snapshot.data(), size, {}).has_value());
+            }
+        }
+
+        TEST_METHOD (DeserializeOtherJsonFile)
+        {
+            const auto snapshot = AppZoneHistorySnapshot::Serialize(MakeHistory(10));
+            Assert::IsFalse(AppZoneHistorySnapshot::Deserialize(snapshot.data(), snapshot.size(), { .lastWriteTime = 1, .size = 2 }).has_value());
+        }
+
+        TEST_METHOD (SaveLoad)
+        {
+            const auto expected = MakeHistory(10);
+            SaveJson(expected);
+
+            Assert::IsTrue(AppZoneHistorySnapshot::Save(m_snapshotFileName, m_jsonFileName, AppZoneHistorySnapshot::Serialize(expected)));
+
+            const auto actual = AppZoneHistorySnapshot::Load(m_snapshotFileName, m_jsonFileName);
+            Assert::IsTrue(actual.has_value());
+            AreEqual(expected, *actual);
+        }
+
+        TEST_METHOD (LoadAfterJsonChanged)
+        {
+            const auto history = MakeHistory(10);
+            SaveJson(history);
+            Assert::IsTrue(AppZoneHistorySnapshot::Save(m_snapshotFileName, m_jsonFileName, AppZoneHistorySnapshot::Serialize(history)));
+
+            SaveJson(MakeHistory(11));
+
+            Assert::IsFalse(AppZoneHistorySnapshot::Load(m_snapshotFileName, m_jsonFileName).has_value());
+        }
+
+        TEST_METHOD (LoadAfterJsonChangedWithSameTimeAndSize)
+        {
+            const auto history = MakeHistory(10);
+            SaveJson(history);
+            Assert::IsTrue(AppZoneHistorySnapshot::Save(m_snapshotFileName, m_jsonFileName, AppZoneHistorySnapshot::Serialize(history)));
+
+            // Same length content, written back with the write time it had
+            const auto lastWriteTime = std::filesystem::last_write_time(m_jsonFileName);
+            std::string json;
+            {
+                std::ifstream file(m_jsonFileName, std::ios::binary);
+                json.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+            const auto digit = json.find('3');
+            Assert::AreNotEqual(std::string::npos, digit);
+            json[digit] = '4';
+            {
+                std::ofstream file(m_jsonFileName, std::ios::binary | std::ios::trunc);
+                file << json;
+            }
+            std::filesystem::last_write_time(m_jsonFileName, lastWriteTime);
+
+            Assert::IsFalse(AppZoneHistorySnapshot::Load(m_snapshotFileName, m_jsonFileName).has_value());
+        }
+
+        TEST_METHOD (LoadMissing)
+        {
+            SaveJson(MakeHistory(1));
+            Assert::IsFalse(AppZoneHistorySnapshot::Load(m_snapshotFileName, m_jsonFileName).has_value());
+        }
+
+        TEST_METHOD (SaveLoadLarge)
+        {
+            // FancyZonesBenchmark measures loading this from the json file and from the snapshot
+            const auto expected = MakeHistory(10000);
+            SaveJson(expected);
+            Assert::IsTrue(AppZoneHistorySnapshot::Save(m_snapshotFileName, m_jsonFileName, AppZoneHistorySnapshot::Serialize(expected)));
+
+            AreEqual(expected, JSONHelpers::ParseAppZoneHistoryFile(m_jsonFileName));
+            const auto actual = AppZoneHistorySnapshot::Load(m_snapshotFileName, m_jsonFileName);
+            Assert::IsTrue(actual.has_value());
+            AreEqual(expected, *actual);
+        }
+    };
+}
@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "FancyZonesLib\CallTracer.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (CallTracerUnitTests)
+    {
+        std::filesystem::path m_profilePath = std::filesystem::temp_directory_path() / L"FancyZonesUnitTests-call-profile.json";
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            std::filesystem::remove(m_profilePath);
+        }
+
+        std::string ReadProfile()
+        {
+            std::ifstream stream(m_profilePath);
+            std::stringstream content;
+            content << stream.rdbuf();
+            return content.str();
+        }
+
+        TEST_METHOD (ProfiledScopesSaved)
+        {
+            CallTracer::StartProfiling();
+            {
+                CallTracer outer("Outer");
+                CallTracer inner("Inner\"Quoted");
+            }
+            Assert::IsTrue(CallTracer::StopProfiling(m_profilePath.wstring()));
+
+            const auto profile = ReadProfile();
+            Assert::IsTrue(profile.starts_with("{\"traceEvents\":["));
+            Assert::IsTrue(profile.find("\"name\":\"Outer\",\"ph\":\"X\"") != std::string::npos);
+            Assert::IsTrue(profile.find("\"name\":\"Inner\\\"Quoted\"") != std::string::npos);
+        }
+
+        TEST_METHOD (NothingRecordedOutsideProfiling)
+        {
+            CallTracer::StartProfiling();
+            Assert::IsTrue(CallTracer::StopProfiling(m_profilePath.wstring()));
+            {
+                CallTracer tracer("NotRecorded");
+            }
+            Assert::IsTrue(CallTracer::StopProfiling(m_profilePath.wstring()));
+
+            Assert::IsTrue(ReadProfile().find("NotRecorded") == std::string::npos);
+        }
+    };
+}
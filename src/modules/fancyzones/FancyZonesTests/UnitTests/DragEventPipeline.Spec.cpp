@@ -0,0 +1,119 @@
+#include "pch.h"
+#include "FancyZonesLib\DragEventPipeline.h"
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace std::chrono_literals;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (DragEventPipelineUnitTests)
+    {
+        HWND m_window = nullptr;
+        DragEventPipeline m_pipeline;
+
+        TEST_METHOD_INITIALIZE(Init)
+        {
+            m_window = Mocks::Window();
+            m_pipeline.Start(m_window, 16ms, false);
+        }
+
+        TEST_METHOD (OtherWindowsDropped)
+        {
+            Assert::IsFalse(m_pipeline.Push(Mocks::Window(), OBJID_WINDOW));
+            Assert::IsFalse(m_pipeline.Push(nullptr, OBJID_WINDOW));
+            Assert::IsFalse(m_pipeline.Push(m_window, OBJID_CARET));
+
+            const auto counters = m_pipeline.GetCounters();
+            Assert::AreEqual(uint64_t{ 3 }, counters.received);
+            Assert::AreEqual(uint64_t{ 3 }, counters.dropped);
+            Assert::AreEqual(uint64_t{ 0 }, counters.processed);
+        }
+
+        TEST_METHOD (BurstCoalesced)
+        {
+            Assert::IsTrue(m_pipeline.Push(m_window, OBJID_WINDOW));
+            for (int i = 0; i < 10; i++)
+            {
+                Assert::IsFalse(m_pipeline.Push(m_window, OBJID_WINDOW));
+            }
+            Assert::IsFalse(m_pipeline.Request());
+
+            m_pipeline.Updated(DragEventPipeline::Clock::now());
+            Assert::IsTrue(m_pipeline.Push(m_window, OBJID_WINDOW));
+
+            const auto counters = m_pipeline.GetCounters();
+            Assert::AreEqual(uint64_t{ 12 }, counters.received);
+            Assert::AreEqual(uint64_t{ 11 }, counters.dropped);
+            Assert::AreEqual(uint64_t{ 1 }, counters.processed);
+        }
+
+        TEST_METHOD (UpdatesOneIntervalApart)
+        {
+            const auto start = DragEventPipeline::Clock::now();
+            Assert::IsTrue(m_pipeline.TimeUntilUpdate(start) == DragEventPipeline::Clock::duration::zero());
+
+            m_pipeline.Updated(start);
+            Assert::IsTrue(m_pipeline.TimeUntilUpdate(start) == 16ms);
+            Assert::IsTrue(m_pipeline.TimeUntilUpdate(start + 10ms) == 6ms);
+            Assert::IsTrue(m_pipeline.TimeUntilUpdate(start + 16ms) == DragEventPipeline::Clock::duration::zero());
+            Assert::IsTrue(m_pipeline.TimeUntilUpdate(start + 1s) == DragEventPipeline::Clock::duration::zero());
+        }
+
+        TEST_METHOD (StopDropsEverything)
+        {
+            Assert::IsTrue(m_pipeline.Push(m_window, OBJID_WINDOW));
+            m_pipeline.Updated(DragEventPipeline::Clock::now());
+
+            const auto counters = m_pipeline.Stop();
+            Assert::AreEqual(uint64_t{ 1 }, counters.received);
+            Assert::AreEqual(uint64_t{ 1 }, counters.processed);
+
+            Assert::IsFalse(m_pipeline.Push(m_window, OBJID_WINDOW));
+        }
+
+        TEST_METHOD (StartResets)
+        {
+            Assert::IsTrue(m_pipeline.Push(m_window, OBJID_WINDOW));
+            m_pipeline.Stop();
+
+            // The update of the previous drag never ran
+            m_pipeline.Start(m_window, 16ms, false);
+            Assert::IsTrue(m_pipeline.Push(m_window, OBJID_WINDOW));
+            Assert::AreEqual(uint64_t{ 1 }, m_pipeline.GetCounters().received);
+        }
+
+        TEST_METHOD (CursorFollowedWhenOutlineDragged)
+        {
+            Assert::IsFalse(m_pipeline.Push(nullptr, OBJID_CURSOR));
+
+            m_pipeline.Start(m_window, 16ms, true);
+            Assert::IsTrue(m_pipeline.Push(nullptr, OBJID_CURSOR));
+            m_pipeline.Updated(DragEventPipeline::Clock::now());
+            Assert::IsTrue(m_pipeline.Push(m_window, OBJID_WINDOW));
+            m_pipeline.Updated(DragEventPipeline::Clock::now());
+            Assert::IsFalse(m_pipeline.Push(Mocks::Window(), OBJID_WINDOW));
+
+            m_pipeline.Stop();
+            Assert::IsFalse(m_pipeline.Push(nullptr, OBJID_CURSOR));
+        }
+
+        TEST_METHOD (DiscardedUpdateNotPending)
+        {
+            m_pipeline.Stop();
+
+            // A key was pressed after the drag ended
+            Assert::IsTrue(m_pipeline.Request());
+            m_pipeline.Discarded();
+            Assert::IsTrue(m_pipeline.Request());
+        }
+
+        TEST_METHOD (DisplayRefreshInterval)
+        {
+            const auto interval = DragEventPipeline::DisplayRefreshInterval();
+            Assert::IsTrue(interval > 0ms);
+            Assert::IsTrue(interval <= 100ms);
+        }
+    };
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "FancyZonesLib/WindowRelayout.h"
+
+#include <unordered_map>
+
+/**
+ * Windows kept in memory, for planning and applying relayouts without a desktop (tests, benchmark).
+ * Window handles are made up and never passed to the system.
+ */
+class FakeWindowBackend : public WindowRelayout::IWindowBackend
+{
+public:
+    struct FakeWindow
+    {
+        RECT rect{};
+        std::vector<size_t> zoneIds;
+        // Invisible borders, the extended frame bounds are the window rectangle without them
+        std::optional<RECT> borders;
+        bool resizable = true;
+        bool canDeferMove = true;
+    };
+
+    // Number of MoveWindows transactions, of windows placed one at a time and of zone stamps
+    size_t transactionCount = 0;
+    size_t placementCount = 0;
+    size_t stampCount = 0;
+    // MoveWindows fails, as when a window of the transaction belongs to an elevated process
+    bool failTransactions = false;
+
+    HWND AddWindow(FakeWindow window)
+    {
+        HWND handle = reinterpret_cast<HWND>(m_nextHandle++);
+        m_windows[handle] = std::move(window);
+        return handle;
+    }
+
+    void DestroyWindow(HWND window) { m_windows.erase(window); }
+
+    FakeWindow& Window(HWND window) { return m_windows.at(window); }
+
+    bool IsWindow(HWND window) const override { return m_windows.contains(window); }
+
+    std::vector<size_t> GetZoneIndexSet(HWND window) const override
+    {
+        auto it = m_windows.find(window);
+        return it != m_windows.end() ? it->second.zoneIds : std::vector<size_t>{};
+    }
+
+    bool GetWindowRect(HWND window, RECT& rect) const override
+    {
+        auto it = m_windows.find(window);
+        if (it == m_windows.end())
+        {
+            return false;
+        }
+
+        rect = it->second.rect;
+        return true;
+    }
+
+    bool GetFrameBounds(HWND window, RECT& rect) const override
+    {
+        auto it = m_windows.find(window);
+        if (it == m_windows.end() || !it->second.borders)
+        {
+            return false;
+        }
+
+        const RECT& borders = *it->second.borders;
+        rect = it->second.rect;
+        rect.left += borders.left;
+        rect.top += borders.top;
+        rect.right -= borders.right;
+        rect.bottom -= borders.bottom;
+        return true;
+    }
+
+    bool IsResizable(HWND window) const override
+    {
+        auto it = m_windows.find(window);
+        return it != m_windows.end() && it->second.resizable;
+    }
+
+    bool CanDeferMove(HWND window) const override
+    {
+        auto it = m_windows.find(window);
+        return it != m_windows.end() && it->second.canDeferMove;
+    }
+
+    bool MoveWindows(const std::vector<WindowRelayout::WindowMove>& moves) override
+    {
+        if (failTransactions)
+        {
+            return false;
+        }
+
+        transactionCount++;
+        for (const auto& move : moves)
+        {
+            m_windows.at(move.window).rect = move.rect;
+        }
+        return true;
+    }
+
+    void PlaceWindow(const WindowRelayout::WindowMove& move) override
+    {
+        placementCount++;
+        m_windows.at(move.window).rect = move.rect;
+    }
+
+    void StampZoneIndexSet(HWND window, const std::vector<size_t>& zoneIds) override
+    {
+        stampCount++;
+        m_windows.at(window).zoneIds = zoneIds;
+    }
+
+private:
+    std::unordered_map<HWND, FakeWindow> m_windows;
+    UINT_PTR m_nextHandle = 1;
+};
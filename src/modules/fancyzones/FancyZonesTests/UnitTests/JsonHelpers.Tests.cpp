@@ -1849,6 +1849,71 @@ namespace FancyZonesUnitTests
                 Assert::IsTrue(std::vector<size_t>{ expectedZoneIndex } == data.GetAppLastZoneIndexSet(window, deviceId, zoneSetId));
             }
 
+            TEST_METHOD (AppLastZoneIndexWrittenOnFlush)
+            {
+                const std::wstring deviceId = L"device-id";
+                const std::wstring zoneSetId = L"zoneset-uuid";
+                const auto window = Mocks::WindowCreate(m_hInst);
+                FancyZonesData data;
+                data.SetSettingsModulePath(m_moduleName);
+
+                Assert::IsTrue(data.SetAppLastZones(window, deviceId, zoneSetId, { 2 }));
+                data.FlushPendingSaves();
+
+                auto savedJson = json::from_file(data.appZoneHistoryFileName);
+                Assert::IsTrue(savedJson.has_value());
+                Assert::AreEqual(size_t{ 1 }, ParseAppZoneHistory(*savedJson).size());
+            }
+
+            TEST_METHOD (AppLastZoneIndexAfterStopSavingNotScheduled)
+            {
+                const std::wstring deviceId = L"device-id";
+                const std::wstring zoneSetId = L"zoneset-uuid";
+                const auto window = Mocks::WindowCreate(m_hInst);
+                FancyZonesData data;
+                data.SetSettingsModulePath(m_moduleName);
+
+                Assert::IsTrue(data.SetAppLastZones(window, deviceId, zoneSetId, { 2 }));
+                data.StopSaving();
+                Assert::IsTrue(data.SetAppLastZones(window, deviceId, zoneSetId, { 1 }));
+
+                Assert::IsFalse(data.flusher.IsPending());
+                auto savedJson = json::from_file(data.appZoneHistoryFileName);
+                Assert::IsTrue(savedJson.has_value());
+                Assert::AreEqual(size_t{ 1 }, ParseAppZoneHistory(*savedJson).size());
+            }
+
+            TEST_METHOD (LoadFancyZonesDataKeepsPendingAppZoneHistory)
+            {
+                const std::wstring deviceId = L"device-id";
+                const std::wstring zoneSetId = L"zoneset-uuid";
+                const auto window = Mocks::WindowCreate(m_hInst);
+                FancyZonesData data;
+                data.SetSettingsModulePath(m_moduleName);
+                data.SaveAppZoneHistoryAndZoneSettings();
+
+                Assert::IsTrue(data.SetAppLastZones(window, deviceId, zoneSetId, { 2 }));
+                data.LoadFancyZonesData();
+
+                Assert::IsTrue(std::vector<size_t>{ 2 } == data.GetAppLastZoneIndexSet(window, deviceId, zoneSetId));
+            }
+
+            TEST_METHOD (LoadFancyZonesDataKeepsPendingZoneSettings)
+            {
+                const std::wstring deviceId = L"device-id";
+                FancyZonesData data;
+                data.SetSettingsModulePath(m_moduleName);
+                data.SaveAppZoneHistoryAndZoneSettings();
+
+                // As when the file watcher reports a write before the change is flushed
+                Assert::IsTrue(data.AddDevice(deviceId));
+                data.SaveZoneSettings();
+                data.LoadFancyZonesData();
+
+                Assert::IsTrue(data.FindDeviceInfo(deviceId).has_value());
+                Assert::IsFalse(data.flusher.IsPending());
+            }
+
             TEST_METHOD (AppLastZoneIndexZero)
             {
                 const std::wstring zoneSetId = L"zoneset-uuid";
@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "FancyZonesLib\LayoutEngine.h"
+#include "FancyZonesLib\ZoneSet.h"
+#include "FancyZonesLib\ZoneSpatialIndex.h"
+
+#include "Util.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FancyZonesDataTypes;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (LayoutEngineUnitTests)
+    {
+        const RECT m_workArea{ 0, 0, 1920, 1080 };
+
+        LayoutEngine::Zones MakeGrid(int columns, int rows)
+        {
+            LayoutEngine::Zones zones;
+            for (int row = 0; row < rows; row++)
+            {
+                for (int column = 0; column < columns; column++)
+                {
+                    const long left = column * 100;
+                    const long top = row * 100;
+                    zones.push_back({ zones.size(), RECT{ left, top, left + 100, top + 100 } });
+                }
+            }
+            return zones;
+        }
+
+    public:
+        TEST_METHOD (SameZonesAsZoneSet)
+        {
+            for (auto type : { ZoneSetLayoutType::Focus, ZoneSetLayoutType::Columns, ZoneSetLayoutType::Rows, ZoneSetLayoutType::Grid, ZoneSetLayoutType::PriorityGrid })
+            {
+                for (int zoneCount : { 1, 3, 8, 11, 12, 64 })
+                {
+                    LayoutEngine::Zones zones;
+                    Assert::IsTrue(LayoutEngine::CalculateLayout(m_workArea, type, zoneCount, 16, zones));
+
+                    ZoneSetConfig config({}, type, Mocks::Monitor(), DefaultValues::SensitivityRadius);
+                    auto set = MakeZoneSet(config);
+                    Assert::IsTrue(set->CalculateZones(m_workArea, zoneCount, 16));
+
+                    Assert::AreEqual(set->GetZones().size(), zones.size());
+                    for (const auto& [zoneId, rect] : zones)
+                    {
+                        const RECT expected = set->GetZones().at(zoneId)->GetZoneRect();
+                        Assert::IsTrue(memcmp(&expected, &rect, sizeof(RECT)) == 0);
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD (ZonesInIdOrder)
+        {
+            // Zone 1 spans both rows of the first column, zone 0 comes after it in the cell order
+            GridLayoutInfo info(GridLayoutInfo::Minimal{ .rows = 2, .columns = 2 });
+            info.rowsPercents() = { 5000, 5000 };
+            info.columnsPercents() = { 5000, 5000 };
+            info.cellChildMap() = { { 1, 0 }, { 1, 2 } };
+
+            LayoutEngine::Zones zones;
+            Assert::IsTrue(LayoutEngine::CalculateGridZones(m_workArea, info, 0, zones));
+            Assert::AreEqual(size_t{ 3 }, zones.size());
+            for (size_t i = 0; i < zones.size(); i++)
+            {
+                Assert::AreEqual(i, zones[i].id);
+            }
+            Assert::AreEqual(1080L, zones[1].rect.bottom);
+            Assert::IsTrue(LayoutEngine::FindZone(zones, 2) == &zones[2]);
+            Assert::IsTrue(LayoutEngine::FindZone(zones, 3) == nullptr);
+        }
+
+        TEST_METHOD (InvalidLayout)
+        {
+            LayoutEngine::Zones zones;
+            Assert::IsFalse(LayoutEngine::CalculateLayout(m_workArea, ZoneSetLayoutType::Grid, 0, 0, zones));
+            Assert::IsFalse(LayoutEngine::CalculateLayout(RECT{ 0, 0, 0, 1080 }, ZoneSetLayoutType::Grid, 4, 0, zones));
+
+            // The spacing doesn't leave room for the zones
+            Assert::IsFalse(LayoutEngine::CalculateLayout(m_workArea, ZoneSetLayoutType::Columns, 200, 16, zones));
+            Assert::IsTrue(zones.empty());
+        }
+
+        TEST_METHOD (CanvasZonesScaled)
+        {
+            CanvasLayoutInfo info{ .lastWorkAreaWidth = 1920, .lastWorkAreaHeight = 1080, .zones = { { 10, 20, 100, 200 } }, .sensitivityRadius = 20 };
+
+            LayoutEngine::Zones zones;
+            Assert::IsTrue(LayoutEngine::CalculateCanvasZones(info, 144, zones));
+            Assert::AreEqual(size_t{ 1 }, zones.size());
+            const RECT expected{ 15, 30, 165, 330 };
+            Assert::IsTrue(memcmp(&expected, &zones[0].rect, sizeof(RECT)) == 0);
+        }
+
+        TEST_METHOD (ZonesFromPoint)
+        {
+            const auto zones = MakeGrid(3, 3);
+            ZoneSpatialIndex index;
+            index.Build(zones, 20);
+
+            const auto captured = LayoutEngine::ZonesFromPoint(index, POINT{ 150, 150 }, Settings::OverlappingZonesAlgorithm::Smallest);
+            Assert::AreEqual(size_t{ 1 }, captured.size());
+            Assert::AreEqual(size_t{ 4 }, captured[0]);
+
+            Assert::IsTrue(LayoutEngine::ZonesFromPoint(index, POINT{ 1000, 1000 }, Settings::OverlappingZonesAlgorithm::Smallest).empty());
+        }
+
+        TEST_METHOD (CombinedZoneRange)
+        {
+            const auto zones = MakeGrid(3, 3);
+
+            const std::vector<size_t> expected{ 0, 1, 3, 4 };
+            Assert::IsTrue(expected == LayoutEngine::GetCombinedZoneRange(zones, { 0 }, { 4 }));
+            Assert::IsTrue(std::vector<size_t>{ 2 } == LayoutEngine::GetCombinedZoneRange(zones, { 2 }, { 2 }));
+            Assert::IsTrue(LayoutEngine::GetCombinedZoneRange(zones, { 9 }, {}).empty());
+        }
+    };
+}
@@ -1,7 +1,13 @@
 #include "pch.h"
 #include "Util.h"
+#include "FancyZonesLib\ProcessPathCache.h"
+#include "FancyZonesLib\Settings.h"
 #include "FancyZonesLib\util.h"
 
+#include <chrono>
+#include <thread>
+#include <common/utils/process_path.h>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 namespace FancyZonesUnitTests
@@ -368,6 +374,143 @@ namespace FancyZonesUnitTests
             const auto actual = HexToRGB(L"zzz");
             Assert::AreEqual(expected, actual);
         }
+
+        TEST_METHOD (TestZoneIndexSetBitmaskRoundTrip)
+        {
+            const std::vector<size_t> expected{ 0, 5, 63, 64, 100, 1000 };
+            const auto bitmask = ZoneIndexSetToBitmask(expected);
+
+            Assert::AreEqual(size_t{ 1000 / 64 + 1 }, bitmask.size());
+            Assert::IsTrue(expected == ZoneIndexSetFromBitmask(bitmask));
+        }
+
+        TEST_METHOD (TestZoneIndexSetBitmaskEmpty)
+        {
+            Assert::IsTrue(ZoneIndexSetToBitmask({}).empty());
+            Assert::IsTrue(ZoneIndexSetFromBitmask({ 0, 0 }).empty());
+        }
+
+        TEST_METHOD (TestZoneIndexSetBitmaskDropsHugeIds)
+        {
+            const auto bitmask = ZoneIndexSetToBitmask({ 1, 4096, std::numeric_limits<size_t>::max() });
+
+            Assert::IsTrue(std::vector<size_t>{ 1 } == ZoneIndexSetFromBitmask(bitmask));
+        }
+
+        TEST_METHOD (TestStampZoneIndexSetAbove63)
+        {
+            const std::vector<size_t> expected{ 70, 200 };
+            auto window = Mocks::Window();
+            StampZoneIndexSet(window, expected);
+
+            Assert::IsTrue(IsZoneIndexSetStamped(window));
+            Assert::IsTrue(expected == GetZoneIndexSetStamp(window));
+        }
+
+        TEST_METHOD (TestStampZoneIndexSetShrinks)
+        {
+            auto window = Mocks::Window();
+            StampZoneIndexSet(window, { 1, 300 });
+            StampZoneIndexSet(window, { 2 });
+
+            Assert::IsTrue(std::vector<size_t>{ 2 } == GetZoneIndexSetStamp(window));
+            Assert::IsNull(::GetProp(window, ZonedWindowProperties::PropertyMultipleZoneWordsID));
+        }
+
+        TEST_METHOD (TestLegacyZoneIndexSetStamp)
+        {
+            auto window = Mocks::Window();
+            SetProp(window, ZonedWindowProperties::PropertyMultipleZoneID, reinterpret_cast<HANDLE>(0b1010));
+
+            Assert::IsTrue(IsZoneIndexSetStamped(window));
+            Assert::IsTrue(std::vector<size_t>{ 1, 3 } == GetZoneIndexSetStamp(window));
+        }
+
+        TEST_METHOD (TestZoneIndexSetStampsEqual)
+        {
+            auto first = Mocks::Window();
+            auto second = Mocks::Window();
+            StampZoneIndexSet(first, { 1, 65 });
+            StampZoneIndexSet(second, { 1 });
+            Assert::IsFalse(ZoneIndexSetStampsEqual(first, second));
+
+            StampZoneIndexSet(second, { 1, 65 });
+            Assert::IsTrue(ZoneIndexSetStampsEqual(first, second));
+        }
+
+        TEST_METHOD (TestRemoveZoneIndexSetStamp)
+        {
+            auto window = Mocks::Window();
+            StampZoneIndexSet(window, { 0, 128 });
+            RemoveZoneIndexSetStamp(window);
+
+            Assert::IsFalse(IsZoneIndexSetStamped(window));
+            Assert::IsTrue(GetZoneIndexSetStamp(window).empty());
+        }
+
+        TEST_METHOD (TestStampedWindows)
+        {
+            auto window = Mocks::Window();
+            StampZoneIndexSet(window, { 1 });
+            auto stamped = GetStampedWindows();
+            Assert::IsTrue(std::find(stamped.begin(), stamped.end(), window) != stamped.end());
+
+            RemoveZoneIndexSetStamp(window);
+            stamped = GetStampedWindows();
+            Assert::IsTrue(std::find(stamped.begin(), stamped.end(), window) == stamped.end());
+        }
+    };
+
+    TEST_CLASS (ProcessPathCacheUnitTests)
+    {
+        TEST_METHOD (SameAsGetProcessPath)
+        {
+            ProcessPathCache cache;
+            auto window = Mocks::Window();
+
+            const auto expected = get_process_path(window);
+            Assert::IsFalse(expected.empty());
+            Assert::AreEqual(expected, cache.GetProcessPath(window));
+            Assert::AreEqual(expected, cache.GetProcessPath(window));
+            Assert::AreEqual(size_t{ 1 }, cache.Size());
+
+            std::wstring upperCase = expected;
+            CharUpperBuffW(upperCase.data(), static_cast<DWORD>(upperCase.length()));
+            Assert::AreEqual(upperCase, cache.GetUpperCaseProcessPath(window));
+        }
+
+        TEST_METHOD (InvalidProcessNotCached)
+        {
+            ProcessPathCache cache;
+
+            Assert::IsTrue(cache.GetProcessPath(DWORD{ 0 }).empty());
+            Assert::AreEqual(size_t{ 0 }, cache.Size());
+        }
+
+        TEST_METHOD (EvictedOnProcessExit)
+        {
+            ProcessPathCache cache;
+
+            wchar_t commandLine[] = L"cmd.exe /c exit";
+            STARTUPINFOW startupInfo{ sizeof(startupInfo) };
+            PROCESS_INFORMATION processInfo{};
+            Assert::IsTrue(CreateProcessW(nullptr, commandLine, nullptr, nullptr, FALSE, CREATE_SUSPENDED | CREATE_NO_WINDOW, nullptr, nullptr, &startupInfo, &processInfo));
+            wil::unique_handle process{ processInfo.hProcess };
+            wil::unique_handle thread{ processInfo.hThread };
+
+            Assert::AreEqual(get_process_path(processInfo.dwProcessId), cache.GetProcessPath(processInfo.dwProcessId));
+            Assert::AreEqual(size_t{ 1 }, cache.Size());
+
+            TerminateProcess(process.get(), 0);
+            WaitForSingleObject(process.get(), INFINITE);
+
+            // The exit is handled on a thread pool thread
+            for (int i = 0; i < 100 && cache.Size() != 0; i++)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            Assert::AreEqual(size_t{ 0 }, cache.Size());
+        }
     };
 }
 
@@ -0,0 +1,187 @@
+#include "pch.h"
+#include "FancyZonesLib\WindowRelayout.h"
+
+#include "FakeWindowBackend.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace WindowRelayout;
+
+namespace FancyZonesUnitTests
+{
+    TEST_CLASS (WindowRelayoutUnitTests)
+    {
+        const HMONITOR m_leftMonitor = reinterpret_cast<HMONITOR>(1);
+        const HMONITOR m_rightMonitor = reinterpret_cast<HMONITOR>(2);
+
+        // Two columns on the left monitor, one zone on the right monitor
+        const WorkAreaZones m_left{ m_leftMonitor, { { 0, RECT{ 0, 0, 960, 1080 } }, { 1, RECT{ 960, 0, 1920, 1080 } } } };
+        const WorkAreaZones m_right{ m_rightMonitor, { { 0, RECT{ 1920, 0, 3840, 1080 } } } };
+
+        // Windows right of x = 1920 are on the right monitor
+        Plan PlanRelayout(const FakeWindowBackend& backend, const std::vector<HWND>& windows)
+        {
+            return WindowRelayout::PlanRelayout(backend, windows, [&](HWND window) -> const WorkAreaZones* {
+                RECT rect{};
+                backend.GetWindowRect(window, rect);
+                return rect.left >= 1920 ? &m_right : &m_left;
+            });
+        }
+
+        static bool SameRect(const RECT& expected, const RECT& actual)
+        {
+            return memcmp(&expected, &actual, sizeof(RECT)) == 0;
+        }
+
+    public:
+        TEST_METHOD (OneBatchPerMonitor)
+        {
+            FakeWindowBackend backend;
+            std::vector<HWND> windows{
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 0 } }),
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 1 } }),
+                backend.AddWindow({ .rect = { 2000, 10, 2500, 500 }, .zoneIds = { 0 } }),
+            };
+
+            const auto plan = PlanRelayout(backend, windows);
+            Assert::AreEqual(size_t{ 2 }, plan.size());
+            Assert::IsTrue(plan[0].monitor == m_leftMonitor);
+            Assert::AreEqual(size_t{ 2 }, plan[0].deferredMoves.size());
+            Assert::IsTrue(plan[1].monitor == m_rightMonitor);
+            Assert::AreEqual(size_t{ 1 }, plan[1].deferredMoves.size());
+
+            ApplyPlan(backend, plan);
+            Assert::AreEqual(size_t{ 2 }, backend.transactionCount);
+            Assert::AreEqual(size_t{ 0 }, backend.placementCount);
+            Assert::IsTrue(SameRect(RECT{ 960, 0, 1920, 1080 }, backend.Window(windows[1]).rect));
+            Assert::IsTrue(SameRect(RECT{ 1920, 0, 3840, 1080 }, backend.Window(windows[2]).rect));
+        }
+
+        TEST_METHOD (WindowsInPlaceNotMoved)
+        {
+            FakeWindowBackend backend;
+            std::vector<HWND> windows{
+                backend.AddWindow({ .rect = { 0, 0, 960, 1080 }, .zoneIds = { 0 } }),
+                backend.AddWindow({ .rect = { 960, 0, 1920, 1080 }, .zoneIds = { 1 } }),
+            };
+
+            const auto plan = PlanRelayout(backend, windows);
+            Assert::AreEqual(size_t{ 1 }, plan.size());
+            Assert::AreEqual(size_t{ 2 }, plan[0].unchanged.size());
+            Assert::IsTrue(plan[0].deferredMoves.empty());
+
+            ApplyPlan(backend, plan);
+            Assert::AreEqual(size_t{ 0 }, backend.transactionCount);
+        }
+
+        TEST_METHOD (WindowSpanningZones)
+        {
+            FakeWindowBackend backend;
+            // Invisible borders on the sides and at the bottom, as on Windows 10
+            HWND window = backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 0, 1 }, .borders = RECT{ 7, 0, 7, 7 } });
+
+            const auto plan = PlanRelayout(backend, { window });
+            Assert::AreEqual(size_t{ 1 }, plan[0].deferredMoves.size());
+            const auto& move = plan[0].deferredMoves[0];
+            Assert::IsTrue(SameRect(RECT{ -7, 0, 1927, 1087 }, move.rect));
+            Assert::IsTrue(std::vector<size_t>{ 0, 1 } == move.zoneIds);
+        }
+
+        TEST_METHOD (FixedSizeWindowKeepsSize)
+        {
+            FakeWindowBackend backend;
+            HWND window = backend.AddWindow({ .rect = { 100, 100, 400, 300 }, .zoneIds = { 1 }, .resizable = false });
+
+            const auto plan = PlanRelayout(backend, { window });
+            Assert::IsTrue(SameRect(RECT{ 960, 0, 1260, 200 }, plan[0].deferredMoves[0].rect));
+        }
+
+        TEST_METHOD (MinimizedWindowPlaced)
+        {
+            FakeWindowBackend backend;
+            std::vector<HWND> windows{
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 0 } }),
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 1 }, .canDeferMove = false }),
+            };
+
+            const auto plan = PlanRelayout(backend, windows);
+            Assert::AreEqual(size_t{ 1 }, plan[0].deferredMoves.size());
+            Assert::AreEqual(size_t{ 1 }, plan[0].placements.size());
+
+            ApplyPlan(backend, plan);
+            Assert::AreEqual(size_t{ 1 }, backend.transactionCount);
+            Assert::AreEqual(size_t{ 1 }, backend.placementCount);
+        }
+
+        TEST_METHOD (SkipsWindowsWithoutZones)
+        {
+            FakeWindowBackend backend;
+            HWND destroyed = backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 0 } });
+            backend.DestroyWindow(destroyed);
+            std::vector<HWND> windows{
+                destroyed,
+                // Zone 5 isn't in the layout anymore
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 5 } }),
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = {} }),
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 1, 5 } }),
+            };
+
+            const auto plan = PlanRelayout(backend, windows);
+            Assert::AreEqual(size_t{ 1 }, plan.size());
+            Assert::AreEqual(size_t{ 1 }, plan[0].deferredMoves.size());
+            Assert::IsTrue(std::vector<size_t>{ 1 } == plan[0].deferredMoves[0].zoneIds);
+        }
+
+        TEST_METHOD (StampsZonesInLayout)
+        {
+            FakeWindowBackend backend;
+            std::vector<HWND> windows{
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 5 } }),
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 1, 5 } }),
+                backend.AddWindow({ .rect = { 0, 0, 960, 1080 }, .zoneIds = { 0 } }),
+            };
+
+            ApplyPlan(backend, PlanRelayout(backend, windows));
+            Assert::AreEqual(size_t{ 2 }, backend.stampCount);
+            // Not moved, so not stamped
+            Assert::IsTrue(std::vector<size_t>{ 5 } == backend.Window(windows[0]).zoneIds);
+            Assert::IsTrue(std::vector<size_t>{ 1 } == backend.Window(windows[1]).zoneIds);
+            Assert::IsTrue(std::vector<size_t>{ 0 } == backend.Window(windows[2]).zoneIds);
+        }
+
+        TEST_METHOD (FailedTransactionPlacesWindows)
+        {
+            FakeWindowBackend backend;
+            backend.failTransactions = true;
+            std::vector<HWND> windows{
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 0 } }),
+                backend.AddWindow({ .rect = { 10, 10, 500, 500 }, .zoneIds = { 1 } }),
+            };
+
+            ApplyPlan(backend, PlanRelayout(backend, windows));
+            Assert::AreEqual(size_t{ 2 }, backend.placementCount);
+            Assert::IsTrue(SameRect(RECT{ 0, 0, 960, 1080 }, backend.Window(windows[0]).rect));
+        }
+
+        TEST_METHOD (PlanManyWindows)
+        {
+            FakeWindowBackend backend;
+            std::vector<HWND> windows;
+            for (size_t i = 0; i < 1000; i++)
+            {
+                // Every other window on the right monitor, the others in both zones of the left monitor
+                const bool right = (i % 2) != 0;
+                const long left = right ? 2000 : 10;
+                const size_t zoneId = right ? 0 : (i / 2) % 2;
+                windows.push_back(backend.AddWindow({ .rect = { left, 10, left + 500, 500 }, .zoneIds = { zoneId } }));
+            }
+
+            // One transaction per monitor however many windows there are
+            const auto plan = PlanRelayout(backend, windows);
+            ApplyPlan(backend, plan);
+
+            Assert::AreEqual(size_t{ 2 }, plan.size());
+            Assert::AreEqual(size_t{ 2 }, backend.transactionCount);
+            Assert::AreEqual(size_t{ 0 }, backend.placementCount);
+        }
+    };
+}
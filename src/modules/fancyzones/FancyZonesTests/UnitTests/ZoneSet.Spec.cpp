@@ -3,9 +3,13 @@
 #include "FancyZonesLib\FancyZonesDataTypes.h"
 #include "FancyZonesLib\JsonHelpers.h"
 #include "FancyZonesLib\VirtualDesktopUtils.h"
+#include "FancyZonesLib\ZoneNavigationGraph.h"
 #include "FancyZonesLib\ZoneSet.h"
+#include "FancyZonesLib\util.h"
 
+#include <complex>
 #include <filesystem>
+#include <random>
 
 #include "Util.h"
 #include <common/SettingsAPI/settings_helpers.h>
@@ -172,7 +176,7 @@ namespace FancyZonesUnitTests
                     {
                         auto actual = m_set->ZonesFromPoint(POINT{ i, j });
                         Assert::IsTrue(actual.size() == 1);
-                        compareZones(expected, m_set->GetZones()[actual[0]]);
+                        compareZones(expected, m_set->GetZones().at(actual[0]));
                     }
                 }
             }
@@ -187,14 +191,14 @@ namespace FancyZonesUnitTests
                 {
                     auto actual = m_set->ZonesFromPoint(POINT{ i, top });
                     Assert::IsTrue(actual.size() == 1);
-                    compareZones(expected, m_set->GetZones()[actual[0]]);
+                    compareZones(expected, m_set->GetZones().at(actual[0]));
                 }
 
                 for (int i = top; i < bottom; i++)
                 {
                     auto actual = m_set->ZonesFromPoint(POINT{ left, i });
                     Assert::IsTrue(actual.size() == 1);
-                    compareZones(expected, m_set->GetZones()[actual[0]]);
+                    compareZones(expected, m_set->GetZones().at(actual[0]));
                 }
 
                 //bottom and right borders considered to be outside
@@ -237,7 +241,7 @@ namespace FancyZonesUnitTests
 
                 auto actual = m_set->ZonesFromPoint(POINT{ 50, 50 });
                 Assert::IsTrue(actual.size() == 1);
-                compareZones(zone4, m_set->GetZones()[actual[0]]);
+                compareZones(zone4, m_set->GetZones().at(actual[0]));
             }
 
             TEST_METHOD (ZoneFromPointMultizoneHorizontal)
@@ -253,8 +257,8 @@ namespace FancyZonesUnitTests
 
                 auto actual = m_set->ZonesFromPoint(POINT{ 50, 100 });
                 Assert::IsTrue(actual.size() == 2);
-                compareZones(zone1, m_set->GetZones()[actual[0]]);
-                compareZones(zone3, m_set->GetZones()[actual[1]]);
+                compareZones(zone1, m_set->GetZones().at(actual[0]));
+                compareZones(zone3, m_set->GetZones().at(actual[1]));
             }
 
             TEST_METHOD (ZoneFromPointMultizoneVertical)
@@ -270,8 +274,8 @@ namespace FancyZonesUnitTests
 
                 auto actual = m_set->ZonesFromPoint(POINT{ 100, 50 });
                 Assert::IsTrue(actual.size() == 2);
-                compareZones(zone1, m_set->GetZones()[actual[0]]);
-                compareZones(zone2, m_set->GetZones()[actual[1]]);
+                compareZones(zone1, m_set->GetZones().at(actual[0]));
+                compareZones(zone2, m_set->GetZones().at(actual[1]));
             }
 
             TEST_METHOD (ZoneFromPointMultizoneQuad)
@@ -287,10 +291,26 @@ namespace FancyZonesUnitTests
 
                 auto actual = m_set->ZonesFromPoint(POINT{ 100, 100 });
                 Assert::IsTrue(actual.size() == 4);
-                compareZones(zone1, m_set->GetZones()[actual[0]]);
-                compareZones(zone2, m_set->GetZones()[actual[1]]);
-                compareZones(zone3, m_set->GetZones()[actual[2]]);
-                compareZones(zone4, m_set->GetZones()[actual[3]]);
+                compareZones(zone1, m_set->GetZones().at(actual[0]));
+                compareZones(zone2, m_set->GetZones().at(actual[1]));
+                compareZones(zone3, m_set->GetZones().at(actual[2]));
+                compareZones(zone4, m_set->GetZones().at(actual[3]));
+            }
+
+            TEST_METHOD (ZoneFromPointAfterAddZone)
+            {
+                winrt::com_ptr<IZone> zone1 = MakeZone({ 0, 0, 100, 100 }, 1);
+                m_set->AddZone(zone1);
+
+                auto actual = m_set->ZonesFromPoint(POINT{ 150, 50 });
+                Assert::IsTrue(actual.size() == 0);
+
+                winrt::com_ptr<IZone> zone2 = MakeZone({ 100, 0, 200, 100 }, 2);
+                m_set->AddZone(zone2);
+
+                actual = m_set->ZonesFromPoint(POINT{ 150, 50 });
+                Assert::IsTrue(actual.size() == 1);
+                compareZones(zone2, m_set->GetZones().at(actual[0]));
             }
 
             TEST_METHOD (ZoneIndexFromWindowUnknown)
@@ -416,6 +436,33 @@ namespace FancyZonesUnitTests
                 Assert::IsTrue(std::vector<size_t>{ 0 } == m_set->GetZoneIndexSetFromWindow(window));
             }
 
+            TEST_METHOD (MoveWindowIntoZoneByIndexSetStampsZonesAbove63)
+            {
+                for (size_t i = 0; i < 130; i++)
+                {
+                    m_set->AddZone(MakeZone({ 0, 0, 100, 100 }, i));
+                }
+
+                const std::vector<size_t> expected{ 3, 64, 129 };
+                auto window = Mocks::Window();
+                m_set->MoveWindowIntoZoneByIndexSet(window, Mocks::Window(), expected);
+
+                Assert::IsTrue(expected == m_set->GetZoneIndexSetFromWindow(window));
+                Assert::IsTrue(expected == FancyZonesUtils::GetZoneIndexSetStamp(window));
+            }
+
+            TEST_METHOD (MoveWindowIntoZoneByIndexSetStampsOnlyLayoutZones)
+            {
+                m_set->AddZone(MakeZone({ 0, 0, 100, 100 }, 0));
+                m_set->AddZone(MakeZone({ 0, 0, 100, 100 }, 1));
+
+                auto window = Mocks::Window();
+                m_set->MoveWindowIntoZoneByIndexSet(window, Mocks::Window(), { 1, 5, std::numeric_limits<size_t>::max() });
+
+                Assert::IsTrue(std::vector<size_t>{ 1 } == m_set->GetZoneIndexSetFromWindow(window));
+                Assert::IsTrue(std::vector<size_t>{ 1 } == FancyZonesUtils::GetZoneIndexSetStamp(window));
+            }
+
             TEST_METHOD (MoveWindowIntoZoneByPointInnerPointOverlappingZones)
             {
                 winrt::com_ptr<IZone> zone1 = MakeZone({ 0, 0, 100, 100 }, 0);
@@ -486,6 +533,315 @@ namespace FancyZonesUnitTests
             }
     };
 
+    // ZonesFromPoint on large layouts, against the linear scan it used before the spatial index.
+    // FancyZonesBenchmark measures how long both take.
+    TEST_CLASS (ZoneSetHitTestUnitTests)
+    {
+        // 3 4K monitors side by side
+        const RECT m_workArea{ 0, 0, 3 * 3840, 2160 };
+        const int m_hitTestCount = 10000;
+
+        std::vector<size_t> linearZonesFromPoint(const IZoneSet::ZonesMap& zones, POINT pt)
+        {
+            const int radius = DefaultValues::SensitivityRadius;
+            std::vector<size_t> capturedZones;
+            size_t strictlyCapturedCount = 0;
+            for (const auto& [zoneId, zone] : zones)
+            {
+                const RECT zoneRect = zone->GetZoneRect();
+                if (zoneRect.left - radius <= pt.x && pt.x <= zoneRect.right + radius &&
+                    zoneRect.top - radius <= pt.y && pt.y <= zoneRect.bottom + radius)
+                {
+                    capturedZones.emplace_back(zoneId);
+                }
+
+                if (zoneRect.left <= pt.x && pt.x < zoneRect.right &&
+                    zoneRect.top <= pt.y && pt.y < zoneRect.bottom)
+                {
+                    strictlyCapturedCount++;
+                }
+            }
+
+            if (capturedZones.size() == 1 && strictlyCapturedCount == 0)
+            {
+                return {};
+            }
+
+            for (size_t i = 0; i < capturedZones.size(); ++i)
+            {
+                for (size_t j = i + 1; j < capturedZones.size(); ++j)
+                {
+                    const RECT rectI = zones.at(capturedZones[i])->GetZoneRect();
+                    const RECT rectJ = zones.at(capturedZones[j])->GetZoneRect();
+                    if (max(rectI.top, rectJ.top) + radius < min(rectI.bottom, rectJ.bottom) &&
+                        max(rectI.left, rectJ.left) + radius < min(rectI.right, rectJ.right))
+                    {
+                        // Smallest zone is selected
+                        size_t chosen = 0;
+                        for (size_t k = 1; k < capturedZones.size(); ++k)
+                        {
+                            if (zones.at(capturedZones[k])->GetZoneArea() < zones.at(capturedZones[chosen])->GetZoneArea())
+                            {
+                                chosen = k;
+                            }
+                        }
+                        return { capturedZones[chosen] };
+                    }
+                }
+            }
+
+            return capturedZones;
+        }
+
+        std::vector<POINT> makePoints()
+        {
+            std::mt19937 random(42);
+            std::uniform_int_distribution<long> x(m_workArea.left - 50, m_workArea.right + 50);
+            std::uniform_int_distribution<long> y(m_workArea.top - 50, m_workArea.bottom + 50);
+            std::vector<POINT> points(m_hitTestCount);
+            for (auto& point : points)
+            {
+                point = POINT{ x(random), y(random) };
+            }
+            return points;
+        }
+
+        void verify(const winrt::com_ptr<IZoneSet>& set)
+        {
+            const auto zones = set->GetZones();
+            const auto points = makePoints();
+
+            for (const auto& point : points)
+            {
+                Assert::IsTrue(linearZonesFromPoint(zones, point) == set->ZonesFromPoint(point));
+            }
+        }
+
+    public:
+        TEST_METHOD (GridLayout)
+        {
+            ZoneSetConfig config({}, ZoneSetLayoutType::Grid, Mocks::Monitor(), DefaultValues::SensitivityRadius);
+            auto set = MakeZoneSet(config);
+            Assert::IsTrue(set->CalculateZones(m_workArea, 120, 10));
+
+            verify(set);
+        }
+
+        TEST_METHOD (OverlappingCanvasLayout)
+        {
+            ZoneSetConfig config({}, ZoneSetLayoutType::Custom, Mocks::Monitor(), DefaultValues::SensitivityRadius);
+            auto set = MakeZoneSet(config);
+
+            std::mt19937 random(7);
+            std::uniform_int_distribution<long> x(0, m_workArea.right - 1000);
+            std::uniform_int_distribution<long> y(0, m_workArea.bottom - 600);
+            std::uniform_int_distribution<long> size(200, 1000);
+            for (size_t i = 0; i < 120; i++)
+            {
+                const long left = x(random);
+                const long top = y(random);
+                set->AddZone(MakeZone({ left, top, left + size(random), top + size(random) * 3 / 5 }, i));
+            }
+
+            verify(set);
+        }
+    };
+
+    TEST_CLASS (ZoneSetNavigationGraphUnitTests)
+    {
+        // 3 4K monitors side by side
+        const RECT m_workArea{ 0, 0, 3 * 3840, 2160 };
+        const std::array<DWORD, 4> m_keys{ VK_LEFT, VK_UP, VK_RIGHT, VK_DOWN };
+
+        // Search used before the navigation graph
+        static size_t linearChooseNextZone(DWORD vkCode, RECT windowRect, const std::vector<RECT>& zoneRects)
+        {
+            using complex = std::complex<double>;
+            const double inf = 1e100;
+            const double eccentricity = 2.0;
+
+            auto rectCenter = [](RECT rect) {
+                return complex{ 0.5 * rect.left + 0.5 * rect.right, 0.5 * rect.top + 0.5 * rect.bottom };
+            };
+
+            auto distance = [&](complex arrowDirection, complex zoneDirection) {
+                double scalarProduct = (arrowDirection * conj(zoneDirection)).real();
+                if (scalarProduct <= 0.0)
+                {
+                    return inf;
+                }
+
+                double cosAngle = scalarProduct / std::abs(zoneDirection);
+                double tanAngle = std::abs(std::tan(std::acos(cosAngle)));
+                if (tanAngle > 10)
+                {
+                    return inf;
+                }
+
+                double intersectY = 2 * eccentricity / (1.0 + eccentricity * eccentricity * tanAngle * tanAngle);
+                double distanceEstimate = scalarProduct / intersectY;
+                return std::isfinite(distanceEstimate) ? distanceEstimate : inf;
+            };
+
+            complex directionVector;
+            switch (vkCode)
+            {
+            case VK_UP:
+                directionVector = { 0.0, -1.0 };
+                break;
+            case VK_DOWN:
+                directionVector = { 0.0, 1.0 };
+                break;
+            case VK_LEFT:
+                directionVector = { -1.0, 0.0 };
+                break;
+            case VK_RIGHT:
+                directionVector = { 1.0, 0.0 };
+                break;
+            }
+
+            size_t closestIdx = zoneRects.size();
+            double smallestDistance = inf;
+            for (size_t i = 0; i < zoneRects.size(); i++)
+            {
+                double dist = distance(directionVector, rectCenter(zoneRects[i]) + 0.001 * (i + 1) - rectCenter(windowRect));
+                if (dist < smallestDistance)
+                {
+                    smallestDistance = dist;
+                    closestIdx = i;
+                }
+            }
+
+            return closestIdx;
+        }
+
+        // Next zone from a zone, the way MoveWindowIntoZoneByDirectionAndPosition used to find it
+        std::optional<size_t> linearNextZone(const IZoneSet::ZonesMap& zones, size_t zoneId, DWORD vkCode, bool cycle)
+        {
+            std::vector<RECT> zoneRects;
+            std::vector<size_t> freeZoneIndices;
+            for (const auto& [id, zone] : zones)
+            {
+                if (id != zoneId)
+                {
+                    zoneRects.emplace_back(zone->GetZoneRect());
+                    freeZoneIndices.emplace_back(id);
+                }
+            }
+
+            const RECT zoneRect = zones.at(zoneId)->GetZoneRect();
+            size_t result = linearChooseNextZone(vkCode, zoneRect, zoneRects);
+            if (result < zoneRects.size())
+            {
+                return freeZoneIndices[result];
+            }
+
+            if (!cycle)
+            {
+                return std::nullopt;
+            }
+
+            zoneRects.clear();
+            for (const auto& [id, zone] : zones)
+            {
+                zoneRects.emplace_back(zone->GetZoneRect());
+            }
+
+            result = linearChooseNextZone(vkCode, FancyZonesUtils::PrepareRectForCycling(zoneRect, m_workArea, vkCode), zoneRects);
+            if (result < zoneRects.size())
+            {
+                return result;
+            }
+
+            return std::nullopt;
+        }
+
+        void verify(const IZoneSet::ZonesMap& zones, const ZoneNavigationGraph& graph)
+        {
+            for (const auto& [zoneId, zone] : zones)
+            {
+                for (DWORD key : m_keys)
+                {
+                    const auto& neighbours = graph.Neighbours(zoneId, key);
+                    Assert::IsTrue(linearNextZone(zones, zoneId, key, false) == (neighbours.empty() ? std::nullopt : std::optional<size_t>{ neighbours.front() }));
+                    if (neighbours.empty())
+                    {
+                        Assert::IsTrue(linearNextZone(zones, zoneId, key, true) == graph.WrapTarget(zoneId, key));
+                    }
+                }
+            }
+        }
+
+    public:
+        TEST_METHOD (GridLayout)
+        {
+            ZoneSetConfig config({}, ZoneSetLayoutType::Grid, Mocks::Monitor(), DefaultValues::SensitivityRadius);
+            auto set = MakeZoneSet(config);
+            Assert::IsTrue(set->CalculateZones(m_workArea, 120, 10));
+
+            verify(set->GetZones(), set->GetNavigationGraph());
+        }
+
+        TEST_METHOD (OverlappingCanvasLayout)
+        {
+            ZoneSetConfig config({}, ZoneSetLayoutType::Custom, Mocks::Monitor(), DefaultValues::SensitivityRadius);
+            auto set = MakeZoneSet(config);
+
+            std::mt19937 random(7);
+            std::uniform_int_distribution<long> x(0, m_workArea.right - 1000);
+            std::uniform_int_distribution<long> y(0, m_workArea.bottom - 600);
+            std::uniform_int_distribution<long> size(200, 1000);
+            for (size_t i = 0; i < 120; i++)
+            {
+                const long left = x(random);
+                const long top = y(random);
+                set->AddZone(MakeZone({ left, top, left + size(random), top + size(random) * 3 / 5 }, i));
+            }
+
+            // Zones added with AddZone don't have a work area, the graph is built for this one
+            LayoutEngine::Zones zoneRects;
+            for (const auto& [zoneId, zone] : set->GetZones())
+            {
+                zoneRects.push_back({ zoneId, zone->GetZoneRect() });
+            }
+
+            ZoneNavigationGraph graph;
+            graph.Build(zoneRects, SIZE{ m_workArea.right - m_workArea.left, m_workArea.bottom - m_workArea.top });
+
+            verify(set->GetZones(), graph);
+        }
+
+        TEST_METHOD (SearchFromWindowRect)
+        {
+            ZoneSetConfig config({}, ZoneSetLayoutType::Grid, Mocks::Monitor(), DefaultValues::SensitivityRadius);
+            auto set = MakeZoneSet(config);
+            Assert::IsTrue(set->CalculateZones(m_workArea, 120, 10));
+
+            std::vector<RECT> zoneRects;
+            for (const auto& [zoneId, zone] : set->GetZones())
+            {
+                zoneRects.emplace_back(zone->GetZoneRect());
+            }
+
+            std::mt19937 random(42);
+            std::uniform_int_distribution<long> x(m_workArea.left, m_workArea.right);
+            std::uniform_int_distribution<long> y(m_workArea.top, m_workArea.bottom);
+            std::uniform_int_distribution<long> size(100, 2000);
+            for (int i = 0; i < 1000; i++)
+            {
+                const long left = x(random);
+                const long top = y(random);
+                const RECT windowRect{ left, top, left + size(random), top + size(random) };
+                for (DWORD key : m_keys)
+                {
+                    const size_t expected = linearChooseNextZone(key, windowRect, zoneRects);
+                    const auto actual = set->GetNavigationGraph().Search(windowRect, key);
+                    Assert::IsTrue((expected < zoneRects.size() ? std::optional<size_t>{ expected } : std::nullopt) == actual);
+                }
+            }
+        }
+    };
+
     // MoveWindowIntoZoneByDirectionAndIndex is complicated enough to warrant it's own test class
     TEST_CLASS (ZoneSetsMoveWindowIntoZoneByDirectionUnitTests)
     {
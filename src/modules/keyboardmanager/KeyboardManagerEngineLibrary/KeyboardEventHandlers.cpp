@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "KeyboardEventHandlers.h"
 
+#include <span>
+
 #include <common/interop/shared_constants.h>
 
 #include <keyboardmanager/common/InputInterface.h>
@@ -178,23 +180,27 @@ namespace KeyboardEventHandlers
     // Function to a handle a shortcut remap
     intptr_t HandleShortcutRemapEvent(KeyboardManagerInput::InputInterface& ii, LowlevelKeyboardEvent* data, State& state, const std::optional<std::wstring>& activatedApp) noexcept
     {
-        // Check if any shortcut is currently in the invoked state
-        bool isShortcutInvoked = state.CheckShortcutRemapInvoked(activatedApp);
-
-        // Get shortcut table for given activatedApp
-        ShortcutRemapTable& reMap = state.GetShortcutRemapTable(activatedApp);
+        // Get shortcut dispatch table for given activatedApp
+        ShortcutDispatchTable& dispatchTable = state.GetShortcutDispatchTable(activatedApp);
 
-        // Iterate through the shortcut remaps and apply whichever has been pressed
-        for (auto& itShortcut : state.GetSortedShortcutRemapVector(activatedApp))
+        // If a shortcut is currently in the invoked state then only that shortcut handles the event. Otherwise only a key down of an action key can invoke a shortcut, so only the shortcuts with that action key are checked
+        std::span<const ShortcutRemapTable::iterator> candidateRemaps;
+        if (dispatchTable.invokedRemap)
         {
-            const auto it = reMap.find(itShortcut);
-
-            // If a shortcut is currently in the invoked state then skip till the shortcut that is currently invoked
-            if (isShortcutInvoked && !it->second.isShortcutInvoked)
+            candidateRemaps = std::span<const ShortcutRemapTable::iterator>(&*dispatchTable.invokedRemap, 1);
+        }
+        else if (data->wParam == WM_KEYDOWN || data->wParam == WM_SYSKEYDOWN)
+        {
+            auto itRemaps = dispatchTable.remapsByActionKey.find(data->lParam->vkCode);
+            if (itRemaps != dispatchTable.remapsByActionKey.end())
             {
-                continue;
+                candidateRemaps = itRemaps->second;
             }
+        }
 
+        // Iterate through the candidate shortcut remaps and apply whichever has been pressed
+        for (const auto it : candidateRemaps)
+        {
             // Check if the remap is to a key or a shortcut
             bool remapToShortcut = (it->second.targetShortcut.index() == 1);
 
@@ -310,6 +316,7 @@ namespace KeyboardEventHandlers
                     }
 
                     it->second.isShortcutInvoked = true;
+                    dispatchTable.invokedRemap = it;
                     // If app specific shortcut is invoked, store the target application
                     if (activatedApp)
                     {
@@ -426,6 +433,7 @@ namespace KeyboardEventHandlers
 
                     // Reset the remap state
                     it->second.isShortcutInvoked = false;
+                    dispatchTable.invokedRemap = std::nullopt;
                     it->second.winKeyInvoked = ModifierKey::Disabled;
                     it->second.isOriginalActionKeyPressed = false;
 
@@ -529,6 +537,7 @@ namespace KeyboardEventHandlers
 
                                 // Reset the remap state
                                 it->second.isShortcutInvoked = false;
+                                dispatchTable.invokedRemap = std::nullopt;
                                 it->second.winKeyInvoked = ModifierKey::Disabled;
                                 it->second.isOriginalActionKeyPressed = false;
 
@@ -662,6 +671,7 @@ namespace KeyboardEventHandlers
 
                             // Reset the remap state
                             it->second.isShortcutInvoked = false;
+                            dispatchTable.invokedRemap = std::nullopt;
                             it->second.winKeyInvoked = ModifierKey::Disabled;
                             it->second.isOriginalActionKeyPressed = false;
 
@@ -731,6 +741,7 @@ namespace KeyboardEventHandlers
 
                                 // Reset the remap state
                                 it->second.isShortcutInvoked = false;
+                                dispatchTable.invokedRemap = std::nullopt;
                                 it->second.winKeyInvoked = ModifierKey::Disabled;
                                 it->second.isOriginalActionKeyPressed = false;
 
@@ -14,40 +14,19 @@ std::optional<SingleKeyRemapTable::iterator> State::GetSingleKeyRemap(const DWOR
     return std::nullopt;
 }
 
-bool State::CheckShortcutRemapInvoked(const std::optional<std::wstring>& appName)
-{
-    // Assumes appName exists in the app-specific remap table
-    ShortcutRemapTable& currentRemapTable = appName ? appSpecificShortcutReMap[*appName] : osLevelShortcutReMap;
-    for (auto& it : currentRemapTable)
-    {
-        if (it.second.isShortcutInvoked)
-        {
-            return true;
-        }
-    }
-
-    return false;
-}
-
-// Function to get the source and target of a shortcut remap given the source shortcut. Returns nullopt if it isn't remapped
-ShortcutRemapTable& State::GetShortcutRemapTable(const std::optional<std::wstring>& appName)
+// Function to get the shortcut dispatch table for the given app, or the os level one if the app has no shortcut remaps
+ShortcutDispatchTable& State::GetShortcutDispatchTable(const std::optional<std::wstring>& appName)
 {
     if (appName)
     {
-        auto itTable = appSpecificShortcutReMap.find(*appName);
-        if (itTable != appSpecificShortcutReMap.end())
+        auto itTable = appSpecificShortcutDispatch.find(*appName);
+        if (itTable != appSpecificShortcutDispatch.end())
         {
             return itTable->second;
         }
     }
 
-    return osLevelShortcutReMap;
-}
-
-std::vector<Shortcut>& State::GetSortedShortcutRemapVector(const std::optional<std::wstring>& appName)
-{
-    // Assumes appName exists in the app-specific remap table
-    return appName ? appSpecificShortcutReMapSortedKeys[*appName] : osLevelShortcutReMapSortedKeys;
+    return osLevelShortcutDispatch;
 }
 
 // Sets the activated target application in app-specific shortcut
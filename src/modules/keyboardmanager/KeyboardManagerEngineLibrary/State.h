@@ -11,12 +11,8 @@ public:
     // Function to get the iterator of a single key remap given the source key. Returns nullopt if it isn't remapped
     std::optional<SingleKeyRemapTable::iterator> GetSingleKeyRemap(const DWORD& originalKey);
 
-    bool CheckShortcutRemapInvoked(const std::optional<std::wstring>& appName);
-
-    // Function to get the source and target of a shortcut remap given the source shortcut. Returns nullopt if it isn't remapped
-    ShortcutRemapTable& GetShortcutRemapTable(const std::optional<std::wstring>& appName);
-
-    std::vector<Shortcut>& GetSortedShortcutRemapVector(const std::optional<std::wstring>& appName);
+    // Function to get the shortcut dispatch table for the given app, or the os level one if the app has no shortcut remaps
+    ShortcutDispatchTable& GetShortcutDispatchTable(const std::optional<std::wstring>& appName);
 
     // Sets the activated target application in app-specific shortcut
     void SetActivatedApp(const std::wstring& appName);
@@ -2687,5 +2687,77 @@ namespace RemappingLogicTests
             // LWin should be pressed
             Assert::AreEqual(true, mockedInputHandler.GetVirtualKeyState(VK_LWIN));
         }
+
+        // Test if the shortcuts are grouped by action key with the longest shortcut first, and the invoked shortcut is tracked until it is released
+        TEST_METHOD (ShortcutDispatchTable_ShouldTrackInvokedShortcut_WhenShortcutIsPressedAndReleased)
+        {
+            // Remap Ctrl+A to Alt+V, Ctrl+Shift+A to Alt+B and Ctrl+C to Alt+D
+            Shortcut src1;
+            src1.SetKey(VK_CONTROL);
+            src1.SetKey(0x41);
+            Shortcut dest1;
+            dest1.SetKey(VK_MENU);
+            dest1.SetKey(0x56);
+            testState.AddOSLevelShortcut(src1, dest1);
+
+            Shortcut src2;
+            src2.SetKey(VK_CONTROL);
+            src2.SetKey(VK_SHIFT);
+            src2.SetKey(0x41);
+            Shortcut dest2;
+            dest2.SetKey(VK_MENU);
+            dest2.SetKey(0x42);
+            testState.AddOSLevelShortcut(src2, dest2);
+
+            Shortcut src3;
+            src3.SetKey(VK_CONTROL);
+            src3.SetKey(0x43);
+            Shortcut dest3;
+            dest3.SetKey(VK_MENU);
+            dest3.SetKey(0x44);
+            testState.AddOSLevelShortcut(src3, dest3);
+
+            // A should dispatch to Ctrl+Shift+A before Ctrl+A, C only to Ctrl+C
+            ShortcutDispatchTable& dispatchTable = testState.osLevelShortcutDispatch;
+            Assert::AreEqual((size_t)2, dispatchTable.remapsByActionKey.size());
+            Assert::AreEqual((size_t)2, dispatchTable.remapsByActionKey[0x41].size());
+            Assert::IsTrue(dispatchTable.remapsByActionKey[0x41][0]->first == src2);
+            Assert::IsTrue(dispatchTable.remapsByActionKey[0x41][1]->first == src1);
+            Assert::AreEqual((size_t)1, dispatchTable.remapsByActionKey[0x43].size());
+            Assert::IsFalse(dispatchTable.invokedRemap.has_value());
+
+            const int nInputs = 3;
+            INPUT input[nInputs] = {};
+            input[0].type = INPUT_KEYBOARD;
+            input[0].ki.wVk = VK_CONTROL;
+            input[1].type = INPUT_KEYBOARD;
+            input[1].ki.wVk = VK_SHIFT;
+            input[2].type = INPUT_KEYBOARD;
+            input[2].ki.wVk = 0x41;
+
+            // Send Ctrl+Shift+A keydown
+            mockedInputHandler.SendVirtualInput(nInputs, input, sizeof(INPUT));
+
+            // Ctrl+Shift+A should be the invoked shortcut
+            Assert::IsTrue(dispatchTable.invokedRemap.has_value());
+            Assert::IsTrue((*dispatchTable.invokedRemap)->first == src2);
+            Assert::AreEqual(true, testState.osLevelShortcutReMap[src2].isShortcutInvoked);
+            Assert::AreEqual(false, testState.osLevelShortcutReMap[src1].isShortcutInvoked);
+            Assert::AreEqual(true, mockedInputHandler.GetVirtualKeyState(0x42));
+
+            input[0].ki.dwFlags = KEYEVENTF_KEYUP;
+            input[1].ki.dwFlags = KEYEVENTF_KEYUP;
+            input[2].ki.dwFlags = KEYEVENTF_KEYUP;
+            std::swap(input[0], input[2]);
+
+            // Release A, Shift and Ctrl
+            mockedInputHandler.SendVirtualInput(nInputs, input, sizeof(INPUT));
+
+            // No shortcut should be invoked
+            Assert::IsFalse(dispatchTable.invokedRemap.has_value());
+            Assert::AreEqual(false, testState.osLevelShortcutReMap[src2].isShortcutInvoked);
+            Assert::AreEqual(false, mockedInputHandler.GetVirtualKeyState(VK_MENU));
+            Assert::AreEqual(false, mockedInputHandler.GetVirtualKeyState(0x42));
+        }
     };
 }
@@ -222,12 +222,4 @@ namespace Helpers
 
         return key;
     }
-
-    // Function to sort a vector of shortcuts based on it's size
-    void SortShortcutVectorBasedOnSize(std::vector<Shortcut>& shortcutVector)
-    {
-        std::sort(shortcutVector.begin(), shortcutVector.end(), [](Shortcut first, Shortcut second) {
-            return first.Size() > second.Size();
-        });
-    }
 }
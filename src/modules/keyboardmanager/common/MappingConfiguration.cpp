@@ -10,11 +10,24 @@
 #include "RemapShortcut.h"
 #include "Helpers.h"
 
+namespace
+{
+    // Function to add a remap to the dispatch table, after the remaps of its action key with as many or more keys
+    void AddToShortcutDispatchTable(ShortcutDispatchTable& dispatchTable, ShortcutRemapTable::iterator remap)
+    {
+        auto& remaps = dispatchTable.remapsByActionKey[remap->first.GetActionKey()];
+        auto position = std::upper_bound(remaps.begin(), remaps.end(), remap, [](const ShortcutRemapTable::iterator& first, const ShortcutRemapTable::iterator& second) {
+            return first->first.Size() > second->first.Size();
+        });
+        remaps.insert(position, remap);
+    }
+}
+
 // Function to clear the OS Level shortcut remapping table
 void MappingConfiguration::ClearOSLevelShortcuts()
 {
     osLevelShortcutReMap.clear();
-    osLevelShortcutReMapSortedKeys.clear();
+    osLevelShortcutDispatch = ShortcutDispatchTable();
 }
 
 
@@ -28,7 +41,7 @@ void MappingConfiguration::ClearSingleKeyRemaps()
 void MappingConfiguration::ClearAppSpecificShortcuts()
 {
     appSpecificShortcutReMap.clear();
-    appSpecificShortcutReMapSortedKeys.clear();
+    appSpecificShortcutDispatch.clear();
 }
 
 // Function to add a new OS level shortcut remapping
@@ -41,9 +54,8 @@ bool MappingConfiguration::AddOSLevelShortcut(const Shortcut& originalSC, const
         return false;
     }
 
-    osLevelShortcutReMap[originalSC] = RemapShortcut(newSC);
-    osLevelShortcutReMapSortedKeys.push_back(originalSC);
-    Helpers::SortShortcutVectorBasedOnSize(osLevelShortcutReMapSortedKeys);
+    it = osLevelShortcutReMap.emplace(originalSC, RemapShortcut(newSC)).first;
+    AddToShortcutDispatchTable(osLevelShortcutDispatch, it);
 
     return true;
 }
@@ -81,14 +93,9 @@ bool MappingConfiguration::AddAppSpecificShortcut(const std::wstring& app, const
             return false;
         }
     }
-    else
-    {
-        appSpecificShortcutReMapSortedKeys[process_name] = std::vector<Shortcut>();
-    }
 
-    appSpecificShortcutReMap[process_name][originalSC] = RemapShortcut(newSC);
-    appSpecificShortcutReMapSortedKeys[process_name].push_back(originalSC);
-    Helpers::SortShortcutVectorBasedOnSize(appSpecificShortcutReMapSortedKeys[process_name]);
+    auto shortcutIt = appSpecificShortcutReMap[process_name].emplace(originalSC, RemapShortcut(newSC)).first;
+    AddToShortcutDispatchTable(appSpecificShortcutDispatch[process_name], shortcutIt);
     return true;
 }
 
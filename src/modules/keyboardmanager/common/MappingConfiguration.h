@@ -10,6 +10,16 @@ using SingleKeyRemapTable = std::unordered_map<DWORD, KeyShortcutUnion>;
 using ShortcutRemapTable = std::map<Shortcut, RemapShortcut>;
 using AppSpecificShortcutRemapTable = std::map<std::wstring, ShortcutRemapTable>;
 
+// Shortcut remaps of a remap table grouped by action key, so that a key event is only checked against the remaps it can invoke
+struct ShortcutDispatchTable
+{
+    // Remaps for each action key, the ones with the most keys first
+    std::unordered_map<DWORD, std::vector<ShortcutRemapTable::iterator>> remapsByActionKey;
+
+    // Remap which is currently invoked, if any. Only one remap of a table can be invoked at a time
+    std::optional<ShortcutRemapTable::iterator> invokedRemap;
+};
+
 class MappingConfiguration
 {
 public:
@@ -17,6 +27,10 @@ public:
 
     ~MappingConfiguration() = default;
 
+    // The dispatch tables point into the remap tables, so a copy would point into the original
+    MappingConfiguration(const MappingConfiguration&) = delete;
+    MappingConfiguration& operator=(const MappingConfiguration&) = delete;
+
     // Load the configuration.
     bool LoadSettings();
 
@@ -48,11 +62,11 @@ public:
 
     // Stores the os level shortcut remappings
     ShortcutRemapTable osLevelShortcutReMap;
-    std::vector<Shortcut> osLevelShortcutReMapSortedKeys;
+    ShortcutDispatchTable osLevelShortcutDispatch;
 
     // Stores the app-specific shortcut remappings. Maps application name to the shortcut map
     AppSpecificShortcutRemapTable appSpecificShortcutReMap;
-    std::map<std::wstring, std::vector<Shortcut>> appSpecificShortcutReMapSortedKeys;
+    std::map<std::wstring, ShortcutDispatchTable> appSpecificShortcutDispatch;
 
     // Stores the current configuration name.
     std::wstring currentConfig = KeyboardManagerConstants::DefaultConfiguration;
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "BenchmarkItems.h"
+#include <functional>
+#include <string>
+
+namespace
+{
+    const UINT FolderSize = 1000;
+    const UINT MaxDepth = 4;
+
+    PCWSTR c_extensions[] = { L".jpg", L".txt", L".docx", L".png", L".tar.gz", L"" };
+}
+
+HRESULT CBenchmarkRenameItem::CreateInstance(_In_ PCWSTR path, _In_ UINT depth, _In_ bool isFolder, _In_ const std::shared_ptr<CPowerRenameStringArena>& arena, _Outptr_ IPowerRenameItem** ppItem)
+{
+    *ppItem = nullptr;
+    CBenchmarkRenameItem* newItem = new CBenchmarkRenameItem();
+    HRESULT hr = E_OUTOFMEMORY;
+    if (newItem)
+    {
+        newItem->m_arena = arena;
+        hr = newItem->_PutNames(path, nullptr);
+        if (SUCCEEDED(hr))
+        {
+            newItem->m_originalName = PathFindFileName(newItem->m_path);
+            newItem->m_depth = depth;
+            newItem->m_isFolder = isFolder;
+            hr = newItem->QueryInterface(IID_PPV_ARGS(ppItem));
+        }
+        newItem->Release();
+    }
+
+    return hr;
+}
+
+IFACEMETHODIMP CBenchmarkMetadataSource::QueryInterface(_In_ REFIID riid, _Outptr_ void** ppv)
+{
+    static const QITAB qit[] = {
+        QITABENT(CBenchmarkMetadataSource, IPowerRenameMetadataSource),
+        { 0 },
+    };
+    return QISearch(this, qit, riid, ppv);
+}
+
+IFACEMETHODIMP_(ULONG) CBenchmarkMetadataSource::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+IFACEMETHODIMP_(ULONG) CBenchmarkMetadataSource::Release()
+{
+    long refCount = InterlockedDecrement(&m_refCount);
+    if (refCount == 0)
+    {
+        delete this;
+    }
+    return refCount;
+}
+
+IFACEMETHODIMP CBenchmarkMetadataSource::GetCreationTimes(_In_ PCWSTR /*folderPath*/, _In_reads_(count) PCWSTR* fileNames, _In_ UINT count, _Out_writes_(count) SYSTEMTIME* times, _Out_writes_(count) HRESULT* results)
+{
+    for (UINT i = 0; i < count; i++)
+    {
+        times[i] = s_GetCreationTime(fileNames[i]);
+        results[i] = S_OK;
+    }
+    return S_OK;
+}
+
+SYSTEMTIME CBenchmarkMetadataSource::s_GetCreationTime(_In_ PCWSTR fileName)
+{
+    size_t hash = std::hash<std::wstring>()(fileName);
+    SYSTEMTIME time = { 0 };
+    time.wYear = static_cast<WORD>(2000 + hash % 25);
+    time.wMonth = static_cast<WORD>(1 + (hash / 25) % 12);
+    time.wDay = static_cast<WORD>(1 + (hash / 300) % 28);
+    time.wHour = static_cast<WORD>((hash / 8400) % 24);
+    time.wMinute = static_cast<WORD>((hash / 201600) % 60);
+    return time;
+}
+
+std::vector<CComPtr<IPowerRenameItem>> CreateBenchmarkItems(_In_ UINT count)
+{
+    std::vector<CComPtr<IPowerRenameItem>> items;
+    items.reserve(count);
+    auto arena = std::make_shared<CPowerRenameStringArena>();
+    for (UINT i = 0; i < count; i++)
+    {
+        const bool isFolder = (i % 10) == 9;
+        std::wstring name = (i % 2 == 0) ? L"IMG_" + std::to_wstring(i) + L"_holiday_foo" : L"doc_" + std::to_wstring(i) + L"_notes";
+        if (!isFolder)
+        {
+            name += c_extensions[i % ARRAYSIZE(c_extensions)];
+        }
+
+        std::wstring path = L"C:\\PowerRenameBenchmark\\folder" + std::to_wstring(i / FolderSize) + L"\\" + name;
+        CComPtr<IPowerRenameItem> item;
+        if (SUCCEEDED(CBenchmarkRenameItem::CreateInstance(path.c_str(), i % MaxDepth, isFolder, arena, &item)))
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
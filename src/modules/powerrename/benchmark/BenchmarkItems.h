@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+#include <PowerRenameItem.h>
+#include <PowerRenameInterfaces.h>
+#include <memory>
+#include <vector>
+
+// Rename item that only exists in memory.  Its time is left to the metadata source.
+class CBenchmarkRenameItem :
+    public CPowerRenameItem
+{
+public:
+    // Items of a benchmark run share an arena like the items of a rename session
+    static HRESULT CreateInstance(_In_ PCWSTR path, _In_ UINT depth, _In_ bool isFolder, _In_ const std::shared_ptr<CPowerRenameStringArena>& arena, _Outptr_ IPowerRenameItem** ppItem);
+};
+
+// Creation times of the synthetic items, derived from their names
+class CBenchmarkMetadataSource :
+    public IPowerRenameMetadataSource
+{
+public:
+    CBenchmarkMetadataSource() :
+        m_refCount(1)
+    {
+    }
+
+    // IUnknown
+    IFACEMETHODIMP QueryInterface(_In_ REFIID riid, _Outptr_ void** ppv);
+    IFACEMETHODIMP_(ULONG) AddRef();
+    IFACEMETHODIMP_(ULONG) Release();
+
+    // IPowerRenameMetadataSource
+    IFACEMETHODIMP GetCreationTimes(_In_ PCWSTR folderPath, _In_reads_(count) PCWSTR* fileNames, _In_ UINT count, _Out_writes_(count) SYSTEMTIME* times, _Out_writes_(count) HRESULT* results);
+
+    static SYSTEMTIME s_GetCreationTime(_In_ PCWSTR fileName);
+
+private:
+    long m_refCount = 0;
+};
+
+// Items with mixed depths and extensions spread over folders of 1000 items.
+// Half of the names contain "foo".
+std::vector<CComPtr<IPowerRenameItem>> CreateBenchmarkItems(_In_ UINT count);
@@ -0,0 +1,26 @@
+#include "pch.h"
+#include "BenchmarkManagerEvents.h"
+
+IFACEMETHODIMP CBenchmarkManagerEvents::QueryInterface(_In_ REFIID riid, _Outptr_ void** ppv)
+{
+    static const QITAB qit[] = {
+        QITABENT(CBenchmarkManagerEvents, IPowerRenameManagerEvents),
+        { 0 },
+    };
+    return QISearch(this, qit, riid, ppv);
+}
+
+IFACEMETHODIMP_(ULONG) CBenchmarkManagerEvents::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+IFACEMETHODIMP_(ULONG) CBenchmarkManagerEvents::Release()
+{
+    long refCount = InterlockedDecrement(&m_refCount);
+    if (refCount == 0)
+    {
+        delete this;
+    }
+    return refCount;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "pch.h"
+#include <PowerRenameInterfaces.h>
+
+// Records when the preview of the manager is done
+class CBenchmarkManagerEvents :
+    public IPowerRenameManagerEvents
+{
+public:
+    CBenchmarkManagerEvents() :
+        m_refCount(1)
+    {
+    }
+
+    // IUnknown
+    IFACEMETHODIMP QueryInterface(_In_ REFIID riid, _Outptr_ void** ppv);
+    IFACEMETHODIMP_(ULONG) AddRef();
+    IFACEMETHODIMP_(ULONG) Release();
+
+    // IPowerRenameManagerEvents
+    IFACEMETHODIMP OnItemAdded(_In_ IPowerRenameItem*, _In_ UINT) { return S_OK; }
+    IFACEMETHODIMP OnUpdate(_In_ UINT, _In_ UINT)
+    {
+        m_updateCount++;
+        return S_OK;
+    }
+    IFACEMETHODIMP OnError(_In_ IPowerRenameItem*) { return S_OK; }
+    IFACEMETHODIMP OnRegExStarted(_In_ DWORD) { return S_OK; }
+    IFACEMETHODIMP OnRegExCanceled(_In_ DWORD)
+    {
+        m_regExCanceled = true;
+        return S_OK;
+    }
+    IFACEMETHODIMP OnRegExCompleted(_In_ DWORD)
+    {
+        m_regExCompleted = true;
+        return S_OK;
+    }
+    IFACEMETHODIMP OnRenameStarted() { return S_OK; }
+    IFACEMETHODIMP OnRenameCompleted() { return S_OK; }
+
+    bool m_regExCompleted = false;
+    bool m_regExCanceled = false;
+    UINT m_updateCount = 0;
+
+private:
+    long m_refCount = 0;
+};
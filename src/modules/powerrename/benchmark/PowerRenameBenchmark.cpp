@@ -0,0 +1,507 @@
+#include "pch.h"
+#include "BenchmarkItems.h"
+#include "BenchmarkManagerEvents.h"
+#include <PowerRenameManager.h>
+#include <PowerRenameRegEx.h>
+#include <PowerRenameExecutor.h>
+#include <PowerRenameFileSystem.h>
+#include <Helpers.h>
+#include "powerrename/lib/Settings.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <regex>
+#include <string>
+#include <vector>
+#include <boost/regex.hpp>
+
+// Measures the preview of CPowerRenameManager on synthetic items, without a shell or UI.
+// Usage: PowerRenameBenchmark.exe [--sizes 10000,100000] [--modes literal,date] [--out results.json]
+// Results are written as JSON, to stdout unless --out is given.  Returns 1 if a run failed.
+// Peak memory is for the whole process, run a single size and mode to measure it alone.
+// The rename mode renames files in a temporary folder and then undoes it.  It only runs
+// when it is named in --modes.  The regex modes also measure the cost of an item when the
+// regular expressions are built again for every item, as Replace did before it kept them.
+
+EXTERN_C IMAGE_DOS_HEADER __ImageBase;
+
+#define HINST_THISCOMPONENT ((HINSTANCE)&__ImageBase)
+
+HINSTANCE g_hInst = HINST_THISCOMPONENT;
+
+namespace
+{
+    // A preview taking longer than this is reported as failed
+    const DWORD PreviewTimeoutMs = 10 * 60 * 1000;
+    const UINT AddBatchSize = 4096;
+
+    struct BenchmarkMode
+    {
+        PCSTR name;
+        DWORD flags;
+        PCWSTR searchTerm;
+        PCWSTR replaceTerm;
+        bool useBoostLib;
+        bool renamesFiles;
+    };
+
+    const BenchmarkMode c_modes[] = {
+        { "literal", MatchAllOccurences, L"foo", L"bar", false, false },
+        { "regex_std", MatchAllOccurences | UseRegularExpressions, L"(IMG)_(\\d+)_(.*)foo", L"$3$2_$1bar", false, false },
+        { "regex_boost", MatchAllOccurences | UseRegularExpressions, L"(IMG)_(\\d+)_(.*)foo", L"$3$2_$1bar", true, false },
+        { "case_transform", MatchAllOccurences | Uppercase, L"foo", L"bar", false, false },
+        { "enumerate", MatchAllOccurences | EnumerateItems, L"foo", L"bar", false, false },
+        { "date", MatchAllOccurences, L"foo", L"bar_$YYYY-$MM-$DD_$hh$mm", false, false },
+        { "rename", MatchAllOccurences, L"foo", L"bar", false, true },
+    };
+
+    // Items the regular expressions are built again for, it is slow
+    const UINT UncachedSampleSize = 20000;
+
+    // Files of the rename mode are spread over folders of this many files
+    const UINT RenameFolderSize = 1000;
+
+    const UINT c_defaultSizes[] = { 10000, 100000, 1000000 };
+
+    struct BenchmarkResult
+    {
+        PCSTR mode = nullptr;
+        UINT itemCount = 0;
+        bool succeeded = false;
+        double previewMs = 0;
+        double itemsPerSecond = 0;
+        double p50ItemUs = 0;
+        double p99ItemUs = 0;
+        double p50UncachedItemUs = 0;
+        UINT updateNotifications = 0;
+        double renameMs = 0;
+        double undoMs = 0;
+        SIZE_T peakWorkingSetBytes = 0;
+        SIZE_T privateBytes = 0;
+    };
+
+    double Percentile(_In_ std::vector<double>& values, _In_ double percentile)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+
+        size_t index = static_cast<size_t>(percentile * (values.size() - 1));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    void GetMemoryCounters(_Inout_ BenchmarkResult& result)
+    {
+        PROCESS_MEMORY_COUNTERS_EX memoryCounters = { 0 };
+        memoryCounters.cb = sizeof(memoryCounters);
+        if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memoryCounters), sizeof(memoryCounters)))
+        {
+            result.peakWorkingSetBytes = memoryCounters.PeakWorkingSetSize;
+            result.privateBytes = memoryCounters.PrivateUsage;
+        }
+    }
+
+    // Cost of computing one new name, as the regex worker does it, on a single thread
+    void MeasureItemCosts(_In_ const BenchmarkMode& mode, _In_ IPowerRenameRegEx* renameRegEx, _In_ const std::vector<CComPtr<IPowerRenameItem>>& items, _Inout_ BenchmarkResult& result)
+    {
+        std::vector<double> costs;
+        costs.reserve(items.size());
+        unsigned long enumIndex = 1;
+        for (const auto& item : items)
+        {
+            PCWSTR originalName = nullptr;
+            if (FAILED(item->GetOriginalNameView(&originalName)))
+            {
+                continue;
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            PWSTR newName = nullptr;
+            HRESULT hr = S_OK;
+            if (isFileTimeUsed(mode.replaceTerm))
+            {
+                hr = renameRegEx->ReplaceWithFileTime(originalName, CBenchmarkMetadataSource::s_GetCreationTime(originalName), &newName);
+            }
+            else
+            {
+                hr = renameRegEx->Replace(originalName, &newName);
+            }
+
+            wchar_t resultName[MAX_PATH] = { 0 };
+            if (SUCCEEDED(hr) && newName && (mode.flags & (Uppercase | Lowercase | Titlecase | Capitalized)))
+            {
+                GetTransformedFileName(resultName, ARRAYSIZE(resultName), newName, mode.flags);
+            }
+
+            if (SUCCEEDED(hr) && newName && (mode.flags & EnumerateItems))
+            {
+                unsigned long numUsed = 0;
+                GetEnumeratedFileName(resultName, ARRAYSIZE(resultName), newName, nullptr, enumIndex++, &numUsed);
+            }
+            auto elapsed = std::chrono::high_resolution_clock::now() - start;
+            costs.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+
+            CoTaskMemFree(newName);
+        }
+
+        result.p50ItemUs = Percentile(costs, 0.5);
+        result.p99ItemUs = Percentile(costs, 0.99);
+    }
+
+    // Cost of an item when Replace builds the regular expressions for every item
+    void MeasureUncachedItemCosts(_In_ const BenchmarkMode& mode, _In_ const std::vector<CComPtr<IPowerRenameItem>>& items, _Inout_ BenchmarkResult& result)
+    {
+        std::vector<double> costs;
+        costs.reserve(min(items.size(), static_cast<size_t>(UncachedSampleSize)));
+        for (size_t i = 0; i < items.size() && i < UncachedSampleSize; i++)
+        {
+            PCWSTR originalName = nullptr;
+            if (FAILED(items[i]->GetOriginalNameView(&originalName)))
+            {
+                continue;
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            std::wstring replace = std::regex_replace(std::wstring(mode.replaceTerm), std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$[0]"), L"$1$$$0");
+            replace = std::regex_replace(replace, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$([1-9])"), L"$1$0$4");
+            std::wstring newName;
+            if (mode.useBoostLib)
+            {
+                boost::wregex pattern(mode.searchTerm, boost::regex::icase | boost::regex::ECMAScript);
+                newName = boost::regex_replace(std::wstring(originalName), pattern, replace);
+            }
+            else
+            {
+                std::wregex pattern(mode.searchTerm, std::regex_constants::icase | std::regex_constants::ECMAScript);
+                newName = std::regex_replace(std::wstring(originalName), pattern, replace);
+            }
+            auto elapsed = std::chrono::high_resolution_clock::now() - start;
+            costs.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+        }
+
+        result.p50UncachedItemUs = Percentile(costs, 0.5);
+    }
+
+    void PumpPendingMessages()
+    {
+        MSG msg;
+        while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+        {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+    }
+
+    // The manager reports the preview through messages to its window on this thread
+    bool PumpMessagesUntil(_In_ const std::function<bool()>& done, _In_ DWORD timeoutMs)
+    {
+        const ULONGLONG deadline = GetTickCount64() + timeoutMs;
+        while (!done())
+        {
+            PumpPendingMessages();
+            if (done())
+            {
+                break;
+            }
+
+            if (GetTickCount64() > deadline)
+            {
+                return false;
+            }
+
+            MsgWaitForMultipleObjects(0, nullptr, FALSE, 10, QS_ALLINPUT);
+        }
+        return true;
+    }
+
+    BenchmarkResult RunBenchmark(_In_ const BenchmarkMode& mode, _In_ UINT itemCount)
+    {
+        BenchmarkResult result;
+        result.mode = mode.name;
+        result.itemCount = itemCount;
+
+        CSettingsInstance().SetUseBoostLib(mode.useBoostLib);
+
+        // Set up before it is given to the manager so only one preview runs
+        CComPtr<IPowerRenameRegEx> renameRegEx;
+        if (FAILED(CPowerRenameRegEx::s_CreateInstance(&renameRegEx)) ||
+            FAILED(renameRegEx->PutFlags(mode.flags)) ||
+            FAILED(renameRegEx->PutSearchTerm(mode.searchTerm)) ||
+            FAILED(renameRegEx->PutReplaceTerm(mode.replaceTerm)))
+        {
+            return result;
+        }
+
+        std::vector<CComPtr<IPowerRenameItem>> items = CreateBenchmarkItems(itemCount);
+        MeasureItemCosts(mode, renameRegEx, items, result);
+        if (mode.flags & UseRegularExpressions)
+        {
+            MeasureUncachedItemCosts(mode, items, result);
+        }
+
+        CComPtr<IPowerRenameManager> manager;
+        if (FAILED(CPowerRenameManager::s_CreateInstance(&manager)))
+        {
+            return result;
+        }
+
+        CBenchmarkMetadataSource* metadataSource = new CBenchmarkMetadataSource();
+        manager->PutMetadataSource(metadataSource);
+        metadataSource->Release();
+
+        CBenchmarkManagerEvents* managerEvents = new CBenchmarkManagerEvents();
+        DWORD cookie = 0;
+        manager->Advise(managerEvents, &cookie);
+        manager->PutRenameRegEx(renameRegEx);
+
+        for (size_t i = 0; i < items.size(); i += AddBatchSize)
+        {
+            std::vector<IPowerRenameItem*> batch;
+            for (size_t j = i; j < min(items.size(), i + AddBatchSize); j++)
+            {
+                batch.push_back(items[j]);
+            }
+            manager->AddItems(batch.data(), static_cast<UINT>(batch.size()));
+        }
+
+        CComPtr<IPowerRenameRegExEvents> regExEvents;
+        if (SUCCEEDED(manager->QueryInterface(IID_PPV_ARGS(&regExEvents))))
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            regExEvents->OnFlagsChanged(mode.flags);
+            bool completed = PumpMessagesUntil([managerEvents] { return managerEvents->m_regExCompleted; }, PreviewTimeoutMs);
+            auto elapsed = std::chrono::high_resolution_clock::now() - start;
+
+            // Let the remaining item updates through so they are counted
+            PumpPendingMessages();
+
+            result.succeeded = completed && !managerEvents->m_regExCanceled;
+            result.previewMs = std::chrono::duration<double, std::milli>(elapsed).count();
+            result.itemsPerSecond = result.previewMs > 0 ? itemCount / (result.previewMs / 1000) : 0;
+            result.updateNotifications = managerEvents->m_updateCount;
+        }
+
+        manager->UnAdvise(cookie);
+        manager->Shutdown();
+        managerEvents->Release();
+
+        GetMemoryCounters(result);
+        return result;
+    }
+
+    // Rename files in a temporary folder with CPowerRenameExecutor and undo it.  Half of
+    // the files take the name of another file that is renamed, so they wait for it.
+    BenchmarkResult RunRenameBenchmark(_In_ const BenchmarkMode& mode, _In_ UINT itemCount)
+    {
+        BenchmarkResult result;
+        result.mode = mode.name;
+        result.itemCount = itemCount;
+
+        wchar_t tempPath[MAX_PATH] = { 0 };
+        if (GetTempPath(ARRAYSIZE(tempPath), tempPath) == 0)
+        {
+            return result;
+        }
+
+        std::wstring root = std::wstring(tempPath) + L"PowerRenameBenchmark" + std::to_wstring(GetCurrentProcessId()) + L"\\";
+        if (!CreateDirectory(root.c_str(), nullptr))
+        {
+            return result;
+        }
+
+        std::vector<std::wstring> folders;
+        std::vector<std::wstring> paths;
+        bool created = true;
+        for (UINT i = 0; i < itemCount && created; i++)
+        {
+            if (i % RenameFolderSize == 0)
+            {
+                folders.push_back(root + L"folder" + std::to_wstring(i / RenameFolderSize) + L"\\");
+                created = CreateDirectory(folders.back().c_str(), nullptr) != FALSE;
+            }
+
+            paths.push_back(folders.back() + L"IMG_" + std::to_wstring(i) + L"_holiday_foo.jpg");
+            HANDLE file = CreateFile(paths.back().c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+            created = created && file != INVALID_HANDLE_VALUE;
+            if (file != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(file);
+            }
+        }
+
+        CComPtr<IPowerRenameFileSystem> fileSystem;
+        if (created && SUCCEEDED(CPowerRenameFileSystem::s_CreateInstance(IID_PPV_ARGS(&fileSystem))))
+        {
+            auto journal = std::make_shared<CPowerRenameJournal>();
+            std::vector<int> failedIds;
+
+            auto start = std::chrono::high_resolution_clock::now();
+            CPowerRenameExecutor executor(fileSystem, journal);
+            for (UINT i = 0; i < itemCount; i++)
+            {
+                // Odd files take the name of the file before them once it is renamed
+                std::wstring newName = (i % 2 == 0) ?
+                                           L"IMG_" + std::to_wstring(i) + L"_holiday_bar.jpg" :
+                                           std::wstring(PathFindFileName(paths[i - 1].c_str()));
+                executor.Add(static_cast<int>(i), paths[i].c_str(), newName.c_str());
+            }
+            executor.Plan();
+            HRESULT hr = executor.Execute(nullptr, failedIds);
+            auto renamed = std::chrono::high_resolution_clock::now();
+            HRESULT hrUndo = journal->Undo(fileSystem, nullptr);
+            auto undone = std::chrono::high_resolution_clock::now();
+
+            result.succeeded = SUCCEEDED(hr) && SUCCEEDED(hrUndo) && failedIds.empty();
+            result.renameMs = std::chrono::duration<double, std::milli>(renamed - start).count();
+            result.undoMs = std::chrono::duration<double, std::milli>(undone - renamed).count();
+            result.itemsPerSecond = result.renameMs > 0 ? itemCount / (result.renameMs / 1000) : 0;
+        }
+
+        // The undo gave the files their names back
+        for (const auto& path : paths)
+        {
+            DeleteFile(path.c_str());
+        }
+        for (const auto& folder : folders)
+        {
+            RemoveDirectory(folder.c_str());
+        }
+        RemoveDirectory(root.c_str());
+
+        GetMemoryCounters(result);
+        return result;
+    }
+
+    std::vector<std::wstring> SplitList(_In_ PCWSTR list)
+    {
+        std::vector<std::wstring> values;
+        std::wstring value;
+        for (PCWSTR p = list; ; p++)
+        {
+            if (*p == L',' || *p == L'\0')
+            {
+                if (!value.empty())
+                {
+                    values.push_back(value);
+                }
+                value.clear();
+                if (*p == L'\0')
+                {
+                    break;
+                }
+            }
+            else
+            {
+                value += *p;
+            }
+        }
+        return values;
+    }
+
+    void WriteResults(_In_ FILE* output, _In_ const std::vector<BenchmarkResult>& results)
+    {
+        fprintf(output, "{\n  \"results\": [\n");
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const BenchmarkResult& result = results[i];
+            fprintf(output,
+                    "    { \"mode\": \"%s\", \"items\": %u, \"succeeded\": %s, \"previewMs\": %.3f, \"itemsPerSecond\": %.1f, "
+                    "\"p50ItemUs\": %.3f, \"p99ItemUs\": %.3f, \"p50UncachedItemUs\": %.3f, \"updateNotifications\": %u, \"renameMs\": %.3f, \"undoMs\": %.3f, "
+                    "\"peakWorkingSetBytes\": %llu, \"privateBytes\": %llu }%s\n",
+                    result.mode,
+                    result.itemCount,
+                    result.succeeded ? "true" : "false",
+                    result.previewMs,
+                    result.itemsPerSecond,
+                    result.p50ItemUs,
+                    result.p99ItemUs,
+                    result.p50UncachedItemUs,
+                    result.updateNotifications,
+                    result.renameMs,
+                    result.undoMs,
+                    static_cast<unsigned long long>(result.peakWorkingSetBytes),
+                    static_cast<unsigned long long>(result.privateBytes),
+                    (i + 1 < results.size()) ? "," : "");
+        }
+        fprintf(output, "  ]\n}\n");
+    }
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+    std::vector<UINT> sizes(std::begin(c_defaultSizes), std::end(c_defaultSizes));
+    std::vector<const BenchmarkMode*> modes;
+    for (const auto& mode : c_modes)
+    {
+        if (!mode.renamesFiles)
+        {
+            modes.push_back(&mode);
+        }
+    }
+    PCWSTR outputPath = nullptr;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (wcscmp(argv[i], L"--sizes") == 0)
+        {
+            sizes.clear();
+            for (const auto& size : SplitList(argv[i + 1]))
+            {
+                sizes.push_back(static_cast<UINT>(_wtoi(size.c_str())));
+            }
+        }
+        else if (wcscmp(argv[i], L"--modes") == 0)
+        {
+            modes.clear();
+            for (const auto& name : SplitList(argv[i + 1]))
+            {
+                for (const auto& mode : c_modes)
+                {
+                    wchar_t modeName[64] = { 0 };
+                    MultiByteToWideChar(CP_ACP, 0, mode.name, -1, modeName, ARRAYSIZE(modeName));
+                    if (name == modeName)
+                    {
+                        modes.push_back(&mode);
+                    }
+                }
+            }
+        }
+        else if (wcscmp(argv[i], L"--out") == 0)
+        {
+            outputPath = argv[i + 1];
+        }
+    }
+
+    if (FAILED(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE)))
+    {
+        return 1;
+    }
+
+    std::vector<BenchmarkResult> results;
+    bool succeeded = true;
+    for (UINT size : sizes)
+    {
+        for (const auto* mode : modes)
+        {
+            results.push_back(mode->renamesFiles ? RunRenameBenchmark(*mode, size) : RunBenchmark(*mode, size));
+            succeeded = succeeded && results.back().succeeded;
+        }
+    }
+
+    FILE* output = stdout;
+    if (outputPath && _wfopen_s(&output, outputPath, L"w") != 0)
+    {
+        output = stdout;
+    }
+    WriteResults(output, results);
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+
+    CoUninitialize();
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "targetver.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <atlbase.h>
+#include <strsafe.h>
+#include <pathcch.h>
+#include <shobjidl.h>
+#include <shellapi.h>
+#include <shlwapi.h>
+#include <psapi.h>
@@ -1,11 +1,9 @@
 #include "pch.h"
 #include "Helpers.h"
-#include <regex>
+#include "PowerRenameCaseTransform.h"
+#include "PowerRenameDateTemplate.h"
 #include <ShlGuid.h>
 #include <cstring>
-#include <filesystem>
-
-namespace fs = std::filesystem;
 
 HRESULT GetTrimmedFileName(_Out_ PWSTR result, UINT cchMax, _In_ PCWSTR source)
 {
@@ -17,11 +15,11 @@ HRESULT GetTrimmedFileName(_Out_ PWSTR result, UINT cchMax, _In_ PCWSTR source)
         if (SUCCEEDED(hr))
         {
             size_t firstValidIndex = 0, lastValidIndex = wcslen(newName) - 1;
-            while (firstValidIndex <= lastValidIndex && iswspace(newName[firstValidIndex]))
+            while (firstValidIndex <= lastValidIndex && CPowerRenameCaseTransform::s_IsSpace(newName[firstValidIndex]))
             {
                 firstValidIndex++;
             }
-            while (firstValidIndex <= lastValidIndex && (iswspace(newName[lastValidIndex]) || newName[lastValidIndex] == L'.'))
+            while (firstValidIndex <= lastValidIndex && (CPowerRenameCaseTransform::s_IsSpace(newName[lastValidIndex]) || newName[lastValidIndex] == L'.'))
             {
                 lastValidIndex--;
             }
@@ -37,275 +35,20 @@ HRESULT GetTrimmedFileName(_Out_ PWSTR result, UINT cchMax, _In_ PCWSTR source)
 
 HRESULT GetTransformedFileName(_Out_ PWSTR result, UINT cchMax, _In_ PCWSTR source, DWORD flags)
 {
-    std::locale::global(std::locale(""));
-    HRESULT hr = E_INVALIDARG;
-    if (source && flags)
-    {
-        if (flags & Uppercase)
-        {
-            if (flags & NameOnly)
-            {
-                std::wstring stem = fs::path(source).stem().wstring();
-                std::transform(stem.begin(), stem.end(), stem.begin(), ::towupper);
-                hr = StringCchPrintf(result, cchMax, L"%s%s", stem.c_str(), fs::path(source).extension().c_str());
-            }
-            else if (flags & ExtensionOnly)
-            {
-                std::wstring extension = fs::path(source).extension().wstring();
-                if (!extension.empty())
-                {
-                    std::transform(extension.begin(), extension.end(), extension.begin(), ::towupper);
-                    hr = StringCchPrintf(result, cchMax, L"%s%s", fs::path(source).stem().c_str(), extension.c_str());
-                }
-                else
-                {
-                    hr = StringCchCopy(result, cchMax, source);
-                    if (SUCCEEDED(hr))
-                    {
-                        std::transform(result, result + wcslen(result), result, ::towupper);
-                    }
-                }
-            }
-            else
-            {
-                hr = StringCchCopy(result, cchMax, source);
-                if (SUCCEEDED(hr))
-                {
-                    std::transform(result, result + wcslen(result), result, ::towupper);
-                }
-            }
-        }
-        else if (flags & Lowercase)
-        {
-            if (flags & NameOnly)
-            {
-                std::wstring stem = fs::path(source).stem().wstring();
-                std::transform(stem.begin(), stem.end(), stem.begin(), ::towlower);
-                hr = StringCchPrintf(result, cchMax, L"%s%s", stem.c_str(), fs::path(source).extension().c_str());
-            }
-            else if (flags & ExtensionOnly)
-            {
-                std::wstring extension = fs::path(source).extension().wstring();
-                if (!extension.empty())
-                {
-                    std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
-                    hr = StringCchPrintf(result, cchMax, L"%s%s", fs::path(source).stem().c_str(), extension.c_str());
-                }
-                else
-                {
-                    hr = StringCchCopy(result, cchMax, source);
-                    if (SUCCEEDED(hr))
-                    {
-                        std::transform(result, result + wcslen(result), result, ::towlower);
-                    }
-                }
-            }
-            else
-            {
-                hr = StringCchCopy(result, cchMax, source);
-                if (SUCCEEDED(hr))
-                {
-                    std::transform(result, result + wcslen(result), result, ::towlower);
-                }
-            }
-        }
-        else if (flags & Titlecase)
-        {
-            if (!(flags & ExtensionOnly))
-            {
-                std::vector<std::wstring> exceptions = { L"a", L"an", L"to", L"the", L"at", L"by", L"for", L"in", L"of", L"on", L"up", L"and", L"as", L"but", L"or", L"nor" };
-                std::wstring stem = fs::path(source).stem().wstring();
-                std::wstring extension = fs::path(source).extension().wstring();
-
-                size_t stemLength = stem.length();
-                bool isFirstWord = true;
-
-                while (stemLength > 0 && (iswspace(stem[stemLength - 1]) || iswpunct(stem[stemLength - 1])))
-                {
-                    stemLength--;
-                }
-
-                for (size_t i = 0; i < stemLength; i++)
-                {
-                    if (!i || iswspace(stem[i - 1]) || iswpunct(stem[i - 1]))
-                    {
-                        if (iswspace(stem[i]) || iswpunct(stem[i]))
-                        {
-                            continue;
-                        }
-                        size_t wordLength = 0;
-                        while (i + wordLength < stemLength && !iswspace(stem[i + wordLength]) && !iswpunct(stem[i + wordLength]))
-                        {
-                            wordLength++;
-                        }
-                        if (isFirstWord || i + wordLength == stemLength || std::find(exceptions.begin(), exceptions.end(), stem.substr(i, wordLength)) == exceptions.end())
-                        {
-                            stem[i] = towupper(stem[i]);
-                            isFirstWord = false;
-                        }
-                        else
-                        {
-                            stem[i] = towlower(stem[i]);
-                        }
-                    }
-                    else
-                    {
-                        stem[i] = towlower(stem[i]);
-                    }
-                }
-                hr = StringCchPrintf(result, cchMax, L"%s%s", stem.c_str(), extension.c_str());
-            }
-            else
-            {
-                hr = StringCchCopy(result, cchMax, source);
-            }
-        } 
-        else if (flags & Capitalized)
-        {
-            if (!(flags & ExtensionOnly))
-            {
-                std::wstring stem = fs::path(source).stem().wstring();
-                std::wstring extension = fs::path(source).extension().wstring();
-
-                size_t stemLength = stem.length();
-
-                while (stemLength > 0 && (iswspace(stem[stemLength - 1]) || iswpunct(stem[stemLength - 1])))
-                {
-                    stemLength--;
-                }
-
-                for (size_t i = 0; i < stemLength; i++)
-                {
-                    if (!i || iswspace(stem[i - 1]) || iswpunct(stem[i - 1]))
-                    {
-                        if (iswspace(stem[i]) || iswpunct(stem[i]))
-                        {
-                            continue;
-                        }
-                        stem[i] = towupper(stem[i]);
-                    }
-                    else
-                    {
-                        stem[i] = towlower(stem[i]);
-                    }
-                }
-                hr = StringCchPrintf(result, cchMax, L"%s%s", stem.c_str(), extension.c_str());
-            }
-            else
-            {
-                hr = StringCchCopy(result, cchMax, source);
-            }
-        }
-        else
-        {
-            hr = StringCchCopy(result, cchMax, source);
-        }
-    }
-
-    return hr;
+    return CPowerRenameCaseTransform::s_Transform(result, cchMax, source, flags);
 }
 
-bool isFileTimeUsed(_In_ PCWSTR source) 
+bool isFileTimeUsed(_In_ PCWSTR source)
 {
-    bool used = false;
-    std::wstring patterns[] = { L"(([^\\$]|^)(\\$\\$)*)\\$Y", L"(([^\\$]|^)(\\$\\$)*)\\$M", L"(([^\\$]|^)(\\$\\$)*)\\$D", 
-        L"(([^\\$]|^)(\\$\\$)*)\\$h", L"(([^\\$]|^)(\\$\\$)*)\\$m", L"(([^\\$]|^)(\\$\\$)*)\\$s", L"(([^\\$]|^)(\\$\\$)*)\\$f" };
-    size_t patternsLength = ARRAYSIZE(patterns);
-    for (size_t i = 0; !used && i < patternsLength; i++)
-    {
-        if (std::regex_search(source, std::wregex(patterns[i])))
-        {
-            used = true;
-        }
-    }
-    return used;
+    return CPowerRenameDateTemplate(source).UsesFileTime();
 }
 
 HRESULT GetDatedFileName(_Out_ PWSTR result, UINT cchMax, _In_ PCWSTR source, SYSTEMTIME fileTime)
 {
-    std::locale::global(std::locale(""));
-    HRESULT hr = E_INVALIDARG;     
+    HRESULT hr = E_INVALIDARG;
     if (source && wcslen(source) > 0)
     {
-        std::wstring res(source);
-        wchar_t replaceTerm[MAX_PATH] = { 0 };
-        wchar_t formattedDate[MAX_PATH] = { 0 };
-
-        wchar_t localeName[LOCALE_NAME_MAX_LENGTH];
-        if (GetUserDefaultLocaleName(localeName, LOCALE_NAME_MAX_LENGTH) == 0)
-        {
-            StringCchCopy(localeName, LOCALE_NAME_MAX_LENGTH, L"en_US");
-        }
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%04d"), L"$01", fileTime.wYear);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$YYYY"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", (fileTime.wYear % 100));
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$YY"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", (fileTime.wYear % 10));
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$Y"), replaceTerm);
-        
-        GetDateFormatEx(localeName, NULL, &fileTime, L"MMMM", formattedDate, MAX_PATH, NULL);
-        formattedDate[0] = towupper(formattedDate[0]);
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%s"), L"$01", formattedDate);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$MMMM"), replaceTerm);
-        
-        GetDateFormatEx(localeName, NULL, &fileTime, L"MMM", formattedDate, MAX_PATH, NULL);
-        formattedDate[0] = towupper(formattedDate[0]);
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%s"), L"$01", formattedDate);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$MMM"), replaceTerm);
-                
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wMonth);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$MM"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wMonth);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$M"), replaceTerm);
-
-        GetDateFormatEx(localeName, NULL, &fileTime, L"dddd", formattedDate, MAX_PATH, NULL);
-        formattedDate[0] = towupper(formattedDate[0]);
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%s"), L"$01", formattedDate);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$DDDD"), replaceTerm);
-        
-        GetDateFormatEx(localeName, NULL, &fileTime, L"ddd", formattedDate, MAX_PATH, NULL);
-        formattedDate[0] = towupper(formattedDate[0]);
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%s"), L"$01", formattedDate);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$DDD"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wDay);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$DD"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wDay);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$D"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wHour);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$hh"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wHour);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$h"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wMinute);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$mm"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wMinute);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$m"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wSecond);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$ss"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wSecond);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$s"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%03d"), L"$01", fileTime.wMilliseconds);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$fff"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%02d"), L"$01", fileTime.wMilliseconds/10);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$ff"), replaceTerm);
-
-        StringCchPrintf(replaceTerm, MAX_PATH, TEXT("%s%d"), L"$01", fileTime.wMilliseconds/100);
-        res = regex_replace(res, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$f"), replaceTerm);
-
-        hr = StringCchCopy(result, cchMax, res.c_str());
+        hr = StringCchCopy(result, cchMax, CPowerRenameDateTemplate(source).Format(fileTime).c_str());
     }
 
     return hr;
@@ -519,6 +262,16 @@ bool DataObjectContainsRenamableItem(_In_ IUnknown* dataSource)
     return hasRenamable;
 }
 
+HRESULT GetLocalFileTime(_In_ const FILETIME& fileTime, _Out_ SYSTEMTIME* localTime)
+{
+    SYSTEMTIME systemTime;
+    if (FileTimeToSystemTime(&fileTime, &systemTime) && SystemTimeToTzSpecificLocalTime(NULL, &systemTime, localTime))
+    {
+        return S_OK;
+    }
+    return E_FAIL;
+}
+
 HWND CreateMsgWindow(_In_ HINSTANCE hInst, _In_ WNDPROC pfnWndProc, _In_ void* p)
 {
     WNDCLASS wc = { 0 };
@@ -0,0 +1,168 @@
+#include "pch.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    // Share of chunks owned by one thread.  The owner takes chunks from the front,
+    // other threads steal from the back.
+    struct ChunkRange
+    {
+        std::mutex lock;
+        UINT next = 0;
+        UINT end = 0;
+
+        bool PopFront(_Out_ UINT* chunk)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (next < end)
+            {
+                *chunk = next++;
+                return true;
+            }
+            return false;
+        }
+
+        bool PopBack(_Out_ UINT* chunk)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (next < end)
+            {
+                *chunk = --end;
+                return true;
+            }
+            return false;
+        }
+    };
+
+    class ParallelForWork
+    {
+    public:
+        ParallelForWork(_In_ UINT count, _In_ UINT chunkSize, _In_ UINT workerCount, _In_ const std::function<bool(UINT begin, UINT end)>& processChunk) :
+            m_count(count),
+            m_chunkSize(chunkSize),
+            m_workerCount(workerCount),
+            m_processChunk(processChunk),
+            m_ranges(new ChunkRange[workerCount])
+        {
+            const UINT chunkCount = (count - 1) / chunkSize + 1;
+            for (UINT i = 0; i < workerCount; i++)
+            {
+                m_ranges[i].next = static_cast<UINT>(static_cast<ULONGLONG>(chunkCount) * i / workerCount);
+                m_ranges[i].end = static_cast<UINT>(static_cast<ULONGLONG>(chunkCount) * (i + 1) / workerCount);
+            }
+        }
+
+        // Process the share of self, then steal from the others
+        void Run(_In_ UINT self)
+        {
+            while (!m_stopped)
+            {
+                UINT chunk = 0;
+                bool found = m_ranges[self].PopFront(&chunk);
+                for (UINT victim = 1; !found && victim < m_workerCount; victim++)
+                {
+                    found = m_ranges[(self + victim) % m_workerCount].PopBack(&chunk);
+                }
+
+                if (!found)
+                {
+                    break;
+                }
+
+                const UINT begin = chunk * m_chunkSize;
+                const UINT end = min(m_count, begin + m_chunkSize);
+                try
+                {
+                    if (!m_processChunk(begin, end))
+                    {
+                        m_stopped = true;
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> guard(m_errorLock);
+                    if (!m_error)
+                    {
+                        m_error = std::current_exception();
+                    }
+                    m_stopped = true;
+                }
+            }
+        }
+
+        // Once every thread is done.  Rethrows the first exception thrown by processChunk.
+        bool Complete()
+        {
+            if (m_error)
+            {
+                std::rethrow_exception(m_error);
+            }
+            return !m_stopped;
+        }
+
+        static void CALLBACK s_WorkCallback(_Inout_ PTP_CALLBACK_INSTANCE, _Inout_opt_ PVOID context, _Inout_ PTP_WORK)
+        {
+            ParallelForWork* work = static_cast<ParallelForWork*>(context);
+            // The calling thread is worker 0
+            work->Run(++work->m_nextWorker);
+        }
+
+    private:
+        const UINT m_count;
+        const UINT m_chunkSize;
+        const UINT m_workerCount;
+        const std::function<bool(UINT begin, UINT end)>& m_processChunk;
+        std::unique_ptr<ChunkRange[]> m_ranges;
+        std::atomic<UINT> m_nextWorker = 0;
+        std::atomic<bool> m_stopped = false;
+        std::mutex m_errorLock;
+        std::exception_ptr m_error;
+    };
+}
+
+UINT GetParallelWorkerCount()
+{
+    UINT workerCount = std::thread::hardware_concurrency();
+    return workerCount > 0 ? workerCount : 1;
+}
+
+bool ParallelFor(_In_ UINT count, _In_ UINT chunkSize, _In_ const std::function<bool(UINT begin, UINT end)>& processChunk)
+{
+    if (count == 0)
+    {
+        return true;
+    }
+
+    chunkSize = max(chunkSize, 1u);
+    const UINT chunkCount = (count - 1) / chunkSize + 1;
+    const UINT workerCount = min(GetParallelWorkerCount(), chunkCount);
+
+    ParallelForWork work(count, chunkSize, workerCount, processChunk);
+    if (workerCount > 1)
+    {
+        // The threads of the process default thread pool are reused from one call to the next
+        PTP_WORK threadpoolWork = CreateThreadpoolWork(ParallelForWork::s_WorkCallback, &work, nullptr);
+        if (threadpoolWork)
+        {
+            for (UINT i = 1; i < workerCount; i++)
+            {
+                SubmitThreadpoolWork(threadpoolWork);
+            }
+
+            work.Run(0);
+            WaitForThreadpoolWorkCallbacks(threadpoolWork, FALSE);
+            CloseThreadpoolWork(threadpoolWork);
+            return work.Complete();
+        }
+    }
+
+    // The calling thread steals every chunk
+    work.Run(0);
+    return work.Complete();
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "pch.h"
+#include <functional>
+
+// Number of threads ParallelFor will use at most
+UINT GetParallelWorkerCount();
+
+// Process the range [0, count) in chunks of chunkSize items on the threads of the process
+// default thread pool, as many as there are cores.  Each thread starts on its own contiguous
+// share of the chunks and steals chunks from the end of the other shares once its own is
+// exhausted.  The calling thread takes part in the work, and does all of it if no work can
+// be submitted to the thread pool.  processChunk returns false to stop every thread early
+// (ex: canceled).  An exception thrown by it stops every thread too and is rethrown on the
+// calling thread once they are all done.
+// Returns false if processing was stopped before the whole range was done.
+bool ParallelFor(_In_ UINT count, _In_ UINT chunkSize, _In_ const std::function<bool(UINT begin, UINT end)>& processChunk);
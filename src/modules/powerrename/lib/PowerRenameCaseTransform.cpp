@@ -0,0 +1,279 @@
+#include "pch.h"
+#include "PowerRenameCaseTransform.h"
+#include "PowerRenameInterfaces.h"
+#include <memory>
+#include <vector>
+#if defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const UINT CharCount = 0x10000;
+
+    struct CaseTables
+    {
+        wchar_t upper[CharCount];
+        wchar_t lower[CharCount];
+        bool separator[CharCount];
+        bool space[CharCount];
+    };
+
+    std::unique_ptr<CaseTables> BuildCaseTables()
+    {
+        auto tables = std::make_unique<CaseTables>();
+        std::vector<wchar_t> chars(CharCount);
+        for (UINT i = 0; i < CharCount; i++)
+        {
+            chars[i] = static_cast<wchar_t>(i);
+        }
+
+        // Map every character at once rather than one call per character like towupper
+        if (LCMapStringEx(LOCALE_NAME_USER_DEFAULT, LCMAP_UPPERCASE, chars.data(), CharCount, tables->upper, CharCount, nullptr, nullptr, 0) != CharCount ||
+            LCMapStringEx(LOCALE_NAME_USER_DEFAULT, LCMAP_LOWERCASE, chars.data(), CharCount, tables->lower, CharCount, nullptr, nullptr, 0) != CharCount)
+        {
+            for (UINT i = 0; i < CharCount; i++)
+            {
+                tables->upper[i] = towupper(chars[i]);
+                tables->lower[i] = towlower(chars[i]);
+            }
+        }
+
+        std::vector<WORD> types(CharCount);
+        const bool hasTypes = GetStringTypeW(CT_CTYPE1, chars.data(), CharCount, types.data()) != FALSE;
+        for (UINT i = 0; i < CharCount; i++)
+        {
+            tables->separator[i] = hasTypes ? (types[i] & (C1_SPACE | C1_PUNCT)) != 0 : (iswspace(chars[i]) || iswpunct(chars[i]));
+            tables->space[i] = hasTypes ? (types[i] & C1_SPACE) != 0 : iswspace(chars[i]) != 0;
+        }
+
+        return tables;
+    }
+
+    const CaseTables& GetCaseTables()
+    {
+        static const std::unique_ptr<CaseTables> tables = BuildCaseTables();
+        return *tables;
+    }
+
+    // Add delta to the ASCII letters from first to last, other characters go through table
+    inline wchar_t ChangeCase(_In_ wchar_t c, _In_ wchar_t first, _In_ wchar_t last, _In_ short delta, _In_reads_(CharCount) const wchar_t* table)
+    {
+        if (c < 0x80)
+        {
+            return (c >= first && c <= last) ? static_cast<wchar_t>(c + delta) : c;
+        }
+        return table[c];
+    }
+
+    void ChangeCase(_Inout_updates_(length) PWSTR text, _In_ size_t length, _In_ wchar_t first, _In_ wchar_t last, _In_ short delta, _In_reads_(CharCount) const wchar_t* table)
+    {
+        size_t i = 0;
+#if defined(_M_X64) || defined(_M_IX86)
+        const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i below = _mm_set1_epi16(static_cast<short>(first - 1));
+        const __m128i above = _mm_set1_epi16(static_cast<short>(last + 1));
+        const __m128i change = _mm_set1_epi16(delta);
+        for (; i + 8 <= length; i += 8)
+        {
+            __m128i* block = reinterpret_cast<__m128i*>(text + i);
+            __m128i chars = _mm_loadu_si128(block);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(chars, nonAscii), zero)) == 0xFFFF)
+            {
+                // Only ASCII so the signed compares are safe
+                __m128i letters = _mm_and_si128(_mm_cmpgt_epi16(chars, below), _mm_cmplt_epi16(chars, above));
+                _mm_storeu_si128(block, _mm_add_epi16(chars, _mm_and_si128(letters, change)));
+            }
+            else
+            {
+                for (size_t j = i; j < i + 8; j++)
+                {
+                    text[j] = ChangeCase(text[j], first, last, delta, table);
+                }
+            }
+        }
+#endif
+        for (; i < length; i++)
+        {
+            text[i] = ChangeCase(text[i], first, last, delta, table);
+        }
+    }
+
+    bool IsTitlecaseException(_In_reads_(length) PCWSTR word, _In_ size_t length)
+    {
+        static const PCWSTR exceptions[] = { L"a", L"an", L"to", L"the", L"at", L"by", L"for", L"in", L"of", L"on", L"up", L"and", L"as", L"but", L"or", L"nor" };
+        for (PCWSTR exception : exceptions)
+        {
+            if (wcslen(exception) == length && wcsncmp(exception, word, length) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+size_t CPowerRenameCaseTransform::s_FindExtension(_In_reads_(length) PCWSTR name, _In_ size_t length)
+{
+    // "." and ".." have no extension and neither does a name whose only dot is the first character
+    if ((length == 1 && name[0] == L'.') || (length == 2 && name[0] == L'.' && name[1] == L'.'))
+    {
+        return length;
+    }
+
+    for (size_t i = length; i > 1; i--)
+    {
+        if (name[i - 1] == L'.')
+        {
+            return i - 1;
+        }
+    }
+    return length;
+}
+
+HRESULT CPowerRenameCaseTransform::s_Transform(_Out_writes_(cchMax) PWSTR result, _In_ UINT cchMax, _In_ PCWSTR source, _In_ DWORD flags)
+{
+    HRESULT hr = E_INVALIDARG;
+    if (source && flags)
+    {
+        hr = StringCchCopy(result, cchMax, source);
+        if (SUCCEEDED(hr))
+        {
+            // Every transform keeps the length so the copy is transformed in place
+            const size_t length = wcslen(result);
+            const size_t extension = s_FindExtension(result, length);
+            if (flags & (Uppercase | Lowercase))
+            {
+                PWSTR text = result;
+                size_t count = length;
+                if (flags & NameOnly)
+                {
+                    count = extension;
+                }
+                else if ((flags & ExtensionOnly) && extension < length)
+                {
+                    text = result + extension;
+                    count = length - extension;
+                }
+
+                if (flags & Uppercase)
+                {
+                    s_ToUpper(text, count);
+                }
+                else
+                {
+                    s_ToLower(text, count);
+                }
+            }
+            else if ((flags & (Titlecase | Capitalized)) && !(flags & ExtensionOnly))
+            {
+                if (flags & Titlecase)
+                {
+                    s_ToTitle(result, extension);
+                }
+                else
+                {
+                    s_ToCapitalized(result, extension);
+                }
+            }
+        }
+    }
+
+    return hr;
+}
+
+void CPowerRenameCaseTransform::s_ToUpper(_Inout_updates_(length) PWSTR text, _In_ size_t length)
+{
+    ChangeCase(text, length, L'a', L'z', L'A' - L'a', GetCaseTables().upper);
+}
+
+void CPowerRenameCaseTransform::s_ToLower(_Inout_updates_(length) PWSTR text, _In_ size_t length)
+{
+    ChangeCase(text, length, L'A', L'Z', L'a' - L'A', GetCaseTables().lower);
+}
+
+void CPowerRenameCaseTransform::s_ToTitle(_Inout_updates_(length) PWSTR text, _In_ size_t length)
+{
+    // Trailing separators are left as they are
+    const size_t trimmedLength = _TrimmedLength(text, length);
+    bool isFirstWord = true;
+    for (size_t i = 0; i < trimmedLength; i++)
+    {
+        if (i == 0 || s_IsSeparator(text[i - 1]))
+        {
+            if (s_IsSeparator(text[i]))
+            {
+                continue;
+            }
+
+            size_t wordLength = 0;
+            while (i + wordLength < trimmedLength && !s_IsSeparator(text[i + wordLength]))
+            {
+                wordLength++;
+            }
+
+            if (isFirstWord || i + wordLength == trimmedLength || !IsTitlecaseException(text + i, wordLength))
+            {
+                text[i] = s_ToUpper(text[i]);
+                isFirstWord = false;
+            }
+            else
+            {
+                text[i] = s_ToLower(text[i]);
+            }
+        }
+        else
+        {
+            text[i] = s_ToLower(text[i]);
+        }
+    }
+}
+
+void CPowerRenameCaseTransform::s_ToCapitalized(_Inout_updates_(length) PWSTR text, _In_ size_t length)
+{
+    const size_t trimmedLength = _TrimmedLength(text, length);
+    for (size_t i = 0; i < trimmedLength; i++)
+    {
+        if (i == 0 || s_IsSeparator(text[i - 1]))
+        {
+            if (!s_IsSeparator(text[i]))
+            {
+                text[i] = s_ToUpper(text[i]);
+            }
+        }
+        else
+        {
+            text[i] = s_ToLower(text[i]);
+        }
+    }
+}
+
+bool CPowerRenameCaseTransform::s_IsSeparator(_In_ wchar_t c)
+{
+    return GetCaseTables().separator[c];
+}
+
+bool CPowerRenameCaseTransform::s_IsSpace(_In_ wchar_t c)
+{
+    return GetCaseTables().space[c];
+}
+
+wchar_t CPowerRenameCaseTransform::s_ToUpper(_In_ wchar_t c)
+{
+    return ChangeCase(c, L'a', L'z', L'A' - L'a', GetCaseTables().upper);
+}
+
+wchar_t CPowerRenameCaseTransform::s_ToLower(_In_ wchar_t c)
+{
+    return ChangeCase(c, L'A', L'Z', L'a' - L'A', GetCaseTables().lower);
+}
+
+size_t CPowerRenameCaseTransform::_TrimmedLength(_In_reads_(length) PCWSTR text, _In_ size_t length)
+{
+    while (length > 0 && s_IsSeparator(text[length - 1]))
+    {
+        length--;
+    }
+    return length;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "pch.h"
+
+// Uppercase, Lowercase, Titlecase and Capitalized transforms of file names.
+// ASCII runs are transformed several characters at a time.  Other characters go
+// through case and separator tables for the user default locale, built once per
+// process, so the transforms are the same as towupper/towlower with that locale.
+// Every transform keeps the length of the name so it can be done in place.
+class CPowerRenameCaseTransform
+{
+public:
+    // Position of the extension of a file name, length if it has none.  Splits the
+    // name into stem and extension like std::filesystem::path does.
+    static size_t s_FindExtension(_In_reads_(length) PCWSTR name, _In_ size_t length);
+
+    // Copy source to result, transformed as the case flags (and NameOnly/ExtensionOnly) ask
+    static HRESULT s_Transform(_Out_writes_(cchMax) PWSTR result, _In_ UINT cchMax, _In_ PCWSTR source, _In_ DWORD flags);
+
+    static void s_ToUpper(_Inout_updates_(length) PWSTR text, _In_ size_t length);
+    static void s_ToLower(_Inout_updates_(length) PWSTR text, _In_ size_t length);
+    // Title case words of text except short ones like "of" and "the" that are not first or last
+    static void s_ToTitle(_Inout_updates_(length) PWSTR text, _In_ size_t length);
+    // Upper case the first letter of every word and lower case the rest
+    static void s_ToCapitalized(_Inout_updates_(length) PWSTR text, _In_ size_t length);
+
+    // Words are separated by spaces and punctuation
+    static bool s_IsSeparator(_In_ wchar_t c);
+    // Space characters of the user default locale, unlike iswspace which only knows the
+    // ASCII ones unless the global locale was changed
+    static bool s_IsSpace(_In_ wchar_t c);
+    static wchar_t s_ToUpper(_In_ wchar_t c);
+    static wchar_t s_ToLower(_In_ wchar_t c);
+
+protected:
+    static size_t _TrimmedLength(_In_reads_(length) PCWSTR text, _In_ size_t length);
+};
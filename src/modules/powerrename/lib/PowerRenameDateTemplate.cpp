@@ -0,0 +1,361 @@
+#include "pch.h"
+#include "PowerRenameDateTemplate.h"
+#include "srwlock.h"
+#include <locale>
+#include <map>
+
+namespace
+{
+    struct TokenInfo
+    {
+        PCWSTR text;
+        size_t length;
+        bool isName;
+    };
+
+    // Indexed by DateToken - 1.  Longer tokens come before the shorter ones starting
+    // with the same letter so $YYYY is never read as $YY followed by YY.
+    const TokenInfo c_tokens[] = {
+        { L"YYYY", 4, false },
+        { L"YY", 2, false },
+        { L"Y", 1, false },
+        { L"MMMM", 4, true },
+        { L"MMM", 3, true },
+        { L"MM", 2, false },
+        { L"M", 1, false },
+        { L"DDDD", 4, true },
+        { L"DDD", 3, true },
+        { L"DD", 2, false },
+        { L"D", 1, false },
+        { L"hh", 2, false },
+        { L"h", 1, false },
+        { L"mm", 2, false },
+        { L"m", 1, false },
+        { L"ss", 2, false },
+        { L"s", 1, false },
+        { L"fff", 3, false },
+        { L"ff", 2, false },
+        { L"f", 1, false },
+    };
+
+    bool IsLeapYear(int year)
+    {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    // GetDateFormatEx fails for dates that don't exist, names are left empty in that case
+    bool IsValidDate(const SYSTEMTIME& date)
+    {
+        static const int daysInMonth[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        if (date.wMonth < 1 || date.wMonth > 12 || date.wDay < 1)
+        {
+            return false;
+        }
+
+        int days = daysInMonth[date.wMonth - 1];
+        if (date.wMonth == 2 && IsLeapYear(date.wYear))
+        {
+            days++;
+        }
+        return date.wDay <= days;
+    }
+
+    // 0 is Sunday, like SYSTEMTIME::wDayOfWeek.  Computed from the date since that is
+    // what GetDateFormatEx does as well.
+    int GetDayOfWeek(const SYSTEMTIME& date)
+    {
+        static const int monthOffsets[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+        int year = date.wYear - (date.wMonth < 3 ? 1 : 0);
+        return (year + year / 4 - year / 100 + year / 400 + monthOffsets[date.wMonth - 1] + date.wDay) % 7;
+    }
+
+    void AppendNumber(std::wstring& result, int value, int width)
+    {
+        wchar_t number[16] = { 0 };
+        StringCchPrintf(number, ARRAYSIZE(number), L"%0*d", width, value);
+        result += number;
+    }
+
+    std::wstring FormatName(_In_ const DateNames& names, _In_ const SYSTEMTIME& date, _In_ PCWSTR format)
+    {
+        wchar_t formattedDate[MAX_PATH] = { 0 };
+        GetDateFormatEx(names.localeName.c_str(), NULL, &date, format, formattedDate, MAX_PATH, NULL);
+        formattedDate[0] = std::toupper(formattedDate[0], names.userLocale);
+        return formattedDate;
+    }
+
+    bool IsGregorianCalendar(_In_ PCWSTR localeName)
+    {
+        CALID calendar = 0;
+        if (GetLocaleInfoEx(localeName, LOCALE_ICALENDARTYPE | LOCALE_RETURN_NUMBER, reinterpret_cast<LPWSTR>(&calendar), sizeof(calendar) / sizeof(wchar_t)) == 0)
+        {
+            return false;
+        }
+
+        switch (calendar)
+        {
+        case CAL_GREGORIAN:
+        case CAL_GREGORIAN_US:
+        case CAL_GREGORIAN_ME_FRENCH:
+        case CAL_GREGORIAN_ARABIC:
+        case CAL_GREGORIAN_XLIT_ENGLISH:
+        case CAL_GREGORIAN_XLIT_FRENCH:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    std::shared_ptr<const DateNames> LoadDateNames(_In_ PCWSTR localeName)
+    {
+        auto names = std::make_shared<DateNames>();
+        names->localeName = localeName;
+        try
+        {
+            names->userLocale = std::locale("");
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+
+        names->cached = IsGregorianCalendar(localeName);
+        if (names->cached)
+        {
+            for (WORD month = 1; month <= 12; month++)
+            {
+                SYSTEMTIME date = { 2020, month, 0, 1 };
+                date.wDayOfWeek = static_cast<WORD>(GetDayOfWeek(date));
+                names->months[month - 1] = FormatName(*names, date, L"MMMM");
+                names->monthAbbreviations[month - 1] = FormatName(*names, date, L"MMM");
+            }
+
+            // January 5th 2020 is a Sunday
+            for (WORD day = 0; day < 7; day++)
+            {
+                SYSTEMTIME date = { 2020, 1, day, static_cast<WORD>(5 + day) };
+                names->days[day] = FormatName(*names, date, L"dddd");
+                names->dayAbbreviations[day] = FormatName(*names, date, L"ddd");
+            }
+        }
+
+        return names;
+    }
+}
+
+// Parsing follows what replacing each token, longest first, with
+// regex_replace(L"(([^\\$]|^)(\\$\\$)*)\\$TOKEN") used to produce: a token needs an
+// even number of '$' in front of it, and since a match consumes the character in front
+// of the '$' run, a token directly following a token of the same kind is not replaced.
+CPowerRenameDateTemplate::CPowerRenameDateTemplate(_In_ PCWSTR source)
+{
+    std::wstring text(source ? source : L"");
+
+    // Where the last token of each kind ended in text
+    size_t tokenEnds[ARRAYSIZE(c_tokens)];
+    std::fill(std::begin(tokenEnds), std::end(tokenEnds), std::wstring::npos);
+
+    bool usesNames = false;
+    std::wstring literal;
+    size_t pos = 0;
+    while (pos < text.length())
+    {
+        if (text[pos] != L'$')
+        {
+            literal += text[pos++];
+            continue;
+        }
+
+        size_t runStart = pos;
+        size_t runEnd = text.find_first_not_of(L'$', pos);
+        if (runEnd == std::wstring::npos)
+        {
+            runEnd = text.length();
+        }
+
+        // Only the last '$' of an odd run can start a token
+        size_t runLength = runEnd - runStart;
+        literal.append(runLength - 1, L'$');
+        pos = runEnd;
+        if (runLength % 2 == 0)
+        {
+            literal += L'$';
+            continue;
+        }
+
+        bool found = false;
+        for (size_t i = 0; i < ARRAYSIZE(c_tokens); i++)
+        {
+            if (tokenEnds[i] != runStart && text.compare(pos, c_tokens[i].length, c_tokens[i].text) == 0)
+            {
+                _AddLiteral(literal);
+                literal.clear();
+
+                Segment segment;
+                segment.token = static_cast<DateToken>(i + 1);
+                m_segments.push_back(std::move(segment));
+
+                m_usesFileTime = true;
+                usesNames |= c_tokens[i].isName;
+                pos += c_tokens[i].length;
+                tokenEnds[i] = pos;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            literal += L'$';
+        }
+    }
+    _AddLiteral(literal);
+
+    if (usesNames)
+    {
+        m_names = s_GetDateNames();
+    }
+}
+
+void CPowerRenameDateTemplate::_AddLiteral(_In_ const std::wstring& literal)
+{
+    if (!literal.empty())
+    {
+        Segment segment;
+        segment.literal = literal;
+        m_segments.push_back(std::move(segment));
+    }
+}
+
+std::wstring CPowerRenameDateTemplate::Format(_In_ const SYSTEMTIME& fileTime) const
+{
+    std::wstring result;
+    result.reserve(MAX_PATH);
+
+    for (const auto& segment : m_segments)
+    {
+        switch (segment.token)
+        {
+        case DateToken::Literal:
+            result += segment.literal;
+            break;
+        case DateToken::Year4:
+            AppendNumber(result, fileTime.wYear, 4);
+            break;
+        case DateToken::Year2:
+            AppendNumber(result, fileTime.wYear % 100, 2);
+            break;
+        case DateToken::Year1:
+            AppendNumber(result, fileTime.wYear % 10, 1);
+            break;
+        case DateToken::MonthName:
+        case DateToken::MonthAbbreviation:
+            _AppendName(segment.token, fileTime, result);
+            break;
+        case DateToken::Month2:
+            AppendNumber(result, fileTime.wMonth, 2);
+            break;
+        case DateToken::Month1:
+            AppendNumber(result, fileTime.wMonth, 1);
+            break;
+        case DateToken::DayName:
+        case DateToken::DayAbbreviation:
+            _AppendName(segment.token, fileTime, result);
+            break;
+        case DateToken::Day2:
+            AppendNumber(result, fileTime.wDay, 2);
+            break;
+        case DateToken::Day1:
+            AppendNumber(result, fileTime.wDay, 1);
+            break;
+        case DateToken::Hour2:
+            AppendNumber(result, fileTime.wHour, 2);
+            break;
+        case DateToken::Hour1:
+            AppendNumber(result, fileTime.wHour, 1);
+            break;
+        case DateToken::Minute2:
+            AppendNumber(result, fileTime.wMinute, 2);
+            break;
+        case DateToken::Minute1:
+            AppendNumber(result, fileTime.wMinute, 1);
+            break;
+        case DateToken::Second2:
+            AppendNumber(result, fileTime.wSecond, 2);
+            break;
+        case DateToken::Second1:
+            AppendNumber(result, fileTime.wSecond, 1);
+            break;
+        case DateToken::Millisecond3:
+            AppendNumber(result, fileTime.wMilliseconds, 3);
+            break;
+        case DateToken::Millisecond2:
+            AppendNumber(result, fileTime.wMilliseconds / 10, 2);
+            break;
+        case DateToken::Millisecond1:
+            AppendNumber(result, fileTime.wMilliseconds / 100, 1);
+            break;
+        }
+    }
+
+    return result;
+}
+
+void CPowerRenameDateTemplate::_AppendName(_In_ DateToken token, _In_ const SYSTEMTIME& fileTime, _Inout_ std::wstring& result) const
+{
+    if (!m_names->cached)
+    {
+        PCWSTR format = token == DateToken::MonthName ? L"MMMM" : token == DateToken::MonthAbbreviation ? L"MMM" : token == DateToken::DayName ? L"dddd" : L"ddd";
+        result += FormatName(*m_names, fileTime, format);
+        return;
+    }
+
+    if (!IsValidDate(fileTime))
+    {
+        return;
+    }
+
+    switch (token)
+    {
+    case DateToken::MonthName:
+        result += m_names->months[fileTime.wMonth - 1];
+        break;
+    case DateToken::MonthAbbreviation:
+        result += m_names->monthAbbreviations[fileTime.wMonth - 1];
+        break;
+    case DateToken::DayName:
+        result += m_names->days[GetDayOfWeek(fileTime)];
+        break;
+    case DateToken::DayAbbreviation:
+        result += m_names->dayAbbreviations[GetDayOfWeek(fileTime)];
+        break;
+    default:
+        break;
+    }
+}
+
+std::shared_ptr<const DateNames> CPowerRenameDateTemplate::s_GetDateNames()
+{
+    static CSRWLock lock;
+    static std::map<std::wstring, std::shared_ptr<const DateNames>> namesByLocale;
+
+    wchar_t localeName[LOCALE_NAME_MAX_LENGTH];
+    if (GetUserDefaultLocaleName(localeName, LOCALE_NAME_MAX_LENGTH) == 0)
+    {
+        StringCchCopy(localeName, LOCALE_NAME_MAX_LENGTH, L"en_US");
+    }
+
+    // Scope lock
+    {
+        CSRWSharedAutoLock sharedLock(&lock);
+        auto it = namesByLocale.find(localeName);
+        if (it != namesByLocale.end())
+        {
+            return it->second;
+        }
+    }
+
+    auto names = LoadDateNames(localeName);
+
+    CSRWExclusiveAutoLock exclusiveLock(&lock);
+    return namesByLocale.emplace(localeName, names).first->second;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "pch.h"
+#include <locale>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Month and day names of a locale as they are inserted in file names
+struct DateNames
+{
+    std::wstring localeName;
+    std::locale userLocale;
+    // Names only depend on the month or day of the week with a gregorian calendar.
+    // Otherwise they are formatted for each date.
+    bool cached = false;
+    std::wstring months[12];
+    std::wstring monthAbbreviations[12];
+    std::wstring days[7];
+    std::wstring dayAbbreviations[7];
+};
+
+// Replace term with its file time tokens ($YYYY, $MMM, $DD, $hh, $fff, ...) parsed once
+// so it can be expanded for any number of file times in a single pass each.
+// Immutable after construction so an instance can be shared between threads.
+class CPowerRenameDateTemplate
+{
+public:
+    CPowerRenameDateTemplate(_In_ PCWSTR source);
+
+    // True when at least one file time token was found
+    bool UsesFileTime() const { return m_usesFileTime; }
+
+    // Expand the tokens with the values of fileTime
+    std::wstring Format(_In_ const SYSTEMTIME& fileTime) const;
+
+    // Names for the user default locale.  Looked up once per locale.
+    static std::shared_ptr<const DateNames> s_GetDateNames();
+
+protected:
+    enum class DateToken
+    {
+        Literal,
+        Year4,
+        Year2,
+        Year1,
+        MonthName,
+        MonthAbbreviation,
+        Month2,
+        Month1,
+        DayName,
+        DayAbbreviation,
+        Day2,
+        Day1,
+        Hour2,
+        Hour1,
+        Minute2,
+        Minute1,
+        Second2,
+        Second1,
+        Millisecond3,
+        Millisecond2,
+        Millisecond1,
+    };
+
+    struct Segment
+    {
+        DateToken token = DateToken::Literal;
+        // Only set for DateToken::Literal
+        std::wstring literal;
+    };
+
+    void _AddLiteral(_In_ const std::wstring& literal);
+    void _AppendName(_In_ DateToken token, _In_ const SYSTEMTIME& fileTime, _Inout_ std::wstring& result) const;
+
+    std::vector<Segment> m_segments;
+    bool m_usesFileTime = false;
+    // Only loaded when the template contains month or day names
+    std::shared_ptr<const DateNames> m_names;
+};
@@ -2,6 +2,31 @@
 #include "PowerRenameEnum.h"
 #include <ShlGuid.h>
 #include <helpers.h>
+#include "ParallelFor.h"
+#include <algorithm>
+
+namespace
+{
+    // Items requested from IEnumShellItems::Next at once
+    const ULONG EnumBatchSize = 256;
+    // Items added to the manager at once
+    const size_t AddBatchSize = 256;
+    // Items the workers list ahead of the thread adding them before they wait for it
+    const size_t MaxPrefetchedItems = 16 * EnumBatchSize;
+    // Enumeration mostly waits on the file system, network shares in particular
+    const UINT MinEnumWorkerCount = 4;
+    // We shouldn't get this deep since we only enum the contents of
+    // regular folders but adding just in case
+    const int MaxEnumDepth = MAX_PATH / 2;
+
+    HRESULT GetIDList(_In_ IShellItem* psi, _Inout_ unique_pidl& pidl)
+    {
+        PIDLIST_ABSOLUTE idList = nullptr;
+        HRESULT hr = SHGetIDListFromObject(psi, &idList);
+        pidl.reset(idList);
+        return hr;
+    }
+}
 
 IFACEMETHODIMP_(ULONG) CPowerRenameEnum::AddRef()
 {
@@ -87,58 +112,334 @@ HRESULT CPowerRenameEnum::_Init(_In_ IUnknown* pdo, _In_ IPowerRenameManager* pM
     return S_OK;
 }
 
-HRESULT CPowerRenameEnum::_ParseEnumItems(_In_ IEnumShellItems* pesi, _In_ int depth)
+HRESULT CPowerRenameEnum::_ParseEnumItems(_In_ IEnumShellItems* pesi)
 {
-    HRESULT hr = E_INVALIDARG;
+    if (!pesi)
+    {
+        return E_INVALIDARG;
+    }
 
-    // We shouldn't get this deep since we only enum the contents of
-    // regular folders but adding just in case
-    if ((pesi) && (depth < (MAX_PATH / 2)))
+    // The selected items are enumerated here, their folders by the workers
+    std::vector<CComPtr<IShellItem>> rootItems;
+    std::vector<std::shared_ptr<FolderListing>> rootContents;
+    IShellItem* fetchedItems[EnumBatchSize] = {};
+    ULONG celtFetched = 0;
+    HRESULT hrNext = S_OK;
+    do
+    {
+        celtFetched = 0;
+        hrNext = pesi->Next(EnumBatchSize, fetchedItems, &celtFetched);
+        for (ULONG i = 0; SUCCEEDED(hrNext) && i < celtFetched; i++)
+        {
+            rootItems.emplace_back();
+            rootItems.back().Attach(fetchedItems[i]);
+            rootContents.push_back(_QueueFolder(fetchedItems[i], 1));
+        }
+    } while (hrNext == S_OK && celtFetched > 0 && !m_canceled);
+
+    _StartWorkers();
+
+    HRESULT hr = S_OK;
+    for (size_t i = 0; SUCCEEDED(hr) && i < rootItems.size(); i++)
+    {
+        hr = _AddEnumItem(rootItems[i], 0, rootContents[i]);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = _FlushPendingItems();
+    }
+
+    _StopWorkers();
+    return hr;
+}
+
+std::shared_ptr<FolderListing> CPowerRenameEnum::_QueueFolder(_In_ IShellItem* psi, _In_ int depth)
+{
+    // Same test as CPowerRenameItem uses for folders.
+    // Some items can be both folders and streams (ex: zip folders).
+    SFGAOF att = 0;
+    if (FAILED(psi->GetAttributes(SFGAO_STREAM | SFGAO_FOLDER, &att)) || !(att & SFGAO_FOLDER) || (att & SFGAO_STREAM) || depth >= MaxEnumDepth)
     {
-        hr = S_OK;
+        return nullptr;
+    }
+
+    // Shell items stay on the thread that created them, the workers get an id list
+    auto listing = std::make_shared<FolderListing>();
+    listing->depth = depth;
+    if (FAILED(GetIDList(psi, listing->pidl)))
+    {
+        return nullptr;
+    }
+
+    // Scope lock
+    {
+        std::lock_guard<std::mutex> guard(m_queueLock);
+        m_queuedFolders.push_back(listing);
+    }
+    m_queueChanged.notify_one();
+    return listing;
+}
 
-        ULONG celtFetched;
-        CComPtr<IShellItem> spsi;
-        while ((S_OK == pesi->Next(1, &spsi, &celtFetched)) && (SUCCEEDED(hr)))
+void CPowerRenameEnum::_StartWorkers()
+{
+    m_stopWorkers = false;
+    m_prefetchedItems = 0;
+    const UINT workerCount = max(GetParallelWorkerCount(), MinEnumWorkerCount);
+    for (UINT i = 0; i < workerCount; i++)
+    {
+        m_workers.emplace_back([this] { _WorkerThread(); });
+    }
+}
+
+void CPowerRenameEnum::_StopWorkers()
+{
+    // Scope lock
+    {
+        std::lock_guard<std::mutex> guard(m_queueLock);
+        m_stopWorkers = true;
+        m_queuedFolders.clear();
+    }
+    m_queueChanged.notify_all();
+    m_prefetchChanged.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void CPowerRenameEnum::_WorkerThread()
+{
+    HRESULT hrCoInit = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+
+    while (true)
+    {
+        std::shared_ptr<FolderListing> listing;
+        // Scope lock
+        {
+            std::unique_lock<std::mutex> guard(m_queueLock);
+            m_queueChanged.wait(guard, [this] { return m_stopWorkers || !m_queuedFolders.empty(); });
+            if (m_stopWorkers)
+            {
+                break;
+            }
+            listing = std::move(m_queuedFolders.front());
+            m_queuedFolders.pop_front();
+        }
+
+        // The folder may already be enumerated by the thread adding the items
+        if (!listing->claimed.exchange(true))
+        {
+            _EnumerateFolder(*listing, true);
+        }
+    }
+
+    if (SUCCEEDED(hrCoInit))
+    {
+        CoUninitialize();
+    }
+}
+
+void CPowerRenameEnum::_EnumerateFolder(_In_ FolderListing& listing, _In_ bool bounded)
+{
+    CComPtr<IShellItem> spsiFolder;
+    HRESULT hr = SHCreateItemFromIDList(listing.pidl.get(), IID_PPV_ARGS(&spsiFolder));
+    CComPtr<IEnumShellItems> spesi;
+    if (SUCCEEDED(hr))
+    {
+        // Bind to the IShellItem for the IEnumShellItems interface
+        hr = spsiFolder->BindToHandler(nullptr, BHID_EnumItems, IID_PPV_ARGS(&spesi));
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        IShellItem* fetchedItems[EnumBatchSize] = {};
+        ULONG celtFetched = 0;
+        HRESULT hrNext = S_OK;
+        do
         {
-            if (m_canceled)
+            if (bounded)
+            {
+                // Wait for the thread adding the items to catch up, unless it waits for this folder
+                std::unique_lock<std::mutex> guard(m_queueLock);
+                m_prefetchChanged.wait(guard, [&] { return m_stopWorkers || m_prefetchedItems < MaxPrefetchedItems || m_waitingListing == &listing; });
+                if (m_stopWorkers)
+                {
+                    break;
+                }
+            }
+
+            celtFetched = 0;
+            hrNext = spesi->Next(EnumBatchSize, fetchedItems, &celtFetched);
+            if (FAILED(hrNext))
+            {
+                break;
+            }
+
+            std::vector<FolderListing::Entry> entries(celtFetched);
+            for (ULONG i = 0; i < celtFetched; i++)
             {
-                return E_ABORT;
+                // Sub folders are queued as soon as they are found so the workers stay ahead
+                if (SUCCEEDED(GetIDList(fetchedItems[i], entries[i].pidl)))
+                {
+                    entries[i].contents = _QueueFolder(fetchedItems[i], listing.depth + 1);
+                }
+                fetchedItems[i]->Release();
             }
 
-            CComPtr<IPowerRenameItemFactory> spFactory;
-            hr = m_spsrm->GetRenameItemFactory(&spFactory);
-            if (SUCCEEDED(hr))
+            size_t listed = 0;
+            // Scope lock
             {
-                CComPtr<IPowerRenameItem> spNewItem;
-                // Failure may be valid if we come across a shell item that does
-                // not support a file system path.  In that case we simply ignore
-                // the item.
-                if (SUCCEEDED(spFactory->Create(spsi, &spNewItem)))
+                std::lock_guard<std::mutex> guard(listing.lock);
+                for (auto& entry : entries)
                 {
-                    spNewItem->PutDepth(depth);
-                    hr = m_spsrm->AddItem(spNewItem);
-                    if (SUCCEEDED(hr))
+                    // Items without an id list can't be renamed anyway
+                    if (entry.pidl)
                     {
-                        bool isFolder = false;
-                        if (SUCCEEDED(spNewItem->GetIsFolder(&isFolder)) && isFolder)
-                        {
-                            // Bind to the IShellItem for the IEnumShellItems interface
-                            CComPtr<IEnumShellItems> spesiNext;
-                            hr = spsi->BindToHandler(nullptr, BHID_EnumItems, IID_PPV_ARGS(&spesiNext));
-                            if (SUCCEEDED(hr))
-                            {
-                                // Parse the folder contents recursively
-                                hr = _ParseEnumItems(spesiNext, depth + 1);
-                            }
-                        }
+                        listing.entries.push_back(std::move(entry));
+                        listed++;
                     }
                 }
             }
+            listing.changed.notify_all();
+
+            // Scope lock
+            {
+                std::lock_guard<std::mutex> guard(m_queueLock);
+                m_prefetchedItems += listed;
+            }
+        } while (hrNext == S_OK && celtFetched > 0 && !m_canceled && !m_stopWorkers);
+    }
+
+    // Scope lock
+    {
+        std::lock_guard<std::mutex> guard(listing.lock);
+        listing.hr = hr;
+        listing.done = true;
+    }
+    listing.changed.notify_all();
+}
+
+HRESULT CPowerRenameEnum::_AddEnumItem(_In_ IShellItem* psi, _In_ int depth, _In_ std::shared_ptr<FolderListing> contents)
+{
+    if (m_canceled)
+    {
+        return E_ABORT;
+    }
+
+    CComPtr<IPowerRenameItemFactory> spFactory;
+    HRESULT hr = m_spsrm->GetRenameItemFactory(&spFactory);
+    if (SUCCEEDED(hr))
+    {
+        CComPtr<IPowerRenameItem> spNewItem;
+        // Failure may be valid if we come across a shell item that does
+        // not support a file system path.  In that case we simply ignore
+        // the item.
+        if (SUCCEEDED(spFactory->Create(psi, &spNewItem)))
+        {
+            spNewItem->PutDepth(depth);
+            m_pendingItems.push_back(spNewItem);
+            if (m_pendingItems.size() >= AddBatchSize)
+            {
+                hr = _FlushPendingItems();
+            }
+
+            bool isFolder = false;
+            if (SUCCEEDED(hr) && SUCCEEDED(spNewItem->GetIsFolder(&isFolder)) && isFolder)
+            {
+                // We shouldn't get this deep since we only enum the contents of
+                // regular folders but adding just in case
+                if (depth + 1 >= MaxEnumDepth)
+                {
+                    return E_INVALIDARG;
+                }
+
+                if (!contents)
+                {
+                    contents = std::make_shared<FolderListing>();
+                    contents->depth = depth + 1;
+                    hr = GetIDList(psi, contents->pidl);
+                }
 
-            spsi = nullptr;
+                if (SUCCEEDED(hr))
+                {
+                    // Parse the folder contents recursively
+                    hr = _AddFolderContents(*contents);
+                }
+            }
         }
     }
 
     return hr;
 }
+
+HRESULT CPowerRenameEnum::_AddFolderContents(_In_ FolderListing& listing)
+{
+    // Don't wait for a worker to get to it
+    if (!listing.claimed.exchange(true))
+    {
+        _EnumerateFolder(listing, false);
+    }
+
+    while (true)
+    {
+        // The worker listing this folder must not wait for us while we wait for it
+        // Scope lock
+        {
+            std::lock_guard<std::mutex> guard(m_queueLock);
+            m_waitingListing = &listing;
+        }
+        m_prefetchChanged.notify_all();
+
+        std::vector<FolderListing::Entry> entries;
+        bool done = false;
+        HRESULT hrListing = S_OK;
+        // Scope lock
+        {
+            std::unique_lock<std::mutex> guard(listing.lock);
+            listing.changed.wait(guard, [&] { return listing.done || !listing.entries.empty(); });
+            entries.swap(listing.entries);
+            done = listing.done;
+            hrListing = listing.hr;
+        }
+
+        // Scope lock
+        {
+            std::lock_guard<std::mutex> guard(m_queueLock);
+            m_prefetchedItems -= entries.size();
+        }
+        m_prefetchChanged.notify_all();
+
+        for (auto& entry : entries)
+        {
+            CComPtr<IShellItem> spsi;
+            if (SUCCEEDED(SHCreateItemFromIDList(entry.pidl.get(), IID_PPV_ARGS(&spsi))))
+            {
+                HRESULT hr = _AddEnumItem(spsi, listing.depth, entry.contents);
+                if (FAILED(hr))
+                {
+                    return hr;
+                }
+            }
+        }
+
+        if (done && entries.empty())
+        {
+            return hrListing;
+        }
+    }
+}
+
+HRESULT CPowerRenameEnum::_FlushPendingItems()
+{
+    HRESULT hr = S_OK;
+    if (!m_pendingItems.empty())
+    {
+        std::vector<IPowerRenameItem*> items(m_pendingItems.begin(), m_pendingItems.end());
+        hr = m_spsrm->AddItems(items.data(), static_cast<UINT>(items.size()));
+        m_pendingItems.clear();
+    }
+    return hr;
+}
@@ -1,9 +1,47 @@
 #pragma once
 #include "pch.h"
 #include "PowerRenameInterfaces.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include "srwlock.h"
 
+struct CoTaskMemDeleter
+{
+    void operator()(_In_opt_ void* p) const { CoTaskMemFree(p); }
+};
+
+using unique_pidl = std::unique_ptr<ITEMIDLIST_ABSOLUTE, CoTaskMemDeleter>;
+
+// Contents of a folder, filled in batches by the thread that enumerates it and
+// consumed in order by the thread adding the items to the manager.
+struct FolderListing
+{
+    struct Entry
+    {
+        unique_pidl pidl;
+        // Set when the entry is a folder, its contents are enumerated ahead of time
+        std::shared_ptr<FolderListing> contents;
+    };
+
+    unique_pidl pidl;
+    // Depth of the items in the folder
+    int depth = 0;
+    // Set by the first thread that starts enumerating the folder
+    std::atomic<bool> claimed = false;
+
+    std::mutex lock;
+    std::condition_variable changed;
+    // Entries not taken by the consumer yet
+    _Guarded_by_(lock) std::vector<Entry> entries;
+    _Guarded_by_(lock) bool done = false;
+    _Guarded_by_(lock) HRESULT hr = S_OK;
+};
+
 class CPowerRenameEnum :
     public IPowerRenameEnum
 {
@@ -25,10 +63,39 @@ protected:
     virtual ~CPowerRenameEnum();
 
     HRESULT _Init(_In_ IUnknown* pdo, _In_ IPowerRenameManager* pManager);
-    HRESULT _ParseEnumItems(_In_ IEnumShellItems* pesi, _In_ int depth = 0);
+    HRESULT _ParseEnumItems(_In_ IEnumShellItems* pesi);
+
+    // Folders are enumerated by a pool of worker threads while the thread calling Start
+    // walks the listings depth first.  It creates the items, which assigns their ids, and
+    // adds them to the manager in batches so the order is the same as a serial walk.
+    // The workers wait when they listed MaxPrefetchedItems items it has not taken yet.
+    std::shared_ptr<FolderListing> _QueueFolder(_In_ IShellItem* psi, _In_ int depth);
+    void _StartWorkers();
+    void _StopWorkers();
+    void _WorkerThread();
+    // Waits for the listed items to be taken when bounded, the thread adding the items
+    // enumerates unbounded since it takes them itself afterwards
+    void _EnumerateFolder(_In_ FolderListing& listing, _In_ bool bounded);
+    HRESULT _AddEnumItem(_In_ IShellItem* psi, _In_ int depth, _In_ std::shared_ptr<FolderListing> contents);
+    HRESULT _AddFolderContents(_In_ FolderListing& listing);
+    HRESULT _FlushPendingItems();
 
     CComPtr<IPowerRenameManager> m_spsrm;
     CComPtr<IUnknown> m_spdo;
-    bool m_canceled = false;
+    std::atomic<bool> m_canceled = false;
+
+    std::mutex m_queueLock;
+    std::condition_variable m_queueChanged;
+    _Guarded_by_(m_queueLock) std::deque<std::shared_ptr<FolderListing>> m_queuedFolders;
+    std::atomic<bool> m_stopWorkers = false;
+    std::condition_variable m_prefetchChanged;
+    // Items listed by the workers and not taken by the thread adding them yet
+    _Guarded_by_(m_queueLock) size_t m_prefetchedItems = 0;
+    // Folder the thread adding the items waits for, its worker doesn't wait
+    _Guarded_by_(m_queueLock) const FolderListing* m_waitingListing = nullptr;
+    std::vector<std::thread> m_workers;
+
+    // Items created but not added to the manager yet
+    std::vector<CComPtr<IPowerRenameItem>> m_pendingItems;
     long m_refCount = 0;
 };
\ No newline at end of file
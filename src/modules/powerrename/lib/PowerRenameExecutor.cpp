@@ -0,0 +1,422 @@
+#include "pch.h"
+#include "PowerRenameExecutor.h"
+#include "PowerRenameCaseTransform.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace
+{
+    // Whether path, or a folder containing it, is one of the folded paths of renamed
+    bool IsRenamed(_In_ const std::wstring& path, _In_ const std::unordered_set<std::wstring>& renamed)
+    {
+        const std::wstring key = CPowerRenameExecutor::s_FoldName(path.c_str());
+        for (size_t end = key.length(); end != std::wstring::npos && end > 0; end = key.rfind(L'\\', end - 1))
+        {
+            if (renamed.find(key.substr(0, end)) != renamed.end())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+void CPowerRenameJournal::Record(_In_ const std::wstring& path, _In_ const std::wstring& newPath)
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_entries.push_back({ path, newPath });
+}
+
+std::vector<CPowerRenameJournal::Entry> CPowerRenameJournal::GetEntries()
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    return m_entries;
+}
+
+bool CPowerRenameJournal::IsEmpty()
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    return m_entries.empty();
+}
+
+HRESULT CPowerRenameJournal::Undo(_In_ IPowerRenameFileSystem* fileSystem, _In_opt_ HWND hwndParent)
+{
+    std::vector<Entry> entries;
+    // Scope lock
+    {
+        CSRWExclusiveAutoLock lock(&m_lock);
+        entries.swap(m_entries);
+    }
+
+    // Paths the queued renames give back, nested items and items of a loop are only
+    // there once those are committed
+    std::unordered_set<std::wstring> queued;
+    std::vector<PowerRenameFileResult> results(entries.size(), { E_PENDING });
+    HRESULT hr = S_OK;
+    for (size_t i = entries.size(); i-- > 0 && SUCCEEDED(hr);)
+    {
+        const Entry& entry = entries[i];
+        if (IsRenamed(entry.newPath, queued))
+        {
+            hr = fileSystem->Commit(hwndParent);
+            queued.clear();
+            if (FAILED(hr))
+            {
+                break;
+            }
+        }
+
+        HRESULT hrRename = fileSystem->Rename(entry.newPath.c_str(), PathFindFileName(entry.path.c_str()), &results[i]);
+        if (FAILED(hrRename))
+        {
+            results[i].hr = hrRename;
+        }
+        queued.insert(CPowerRenameExecutor::s_FoldName(entry.path.c_str()));
+    }
+
+    HRESULT hrCommit = fileSystem->Commit(hwndParent);
+    if (SUCCEEDED(hr))
+    {
+        hr = hrCommit;
+    }
+
+    for (size_t i = entries.size(); i-- > 0 && SUCCEEDED(hr);)
+    {
+        hr = results[i].hr;
+    }
+    return hr;
+}
+
+CPowerRenameExecutor::CPowerRenameExecutor(_In_ IPowerRenameFileSystem* fileSystem, _In_ const std::shared_ptr<CPowerRenameJournal>& journal) :
+    m_spFileSystem(fileSystem),
+    m_journal(journal)
+{
+}
+
+void CPowerRenameExecutor::Add(_In_ int id, _In_ PCWSTR path, _In_ PCWSTR newName)
+{
+    PCWSTR name = PathFindFileName(path);
+    if (wcscmp(name, newName) == 0)
+    {
+        return;
+    }
+
+    std::wstring folderPath(path, name - path);
+    auto it = m_folderIndexes.find(folderPath);
+    if (it == m_folderIndexes.end())
+    {
+        Folder folder;
+        folder.depth = std::count(folderPath.begin(), folderPath.end(), L'\\');
+        folder.path = folderPath;
+        it = m_folderIndexes.emplace(folderPath, m_folders.size()).first;
+        m_folders.push_back(std::move(folder));
+    }
+
+    Rename rename;
+    rename.id = id;
+    rename.path = path;
+    rename.nameOffset = name - path;
+    rename.newName = newName;
+    rename.folder = it->second;
+
+    m_folders[it->second].renames.push_back(m_renames.size());
+    m_renameIndexes[id] = m_renames.size();
+    m_pathIndexes[s_FoldName(path)] = m_renames.size();
+    m_renames.push_back(std::move(rename));
+}
+
+void CPowerRenameExecutor::Plan()
+{
+    // Folders only look up names in themselves so they are planned independently
+    ParallelFor(static_cast<UINT>(m_folders.size()), 1, [this](UINT begin, UINT end) {
+        for (UINT f = begin; f < end; f++)
+        {
+            _PlanFolder(m_folders[f]);
+        }
+        return true;
+    });
+}
+
+HRESULT CPowerRenameExecutor::Execute(_In_opt_ HWND hwndParent, _Out_ std::vector<int>& failedIds)
+{
+    failedIds.clear();
+
+    std::vector<size_t> folders(m_folders.size());
+    for (size_t f = 0; f < folders.size(); f++)
+    {
+        folders[f] = f;
+    }
+    std::stable_sort(folders.begin(), folders.end(), [this](size_t a, size_t b) { return m_folders[a].depth > m_folders[b].depth; });
+
+    bool moves = false;
+    for (const Rename& rename : m_renames)
+    {
+        moves = moves || !rename.tempName.empty();
+    }
+
+    _QueueRenames(folders, false);
+    HRESULT hr = m_spFileSystem->Commit(hwndParent);
+    for (Rename& rename : m_renames)
+    {
+        if (SUCCEEDED(rename.result.hr) && rename.result.renamedTo[0] != L'\0')
+        {
+            (rename.tempName.empty() ? rename.newName : rename.tempName) = rename.result.renamedTo;
+        }
+    }
+
+    if (moves && SUCCEEDED(hr))
+    {
+        // The items moved out of the way only have their temporary names once the first
+        // commit is done
+        _QueueRenames(folders, true);
+        hr = m_spFileSystem->Commit(hwndParent);
+        for (Rename& rename : m_renames)
+        {
+            if (SUCCEEDED(rename.tempResult.hr) && rename.tempResult.renamedTo[0] != L'\0')
+            {
+                rename.newName = rename.tempResult.renamedTo;
+            }
+        }
+    }
+
+    // Journal the renames that were done, in the order they were done
+    for (size_t f : folders)
+    {
+        const Folder& folder = m_folders[f];
+        for (size_t r : folder.order)
+        {
+            const Rename& rename = m_renames[r];
+            if (SUCCEEDED(rename.result.hr))
+            {
+                m_journal->Record(rename.path, folder.path + (rename.tempName.empty() ? rename.newName : rename.tempName));
+            }
+            else
+            {
+                failedIds.push_back(rename.id);
+            }
+        }
+    }
+
+    for (size_t f : folders)
+    {
+        const Folder& folder = m_folders[f];
+        const std::wstring folderPath = moves ? _RenamedFolderPath(folder.path) : folder.path;
+        for (size_t r : folder.order)
+        {
+            const Rename& rename = m_renames[r];
+            if (!rename.tempName.empty() && SUCCEEDED(rename.result.hr))
+            {
+                if (SUCCEEDED(rename.tempResult.hr))
+                {
+                    m_journal->Record(folderPath + rename.tempName, folderPath + rename.newName);
+                }
+                else
+                {
+                    failedIds.push_back(rename.id);
+                }
+            }
+        }
+    }
+
+    return hr;
+}
+
+PCWSTR CPowerRenameExecutor::GetNewName(_In_ int id) const
+{
+    auto it = m_renameIndexes.find(id);
+    return it != m_renameIndexes.end() ? m_renames[it->second].newName.c_str() : nullptr;
+}
+
+std::wstring CPowerRenameExecutor::s_FoldName(_In_ PCWSTR name)
+{
+    std::wstring key(name);
+    CPowerRenameCaseTransform::s_ToUpper(key.data(), key.length());
+    return key;
+}
+
+void CPowerRenameExecutor::_PlanFolder(_Inout_ Folder& folder)
+{
+    std::unordered_map<std::wstring, size_t> originals;
+    std::unordered_map<std::wstring, size_t> targets;
+    originals.reserve(folder.renames.size());
+    targets.reserve(folder.renames.size());
+    for (size_t r : folder.renames)
+    {
+        originals.emplace(s_FoldName(m_renames[r].path.c_str() + m_renames[r].nameOffset), r);
+    }
+
+    for (size_t r : folder.renames)
+    {
+        Rename& rename = m_renames[r];
+        std::wstring key = s_FoldName(rename.newName.c_str());
+        if (targets.find(key) != targets.end())
+        {
+            // Another item gets this name first
+            rename.newName = _TakeFreeName(rename.newName, r, folder, targets, originals);
+            continue;
+        }
+
+        auto original = originals.find(key);
+        if (original != originals.end())
+        {
+            // Free once the other item is renamed, or only the case of the name changes
+            if (original->second != r)
+            {
+                rename.dependsOn = original->second;
+            }
+            targets.emplace(key, r);
+            continue;
+        }
+
+        bool exists = false;
+        if (SUCCEEDED(m_spFileSystem->Exists((folder.path + rename.newName).c_str(), &exists)) && exists)
+        {
+            rename.newName = _TakeFreeName(rename.newName, r, folder, targets, originals);
+        }
+        else
+        {
+            targets.emplace(key, r);
+        }
+    }
+
+    // Each rename waits for at most one other so following the waits gives chains,
+    // done from their end, or loops
+    enum class State
+    {
+        New,
+        InChain,
+        Ordered,
+    };
+
+    std::unordered_map<size_t, State> states;
+    for (size_t r : folder.renames)
+    {
+        states[r] = State::New;
+    }
+
+    std::vector<size_t> chain;
+    for (size_t r : folder.renames)
+    {
+        while (true)
+        {
+            chain.clear();
+            size_t next = r;
+            while (next != NoRename && states[next] == State::New)
+            {
+                states[next] = State::InChain;
+                chain.push_back(next);
+                next = m_renames[next].dependsOn;
+            }
+
+            if (next != NoRename && states[next] == State::InChain)
+            {
+                // Loop, ex: two items swapping names.  The item closing the loop is
+                // moved out of the way first and the chain is followed again.
+                Rename& rename = m_renames[next];
+                rename.tempName = _TakeFreeName(rename.path.substr(rename.nameOffset), next, folder, targets, originals);
+                rename.dependsOn = NoRename;
+                for (size_t c : chain)
+                {
+                    states[c] = State::New;
+                }
+                continue;
+            }
+
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            {
+                folder.order.push_back(*it);
+                states[*it] = State::Ordered;
+            }
+            break;
+        }
+    }
+}
+
+void CPowerRenameExecutor::_QueueRenames(_In_ const std::vector<size_t>& folders, _In_ bool moves)
+{
+    for (size_t first = 0; first < folders.size();)
+    {
+        // Folders of the same depth can't contain each other
+        size_t last = first;
+        while (last < folders.size() && m_folders[folders[last]].depth == m_folders[folders[first]].depth)
+        {
+            last++;
+        }
+
+        ParallelFor(static_cast<UINT>(last - first), 1, [&](UINT begin, UINT end) {
+            for (UINT f = begin; f < end; f++)
+            {
+                const Folder& folder = m_folders[folders[first + f]];
+                const std::wstring folderPath = moves ? _RenamedFolderPath(folder.path) : folder.path;
+                for (size_t r : folder.order)
+                {
+                    Rename& rename = m_renames[r];
+                    if (!moves)
+                    {
+                        const std::wstring& newName = rename.tempName.empty() ? rename.newName : rename.tempName;
+                        HRESULT hr = m_spFileSystem->Rename(rename.path.c_str(), newName.c_str(), &rename.result);
+                        if (FAILED(hr))
+                        {
+                            rename.result.hr = hr;
+                        }
+                    }
+                    else if (!rename.tempName.empty() && SUCCEEDED(rename.result.hr))
+                    {
+                        // The name of the loop is free now
+                        std::wstring tempPath = folderPath + rename.tempName;
+                        HRESULT hr = m_spFileSystem->Rename(tempPath.c_str(), rename.newName.c_str(), &rename.tempResult);
+                        if (FAILED(hr))
+                        {
+                            rename.tempResult.hr = hr;
+                        }
+                    }
+                }
+            }
+            return true;
+        });
+
+        first = last;
+    }
+}
+
+std::wstring CPowerRenameExecutor::_RenamedFolderPath(_In_ const std::wstring& folderPath) const
+{
+    // The folders got their temporary name if they have one
+    std::wstring path;
+    for (size_t start = 0, end = folderPath.find(L'\\'); end != std::wstring::npos; start = end + 1, end = folderPath.find(L'\\', start))
+    {
+        std::wstring name = folderPath.substr(start, end - start);
+        auto it = m_pathIndexes.find(s_FoldName(folderPath.substr(0, end).c_str()));
+        if (it != m_pathIndexes.end() && SUCCEEDED(m_renames[it->second].result.hr))
+        {
+            const Rename& rename = m_renames[it->second];
+            name = rename.tempName.empty() ? rename.newName : rename.tempName;
+        }
+        path += name + L"\\";
+    }
+    return path;
+}
+
+std::wstring CPowerRenameExecutor::_TakeFreeName(_In_ const std::wstring& name, _In_ size_t index, _In_ const Folder& folder, _Inout_ std::unordered_map<std::wstring, size_t>& targets, _In_ const std::unordered_map<std::wstring, size_t>& originals)
+{
+    const size_t extension = CPowerRenameCaseTransform::s_FindExtension(name.c_str(), name.length());
+    for (UINT n = 2;; n++)
+    {
+        std::wstring candidate = name.substr(0, extension) + L" (" + std::to_wstring(n) + L")" + name.substr(extension);
+        std::wstring key = s_FoldName(candidate.c_str());
+        if (targets.find(key) != targets.end() || originals.find(key) != originals.end())
+        {
+            continue;
+        }
+
+        bool exists = false;
+        if (SUCCEEDED(m_spFileSystem->Exists((folder.path + candidate).c_str(), &exists)) && exists)
+        {
+            continue;
+        }
+
+        targets.emplace(key, index);
+        return candidate;
+    }
+}
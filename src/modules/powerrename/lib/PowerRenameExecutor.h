@@ -0,0 +1,117 @@
+#pragma once
+#include "pch.h"
+#include "PowerRenameInterfaces.h"
+#include "srwlock.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Renames done by CPowerRenameExecutor, in the order they were done
+class CPowerRenameJournal
+{
+public:
+    struct Entry
+    {
+        std::wstring path;
+        std::wstring newPath;
+    };
+
+    void Record(_In_ const std::wstring& path, _In_ const std::wstring& newPath);
+    std::vector<Entry> GetEntries();
+    bool IsEmpty();
+
+    // Rename the items back, last rename first so folders get their names back before
+    // the items in them.  The queued renames are committed before an item they give its
+    // path back to is renamed.  The journal is empty afterwards.
+    HRESULT Undo(_In_ IPowerRenameFileSystem* fileSystem, _In_opt_ HWND hwndParent);
+
+private:
+    CSRWLock m_lock;
+    std::vector<Entry> m_entries;
+};
+
+// Renames items through an IPowerRenameFileSystem.  Before anything is renamed the new
+// names are indexed by folder, case insensitively, to find the ones that would collide
+// with another new name or with an item that stays.  Those get a free "name (2).ext"
+// style name, like the shell gives on collision.  A rename to the name of another item
+// that is renamed waits for that item, and such chains that loop back (ex: two items
+// swapping names) are broken by moving one of their items out of the way to a free name
+// first and to its new name once the others are done.
+// The renames of the folders of a depth are queued concurrently, deepest folders first so
+// items are renamed before the folders containing them, and committed once.  Only when
+// items were moved out of the way are they renamed again in a second commit.  The renames
+// that were done are journaled under the names the file system gave, so the journal
+// undoes the whole run.
+class CPowerRenameExecutor
+{
+public:
+    CPowerRenameExecutor(_In_ IPowerRenameFileSystem* fileSystem, _In_ const std::shared_ptr<CPowerRenameJournal>& journal);
+
+    // Renames to the same name are ignored
+    void Add(_In_ int id, _In_ PCWSTR path, _In_ PCWSTR newName);
+
+    // Give colliding renames a free name and order the renames of each folder
+    void Plan();
+
+    // Rename in the planned order and commit.  failedIds are the items the file system
+    // failed to rename or did not get to, ex: once the user canceled.
+    HRESULT Execute(_In_opt_ HWND hwndParent, _Out_ std::vector<int>& failedIds);
+
+    // New name of the item once planned, nullptr if it isn't renamed
+    PCWSTR GetNewName(_In_ int id) const;
+
+    // Key of a name in the folder index
+    static std::wstring s_FoldName(_In_ PCWSTR name);
+
+protected:
+    static const size_t NoRename = static_cast<size_t>(-1);
+
+    struct Rename
+    {
+        int id = 0;
+        std::wstring path;
+        // Position of the name in path
+        size_t nameOffset = 0;
+        std::wstring newName;
+        size_t folder = 0;
+        // Rename that frees the new name of this one, done first
+        size_t dependsOn = NoRename;
+        // Name the item has until the rest of its folder is renamed, empty if none
+        std::wstring tempName;
+        // Result of the rename to newName, or to tempName if there is one
+        PowerRenameFileResult result = { E_PENDING };
+        // Result of the rename from tempName to newName
+        PowerRenameFileResult tempResult = { E_PENDING };
+    };
+
+    struct Folder
+    {
+        // Ends with a path separator
+        std::wstring path;
+        // Number of path separators, deeper folders are renamed first
+        size_t depth = 0;
+        std::vector<size_t> renames;
+        // Renames in the order they have to be done
+        std::vector<size_t> order;
+    };
+
+    void _PlanFolder(_Inout_ Folder& folder);
+    // Queue the renames of the folders, in their order, the renames from their temporary
+    // name if moves is set
+    void _QueueRenames(_In_ const std::vector<size_t>& folders, _In_ bool moves);
+    // Path of a folder once the first commit renamed the folders containing it
+    std::wstring _RenamedFolderPath(_In_ const std::wstring& folderPath) const;
+    // Name like name that is free in its folder, taken by index.  Names taken are keys of
+    // targets.
+    std::wstring _TakeFreeName(_In_ const std::wstring& name, _In_ size_t index, _In_ const Folder& folder, _Inout_ std::unordered_map<std::wstring, size_t>& targets, _In_ const std::unordered_map<std::wstring, size_t>& originals);
+
+    CComPtr<IPowerRenameFileSystem> m_spFileSystem;
+    std::shared_ptr<CPowerRenameJournal> m_journal;
+    std::vector<Rename> m_renames;
+    std::vector<Folder> m_folders;
+    std::unordered_map<std::wstring, size_t> m_folderIndexes;
+    std::unordered_map<int, size_t> m_renameIndexes;
+    // Folded path of the item to its rename
+    std::unordered_map<std::wstring, size_t> m_pathIndexes;
+};
@@ -0,0 +1,260 @@
+#include "pch.h"
+#include "PowerRenameFileSystem.h"
+#include <sherrors.h>
+
+// The new names are free when the renames are planned, FOF_RENAMEONCOLLISION gives a free
+// name to the items whose name was taken since.  The name they got is reported.
+#define FOF_DEFAULTFLAGS (FOF_ALLOWUNDO | FOFX_ADDUNDORECORD | FOF_RENAMEONCOLLISION | FOFX_SHOWELEVATIONPROMPT)
+
+namespace
+{
+    // Progress sink of a single rename of an IFileOperation, sets the result of the rename
+    class CRenameResultSink :
+        public IFileOperationProgressSink
+    {
+    public:
+        CRenameResultSink(_In_ PowerRenameFileResult* result) :
+            m_refCount(1),
+            m_result(result)
+        {
+        }
+
+        // IUnknown
+        IFACEMETHODIMP QueryInterface(_In_ REFIID riid, _Outptr_ void** ppv)
+        {
+            static const QITAB qit[] = {
+                QITABENT(CRenameResultSink, IFileOperationProgressSink),
+                { 0 }
+            };
+            return QISearch(this, qit, riid, ppv);
+        }
+
+        IFACEMETHODIMP_(ULONG) AddRef()
+        {
+            return InterlockedIncrement(&m_refCount);
+        }
+
+        IFACEMETHODIMP_(ULONG) Release()
+        {
+            long refCount = InterlockedDecrement(&m_refCount);
+            if (refCount == 0)
+            {
+                delete this;
+            }
+            return refCount;
+        }
+
+        // IFileOperationProgressSink
+        IFACEMETHODIMP PostRenameItem(_In_ DWORD, _In_ IShellItem*, _In_opt_ PCWSTR pszNewName, _In_ HRESULT hrRename, _In_opt_ IShellItem* psiNewlyCreated)
+        {
+            // The other COPYENGINE_S_ codes succeed without the item being renamed, ex: when
+            // the user skips it
+            if (hrRename == COPYENGINE_S_COLLISIONRESOLVED)
+            {
+                hrRename = S_OK;
+            }
+            m_result->hr = (hrRename == S_OK || FAILED(hrRename)) ? hrRename : HRESULT_FROM_WIN32(ERROR_CANCELLED);
+
+            PWSTR renamedTo = nullptr;
+            if (m_result->hr == S_OK && psiNewlyCreated && SUCCEEDED(psiNewlyCreated->GetDisplayName(SIGDN_PARENTRELATIVEPARSING, &renamedTo)))
+            {
+                if (!pszNewName || wcscmp(renamedTo, pszNewName) != 0)
+                {
+                    StringCchCopy(m_result->renamedTo, ARRAYSIZE(m_result->renamedTo), renamedTo);
+                }
+                CoTaskMemFree(renamedTo);
+            }
+            return S_OK;
+        }
+
+        IFACEMETHODIMP StartOperations() { return S_OK; }
+        IFACEMETHODIMP FinishOperations(_In_ HRESULT) { return S_OK; }
+        IFACEMETHODIMP PreRenameItem(_In_ DWORD, _In_ IShellItem*, _In_opt_ PCWSTR) { return S_OK; }
+        IFACEMETHODIMP PreMoveItem(_In_ DWORD, _In_ IShellItem*, _In_ IShellItem*, _In_opt_ PCWSTR) { return S_OK; }
+        IFACEMETHODIMP PostMoveItem(_In_ DWORD, _In_ IShellItem*, _In_ IShellItem*, _In_opt_ PCWSTR, _In_ HRESULT, _In_opt_ IShellItem*) { return S_OK; }
+        IFACEMETHODIMP PreCopyItem(_In_ DWORD, _In_ IShellItem*, _In_ IShellItem*, _In_opt_ PCWSTR) { return S_OK; }
+        IFACEMETHODIMP PostCopyItem(_In_ DWORD, _In_ IShellItem*, _In_ IShellItem*, _In_opt_ PCWSTR, _In_ HRESULT, _In_opt_ IShellItem*) { return S_OK; }
+        IFACEMETHODIMP PreDeleteItem(_In_ DWORD, _In_ IShellItem*) { return S_OK; }
+        IFACEMETHODIMP PostDeleteItem(_In_ DWORD, _In_ IShellItem*, _In_ HRESULT, _In_opt_ IShellItem*) { return S_OK; }
+        IFACEMETHODIMP PreNewItem(_In_ DWORD, _In_ IShellItem*, _In_opt_ PCWSTR) { return S_OK; }
+        IFACEMETHODIMP PostNewItem(_In_ DWORD, _In_ IShellItem*, _In_opt_ PCWSTR, _In_opt_ PCWSTR, _In_ DWORD, _In_ HRESULT, _In_opt_ IShellItem*) { return S_OK; }
+        IFACEMETHODIMP UpdateProgress(_In_ UINT, _In_ UINT) { return S_OK; }
+        IFACEMETHODIMP ResetTimer() { return S_OK; }
+        IFACEMETHODIMP PauseTimer() { return S_OK; }
+        IFACEMETHODIMP ResumeTimer() { return S_OK; }
+
+    private:
+        ~CRenameResultSink()
+        {
+        }
+
+        long m_refCount;
+        PowerRenameFileResult* m_result;
+    };
+}
+
+IFACEMETHODIMP_(ULONG) CPowerRenameFileSystem::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+IFACEMETHODIMP_(ULONG) CPowerRenameFileSystem::Release()
+{
+    long refCount = InterlockedDecrement(&m_refCount);
+
+    if (refCount == 0)
+    {
+        delete this;
+    }
+    return refCount;
+}
+
+IFACEMETHODIMP CPowerRenameFileSystem::QueryInterface(_In_ REFIID riid, _Outptr_ void** ppv)
+{
+    static const QITAB qit[] = {
+        QITABENT(CPowerRenameFileSystem, IPowerRenameFileSystem),
+        { 0 }
+    };
+    return QISearch(this, qit, riid, ppv);
+}
+
+IFACEMETHODIMP CPowerRenameFileSystem::Exists(_In_ PCWSTR path, _Out_ bool* exists)
+{
+    *exists = GetFileAttributesW(path) != INVALID_FILE_ATTRIBUTES;
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameFileSystem::Rename(_In_ PCWSTR path, _In_ PCWSTR newName, _Out_ PowerRenameFileResult* result)
+{
+    std::wstring newPath(path, PathFindFileName(path) - path);
+    newPath += newName;
+
+    // Never replace an existing item
+    result->renamedTo[0] = L'\0';
+    result->hr = MoveFileExW(path, newPath.c_str(), 0) ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+    return result->hr;
+}
+
+IFACEMETHODIMP CPowerRenameFileSystem::Commit(_In_opt_ HWND)
+{
+    return S_OK;
+}
+
+HRESULT CPowerRenameFileSystem::s_CreateInstance(_In_ REFIID iid, _Outptr_ void** resultInterface)
+{
+    *resultInterface = nullptr;
+
+    CPowerRenameFileSystem* newFileSystem = new CPowerRenameFileSystem();
+    HRESULT hr = newFileSystem ? S_OK : E_OUTOFMEMORY;
+    if (SUCCEEDED(hr))
+    {
+        hr = newFileSystem->QueryInterface(iid, resultInterface);
+        newFileSystem->Release();
+    }
+    return hr;
+}
+
+CPowerRenameFileSystem::CPowerRenameFileSystem() :
+    m_refCount(1)
+{
+}
+
+CPowerRenameFileSystem::~CPowerRenameFileSystem()
+{
+}
+
+IFACEMETHODIMP CPowerRenameShellFileSystem::Rename(_In_ PCWSTR path, _In_ PCWSTR newName, _Out_ PowerRenameFileResult* result)
+{
+    // Not done until the operation reports it
+    result->hr = E_PENDING;
+    result->renamedTo[0] = L'\0';
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_queue.push_back({ path, newName, result });
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameShellFileSystem::Commit(_In_opt_ HWND hwndParent)
+{
+    std::vector<QueuedRename> queue;
+    // Scope lock
+    {
+        CSRWExclusiveAutoLock lock(&m_lock);
+        queue.swap(m_queue);
+    }
+
+    if (queue.empty())
+    {
+        return S_OK;
+    }
+
+    // Created on the calling thread since the operation belongs to its apartment
+    CComPtr<IFileOperation> spFileOp;
+    HRESULT hr = CoCreateInstance(CLSID_FileOperation, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&spFileOp));
+    if (SUCCEEDED(hr))
+    {
+        UINT queued = 0;
+        for (const auto& rename : queue)
+        {
+            CComPtr<IShellItem> spShellItem;
+            HRESULT hrRename = SHCreateItemFromParsingName(rename.path.c_str(), nullptr, IID_PPV_ARGS(&spShellItem));
+            if (SUCCEEDED(hrRename))
+            {
+                CComPtr<IFileOperationProgressSink> spSink;
+                spSink.Attach(new CRenameResultSink(rename.result));
+                hrRename = spFileOp->RenameItem(spShellItem, rename.newName.c_str(), spSink);
+            }
+
+            if (SUCCEEDED(hrRename))
+            {
+                queued++;
+            }
+            else
+            {
+                rename.result->hr = hrRename;
+            }
+        }
+
+        // Set the operation flags
+        hr = queued > 0 ? spFileOp->SetOperationFlags(FOF_DEFAULTFLAGS) : S_OK;
+        if (SUCCEEDED(hr) && queued > 0)
+        {
+            // Set the parent window
+            if (hwndParent)
+            {
+                spFileOp->SetOwnerWindow(hwndParent);
+            }
+
+            // Perform the operation.  The renames done before a failure or a cancel stay
+            // done and their results say so, the user can still undo them from Explorer.
+            hr = spFileOp->PerformOperations();
+            BOOL aborted = FALSE;
+            if (SUCCEEDED(hr) && SUCCEEDED(spFileOp->GetAnyOperationsAborted(&aborted)) && aborted)
+            {
+                hr = HRESULT_FROM_WIN32(ERROR_CANCELLED);
+            }
+        }
+    }
+    else
+    {
+        for (const auto& rename : queue)
+        {
+            rename.result->hr = hr;
+        }
+    }
+
+    return hr;
+}
+
+HRESULT CPowerRenameShellFileSystem::s_CreateInstance(_In_ REFIID iid, _Outptr_ void** resultInterface)
+{
+    *resultInterface = nullptr;
+
+    CPowerRenameShellFileSystem* newFileSystem = new CPowerRenameShellFileSystem();
+    HRESULT hr = newFileSystem ? S_OK : E_OUTOFMEMORY;
+    if (SUCCEEDED(hr))
+    {
+        hr = newFileSystem->QueryInterface(iid, resultInterface);
+        newFileSystem->Release();
+    }
+    return hr;
+}
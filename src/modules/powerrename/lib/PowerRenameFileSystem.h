@@ -0,0 +1,58 @@
+#pragma once
+#include "pch.h"
+#include "PowerRenameInterfaces.h"
+#include "srwlock.h"
+#include <string>
+#include <vector>
+
+// Renames items on disk as soon as Rename is called.  Can be called from several threads
+// at once.  Used to rename without the shell, ex: in benchmarks on a temporary folder.
+class CPowerRenameFileSystem :
+    public IPowerRenameFileSystem
+{
+public:
+    // IUnknown
+    IFACEMETHODIMP QueryInterface(_In_ REFIID iid, _Outptr_ void** resultInterface);
+    IFACEMETHODIMP_(ULONG) AddRef();
+    IFACEMETHODIMP_(ULONG) Release();
+
+    // IPowerRenameFileSystem
+    IFACEMETHODIMP Exists(_In_ PCWSTR path, _Out_ bool* exists);
+    IFACEMETHODIMP Rename(_In_ PCWSTR path, _In_ PCWSTR newName, _Out_ PowerRenameFileResult* result);
+    IFACEMETHODIMP Commit(_In_opt_ HWND hwndParent);
+
+    static HRESULT s_CreateInstance(_In_ REFIID iid, _Outptr_ void** resultInterface);
+
+protected:
+    CPowerRenameFileSystem();
+    virtual ~CPowerRenameFileSystem();
+
+    long m_refCount = 0;
+};
+
+// Queues the renames and performs them in a single IFileOperation on Commit, one after
+// the other in the order they were queued, so renames queued from several threads are
+// not done concurrently.  The shell shows progress and errors and the user can undo the
+// commit from Explorer.  The items are looked up when Commit starts so a queued rename
+// can't be of an item another queued rename gives its name to.
+class CPowerRenameShellFileSystem :
+    public CPowerRenameFileSystem
+{
+public:
+    // IPowerRenameFileSystem
+    IFACEMETHODIMP Rename(_In_ PCWSTR path, _In_ PCWSTR newName, _Out_ PowerRenameFileResult* result);
+    IFACEMETHODIMP Commit(_In_opt_ HWND hwndParent);
+
+    static HRESULT s_CreateInstance(_In_ REFIID iid, _Outptr_ void** resultInterface);
+
+protected:
+    struct QueuedRename
+    {
+        std::wstring path;
+        std::wstring newName;
+        PowerRenameFileResult* result = nullptr;
+    };
+
+    CSRWLock m_lock;
+    std::vector<QueuedRename> m_queue;
+};
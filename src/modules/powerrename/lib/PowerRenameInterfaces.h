@@ -49,6 +49,7 @@ public:
     IFACEMETHOD(PutFileTime)(_In_ SYSTEMTIME fileTime) = 0;
     IFACEMETHOD(ResetFileTime)() = 0;
     IFACEMETHOD(Replace)(_In_ PCWSTR source, _Outptr_ PWSTR* result) = 0;
+    IFACEMETHOD(ReplaceWithFileTime)(_In_ PCWSTR source, _In_ SYSTEMTIME fileTime, _Outptr_ PWSTR* result) = 0;
 };
 
 interface __declspec(uuid("C7F59201-4DE1-4855-A3A2-26FC3279C8A5")) IPowerRenameItem : public IUnknown
@@ -56,6 +57,8 @@ interface __declspec(uuid("C7F59201-4DE1-4855-A3A2-26FC3279C8A5")) IPowerRenameI
 public:
     IFACEMETHOD(GetPath)(_Outptr_ PWSTR* path) = 0;
     IFACEMETHOD(GetTime)(_Outptr_ SYSTEMTIME* time) = 0;
+    IFACEMETHOD(PutTime)(_In_ SYSTEMTIME time) = 0;
+    IFACEMETHOD(GetIsTimeParsed)(_Out_ bool* isTimeParsed) = 0;
     IFACEMETHOD(GetShellItem)(_Outptr_ IShellItem** ppsi) = 0;
     IFACEMETHOD(GetOriginalName)(_Outptr_ PWSTR* originalName) = 0;
     IFACEMETHOD(GetNewName)(_Outptr_ PWSTR* newName) = 0;
@@ -71,6 +74,13 @@ public:
     IFACEMETHOD(ShouldRenameItem)(_In_ DWORD flags, _Out_ bool* shouldRename) = 0;
     IFACEMETHOD(IsItemVisible)(_In_ DWORD filter, _In_ DWORD flags, _Out_ bool* isItemVisible) = 0;
     IFACEMETHOD(Reset)() = 0;
+    // In process callers can read the names without the copies made by GetPath and GetOriginalName.
+    // The views stay valid as long as the item.
+    IFACEMETHOD(GetPathView)(_Outptr_ PCWSTR* path) = 0;
+    IFACEMETHOD(GetOriginalNameView)(_Outptr_ PCWSTR* originalName) = 0;
+    // The new name changes while the regex runs so it is copied into a caller buffer, empty if there is none
+    IFACEMETHOD(CopyNewName)(_Out_writes_(cchMax) PWSTR newName, _In_ UINT cchMax) = 0;
+    IFACEMETHOD(IsNewNameEqual)(_In_opt_ PCWSTR newName, _Out_ bool* isEqual) = 0;
 };
 
 interface __declspec(uuid("{26CBFFD9-13B3-424E-BAC9-D12B0539149C}")) IPowerRenameItemFactory : public IUnknown
@@ -79,11 +89,44 @@ public:
     IFACEMETHOD(Create)(_In_ IShellItem* psi, _COM_Outptr_ IPowerRenameItem** ppItem) = 0;
 };
 
+interface __declspec(uuid("2B114D11-A997-4829-A0C0-5C80156C17C2")) IPowerRenameMetadataSource : public IUnknown
+{
+public:
+    IFACEMETHOD(GetCreationTimes)(_In_ PCWSTR folderPath, _In_reads_(count) PCWSTR* fileNames, _In_ UINT count, _Out_writes_(count) SYSTEMTIME* times, _Out_writes_(count) HRESULT* results) = 0;
+};
+
+// Result of a rename queued with IPowerRenameFileSystem::Rename
+struct PowerRenameFileResult
+{
+    // E_PENDING until the rename is done
+    HRESULT hr;
+    // Name the item got when the file system had to give it another name than the new
+    // one, ex: the shell on a collision the renames were not planned for.  Empty otherwise.
+    wchar_t renamedTo[MAX_PATH];
+};
+
+interface __declspec(uuid("EA35935B-A419-4698-A1F5-ABFAD90BBF8B")) IPowerRenameFileSystem : public IUnknown
+{
+public:
+    IFACEMETHOD(Exists)(_In_ PCWSTR path, _Out_ bool* exists) = 0;
+    // Rename the item at path within its folder.  Can be called from several threads at
+    // once and may only be done when Commit is called, so path has to exist before the
+    // renames queued since the last commit are done.  result is set once the rename is
+    // done, at the latest by Commit, and has to stay valid until then.
+    IFACEMETHOD(Rename)(_In_ PCWSTR path, _In_ PCWSTR newName, _Out_ PowerRenameFileResult* result) = 0;
+    // Do the queued renames.  Fails if they could not be done or were canceled, the
+    // results of the renames tell which ones were done.
+    IFACEMETHOD(Commit)(_In_opt_ HWND hwndParent) = 0;
+};
+
 interface __declspec(uuid("87FC43F9-7634-43D9-99A5-20876AFCE4AD")) IPowerRenameManagerEvents : public IUnknown
 {
 public:
-    IFACEMETHOD(OnItemAdded)(_In_ IPowerRenameItem* renameItem) = 0;
-    IFACEMETHOD(OnUpdate)(_In_ IPowerRenameItem* renameItem) = 0;
+    // Sent once per AddItem or AddItems call with the last item added and the number of
+    // items added by the call
+    IFACEMETHOD(OnItemAdded)(_In_ IPowerRenameItem* renameItem, _In_ UINT count) = 0;
+    // Items with an index from firstIndex to lastIndex may have a new name
+    IFACEMETHOD(OnUpdate)(_In_ UINT firstIndex, _In_ UINT lastIndex) = 0;
     IFACEMETHOD(OnError)(_In_ IPowerRenameItem* renameItem) = 0;
     IFACEMETHOD(OnRegExStarted)(_In_ DWORD threadId) = 0;
     IFACEMETHOD(OnRegExCanceled)(_In_ DWORD threadId) = 0;
@@ -103,14 +146,22 @@ public:
     IFACEMETHOD(Shutdown)() = 0;
     IFACEMETHOD(Rename)(_In_ HWND hwndParent) = 0;
     IFACEMETHOD(AddItem)(_In_ IPowerRenameItem* pItem) = 0;
+    IFACEMETHOD(AddItems)(_In_reads_(count) IPowerRenameItem** items, _In_ UINT count) = 0;
     IFACEMETHOD(GetItemByIndex)(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem) = 0;
     IFACEMETHOD(GetVisibleItemByIndex)(_In_ UINT index, _COM_Outptr_ IPowerRenameItem ** ppItem) = 0;
     IFACEMETHOD(SetVisible)() = 0;
     IFACEMETHOD(GetItemById)(_In_ int id, _COM_Outptr_ IPowerRenameItem** ppItem) = 0;
+    // Rows of the list to redraw after the items in [firstIndex, lastIndex] changed: the rows of those
+    // items, and every row from the first one that shows another item since the previous call.
+    // Returns S_FALSE if there is no row to redraw.
+    IFACEMETHOD(GetVisibleRowRange)(_In_ UINT firstIndex, _In_ UINT lastIndex, _Out_ UINT* firstRow, _Out_ UINT* lastRow) = 0;
+    IFACEMETHOD(PutPreviewRange)(_In_ UINT first, _In_ UINT last) = 0;
     IFACEMETHOD(GetItemCount)(_Out_ UINT* count) = 0;
     IFACEMETHOD(GetVisibleItemCount)(_Out_ UINT* count) = 0;
     IFACEMETHOD(GetSelectedItemCount)(_Out_ UINT* count) = 0;
     IFACEMETHOD(GetRenameItemCount)(_Out_ UINT* count) = 0;
+    // Select items through the manager so it can keep its counts up to date
+    IFACEMETHOD(PutItemSelected)(_In_ IPowerRenameItem* pItem, _In_ bool selected) = 0;
     IFACEMETHOD(GetFlags)(_Out_ DWORD* flags) = 0;
     IFACEMETHOD(PutFlags)(_In_ DWORD flags) = 0;
     IFACEMETHOD(GetFilter)(_Out_ DWORD * filter) = 0;
@@ -119,6 +170,13 @@ public:
     IFACEMETHOD(PutRenameRegEx)(_In_ IPowerRenameRegEx* pRegEx) = 0;
     IFACEMETHOD(GetRenameItemFactory)(_COM_Outptr_ IPowerRenameItemFactory** ppItemFactory) = 0;
     IFACEMETHOD(PutRenameItemFactory)(_In_ IPowerRenameItemFactory* pItemFactory) = 0;
+    IFACEMETHOD(GetMetadataSource)(_COM_Outptr_ IPowerRenameMetadataSource** ppMetadataSource) = 0;
+    IFACEMETHOD(PutMetadataSource)(_In_ IPowerRenameMetadataSource* pMetadataSource) = 0;
+    IFACEMETHOD(GetFileSystem)(_COM_Outptr_ IPowerRenameFileSystem** ppFileSystem) = 0;
+    IFACEMETHOD(PutFileSystem)(_In_ IPowerRenameFileSystem* pFileSystem) = 0;
+    // Rename the items of the last Rename back to their original names.  The dialog closes
+    // once the rename is done so it has no undo, this is for hosts that keep the manager.
+    IFACEMETHOD(UndoRename)() = 0;
 };
 
 interface __declspec(uuid("E6679DEB-460D-42C1-A7A8-E25897061C99")) IPowerRenameUI : public IUnknown
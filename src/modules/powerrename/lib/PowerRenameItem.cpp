@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "PowerRenameItem.h"
+#include "Helpers.h"
 #include <common/themes/icon_helpers.h>
 
 int CPowerRenameItem::s_id = 0;
@@ -46,7 +47,8 @@ IFACEMETHODIMP CPowerRenameItem::GetPath(_Outptr_ PWSTR* path)
 
 IFACEMETHODIMP CPowerRenameItem::GetTime(_Outptr_ SYSTEMTIME* time)
 {
-    CSRWSharedAutoLock lock(&m_lock);
+    // Usually prefetched with the other items of the folder, see IPowerRenameMetadataSource
+    CSRWExclusiveAutoLock lock(&m_lock);
     HRESULT hr = E_FAIL ;
 
     if (m_isTimeParsed)
@@ -61,15 +63,12 @@ IFACEMETHODIMP CPowerRenameItem::GetTime(_Outptr_ SYSTEMTIME* time)
             FILETIME CreationTime;
             if (GetFileTime(hFile, &CreationTime, NULL, NULL))
             {
-                SYSTEMTIME SystemTime, LocalTime;
-                if (FileTimeToSystemTime(&CreationTime, &SystemTime))
+                SYSTEMTIME LocalTime;
+                if (SUCCEEDED(GetLocalFileTime(CreationTime, &LocalTime)))
                 {
-                    if (SystemTimeToTzSpecificLocalTime(NULL, &SystemTime, &LocalTime))
-                    {
-                        m_time = LocalTime;
-                        m_isTimeParsed = true;
-                        hr = S_OK;
-                    }
+                    m_time = LocalTime;
+                    m_isTimeParsed = true;
+                    hr = S_OK;
                 }
             }
         }
@@ -79,6 +78,21 @@ IFACEMETHODIMP CPowerRenameItem::GetTime(_Outptr_ SYSTEMTIME* time)
     return hr;
 }
 
+IFACEMETHODIMP CPowerRenameItem::PutTime(_In_ SYSTEMTIME time)
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_time = time;
+    m_isTimeParsed = true;
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameItem::GetIsTimeParsed(_Out_ bool* isTimeParsed)
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    *isTimeParsed = m_isTimeParsed;
+    return S_OK;
+}
+
 IFACEMETHODIMP CPowerRenameItem::GetShellItem(_Outptr_ IShellItem** ppsi)
 {
     return SHCreateItemFromParsingName(m_path, nullptr, IID_PPV_ARGS(ppsi));
@@ -97,13 +111,21 @@ IFACEMETHODIMP CPowerRenameItem::GetOriginalName(_Outptr_ PWSTR* originalName)
 
 IFACEMETHODIMP CPowerRenameItem::PutNewName(_In_opt_ PCWSTR newName)
 {
-    CSRWSharedAutoLock lock(&m_lock);
-    CoTaskMemFree(m_newName);
-    m_newName = nullptr;
+    CSRWExclusiveAutoLock lock(&m_lock);
     HRESULT hr = S_OK;
+    m_hasNewName = false;
+    m_newName.clear();
     if (newName != nullptr)
     {
-        hr = SHStrDup(newName, &m_newName);
+        try
+        {
+            m_newName.assign(newName);
+            m_hasNewName = true;
+        }
+        catch (const std::bad_alloc&)
+        {
+            hr = E_OUTOFMEMORY;
+        }
     }
     return hr;
 }
@@ -112,9 +134,9 @@ IFACEMETHODIMP CPowerRenameItem::GetNewName(_Outptr_ PWSTR* newName)
 {
     CSRWSharedAutoLock lock(&m_lock);
     HRESULT hr = S_OK;
-    if (m_newName)
+    if (m_hasNewName)
     {
-        hr = SHStrDup(m_newName, newName);
+        hr = SHStrDup(m_newName.c_str(), newName);
     }
     return hr;
 }
@@ -180,7 +202,7 @@ IFACEMETHODIMP CPowerRenameItem::ShouldRenameItem(_In_ DWORD flags, _Out_ bool*
 {
     // Should we perform a rename on this item given its
     // state and the options that were set?
-    bool hasChanged = m_newName != nullptr && (lstrcmp(m_originalName, m_newName) != 0);
+    bool hasChanged = m_hasNewName && (lstrcmp(m_originalName, m_newName.c_str()) != 0);
     bool excludeBecauseFolder = (m_isFolder && (flags & PowerRenameFlags::ExcludeFolders));
     bool excludeBecauseFile = (!m_isFolder && (flags & PowerRenameFlags::ExcludeFiles));
     bool excludeBecauseSubFolderContent = (m_depth > 0 && (flags & PowerRenameFlags::ExcludeSubfolders));
@@ -212,14 +234,56 @@ IFACEMETHODIMP CPowerRenameItem::IsItemVisible(_In_ DWORD filter, _In_ DWORD fla
 }
 
 IFACEMETHODIMP CPowerRenameItem::Reset()
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_hasNewName = false;
+    m_newName.clear();
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameItem::GetPathView(_Outptr_ PCWSTR* path)
+{
+    // The path never changes once the item is created so it needs no lock
+    *path = m_path;
+    return m_path ? S_OK : E_FAIL;
+}
+
+IFACEMETHODIMP CPowerRenameItem::GetOriginalNameView(_Outptr_ PCWSTR* originalName)
+{
+    *originalName = m_originalName;
+    return m_originalName ? S_OK : E_FAIL;
+}
+
+IFACEMETHODIMP CPowerRenameItem::CopyNewName(_Out_writes_(cchMax) PWSTR newName, _In_ UINT cchMax)
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    return StringCchCopy(newName, cchMax, m_newName.c_str());
+}
+
+IFACEMETHODIMP CPowerRenameItem::IsNewNameEqual(_In_opt_ PCWSTR newName, _Out_ bool* isEqual)
 {
     CSRWSharedAutoLock lock(&m_lock);
-    CoTaskMemFree(m_newName);
-    m_newName = nullptr;
+    *isEqual = m_hasNewName ? (newName != nullptr && m_newName.compare(newName) == 0) : newName == nullptr;
     return S_OK;
 }
 
+IFACEMETHODIMP CPowerRenameItem::Create(_In_ IShellItem* psi, _Outptr_ IPowerRenameItem** ppItem)
+{
+    return _CreateInstance(psi, m_arena, IID_PPV_ARGS(ppItem));
+}
+
 HRESULT CPowerRenameItem::s_CreateInstance(_In_opt_ IShellItem* psi, _In_ REFIID iid, _Outptr_ void** resultInterface)
+{
+    std::shared_ptr<CPowerRenameStringArena> arena;
+    if (psi == nullptr)
+    {
+        // The factory of a rename session
+        arena = std::make_shared<CPowerRenameStringArena>();
+    }
+    return _CreateInstance(psi, arena, iid, resultInterface);
+}
+
+HRESULT CPowerRenameItem::_CreateInstance(_In_opt_ IShellItem* psi, _In_ const std::shared_ptr<CPowerRenameStringArena>& arena, _In_ REFIID iid, _Outptr_ void** resultInterface)
 {
     *resultInterface = nullptr;
 
@@ -228,6 +292,7 @@ HRESULT CPowerRenameItem::s_CreateInstance(_In_opt_ IShellItem* psi, _In_ REFIID
     if (newRenameItem)
     {
         hr = S_OK ;
+        newRenameItem->m_arena = arena;
         if (psi != nullptr)
         {
             hr = newRenameItem->_Init(psi);
@@ -251,20 +316,22 @@ CPowerRenameItem::CPowerRenameItem() :
 
 CPowerRenameItem::~CPowerRenameItem()
 {
-    CoTaskMemFree(m_path);
-    CoTaskMemFree(m_newName);
-    CoTaskMemFree(m_originalName);
 }
 
 HRESULT CPowerRenameItem::_Init(_In_ IShellItem* psi)
 {
     // Get the full filesystem path from the shell item
-    HRESULT hr = psi->GetDisplayName(SIGDN_FILESYSPATH, &m_path);
+    PWSTR path = nullptr;
+    HRESULT hr = psi->GetDisplayName(SIGDN_FILESYSPATH, &path);
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDup(PathFindFileName(m_path), &m_originalName);
+        hr = _PutNames(path, nullptr);
+        CoTaskMemFree(path);
         if (SUCCEEDED(hr))
         {
+            // The original name is the end of the path and needs no copy
+            m_originalName = PathFindFileName(m_path);
+
             // Check if we are a folder now so we can check this attribute quickly later
             // Also check if the shell allows us to rename the item.
             SFGAOF att = 0;
@@ -282,3 +349,27 @@ HRESULT CPowerRenameItem::_Init(_In_ IShellItem* psi)
 
     return hr;
 }
+
+HRESULT CPowerRenameItem::_PutNames(_In_opt_ PCWSTR path, _In_opt_ PCWSTR originalName)
+{
+    if (!m_arena)
+    {
+        // Only this item uses the arena so it allocates no more than the names need
+        m_arena = std::make_shared<CPowerRenameStringArena>(0);
+    }
+
+    HRESULT hr = S_OK;
+    if (path != nullptr)
+    {
+        m_path = m_arena->Store(path);
+        hr = m_path ? S_OK : E_OUTOFMEMORY;
+    }
+
+    if (SUCCEEDED(hr) && originalName != nullptr)
+    {
+        m_originalName = m_arena->Store(originalName);
+        hr = m_originalName ? S_OK : E_OUTOFMEMORY;
+    }
+
+    return hr;
+}
@@ -2,6 +2,9 @@
 #include "pch.h"
 #include "PowerRenameInterfaces.h"
 #include "srwlock.h"
+#include "PowerRenameStringArena.h"
+#include <memory>
+#include <string>
 
 class CPowerRenameItem :
     public IPowerRenameItem,
@@ -16,6 +19,8 @@ public:
     // IPowerRenameItem
     IFACEMETHODIMP GetPath(_Outptr_ PWSTR* path);
     IFACEMETHODIMP GetTime(_Outptr_ SYSTEMTIME* time);
+    IFACEMETHODIMP PutTime(_In_ SYSTEMTIME time);
+    IFACEMETHODIMP GetIsTimeParsed(_Out_ bool* isTimeParsed);
     IFACEMETHODIMP GetShellItem(_Outptr_ IShellItem** ppsi);
     IFACEMETHODIMP GetOriginalName(_Outptr_ PWSTR* originalName);
     IFACEMETHODIMP PutNewName(_In_opt_ PCWSTR newName);
@@ -31,14 +36,17 @@ public:
     IFACEMETHODIMP Reset();
     IFACEMETHODIMP ShouldRenameItem(_In_ DWORD flags, _Out_ bool* shouldRename);
     IFACEMETHODIMP IsItemVisible(_In_ DWORD filter, _In_ DWORD flags, _Out_ bool* isItemVisible);
+    IFACEMETHODIMP GetPathView(_Outptr_ PCWSTR* path);
+    IFACEMETHODIMP GetOriginalNameView(_Outptr_ PCWSTR* originalName);
+    IFACEMETHODIMP CopyNewName(_Out_writes_(cchMax) PWSTR newName, _In_ UINT cchMax);
+    IFACEMETHODIMP IsNewNameEqual(_In_opt_ PCWSTR newName, _Out_ bool* isEqual);
 
     // IPowerRenameItemFactory
-    IFACEMETHODIMP Create(_In_ IShellItem* psi, _Outptr_ IPowerRenameItem** ppItem)
-    {
-        return CPowerRenameItem::s_CreateInstance(psi, IID_PPV_ARGS(ppItem));
-    }
+    // Items created by a factory share its string arena
+    IFACEMETHODIMP Create(_In_ IShellItem* psi, _Outptr_ IPowerRenameItem** ppItem);
 
 public:
+    // Without a shell item the instance is a factory with a new string arena for its items
     static HRESULT s_CreateInstance(_In_opt_ IShellItem* psi, _In_ REFIID iid, _Outptr_ void** resultInterface);
 
 protected:
@@ -46,19 +54,26 @@ protected:
     CPowerRenameItem();
     virtual ~CPowerRenameItem();
 
+    static HRESULT _CreateInstance(_In_opt_ IShellItem* psi, _In_ const std::shared_ptr<CPowerRenameStringArena>& arena, _In_ REFIID iid, _Outptr_ void** resultInterface);
     HRESULT _Init(_In_ IShellItem* psi);
+    // Store the names in the arena of the item, a private one if the item has none
+    HRESULT _PutNames(_In_opt_ PCWSTR path, _In_opt_ PCWSTR originalName);
 
     bool        m_selected = true;
     bool        m_isFolder = false;
     bool        m_isTimeParsed = false;
     bool        m_canRename = true;
+    bool        m_hasNewName = false;
     int         m_id = -1;
     int         m_iconIndex = -1;
     UINT        m_depth = 0;
     HRESULT     m_error = S_OK;
-    PWSTR       m_path = nullptr;
-    PWSTR       m_originalName = nullptr;
-    PWSTR       m_newName = nullptr;
+    // Names stored in m_arena
+    PCWSTR      m_path = nullptr;
+    PCWSTR      m_originalName = nullptr;
+    // Reuses its buffer when the regex gives the item another new name
+    std::wstring m_newName;
+    std::shared_ptr<CPowerRenameStringArena> m_arena;
     SYSTEMTIME  m_time = {0};
     CSRWLock    m_lock;
     long        m_refCount = 0;
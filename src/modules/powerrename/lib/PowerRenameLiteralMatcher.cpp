@@ -0,0 +1,62 @@
+#include "pch.h"
+#include "PowerRenameLiteralMatcher.h"
+
+CPowerRenameLiteralMatcher::CPowerRenameLiteralMatcher(_In_ PCWSTR searchTerm, _In_ bool caseSensitive) :
+    m_searchTerm(searchTerm ? searchTerm : L""),
+    m_caseSensitive(caseSensitive)
+{
+    if (!m_caseSensitive)
+    {
+        for (auto& c : m_searchTerm)
+        {
+            c = s_FoldCase(c);
+        }
+    }
+
+    const size_t length = m_searchTerm.length();
+    m_shifts.fill(length);
+    for (size_t i = 0; i + 1 < length; i++)
+    {
+        m_shifts[m_searchTerm[i] & 0xFF] = length - 1 - i;
+    }
+}
+
+size_t CPowerRenameLiteralMatcher::Find(_In_reads_(length) PCWSTR text, _In_ size_t length, _In_ size_t pos) const
+{
+    const size_t termLength = m_searchTerm.length();
+    if (termLength == 0 || pos > length || length - pos < termLength)
+    {
+        return std::wstring::npos;
+    }
+
+    const size_t last = termLength - 1;
+    const wchar_t lastChar = m_searchTerm[last];
+    const PCWSTR term = m_searchTerm.c_str();
+
+    for (size_t start = pos; start + last < length;)
+    {
+        const wchar_t c = _Fold(text[start + last]);
+        if (c == lastChar)
+        {
+            size_t i = 0;
+            while (i < last && _Fold(text[start + i]) == term[i])
+            {
+                i++;
+            }
+
+            if (i == last)
+            {
+                return start;
+            }
+        }
+
+        start += m_shifts[c & 0xFF];
+    }
+
+    return std::wstring::npos;
+}
+
+bool CPowerRenameLiteralMatcher::Contains(_In_ PCWSTR text) const
+{
+    return text && Find(text, wcslen(text), 0) != std::wstring::npos;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "pch.h"
+#include "PowerRenameCaseTransform.h"
+#include <array>
+#include <string>
+
+// Finds a literal search term in names without copying or case folding them up front.
+// The term is folded once when the matcher is built and the names are folded a character
+// at a time while they are scanned, skipping ahead with a Horspool shift table.
+// A matcher is immutable once built so it can be shared by any number of threads.
+class CPowerRenameLiteralMatcher
+{
+public:
+    CPowerRenameLiteralMatcher(_In_ PCWSTR searchTerm, _In_ bool caseSensitive);
+
+    // Position of the first occurrence of the search term in text at or after pos.
+    // std::wstring::npos if there is none or the search term is empty.
+    size_t Find(_In_reads_(length) PCWSTR text, _In_ size_t length, _In_ size_t pos) const;
+    bool Contains(_In_ PCWSTR text) const;
+
+    size_t GetLength() const { return m_searchTerm.length(); }
+
+    // Case folding used by the case insensitive literal search.  Characters outside ASCII
+    // are folded with the user default locale tables of the case transforms.
+    static wchar_t s_FoldCase(_In_ wchar_t c)
+    {
+        if (c < 0x80)
+        {
+            return (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c + (L'a' - L'A')) : c;
+        }
+
+        return CPowerRenameCaseTransform::s_ToLower(c);
+    }
+
+protected:
+    wchar_t _Fold(_In_ wchar_t c) const { return m_caseSensitive ? c : s_FoldCase(c); }
+
+    // Folded unless the search is case sensitive
+    std::wstring m_searchTerm;
+    bool m_caseSensitive = false;
+    // Shift of the search window by the low byte of its last character.  Characters
+    // sharing a low byte share the smallest shift so no occurrence can be skipped.
+    std::array<size_t, 256> m_shifts{};
+};
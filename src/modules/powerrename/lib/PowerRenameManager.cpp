@@ -5,17 +5,18 @@
 #include <shlobj.h>
 #include <cstring>
 #include "helpers.h"
-#include <filesystem>
+#include "ParallelFor.h"
+#include "PowerRenamePreviewCache.h"
+#include "PowerRenameMetadataSource.h"
+#include "PowerRenameLiteralMatcher.h"
+#include "PowerRenameCaseTransform.h"
+#include "PowerRenameFileSystem.h"
+#include <optional>
 #include "trace.h"
 #include <winrt/base.h>
 
-namespace fs = std::filesystem;
-
 extern HINSTANCE g_hInst;
 
-// The default FOF flags to use in the rename operations
-#define FOF_DEFAULTFLAGS (FOF_ALLOWUNDO | FOFX_ADDUNDORECORD | FOFX_SHOWELEVATIONPROMPT | FOF_RENAMEONCOLLISION)
-
 IFACEMETHODIMP_(ULONG)
 CPowerRenameManager::AddRef()
 {
@@ -118,73 +119,117 @@ IFACEMETHODIMP CPowerRenameManager::AddItem(_In_ IPowerRenameItem* pItem)
     // Scope lock
     {
         CSRWExclusiveAutoLock lock(&m_lockItems);
-        int id = 0;
-        pItem->GetId(&id);
-        // Verify the item isn't already added
-        if (m_renameItems.find(id) == m_renameItems.end())
-        {
-            m_renameItems[id] = pItem;
-            m_isVisible.push_back(true);
-            pItem->AddRef();
-            hr = S_OK;
-        }
+        hr = _AddItem(pItem);
     }
 
     if (SUCCEEDED(hr))
     {
-        _OnItemAdded(pItem);
+        _OnItemAdded(pItem, 1);
     }
 
     return hr;
 }
 
-IFACEMETHODIMP CPowerRenameManager::GetItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem)
+IFACEMETHODIMP CPowerRenameManager::AddItems(_In_reads_(count) IPowerRenameItem** items, _In_ UINT count)
 {
-    *ppItem = nullptr;
-    CSRWSharedAutoLock lock(&m_lockItems);
-    HRESULT hr = E_FAIL;
-    if (index < m_renameItems.size())
+    HRESULT hr = S_OK;
+    IPowerRenameItem* lastAdded = nullptr;
+    UINT added = 0;
+    // Scope lock
     {
-        std::map<int, IPowerRenameItem*>::iterator it = m_renameItems.begin();
-        std::advance(it, index);
-        *ppItem = it->second;
-        (*ppItem)->AddRef();
-        hr = S_OK;
+        CSRWExclusiveAutoLock lock(&m_lockItems);
+        for (UINT i = 0; i < count; i++)
+        {
+            if (SUCCEEDED(_AddItem(items[i])))
+            {
+                lastAdded = items[i];
+                added++;
+            }
+            else
+            {
+                hr = E_FAIL;
+            }
+        }
+    }
+
+    // A single notification for the whole batch
+    if (lastAdded)
+    {
+        _OnItemAdded(lastAdded, added);
     }
 
     return hr;
 }
 
+IFACEMETHODIMP CPowerRenameManager::GetItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem)
+{
+    CSRWSharedAutoLock lock(&m_lockItems);
+    return _GetItemByIndex(index, ppItem);
+}
+
 IFACEMETHODIMP CPowerRenameManager::GetVisibleItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem)
 {
     *ppItem = nullptr;
-    CSRWSharedAutoLock lock(&m_lockItems);
-    UINT count = 0;
-    HRESULT hr = E_FAIL;
+    // Scope lock
+    {
+        CSRWSharedAutoLock lock(&m_lockItems);
+        if (m_filter == PowerRenameFilters::None)
+        {
+            return _GetItemByIndex(index, ppItem);
+        }
+
+        if (m_visibleValid)
+        {
+            return (index < m_visibleItemIndexes.size()) ? _GetItemByIndex(m_visibleItemIndexes[index], ppItem) : E_FAIL;
+        }
+    }
+
+    // The visible items changed since they were last built
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    _EnsureVisible();
+    return (index < m_visibleItemIndexes.size()) ? _GetItemByIndex(m_visibleItemIndexes[index], ppItem) : E_FAIL;
+}
 
+IFACEMETHODIMP CPowerRenameManager::GetVisibleRowRange(_In_ UINT firstIndex, _In_ UINT lastIndex, _Out_ UINT* firstRow, _Out_ UINT* lastRow)
+{
+    *firstRow = 0;
+    *lastRow = 0;
+    CSRWExclusiveAutoLock lock(&m_lockItems);
     if (m_filter == PowerRenameFilters::None)
     {
-        hr = GetItemByIndex(index, ppItem);
+        *firstRow = firstIndex;
+        *lastRow = lastIndex;
+        return (firstIndex <= lastIndex) ? S_OK : S_FALSE;
     }
-    else if (SUCCEEDED(GetVisibleItemCount(&count)) && index < count)
+
+    _EnsureVisible();
+    auto first = std::lower_bound(m_visibleItemIndexes.begin(), m_visibleItemIndexes.end(), firstIndex);
+    auto last = std::upper_bound(first, m_visibleItemIndexes.end(), lastIndex);
+    UINT rowCount = static_cast<UINT>(m_visibleItemIndexes.size());
+    UINT changedFirst = static_cast<UINT>(first - m_visibleItemIndexes.begin());
+    UINT changedLast = (last != first) ? static_cast<UINT>(last - m_visibleItemIndexes.begin()) - 1 : 0;
+    bool changed = (last != first);
+
+    // Rows after a row that was shown or hidden hold other items now
+    if (m_visibleChangedRow < rowCount)
     {
-        UINT realIndex = 0, visibleIndex = 0;
-        for (size_t i = 0; i < m_isVisible.size(); i++)
-        {
-            if (m_isVisible[i] && visibleIndex == index)
-            {
-                realIndex = static_cast<UINT>(i);
-                break;
-            }
-            if (m_isVisible[i])
-            {
-                visibleIndex++;
-            }
-        }
-        hr = GetItemByIndex(realIndex, ppItem);
+        changedFirst = changed ? min(changedFirst, m_visibleChangedRow) : m_visibleChangedRow;
+        changedLast = rowCount - 1;
+        changed = true;
     }
+    m_visibleChangedRow = UINT_MAX;
 
-    return hr;
+    *firstRow = changedFirst;
+    *lastRow = changedLast;
+    return changed ? S_OK : S_FALSE;
+}
+
+IFACEMETHODIMP CPowerRenameManager::PutPreviewRange(_In_ UINT first, _In_ UINT last)
+{
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    m_previewFirst = first;
+    m_previewCount = (last >= first) ? last - first + 1 : 0;
+    return S_OK;
 }
 
 IFACEMETHODIMP CPowerRenameManager::GetItemById(_In_ int id, _COM_Outptr_ IPowerRenameItem** ppItem)
@@ -193,13 +238,10 @@ IFACEMETHODIMP CPowerRenameManager::GetItemById(_In_ int id, _COM_Outptr_ IPower
 
     CSRWSharedAutoLock lock(&m_lockItems);
     HRESULT hr = E_FAIL;
-    std::map<int, IPowerRenameItem*>::iterator it;
-    it = m_renameItems.find(id);
-    if (it != m_renameItems.end())
+    auto it = m_renameItemIndexes.find(id);
+    if (it != m_renameItemIndexes.end())
     {
-        *ppItem = m_renameItems[id];
-        (*ppItem)->AddRef();
-        hr = S_OK;
+        hr = _GetItemByIndex(it->second, ppItem);
     }
 
     return hr;
@@ -214,104 +256,84 @@ IFACEMETHODIMP CPowerRenameManager::GetItemCount(_Out_ UINT* count)
 
 IFACEMETHODIMP CPowerRenameManager::SetVisible()
 {
-    CSRWSharedAutoLock lock(&m_lockItems);
-    HRESULT hr = E_FAIL;
-    UINT lastVisibleDepth = 0;
-    size_t i = m_isVisible.size() - 1;
-    PWSTR searchTerm = nullptr;
-    for (auto rit = m_renameItems.rbegin(); rit != m_renameItems.rend(); ++rit, --i)
-    {
-        bool isVisible = false;
-        if (m_filter == PowerRenameFilters::ShouldRename &&
-            (FAILED(m_spRegEx->GetSearchTerm(&searchTerm)) || searchTerm && wcslen(searchTerm) == 0))
-        {
-            isVisible = true;
-        }
-        else
-        {
-            rit->second->IsItemVisible(m_filter, m_flags, &isVisible);
-        }
-
-        UINT itemDepth = 0;
-        rit->second->GetDepth(&itemDepth);
-
-        //Make an item visible if it has a least one visible subitem
-        if (isVisible)
-        {
-            lastVisibleDepth = itemDepth;
-        }
-        else if (lastVisibleDepth == itemDepth + 1)
-        {
-            isVisible = true;
-            lastVisibleDepth = itemDepth;
-        }
-
-        m_isVisible[i] = isVisible;
-        hr = S_OK;
-    }
-
-    return hr;
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    _SetVisible();
+    m_visibleValid = true;
+    return m_renameItems.empty() ? E_FAIL : S_OK;
 }
 
 IFACEMETHODIMP CPowerRenameManager::GetVisibleItemCount(_Out_ UINT* count)
 {
     *count = 0;
-    CSRWSharedAutoLock lock(&m_lockItems);
-
-    if (m_filter != PowerRenameFilters::None)
+    // Scope lock
     {
-        SetVisible();
+        CSRWSharedAutoLock lock(&m_lockItems);
+        if (m_filter == PowerRenameFilters::None)
+        {
+            *count = static_cast<UINT>(m_renameItems.size());
+            return S_OK;
+        }
 
-        for (size_t i = 0; i < m_isVisible.size(); i++)
+        if (m_visibleValid)
         {
-            if (m_isVisible[i])
-            {
-                (*count)++;
-            }
+            *count = static_cast<UINT>(m_visibleItemIndexes.size());
+            return S_OK;
         }
     }
-    else
-    {
-        GetItemCount(count);
-    }
 
+    // The visible items changed since they were last built
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    _EnsureVisible();
+    *count = static_cast<UINT>(m_visibleItemIndexes.size());
     return S_OK;
 }
 
 IFACEMETHODIMP CPowerRenameManager::GetSelectedItemCount(_Out_ UINT* count)
 {
-    *count = 0;
-    CSRWSharedAutoLock lock(&m_lockItems);
-
-    for (auto it : m_renameItems)
-    {
-        IPowerRenameItem* pItem = it.second;
-        bool selected = false;
-        if (SUCCEEDED(pItem->GetSelected(&selected)) && selected)
-        {
-            (*count)++;
-        }
-    }
-
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    _EnsureCounts();
+    *count = m_selectedCount;
     return S_OK;
 }
 
 IFACEMETHODIMP CPowerRenameManager::GetRenameItemCount(_Out_ UINT* count)
 {
-    *count = 0;
-    CSRWSharedAutoLock lock(&m_lockItems);
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    _EnsureCounts();
+    *count = m_renameCount;
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameManager::PutItemSelected(_In_ IPowerRenameItem* pItem, _In_ bool selected)
+{
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    // The regex worker may be giving the item a new name
+    CSRWExclusiveAutoLock itemLock(m_updates->GetItemLock());
+
+    bool wasSelected = false;
+    bool shouldRenameBefore = false;
+    pItem->GetSelected(&wasSelected);
+    pItem->ShouldRenameItem(m_flags, &shouldRenameBefore);
+
+    HRESULT hr = pItem->PutSelected(selected);
+
+    bool shouldRenameAfter = false;
+    pItem->ShouldRenameItem(m_flags, &shouldRenameAfter);
 
-    for (auto it : m_renameItems)
+    int id = 0;
+    pItem->GetId(&id);
+    if (m_countsValid && m_renameItemIndexes.find(id) != m_renameItemIndexes.end())
     {
-        IPowerRenameItem* pItem = it.second;
-        bool shouldRename = false;
-        if (SUCCEEDED(pItem->ShouldRenameItem(m_flags, &shouldRename)) && shouldRename)
-        {
-            (*count)++;
-        }
+        m_selectedCount = m_selectedCount + (selected ? 1 : 0) - (wasSelected ? 1 : 0);
+        m_renameCount = m_renameCount + (shouldRenameAfter ? 1 : 0) - (shouldRenameBefore ? 1 : 0);
     }
 
-    return S_OK;
+    if (selected != wasSelected)
+    {
+        m_visibleValid = false;
+    }
+
+    return hr;
 }
 
 IFACEMETHODIMP CPowerRenameManager::GetFlags(_Out_ DWORD* flags)
@@ -326,6 +348,8 @@ IFACEMETHODIMP CPowerRenameManager::PutFlags(_In_ DWORD flags)
     if (flags != m_flags)
     {
         m_flags = flags;
+        _InvalidateCounts();
+        _InvalidateVisible();
         _EnsureRegEx();
         m_spRegEx->PutFlags(flags);
     }
@@ -340,6 +364,8 @@ IFACEMETHODIMP CPowerRenameManager::GetFilter(_Out_ DWORD* filter)
 
 IFACEMETHODIMP CPowerRenameManager::SwitchFilter(_In_ int columnNumber)
 {
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    m_visibleValid = false;
     switch (m_filter)
     {
     case PowerRenameFilters::None:
@@ -397,8 +423,58 @@ IFACEMETHODIMP CPowerRenameManager::PutRenameItemFactory(_In_ IPowerRenameItemFa
     return S_OK;
 }
 
+IFACEMETHODIMP CPowerRenameManager::GetMetadataSource(_COM_Outptr_ IPowerRenameMetadataSource** ppMetadataSource)
+{
+    *ppMetadataSource = nullptr;
+    HRESULT hr = E_FAIL;
+    if (m_spMetadataSource)
+    {
+        hr = S_OK;
+        *ppMetadataSource = m_spMetadataSource;
+        (*ppMetadataSource)->AddRef();
+    }
+    return hr;
+}
+
+IFACEMETHODIMP CPowerRenameManager::PutMetadataSource(_In_ IPowerRenameMetadataSource* pMetadataSource)
+{
+    m_spMetadataSource = pMetadataSource;
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameManager::GetFileSystem(_COM_Outptr_ IPowerRenameFileSystem** ppFileSystem)
+{
+    *ppFileSystem = nullptr;
+    HRESULT hr = E_FAIL;
+    if (m_spFileSystem)
+    {
+        hr = S_OK;
+        *ppFileSystem = m_spFileSystem;
+        (*ppFileSystem)->AddRef();
+    }
+    return hr;
+}
+
+IFACEMETHODIMP CPowerRenameManager::PutFileSystem(_In_ IPowerRenameFileSystem* pFileSystem)
+{
+    m_spFileSystem = pFileSystem;
+    return S_OK;
+}
+
+IFACEMETHODIMP CPowerRenameManager::UndoRename()
+{
+    if (!m_spFileSystem || !m_journal || m_journal->IsEmpty())
+    {
+        return E_FAIL;
+    }
+
+    return m_journal->Undo(m_spFileSystem, m_hwndParent);
+}
+
 IFACEMETHODIMP CPowerRenameManager::OnSearchTermChanged(_In_ PCWSTR /*searchTerm*/)
 {
+    // All the items are shown by the ShouldRename filter while the search term is empty
+    _InvalidateVisible();
     _PerformRegExRename();
     return S_OK;
 }
@@ -413,6 +489,8 @@ IFACEMETHODIMP CPowerRenameManager::OnFlagsChanged(_In_ DWORD flags)
 {
     // Flags were updated in the rename regex.  Update our preview.
     m_flags = flags;
+    _InvalidateCounts();
+    _InvalidateVisible();
     _PerformRegExRename();
     return S_OK;
 }
@@ -460,16 +538,28 @@ HRESULT CPowerRenameManager::_Init()
 
     m_hwndMessage = CreateMsgWindow(g_hInst, s_msgWndProc, this);
 
+    m_previewCache = std::make_shared<CPowerRenamePreviewCache>();
+    m_updates = std::make_shared<CPowerRenameUpdateQueue>();
+
+    // Creation times come from the file system unless a metadata source is put
+    CPowerRenameMetadataSource::s_CreateInstance(IID_PPV_ARGS(&m_spMetadataSource));
+
+    // Renames go through the shell, so they can be undone from Explorer, unless a file
+    // system is put
+    CPowerRenameShellFileSystem::s_CreateInstance(IID_PPV_ARGS(&m_spFileSystem));
+    m_journal = std::make_shared<CPowerRenameJournal>();
+
     return S_OK;
 }
 
 // Custom messages for worker threads
 enum
 {
-    SRM_REGEX_ITEM_UPDATED = (WM_APP + 1), // Single rename item processed by regex worker thread
+    SRM_REGEX_ITEM_UPDATED = (WM_APP + 1), // Rename items processed by regex worker thread, see CPowerRenameUpdateQueue
     SRM_REGEX_STARTED, // RegEx operation was started
     SRM_REGEX_CANCELED, // Regex operation was canceled
     SRM_REGEX_COMPLETE, // Regex worker thread completed
+    SRM_FILEOP_ERROR, // File Operation worker thread failed to rename the item with the id in lParam
     SRM_FILEOP_COMPLETE // File Operation worker thread completed
 };
 
@@ -480,6 +570,12 @@ struct WorkerThreadData
     HANDLE cancelEvent = nullptr;
     HWND hwndParent = nullptr;
     CComPtr<IPowerRenameManager> spsrm;
+    std::shared_ptr<CPowerRenamePreviewCache> previewCache;
+    std::shared_ptr<CPowerRenameUpdateQueue> updates;
+    CComPtr<IPowerRenameFileSystem> spFileSystem;
+    std::shared_ptr<CPowerRenameJournal> journal;
+    // Indexes of the items shown in the list, computed first
+    std::vector<UINT> previewIndexes;
 };
 
 // Msg-only worker window proc for communication from our worker threads
@@ -514,27 +610,33 @@ LRESULT CPowerRenameManager::_WndProc(_In_ HWND hwnd, _In_ UINT msg, _In_ WPARAM
     switch (msg)
     {
     case SRM_REGEX_ITEM_UPDATED:
-    {
-        int id = static_cast<int>(lParam);
-        CComPtr<IPowerRenameItem> spItem;
-        if (SUCCEEDED(GetItemById(id, &spItem)))
-        {
-            _OnUpdate(spItem);
-        }
+        _FlushUpdates();
         break;
-    }
+
     case SRM_REGEX_STARTED:
         _OnRegExStarted(static_cast<DWORD>(wParam));
         break;
 
     case SRM_REGEX_CANCELED:
+        _FlushUpdates();
         _OnRegExCanceled(static_cast<DWORD>(wParam));
         break;
 
     case SRM_REGEX_COMPLETE:
+        _FlushUpdates();
         _OnRegExCompleted(static_cast<DWORD>(wParam));
         break;
 
+    case SRM_FILEOP_ERROR:
+    {
+        CComPtr<IPowerRenameItem> spItem;
+        if (SUCCEEDED(GetItemById(static_cast<int>(lParam), &spItem)))
+        {
+            _OnError(spItem);
+        }
+        break;
+    }
+
     default:
         lRes = DefWindowProc(hwnd, msg, wParam, lParam);
         break;
@@ -564,10 +666,10 @@ void CPowerRenameManager::_LogOperationTelemetry()
         CComPtr<IPowerRenameItem> spItem;
         if (SUCCEEDED(GetItemByIndex(i, &spItem)))
         {
-            PWSTR originalName;
-            if (SUCCEEDED(spItem->GetOriginalName(&originalName)))
+            PCWSTR originalName = nullptr;
+            if (SUCCEEDED(spItem->GetOriginalNameView(&originalName)))
             {
-                std::wstring extension = fs::path(originalName).extension().wstring();
+                std::wstring extension(originalName + CPowerRenameCaseTransform::s_FindExtension(originalName, wcslen(originalName)));
                 std::map<std::wstring, int>::iterator it = extensionsMap.find(extension);
                 if (it == extensionsMap.end())
                 {
@@ -577,8 +679,6 @@ void CPowerRenameManager::_LogOperationTelemetry()
                 {
                     it->second++;
                 }
-
-                CoTaskMemFree(originalName);
             }
         }
     }
@@ -609,6 +709,15 @@ HRESULT CPowerRenameManager::_PerformFileOperation()
     // Wait for existing regex thread to finish
     _WaitForRegExWorkerThread();
 
+    // Cached previews are computed from the names before the rename
+    if (m_previewCache)
+    {
+        m_previewCache->Clear();
+    }
+
+    // Only the renames of this operation can be undone
+    m_journal = std::make_shared<CPowerRenameJournal>();
+
     // Create worker thread which will perform the actual rename
     HRESULT hr = _CreateFileOpWorkerThread();
     if (SUCCEEDED(hr))
@@ -643,6 +752,8 @@ HRESULT CPowerRenameManager::_PerformFileOperation()
             }
         }
 
+        // Items that were renamed no longer have a new name to apply
+        _InvalidateCounts();
         _OnRenameCompleted();
     }
 
@@ -656,9 +767,12 @@ HRESULT CPowerRenameManager::_CreateFileOpWorkerThread()
     if (pwtd)
     {
         pwtd->hwndManager = m_hwndMessage;
-        pwtd->startEvent = m_startRegExWorkerEvent;
+        pwtd->startEvent = m_startFileOpWorkerEvent;
         pwtd->cancelEvent = nullptr;
+        pwtd->hwndParent = m_hwndParent;
         pwtd->spsrm = this;
+        pwtd->spFileSystem = m_spFileSystem;
+        pwtd->journal = m_journal;
         m_fileOpWorkerThreadHandle = CreateThread(nullptr, 0, s_fileOpWorkerThread, pwtd, 0, nullptr);
         hr = E_FAIL;
         if (m_fileOpWorkerThreadHandle)
@@ -685,76 +799,48 @@ DWORD WINAPI CPowerRenameManager::s_fileOpWorkerThread(_In_ void* pv)
             if (WaitForSingleObject(pwtd->startEvent, INFINITE) == WAIT_OBJECT_0)
             {
                 CComPtr<IPowerRenameRegEx> spRenameRegEx;
-                if (SUCCEEDED(pwtd->spsrm->GetRenameRegEx(&spRenameRegEx)))
+                if (pwtd->spFileSystem && SUCCEEDED(pwtd->spsrm->GetRenameRegEx(&spRenameRegEx)))
                 {
-                    // Create IFileOperation interface
-                    CComPtr<IFileOperation> spFileOp;
-                    if (SUCCEEDED(CoCreateInstance(CLSID_FileOperation, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&spFileOp))))
-                    {
-                        DWORD flags = 0;
-                        spRenameRegEx->GetFlags(&flags);
-
-                        UINT itemCount = 0;
-                        pwtd->spsrm->GetItemCount(&itemCount);
-
-                        // We add the items to the operation in depth-first order.  This allows child items to be
-                        // renamed before parent items.
-
-                        // Creating a vector of vectors of items of the same depth
-                        std::vector<std::vector<UINT>> matrix(itemCount);
+                    DWORD flags = 0;
+                    spRenameRegEx->GetFlags(&flags);
 
-                        for (UINT u = 0; u < itemCount; u++)
-                        {
-                            CComPtr<IPowerRenameItem> spItem;
-                            if (SUCCEEDED(pwtd->spsrm->GetItemByIndex(u, &spItem)))
-                            {
-                                UINT depth = 0;
-                                spItem->GetDepth(&depth);
-                                matrix[depth].push_back(u);
-                            }
-                        }
+                    UINT itemCount = 0;
+                    pwtd->spsrm->GetItemCount(&itemCount);
 
-                        // From the greatest depth first, add all items of that depth to the operation
-                        for (LONG v = itemCount - 1; v >= 0; v--)
+                    CPowerRenameExecutor executor(pwtd->spFileSystem, pwtd->journal);
+                    for (UINT u = 0; u < itemCount; u++)
+                    {
+                        CComPtr<IPowerRenameItem> spItem;
+                        if (SUCCEEDED(pwtd->spsrm->GetItemByIndex(u, &spItem)))
                         {
-                            for (auto it : matrix[v])
+                            bool shouldRename = false;
+                            if (SUCCEEDED(spItem->ShouldRenameItem(flags, &shouldRename)) && shouldRename)
                             {
-                                CComPtr<IPowerRenameItem> spItem;
-                                if (SUCCEEDED(pwtd->spsrm->GetItemByIndex(it, &spItem)))
+                                int id = 0;
+                                PCWSTR path = nullptr;
+                                wchar_t newName[MAX_PATH] = { 0 };
+                                if (SUCCEEDED(spItem->GetId(&id)) &&
+                                    SUCCEEDED(spItem->GetPathView(&path)) &&
+                                    SUCCEEDED(spItem->CopyNewName(newName, ARRAYSIZE(newName))))
                                 {
-                                    bool shouldRename = false;
-                                    if (SUCCEEDED(spItem->ShouldRenameItem(flags, &shouldRename)) && shouldRename)
-                                    {
-                                        PWSTR newName = nullptr;
-                                        if (SUCCEEDED(spItem->GetNewName(&newName)))
-                                        {
-                                            CComPtr<IShellItem> spShellItem;
-                                            if (SUCCEEDED(spItem->GetShellItem(&spShellItem)))
-                                            {
-                                                spFileOp->RenameItem(spShellItem, newName, nullptr);
-                                            }
-                                            CoTaskMemFree(newName);
-                                        }
-                                    }
+                                    executor.Add(id, path, newName);
                                 }
                             }
                         }
+                    }
 
-                        // Set the operation flags
-                        if (SUCCEEDED(spFileOp->SetOperationFlags(FOF_DEFAULTFLAGS)))
-                        {
-                            // Set the parent window
-                            if (pwtd->hwndParent)
-                            {
-                                spFileOp->SetOwnerWindow(pwtd->hwndParent);
-                            }
+                    // Resolve the collisions and the order of the renames up front, then
+                    // rename the items in one operation, children before their parents.
+                    // The items that were not renamed, because they failed or the user
+                    // canceled, are reported.  The renames done stay done so the user can
+                    // cleanly undo the operation from explorer if it failed halfway through.
+                    executor.Plan();
+                    std::vector<int> failedIds;
+                    executor.Execute(pwtd->hwndParent, failedIds);
 
-                            // Perform the operation
-                            // We don't care about the return code here. We would rather
-                            // return control back to explorer so the user can cleanly
-                            // undo the operation if it failed halfway through.
-                            spFileOp->PerformOperations();
-                        }
+                    for (int id : failedIds)
+                    {
+                        PostMessage(pwtd->hwndManager, SRM_FILEOP_ERROR, GetCurrentThreadId(), static_cast<LPARAM>(id));
                     }
                 }
             }
@@ -810,6 +896,9 @@ HRESULT CPowerRenameManager::_CreateRegExWorkerThread()
         pwtd->cancelEvent = m_cancelRegExWorkerEvent;
         pwtd->hwndParent = m_hwndParent;
         pwtd->spsrm = this;
+        pwtd->previewCache = m_previewCache;
+        pwtd->updates = m_updates;
+        _GetPreviewIndexes(pwtd->previewIndexes);
         m_regExWorkerThreadHandle = CreateThread(nullptr, 0, s_regexWorkerThread, pwtd, 0, nullptr);
         hr = E_FAIL;
         if (m_regExWorkerThreadHandle)
@@ -825,205 +914,484 @@ HRESULT CPowerRenameManager::_CreateRegExWorkerThread()
     return hr;
 }
 
-DWORD WINAPI CPowerRenameManager::s_regexWorkerThread(_In_ void* pv)
+namespace
 {
-    try
-    {
-        winrt::check_hresult(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE));
-        WorkerThreadData* pwtd = reinterpret_cast<WorkerThreadData*>(pv);
-        if (pwtd)
-        {
-            PostMessage(pwtd->hwndManager, SRM_REGEX_STARTED, GetCurrentThreadId(), 0);
+    // Number of items a regex worker thread takes at a time
+    const UINT RegExChunkSize = 256;
 
-            // Wait to be told we can begin
-            if (WaitForSingleObject(pwtd->startEvent, INFINITE) == WAIT_OBJECT_0)
-            {
-                CComPtr<IPowerRenameRegEx> spRenameRegEx;
+    // What a regex worker run needs to compute the new name of an item
+    struct RegExRunContext
+    {
+        IPowerRenameRegEx* renameRegEx = nullptr;
+        DWORD flags = 0;
+        bool useFileTime = false;
+        // Set for literal searches
+        bool literalSearch = false;
+        std::optional<CPowerRenameLiteralMatcher> matcher;
+        // Results of a literal search for a term contained in this one, if cached
+        const CPowerRenamePreviewCache::Results* narrowing = nullptr;
+    };
 
-                winrt::check_hresult(pwtd->spsrm->GetRenameRegEx(&spRenameRegEx));
+    // False if the source name of the item at index is known not to contain the search term
+    bool MayMatch(_In_ const RegExRunContext& context, _In_ UINT index, _In_ int id)
+    {
+        if (!context.narrowing || index >= context.narrowing->items.size())
+        {
+            return true;
+        }
 
-                DWORD flags = 0;
-                winrt::check_hresult(spRenameRegEx->GetFlags(&flags));
+        const PreviewItemResult& narrowingResult = context.narrowing->items[index];
+        return !narrowingResult.computed || narrowingResult.id != id || narrowingResult.mayMatch;
+    }
 
-                PWSTR replaceTerm = nullptr;
-                bool useFileTime = false;
+    // Reads the creation time of the items that don't have it yet, a folder at a time and
+    // on all cores, so the items don't each open their file when they are processed.
+    // Items the metadata source fails on still read their own time.
+    bool PrefetchFileTimes(_In_ IPowerRenameManager* manager, _In_ UINT itemCount, _In_ const std::function<bool()>& isCanceled)
+    {
+        CComPtr<IPowerRenameMetadataSource> spMetadataSource;
+        if (FAILED(manager->GetMetadataSource(&spMetadataSource)))
+        {
+            return true;
+        }
 
-                winrt::check_hresult(spRenameRegEx->GetReplaceTerm(&replaceTerm));
+        struct FolderItems
+        {
+            std::wstring folderPath;
+            // Views of the item paths, kept valid by the items
+            std::vector<PCWSTR> fileNames;
+            std::vector<CComPtr<IPowerRenameItem>> items;
+        };
+
+        std::vector<FolderItems> folders;
+        std::unordered_map<std::wstring, size_t> folderIndexes;
+        for (UINT u = 0; u < itemCount; u++)
+        {
+            CComPtr<IPowerRenameItem> spItem;
+            winrt::check_hresult(manager->GetItemByIndex(u, &spItem));
 
-                if (isFileTimeUsed(replaceTerm))
+            bool isTimeParsed = false;
+            PCWSTR path = nullptr;
+            if (SUCCEEDED(spItem->GetIsTimeParsed(&isTimeParsed)) && !isTimeParsed && SUCCEEDED(spItem->GetPathView(&path)))
+            {
+                PCWSTR fileName = PathFindFileName(path);
+                std::wstring folderPath(path, fileName - path);
+                auto it = folderIndexes.find(folderPath);
+                if (it == folderIndexes.end())
                 {
-                    useFileTime = true;
+                    it = folderIndexes.emplace(folderPath, folders.size()).first;
+                    folders.push_back({ folderPath });
                 }
 
-                UINT itemCount = 0;
-                unsigned long itemEnumIndex = 1;
-                winrt::check_hresult(pwtd->spsrm->GetItemCount(&itemCount));
-                for (UINT u = 0; u < itemCount; u++)
+                folders[it->second].fileNames.push_back(fileName);
+                folders[it->second].items.push_back(spItem);
+            }
+        }
+
+        return ParallelFor(static_cast<UINT>(folders.size()), 1, [&](UINT begin, UINT end) {
+            if (isCanceled())
+            {
+                return false;
+            }
+
+            for (UINT f = begin; f < end; f++)
+            {
+                FolderItems& folder = folders[f];
+                const UINT count = static_cast<UINT>(folder.items.size());
+                std::vector<SYSTEMTIME> times(count);
+                std::vector<HRESULT> results(count);
+                if (SUCCEEDED(spMetadataSource->GetCreationTimes(folder.folderPath.c_str(), folder.fileNames.data(), count, times.data(), results.data())))
                 {
-                    // Check if cancel event is signaled
-                    if (WaitForSingleObject(pwtd->cancelEvent, 0) == WAIT_OBJECT_0)
+                    for (UINT i = 0; i < count; i++)
                     {
-                        // Canceled from manager
-                        // Send the manager thread the canceled message
-                        PostMessage(pwtd->hwndManager, SRM_REGEX_CANCELED, GetCurrentThreadId(), 0);
-                        break;
+                        if (SUCCEEDED(results[i]))
+                        {
+                            folder.items[i]->PutTime(times[i]);
+                        }
                     }
+                }
+            }
+            return true;
+        });
+    }
 
-                    CComPtr<IPowerRenameItem> spItem;
-                    winrt::check_hresult(pwtd->spsrm->GetItemByIndex(u, &spItem));
-
-                    int id = -1;
-                    winrt::check_hresult(spItem->GetId(&id));
-
-                    bool isFolder = false;
-                    bool isSubFolderContent = false;
-                    winrt::check_hresult(spItem->GetIsFolder(&isFolder));
-                    winrt::check_hresult(spItem->GetIsSubFolderContent(&isSubFolderContent));
-                    if ((isFolder && (flags & PowerRenameFlags::ExcludeFolders)) ||
-                        (!isFolder && (flags & PowerRenameFlags::ExcludeFiles)) ||
-                        (isSubFolderContent && (flags & PowerRenameFlags::ExcludeSubfolders)))
-                    {
-                        // Exclude this item from renaming.  Ensure new name is cleared.
-                        winrt::check_hresult(spItem->PutNewName(nullptr));
+    // Only reads from the regex and the item so it can run for many items concurrently
+    void ComputeItemNewName(_In_ const RegExRunContext& context, _In_ IPowerRenameItem* item, _In_ UINT index, _Inout_ PreviewItemResult& result)
+    {
+        const DWORD flags = context.flags;
+        result = PreviewItemResult();
+        winrt::check_hresult(item->GetId(&result.id));
+
+        bool isFolder = false;
+        bool isSubFolderContent = false;
+        winrt::check_hresult(item->GetIsFolder(&isFolder));
+        winrt::check_hresult(item->GetIsSubFolderContent(&isSubFolderContent));
+        if ((isFolder && (flags & PowerRenameFlags::ExcludeFolders)) ||
+            (!isFolder && (flags & PowerRenameFlags::ExcludeFiles)) ||
+            (isSubFolderContent && (flags & PowerRenameFlags::ExcludeSubfolders)))
+        {
+            result.excluded = true;
+            return;
+        }
 
-                        // Send the manager thread the item processed message
-                        PostMessage(pwtd->hwndManager, SRM_REGEX_ITEM_UPDATED, GetCurrentThreadId(), id);
+        PCWSTR originalName = nullptr;
+        winrt::check_hresult(item->GetOriginalNameView(&originalName));
 
-                        continue;
-                    }
+        // Split once into stem and extension, the extension starts with its dot
+        const size_t originalLength = wcslen(originalName);
+        const size_t stemLength = CPowerRenameCaseTransform::s_FindExtension(originalName, originalLength);
+        const PCWSTR extension = originalName + stemLength;
 
-                    PWSTR originalName = nullptr;
-                    winrt::check_hresult(spItem->GetOriginalName(&originalName));
+        wchar_t sourceName[MAX_PATH] = { 0 };
+        if (flags & NameOnly)
+        {
+            StringCchCopyN(sourceName, ARRAYSIZE(sourceName), originalName, stemLength);
+        }
+        else if (flags & ExtensionOnly)
+        {
+            StringCchCopy(sourceName, ARRAYSIZE(sourceName), extension[0] == L'.' ? extension + 1 : extension);
+        }
+        else
+        {
+            StringCchCopy(sourceName, ARRAYSIZE(sourceName), originalName);
+        }
 
+        PWSTR newName = nullptr;
 
-                    PWSTR currentNewName = nullptr;
-                    winrt::check_hresult(spItem->GetNewName(&currentNewName));
+        if (context.literalSearch)
+        {
+            result.mayMatch = MayMatch(context, index, result.id) && context.matcher->Contains(sourceName);
+        }
 
-                    wchar_t sourceName[MAX_PATH] = { 0 };
-                    if (flags & NameOnly)
-                    {
-                        StringCchCopy(sourceName, ARRAYSIZE(sourceName), fs::path(originalName).stem().c_str());
-                    }
-                    else if (flags & ExtensionOnly)
-                    {
-                        std::wstring extension = fs::path(originalName).extension().wstring();
-                        if (!extension.empty() && extension.front() == '.')
-                        {
-                            extension = extension.erase(0, 1);
-                        }
-                        StringCchCopy(sourceName, ARRAYSIZE(sourceName), extension.c_str());
-                    }
-                    else
-                    {
-                        StringCchCopy(sourceName, ARRAYSIZE(sourceName), originalName);
-                    }
+        if (!result.mayMatch)
+        {
+            // Nothing to replace so the result is the source name, like Replace would return
+            if (sourceName[0] != L'\0')
+            {
+                SHStrDup(sourceName, &newName);
+            }
+        }
+        else if (context.useFileTime)
+        {
+            // Failure here means we didn't match anything or had nothing to match
+            // Call put_newName with null in that case to reset it
+            SYSTEMTIME fileTime = { 0 };
+            winrt::check_hresult(item->GetTime(&fileTime));
+            winrt::check_hresult(context.renameRegEx->ReplaceWithFileTime(sourceName, fileTime, &newName));
+        }
+        else
+        {
+            winrt::check_hresult(context.renameRegEx->Replace(sourceName, &newName));
+        }
 
-                    SYSTEMTIME fileTime = { 0 };
+        wchar_t resultName[MAX_PATH] = { 0 };
 
-                    if (useFileTime)
-                    {
-                        winrt::check_hresult(spItem->GetTime(&fileTime));
-                        winrt::check_hresult(spRenameRegEx->PutFileTime(fileTime));
-                    }
+        PWSTR newNameToUse = nullptr;
 
-                    PWSTR newName = nullptr;
+        // newName == nullptr likely means we have an empty search string.  We should leave newNameToUse
+        // as nullptr so we clear the renamed column
+        // Except string transformation is selected.
 
-                    // Failure here means we didn't match anything or had nothing to match
-                    // Call put_newName with null in that case to reset it
-                    winrt::check_hresult(spRenameRegEx->Replace(sourceName, &newName));
+        if (newName == nullptr && (flags & Uppercase || flags & Lowercase || flags & Titlecase || flags & Capitalized))
+        {
+            SHStrDup(sourceName, &newName);
+        }
 
-                    if (useFileTime)
-                    {
-                        winrt::check_hresult(spRenameRegEx->ResetFileTime());
-                    }
+        if (newName != nullptr)
+        {
+            newNameToUse = resultName;
+            if (flags & NameOnly)
+            {
+                StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s%s", newName, extension);
+            }
+            else if (flags & ExtensionOnly)
+            {
+                if (extension[0] != L'\0')
+                {
+                    StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%.*s.%s", static_cast<int>(stemLength), originalName, newName);
+                }
+                else
+                {
+                    StringCchCopy(resultName, ARRAYSIZE(resultName), originalName);
+                }
+            }
+            else
+            {
+                StringCchCopy(resultName, ARRAYSIZE(resultName), newName);
+            }
+        }
 
-                    wchar_t resultName[MAX_PATH] = { 0 };
+        wchar_t trimmedName[MAX_PATH] = { 0 };
+        if (newNameToUse != nullptr)
+        {
+            winrt::check_hresult(GetTrimmedFileName(trimmedName, ARRAYSIZE(trimmedName), newNameToUse));
+            newNameToUse = trimmedName;
+        }
 
-                    PWSTR newNameToUse = nullptr;
+        wchar_t transformedName[MAX_PATH] = { 0 };
+        if (newNameToUse != nullptr && (flags & Uppercase || flags & Lowercase || flags & Titlecase || flags & Capitalized))
+        {
+            winrt::check_hresult(GetTransformedFileName(transformedName, ARRAYSIZE(transformedName), newNameToUse, flags));
+            newNameToUse = transformedName;
+        }
 
-                    // newName == nullptr likely means we have an empty search string.  We should leave newNameToUse
-                    // as nullptr so we clear the renamed column
-                    // Except string transformation is selected.
+        // No change from originalName so leave the new name
+        // null so we clear it from our UI as well.
+        if (newNameToUse != nullptr && lstrcmp(originalName, newNameToUse) != 0)
+        {
+            result.hasNewName = true;
+            result.newName = newNameToUse;
+        }
 
-                    if (newName == nullptr && (flags & Uppercase || flags & Lowercase || flags & Titlecase || flags & Capitalized))
-                    {
-                        SHStrDup(sourceName, &newName);
-                    }
+        CoTaskMemFree(newName);
+        result.computed = true;
+    }
 
-                    if (newName != nullptr)
+    // Compute the result of the item at index unless it is already cached
+    const PreviewItemResult& GetItemResult(_In_ const RegExRunContext& context, _In_ IPowerRenameItem* item, _In_ UINT index, _Inout_ CPowerRenamePreviewCache::Results& results)
+    {
+        PreviewItemResult& result = results.items[index];
+        int id = -1;
+        winrt::check_hresult(item->GetId(&id));
+        if (!result.computed || result.id != id)
+        {
+            ComputeItemNewName(context, item, index, result);
+        }
+        return result;
+    }
+
+    // Store the new name on the item and tell the manager thread if it changed
+    void UpdateItemNewName(_In_ IPowerRenameItem* item, _In_ UINT index, _In_opt_ PCWSTR newName, _In_ DWORD flags, _In_ const WorkerThreadData* pwtd, _In_ DWORD threadId)
+    {
+        bool unchanged = false;
+        winrt::check_hresult(item->IsNewNameEqual(newName, &unchanged));
+
+        if (!unchanged)
+        {
+            bool notify = false;
+            // Scope lock
+            {
+                CSRWSharedAutoLock lock(pwtd->updates->GetItemLock());
+                bool shouldRenameBefore = false;
+                winrt::check_hresult(item->ShouldRenameItem(flags, &shouldRenameBefore));
+                winrt::check_hresult(item->PutNewName(newName));
+                bool shouldRenameAfter = false;
+                winrt::check_hresult(item->ShouldRenameItem(flags, &shouldRenameAfter));
+                notify = pwtd->updates->Push(index, (shouldRenameAfter ? 1 : 0) - (shouldRenameBefore ? 1 : 0));
+            }
+
+            if (notify)
+            {
+                // Send the manager thread the items processed message.  Items changed
+                // until it takes them are reported together.
+                PostMessage(pwtd->hwndManager, SRM_REGEX_ITEM_UPDATED, threadId, 0);
+            }
+        }
+    }
+}
+
+DWORD WINAPI CPowerRenameManager::s_regexWorkerThread(_In_ void* pv)
+{
+    try
+    {
+        winrt::check_hresult(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE));
+        WorkerThreadData* pwtd = reinterpret_cast<WorkerThreadData*>(pv);
+        if (pwtd)
+        {
+            const DWORD threadId = GetCurrentThreadId();
+            PostMessage(pwtd->hwndManager, SRM_REGEX_STARTED, threadId, 0);
+
+            // Wait to be told we can begin
+            if (WaitForSingleObject(pwtd->startEvent, INFINITE) == WAIT_OBJECT_0)
+            {
+                CComPtr<IPowerRenameRegEx> spRenameRegEx;
+
+                winrt::check_hresult(pwtd->spsrm->GetRenameRegEx(&spRenameRegEx));
+
+                DWORD flags = 0;
+                winrt::check_hresult(spRenameRegEx->GetFlags(&flags));
+
+                PWSTR searchTerm = nullptr;
+                PWSTR replaceTerm = nullptr;
+                winrt::check_hresult(spRenameRegEx->GetSearchTerm(&searchTerm));
+                winrt::check_hresult(spRenameRegEx->GetReplaceTerm(&replaceTerm));
+
+                PreviewKey key;
+                key.searchTerm = searchTerm ? searchTerm : L"";
+                key.replaceTerm = replaceTerm ? replaceTerm : L"";
+                key.flags = flags;
+                CoTaskMemFree(searchTerm);
+                CoTaskMemFree(replaceTerm);
+
+                RegExRunContext context;
+                context.renameRegEx = spRenameRegEx;
+                context.flags = flags;
+                context.useFileTime = isFileTimeUsed(key.replaceTerm.c_str());
+                context.literalSearch = CPowerRenamePreviewCache::s_IsLiteralSearch(key);
+                if (context.literalSearch)
+                {
+                    context.matcher.emplace(key.searchTerm.c_str(), (flags & CaseSensitive) != 0);
+                }
+
+                UINT itemCount = 0;
+                winrt::check_hresult(pwtd->spsrm->GetItemCount(&itemCount));
+
+                // Results already computed for the same terms are applied as they are.  For a
+                // literal search extending a previous one, items that didn't contain the
+                // previous term are not searched again.
+                std::shared_ptr<CPowerRenamePreviewCache::Results> results = pwtd->previewCache->GetResults(key, itemCount);
+                std::shared_ptr<const CPowerRenamePreviewCache::Results> narrowing = pwtd->previewCache->FindNarrowingResults(key);
+                context.narrowing = narrowing.get();
+
+                auto isCanceled = [pwtd]() {
+                    return WaitForSingleObject(pwtd->cancelEvent, 0) == WAIT_OBJECT_0;
+                };
+
+                auto updateItem = [&](UINT index) {
+                    CComPtr<IPowerRenameItem> spItem;
+                    winrt::check_hresult(pwtd->spsrm->GetItemByIndex(index, &spItem));
+
+                    const PreviewItemResult& result = GetItemResult(context, spItem, index, *results);
+                    UpdateItemNewName(spItem, index, (!result.excluded && result.hasNewName) ? result.newName.c_str() : nullptr, flags, pwtd, threadId);
+                };
+
+                // Items are split in chunks that are processed on all cores.  Enumeration
+                // numbers depend on how many items before an item get a new name, so in that
+                // case the names are computed first and numbered in a second pass to keep the
+                // numbering the same as when the items are processed in order.
+                const bool enumerate = (flags & EnumerateItems) != 0;
+                bool completed = true;
+                if (!enumerate)
+                {
+                    // Rows shown in the list first so typing stays responsive with many items
+                    for (UINT index : pwtd->previewIndexes)
                     {
-                        newNameToUse = resultName;
-                        if (flags & NameOnly)
+                        if (isCanceled())
                         {
-                            StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s%s", newName, fs::path(originalName).extension().c_str());
+                            completed = false;
+                            break;
                         }
-                        else if (flags & ExtensionOnly)
-                        {
-                            std::wstring extension = fs::path(originalName).extension().wstring();
-                            if (!extension.empty())
-                            {
-                                StringCchPrintf(resultName, ARRAYSIZE(resultName), L"%s.%s", fs::path(originalName).stem().c_str(), newName);
-                            }
-                            else
-                            {
-                                StringCchCopy(resultName, ARRAYSIZE(resultName), originalName);
-                            }
-                        }
-                        else
+
+                        if (index < itemCount)
                         {
-                            StringCchCopy(resultName, ARRAYSIZE(resultName), newName);
+                            updateItem(index);
                         }
                     }
 
-                    wchar_t trimmedName[MAX_PATH] = { 0 };
-                    if (newNameToUse != nullptr)
+                    if (completed && context.useFileTime)
                     {
-                        winrt::check_hresult(GetTrimmedFileName(trimmedName, ARRAYSIZE(trimmedName), newNameToUse));
-                        newNameToUse = trimmedName;
+                        completed = PrefetchFileTimes(pwtd->spsrm, itemCount, isCanceled);
                     }
 
-                    wchar_t transformedName[MAX_PATH] = { 0 };
-                    if (newNameToUse != nullptr && (flags & Uppercase || flags & Lowercase || flags & Titlecase || flags & Capitalized))
-                    {
-                        winrt::check_hresult(GetTransformedFileName(transformedName, ARRAYSIZE(transformedName), newNameToUse, flags));
-                        newNameToUse = transformedName;
-                    }
+                    completed = completed && ParallelFor(itemCount, RegExChunkSize, [&](UINT begin, UINT end) {
+                        // Check if cancel event is signaled
+                        if (isCanceled())
+                        {
+                            return false;
+                        }
 
-                    // No change from originalName so set newName to
-                    // null so we clear it from our UI as well.
-                    if (lstrcmp(originalName, newNameToUse) == 0)
+                        for (UINT u = begin; u < end; u++)
+                        {
+                            updateItem(u);
+                        }
+                        return true;
+                    });
+                }
+                else
+                {
+                    if (context.useFileTime)
                     {
-                        newNameToUse = nullptr;
+                        completed = PrefetchFileTimes(pwtd->spsrm, itemCount, isCanceled);
                     }
 
-                    wchar_t uniqueName[MAX_PATH] = { 0 };
-                    if (newNameToUse != nullptr && (flags & EnumerateItems))
+                    completed = completed && ParallelFor(itemCount, RegExChunkSize, [&](UINT begin, UINT end) {
+                        if (isCanceled())
+                        {
+                            return false;
+                        }
+
+                        for (UINT u = begin; u < end; u++)
+                        {
+                            CComPtr<IPowerRenameItem> spItem;
+                            winrt::check_hresult(pwtd->spsrm->GetItemByIndex(u, &spItem));
+
+                            const PreviewItemResult& result = GetItemResult(context, spItem, u, *results);
+                            if (result.excluded)
+                            {
+                                // Exclude this item from renaming.  Ensure new name is cleared.
+                                UpdateItemNewName(spItem, u, nullptr, flags, pwtd, threadId);
+                            }
+                        }
+                        return true;
+                    });
+
+                    if (completed)
                     {
-                        unsigned long countUsed = 0;
-                        if (GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), newNameToUse, nullptr, itemEnumIndex, &countUsed))
+                        // Prefix sum of the items that got a new name gives each item its enumeration index
+                        std::vector<unsigned long> enumIndexes(itemCount);
+                        unsigned long itemEnumIndex = 1;
+                        for (UINT u = 0; u < itemCount; u++)
                         {
-                            newNameToUse = uniqueName;
+                            enumIndexes[u] = itemEnumIndex;
+                            if (!results->items[u].excluded && results->items[u].hasNewName)
+                            {
+                                itemEnumIndex++;
+                            }
                         }
-                        itemEnumIndex++;
-                    }
 
-                    winrt::check_hresult(spItem->PutNewName(newNameToUse));
+                        completed = ParallelFor(itemCount, RegExChunkSize, [&](UINT begin, UINT end) {
+                            if (isCanceled())
+                            {
+                                return false;
+                            }
+
+                            for (UINT u = begin; u < end; u++)
+                            {
+                                const PreviewItemResult& result = results->items[u];
+                                if (result.excluded)
+                                {
+                                    continue;
+                                }
+
+                                CComPtr<IPowerRenameItem> spItem;
+                                winrt::check_hresult(pwtd->spsrm->GetItemByIndex(u, &spItem));
+
+                                PCWSTR newNameToUse = nullptr;
+                                wchar_t uniqueName[MAX_PATH] = { 0 };
+                                if (result.hasNewName)
+                                {
+                                    newNameToUse = result.newName.c_str();
+                                    unsigned long countUsed = 0;
+                                    if (GetEnumeratedFileName(uniqueName, ARRAYSIZE(uniqueName), newNameToUse, nullptr, enumIndexes[u], &countUsed))
+                                    {
+                                        newNameToUse = uniqueName;
+                                    }
+                                }
+
+                                UpdateItemNewName(spItem, u, newNameToUse, flags, pwtd, threadId);
+                            }
+                            return true;
+                        });
+                    }
+                }
 
-                    // Was there a change?
-                    if (lstrcmp(currentNewName, newNameToUse) != 0)
+                if (!completed)
+                {
+                    // Processing also stops when an item failed, in which case the error is
+                    // handled like it was before the work was split across threads.
+                    if (!isCanceled())
                     {
-                        // Send the manager thread the item processed message
-                        PostMessage(pwtd->hwndManager, SRM_REGEX_ITEM_UPDATED, GetCurrentThreadId(), id);
+                        winrt::throw_hresult(E_FAIL);
                     }
-                    CoTaskMemFree(newName);
-                    CoTaskMemFree(currentNewName);
-                    CoTaskMemFree(originalName);
+
+                    // Canceled from manager
+                    // Send the manager thread the canceled message
+                    PostMessage(pwtd->hwndManager, SRM_REGEX_CANCELED, threadId, 0);
                 }
-                CoTaskMemFree(replaceTerm);
             }
 
             // Send the manager thread the completion message
-            PostMessage(pwtd->hwndManager, SRM_REGEX_COMPLETE, GetCurrentThreadId(), 0);
+            PostMessage(pwtd->hwndManager, SRM_REGEX_COMPLETE, threadId, 0);
 
             delete pwtd;
             
@@ -1111,7 +1479,7 @@ void CPowerRenameManager::_ClearRegEx()
     }
 }
 
-void CPowerRenameManager::_OnItemAdded(_In_ IPowerRenameItem* renameItem)
+void CPowerRenameManager::_OnItemAdded(_In_ IPowerRenameItem* renameItem, _In_ UINT count)
 {
     CSRWSharedAutoLock lock(&m_lockEvents);
 
@@ -1119,12 +1487,12 @@ void CPowerRenameManager::_OnItemAdded(_In_ IPowerRenameItem* renameItem)
     {
         if (it.pEvents)
         {
-            it.pEvents->OnItemAdded(renameItem);
+            it.pEvents->OnItemAdded(renameItem, count);
         }
     }
 }
 
-void CPowerRenameManager::_OnUpdate(_In_ IPowerRenameItem* renameItem)
+void CPowerRenameManager::_OnUpdate(_In_ UINT firstIndex, _In_ UINT lastIndex)
 {
     CSRWSharedAutoLock lock(&m_lockEvents);
 
@@ -1132,7 +1500,7 @@ void CPowerRenameManager::_OnUpdate(_In_ IPowerRenameItem* renameItem)
     {
         if (it.pEvents)
         {
-            it.pEvents->OnUpdate(renameItem);
+            it.pEvents->OnUpdate(firstIndex, lastIndex);
         }
     }
 }
@@ -1233,22 +1601,277 @@ void CPowerRenameManager::_ClearEventHandlers()
     m_powerRenameManagerEvents.clear();
 }
 
+HRESULT CPowerRenameManager::_AddItem(_In_ IPowerRenameItem* pItem)
+{
+    int id = 0;
+    pItem->GetId(&id);
+    // Verify the item isn't already added
+    if (m_renameItemIndexes.find(id) != m_renameItemIndexes.end())
+    {
+        return E_FAIL;
+    }
+
+    int lastId = 0;
+    if (m_renameItems.empty() || (SUCCEEDED(m_renameItems.back()->GetId(&lastId)) && lastId < id))
+    {
+        // Items are almost always added in id order
+        m_renameItemIndexes[id] = static_cast<UINT>(m_renameItems.size());
+        m_renameItems.push_back(pItem);
+        m_isVisible.push_back(true);
+    }
+    else
+    {
+        // Keep the store ordered by id and shift the indexes of the items that follow
+        auto it = std::lower_bound(m_renameItems.begin(), m_renameItems.end(), id, [](IPowerRenameItem* item, int value) {
+            int itemId = 0;
+            item->GetId(&itemId);
+            return itemId < value;
+        });
+        size_t index = it - m_renameItems.begin();
+        m_renameItems.insert(it, pItem);
+        m_isVisible.insert(m_isVisible.begin() + index, true);
+        for (size_t i = index; i < m_renameItems.size(); i++)
+        {
+            int itemId = 0;
+            m_renameItems[i]->GetId(&itemId);
+            m_renameItemIndexes[itemId] = static_cast<UINT>(i);
+        }
+    }
+    pItem->AddRef();
+    m_visibleValid = false;
+
+    if (m_countsValid)
+    {
+        bool selected = false;
+        bool shouldRename = false;
+        if (SUCCEEDED(pItem->GetSelected(&selected)) && selected)
+        {
+            m_selectedCount++;
+        }
+        if (SUCCEEDED(pItem->ShouldRenameItem(m_flags, &shouldRename)) && shouldRename)
+        {
+            m_renameCount++;
+        }
+    }
+
+    return S_OK;
+}
+
+void CPowerRenameManager::_EnsureCounts()
+{
+    if (m_countsValid)
+    {
+        // Items renamed by the regex worker may not have been reported yet
+        m_renameCount = static_cast<UINT>(static_cast<int>(m_renameCount) + m_updates->TakeRenameCountDelta());
+        return;
+    }
+
+    // Regex workers wait while the items are counted
+    CSRWExclusiveAutoLock itemLock(m_updates->GetItemLock());
+
+    m_selectedCount = 0;
+    m_renameCount = 0;
+    for (auto pItem : m_renameItems)
+    {
+        bool selected = false;
+        if (SUCCEEDED(pItem->GetSelected(&selected)) && selected)
+        {
+            m_selectedCount++;
+        }
+
+        bool shouldRename = false;
+        if (SUCCEEDED(pItem->ShouldRenameItem(m_flags, &shouldRename)) && shouldRename)
+        {
+            m_renameCount++;
+        }
+    }
+
+    // Changes not taken yet are part of this count
+    m_updates->ClearRenameCountDelta();
+    m_countsValid = true;
+}
+
+void CPowerRenameManager::_InvalidateCounts()
+{
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    m_countsValid = false;
+}
+
+void CPowerRenameManager::_InvalidateVisible()
+{
+    CSRWExclusiveAutoLock lock(&m_lockItems);
+    m_visibleValid = false;
+}
+
+void CPowerRenameManager::_EnsureVisible()
+{
+    if (!m_visibleValid)
+    {
+        _SetVisible();
+        m_visibleValid = true;
+    }
+}
+
+void CPowerRenameManager::_FlushUpdates()
+{
+    UINT first = 0;
+    UINT last = 0;
+    bool updated = false;
+    // Scope lock
+    {
+        CSRWExclusiveAutoLock lock(&m_lockItems);
+        int renameCountDelta = 0;
+        bool renameStateChanged = false;
+        updated = m_updates->Take(&first, &last, &renameCountDelta, &renameStateChanged);
+        if (updated && m_countsValid)
+        {
+            m_renameCount = static_cast<UINT>(static_cast<int>(m_renameCount) + renameCountDelta);
+        }
+
+        // Only the items to rename are filtered on their new name
+        if (renameStateChanged && m_filter == PowerRenameFilters::ShouldRename)
+        {
+            m_visibleValid = false;
+        }
+    }
+
+    if (updated)
+    {
+        _OnUpdate(first, last);
+    }
+}
+
 void CPowerRenameManager::_ClearPowerRenameItems()
 {
     CSRWExclusiveAutoLock lock(&m_lockItems);
 
     // Cleanup rename items
-    for (std::map<int, IPowerRenameItem*>::iterator it = m_renameItems.begin(); it != m_renameItems.end(); ++it)
+    for (auto& pItem : m_renameItems)
     {
-        IPowerRenameItem* pItem = it->second;
         if (pItem)
         {
             pItem->Release();
-            it->second = nullptr;
+            pItem = nullptr;
         }
     }
 
     m_renameItems.clear();
+    m_renameItemIndexes.clear();
+    m_isVisible.clear();
+    m_visibleItemIndexes.clear();
+    m_visibleValid = false;
+    // Counted again so updates of the removed items still pending are dropped
+    m_countsValid = false;
+
+    if (m_previewCache)
+    {
+        m_previewCache->Clear();
+    }
+}
+
+void CPowerRenameManager::_GetPreviewIndexes(_Out_ std::vector<UINT>& indexes)
+{
+    // The visible items may be out of date here.  They only decide which previews are computed first,
+    // so they aren't rebuilt on the regex worker.
+    CSRWSharedAutoLock lock(&m_lockItems);
+
+    indexes.clear();
+    for (UINT visibleIndex = m_previewFirst; visibleIndex - m_previewFirst < m_previewCount; visibleIndex++)
+    {
+        if (m_filter == PowerRenameFilters::None)
+        {
+            if (visibleIndex >= m_renameItems.size())
+            {
+                break;
+            }
+            indexes.push_back(visibleIndex);
+        }
+        else
+        {
+            if (visibleIndex >= m_visibleItemIndexes.size())
+            {
+                break;
+            }
+            indexes.push_back(m_visibleItemIndexes[visibleIndex]);
+        }
+    }
+}
+
+HRESULT CPowerRenameManager::_GetItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem)
+{
+    *ppItem = nullptr;
+    HRESULT hr = E_FAIL;
+    if (index < m_renameItems.size())
+    {
+        *ppItem = m_renameItems[index];
+        (*ppItem)->AddRef();
+        hr = S_OK;
+    }
+
+    return hr;
+}
+
+void CPowerRenameManager::_SetVisible()
+{
+    bool showAll = false;
+    if (m_filter == PowerRenameFilters::ShouldRename)
+    {
+        PWSTR searchTerm = nullptr;
+        showAll = FAILED(m_spRegEx->GetSearchTerm(&searchTerm)) || (searchTerm && wcslen(searchTerm) == 0);
+        CoTaskMemFree(searchTerm);
+    }
+
+    // Walk the items backwards so a folder can be made visible when one of its
+    // children is.
+    UINT lastVisibleDepth = 0;
+    UINT visibleCount = 0;
+    for (size_t i = m_renameItems.size(); i-- > 0;)
+    {
+        bool isVisible = showAll;
+        if (!showAll)
+        {
+            m_renameItems[i]->IsItemVisible(m_filter, m_flags, &isVisible);
+        }
+
+        UINT itemDepth = 0;
+        m_renameItems[i]->GetDepth(&itemDepth);
+
+        //Make an item visible if it has a least one visible subitem
+        if (isVisible)
+        {
+            lastVisibleDepth = itemDepth;
+        }
+        else if (lastVisibleDepth == itemDepth + 1)
+        {
+            isVisible = true;
+            lastVisibleDepth = itemDepth;
+        }
+
+        m_isVisible[i] = isVisible;
+        if (isVisible)
+        {
+            visibleCount++;
+        }
+    }
+
+    // Rebuild the visible index to real index mapping
+    std::vector<UINT> previousIndexes;
+    previousIndexes.swap(m_visibleItemIndexes);
+    m_visibleItemIndexes.reserve(visibleCount);
+    for (size_t i = 0; i < m_isVisible.size(); i++)
+    {
+        if (m_isVisible[i])
+        {
+            m_visibleItemIndexes.push_back(static_cast<UINT>(i));
+        }
+    }
+
+    // Remember the first row that shows another item than before
+    auto mismatch = std::mismatch(m_visibleItemIndexes.begin(), m_visibleItemIndexes.end(), previousIndexes.begin(), previousIndexes.end());
+    if (mismatch.first != m_visibleItemIndexes.end() || mismatch.second != previousIndexes.end())
+    {
+        m_visibleChangedRow = min(m_visibleChangedRow, static_cast<UINT>(mismatch.first - m_visibleItemIndexes.begin()));
+    }
 }
 
 void CPowerRenameManager::_Cleanup()
@@ -1,7 +1,12 @@
 #pragma once
 #include <vector>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include "srwlock.h"
+#include "PowerRenamePreviewCache.h"
+#include "PowerRenameUpdateQueue.h"
+#include "PowerRenameExecutor.h"
 
 #include <lib/PowerRenameManager.h>
 #include <lib/PowerRenameInterfaces.h>
@@ -25,14 +30,18 @@ public:
     IFACEMETHODIMP Shutdown();
     IFACEMETHODIMP Rename(_In_ HWND hwndParent);
     IFACEMETHODIMP AddItem(_In_ IPowerRenameItem* pItem);
+    IFACEMETHODIMP AddItems(_In_reads_(count) IPowerRenameItem** items, _In_ UINT count);
     IFACEMETHODIMP GetItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem);
     IFACEMETHODIMP GetVisibleItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem);
     IFACEMETHODIMP GetItemById(_In_ int id, _COM_Outptr_ IPowerRenameItem** ppItem);
+    IFACEMETHODIMP GetVisibleRowRange(_In_ UINT firstIndex, _In_ UINT lastIndex, _Out_ UINT* firstRow, _Out_ UINT* lastRow);
+    IFACEMETHODIMP PutPreviewRange(_In_ UINT first, _In_ UINT last);
     IFACEMETHODIMP GetItemCount(_Out_ UINT* count);
     IFACEMETHODIMP SetVisible();
     IFACEMETHODIMP GetVisibleItemCount(_Out_ UINT* count);
     IFACEMETHODIMP GetSelectedItemCount(_Out_ UINT* count);
     IFACEMETHODIMP GetRenameItemCount(_Out_ UINT* count);
+    IFACEMETHODIMP PutItemSelected(_In_ IPowerRenameItem* pItem, _In_ bool selected);
     IFACEMETHODIMP GetFlags(_Out_ DWORD* flags);
     IFACEMETHODIMP PutFlags(_In_ DWORD flags);
     IFACEMETHODIMP GetFilter(_Out_ DWORD* filter);
@@ -41,6 +50,11 @@ public:
     IFACEMETHODIMP PutRenameRegEx(_In_ IPowerRenameRegEx* pRegEx);
     IFACEMETHODIMP GetRenameItemFactory(_COM_Outptr_ IPowerRenameItemFactory** ppItemFactory);
     IFACEMETHODIMP PutRenameItemFactory(_In_ IPowerRenameItemFactory* pItemFactory);
+    IFACEMETHODIMP GetMetadataSource(_COM_Outptr_ IPowerRenameMetadataSource** ppMetadataSource);
+    IFACEMETHODIMP PutMetadataSource(_In_ IPowerRenameMetadataSource* pMetadataSource);
+    IFACEMETHODIMP GetFileSystem(_COM_Outptr_ IPowerRenameFileSystem** ppFileSystem);
+    IFACEMETHODIMP PutFileSystem(_In_ IPowerRenameFileSystem* pFileSystem);
+    IFACEMETHODIMP UndoRename();
 
     // IPowerRenameRegExEvents
     IFACEMETHODIMP OnSearchTermChanged(_In_ PCWSTR searchTerm);
@@ -59,8 +73,8 @@ protected:
 
     void _Cancel();
 
-    void _OnItemAdded(_In_ IPowerRenameItem* renameItem);
-    void _OnUpdate(_In_ IPowerRenameItem* renameItem);
+    void _OnItemAdded(_In_ IPowerRenameItem* renameItem, _In_ UINT count);
+    void _OnUpdate(_In_ UINT firstIndex, _In_ UINT lastIndex);
     void _OnError(_In_ IPowerRenameItem* renameItem);
     void _OnRegExStarted(_In_ DWORD threadId);
     void _OnRegExCanceled(_In_ DWORD threadId);
@@ -69,8 +83,26 @@ protected:
     void _OnRenameCompleted();
 
     void _ClearEventHandlers();
+    // Insert in the store ordered by id.  Caller holds the exclusive items lock.
+    HRESULT _AddItem(_In_ IPowerRenameItem* pItem);
     void _ClearPowerRenameItems();
 
+    // Item store helpers.  Must be called with m_lockItems held.
+    HRESULT _GetItemByIndex(_In_ UINT index, _COM_Outptr_ IPowerRenameItem** ppItem);
+    void _SetVisible();
+    // Rebuild the visible items if they changed.  Caller holds the exclusive items lock.
+    void _EnsureVisible();
+    void _InvalidateVisible();
+    // Bring the counts of selected items and items to rename up to date
+    void _EnsureCounts();
+    void _InvalidateCounts();
+
+    // Report the items changed by the regex worker since the last call
+    void _FlushUpdates();
+
+    // Indexes of the items in the preview range, in display order
+    void _GetPreviewIndexes(_Out_ std::vector<UINT>& indexes);
+
     HRESULT _PerformRegExRename();
     HRESULT _PerformFileOperation();
 
@@ -117,11 +149,39 @@ protected:
     };
 
     CComPtr<IPowerRenameItemFactory> m_spItemFactory;
+    CComPtr<IPowerRenameMetadataSource> m_spMetadataSource;
+    CComPtr<IPowerRenameFileSystem> m_spFileSystem;
     CComPtr<IPowerRenameRegEx> m_spRegEx;
 
     _Guarded_by_(m_lockEvents) std::vector<RENAME_MGR_EVENT> m_powerRenameManagerEvents;
-    _Guarded_by_(m_lockItems) std::map<int, IPowerRenameItem*> m_renameItems;
+    // Items ordered by id so they can be addressed by index in O(1)
+    _Guarded_by_(m_lockItems) std::vector<IPowerRenameItem*> m_renameItems;
+    // Item id to index in m_renameItems
+    _Guarded_by_(m_lockItems) std::unordered_map<int, UINT> m_renameItemIndexes;
     _Guarded_by_(m_lockItems) std::vector<bool> m_isVisible;
+    // Visible index to index in m_renameItems.  Rebuilt on first use after an item,
+    // its selection, its new name, the flags or the filter changed.
+    _Guarded_by_(m_lockItems) std::vector<UINT> m_visibleItemIndexes;
+    _Guarded_by_(m_lockItems) bool m_visibleValid = false;
+    // First row showing another item since GetVisibleRowRange was last called, UINT_MAX if none
+    _Guarded_by_(m_lockItems) UINT m_visibleChangedRow = UINT_MAX;
+
+    // Range of visible items shown in the list.  Their preview is computed first.
+    _Guarded_by_(m_lockItems) UINT m_previewFirst = 0;
+    _Guarded_by_(m_lockItems) UINT m_previewCount = 0;
+
+    // Kept up to date as items are added, selected and renamed by the regex worker.
+    // Counted again when m_countsValid is false (ex: the flags changed).
+    _Guarded_by_(m_lockItems) UINT m_selectedCount = 0;
+    _Guarded_by_(m_lockItems) UINT m_renameCount = 0;
+    _Guarded_by_(m_lockItems) bool m_countsValid = true;
+
+    // Preview results of previous search/replace terms, shared with the regex worker
+    std::shared_ptr<CPowerRenamePreviewCache> m_previewCache;
+    // Items changed by the regex worker, shared with it
+    std::shared_ptr<CPowerRenameUpdateQueue> m_updates;
+    // Renames done by the file operation worker, undone by UndoRename
+    std::shared_ptr<CPowerRenameJournal> m_journal;
 
     // Parent HWND used by IFileOperation
     HWND m_hwndParent = nullptr;
@@ -0,0 +1,138 @@
+#include "pch.h"
+#include "PowerRenameMetadataSource.h"
+#include "Helpers.h"
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+    // Below this many items, querying them one by one is cheaper than listing the folder
+    const UINT FolderListThreshold = 16;
+}
+
+IFACEMETHODIMP_(ULONG) CPowerRenameMetadataSource::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+IFACEMETHODIMP_(ULONG) CPowerRenameMetadataSource::Release()
+{
+    long refCount = InterlockedDecrement(&m_refCount);
+
+    if (refCount == 0)
+    {
+        delete this;
+    }
+    return refCount;
+}
+
+IFACEMETHODIMP CPowerRenameMetadataSource::QueryInterface(_In_ REFIID riid, _Outptr_ void** ppv)
+{
+    static const QITAB qit[] = {
+        QITABENT(CPowerRenameMetadataSource, IPowerRenameMetadataSource),
+        { 0 }
+    };
+    return QISearch(this, qit, riid, ppv);
+}
+
+IFACEMETHODIMP CPowerRenameMetadataSource::GetCreationTimes(_In_ PCWSTR folderPath, _In_reads_(count) PCWSTR* fileNames, _In_ UINT count, _Out_writes_(count) SYSTEMTIME* times, _Out_writes_(count) HRESULT* results)
+{
+    for (UINT i = 0; i < count; i++)
+    {
+        times[i] = { 0 };
+        results[i] = E_FAIL;
+    }
+
+    if (count >= FolderListThreshold)
+    {
+        _ListFolder(folderPath, fileNames, count, times, results);
+    }
+
+    // Items the folder listing didn't return (or all of them for a few items)
+    for (UINT i = 0; i < count; i++)
+    {
+        if (SUCCEEDED(results[i]))
+        {
+            continue;
+        }
+
+        std::wstring path(folderPath);
+        if (!path.empty() && path.back() != L'\\')
+        {
+            path += L'\\';
+        }
+        path += fileNames[i];
+
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attributes))
+        {
+            results[i] = GetLocalFileTime(attributes.ftCreationTime, &times[i]);
+        }
+        else
+        {
+            results[i] = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+
+    return S_OK;
+}
+
+void CPowerRenameMetadataSource::_ListFolder(_In_ PCWSTR folderPath, _In_reads_(count) PCWSTR* fileNames, _In_ UINT count, _Out_writes_(count) SYSTEMTIME* times, _Out_writes_(count) HRESULT* results)
+{
+    std::unordered_map<std::wstring, UINT> indexes;
+    indexes.reserve(count);
+    for (UINT i = 0; i < count; i++)
+    {
+        indexes.emplace(fileNames[i], i);
+    }
+
+    std::wstring pattern(folderPath);
+    if (!pattern.empty() && pattern.back() != L'\\')
+    {
+        pattern += L'\\';
+    }
+    pattern += L'*';
+
+    WIN32_FIND_DATAW findData;
+    HANDLE findHandle = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (findHandle == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    UINT found = 0;
+    do
+    {
+        auto it = indexes.find(findData.cFileName);
+        if (it != indexes.end() && FAILED(results[it->second]))
+        {
+            results[it->second] = GetLocalFileTime(findData.ftCreationTime, &times[it->second]);
+            found++;
+        }
+    } while (found < count && FindNextFileW(findHandle, &findData));
+
+    FindClose(findHandle);
+}
+
+HRESULT CPowerRenameMetadataSource::s_CreateInstance(_In_ REFIID iid, _Outptr_ void** resultInterface)
+{
+    *resultInterface = nullptr;
+
+    CPowerRenameMetadataSource* newMetadataSource = new CPowerRenameMetadataSource();
+    HRESULT hr = newMetadataSource ? S_OK : E_OUTOFMEMORY;
+    if (SUCCEEDED(hr))
+    {
+        hr = newMetadataSource->QueryInterface(iid, resultInterface);
+        newMetadataSource->Release();
+    }
+    return hr;
+}
+
+CPowerRenameMetadataSource::CPowerRenameMetadataSource() :
+    m_refCount(1)
+{
+}
+
+CPowerRenameMetadataSource::~CPowerRenameMetadataSource()
+{
+}
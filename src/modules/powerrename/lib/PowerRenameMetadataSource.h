@@ -0,0 +1,28 @@
+#pragma once
+#include "pch.h"
+#include "PowerRenameInterfaces.h"
+
+// Reads creation times from the file system.  Folders with many requested items are
+// listed once instead of querying each item.  Can be called from several threads at once.
+class CPowerRenameMetadataSource :
+    public IPowerRenameMetadataSource
+{
+public:
+    // IUnknown
+    IFACEMETHODIMP QueryInterface(_In_ REFIID iid, _Outptr_ void** resultInterface);
+    IFACEMETHODIMP_(ULONG) AddRef();
+    IFACEMETHODIMP_(ULONG) Release();
+
+    // IPowerRenameMetadataSource
+    IFACEMETHODIMP GetCreationTimes(_In_ PCWSTR folderPath, _In_reads_(count) PCWSTR* fileNames, _In_ UINT count, _Out_writes_(count) SYSTEMTIME* times, _Out_writes_(count) HRESULT* results);
+
+    static HRESULT s_CreateInstance(_In_ REFIID iid, _Outptr_ void** resultInterface);
+
+protected:
+    CPowerRenameMetadataSource();
+    virtual ~CPowerRenameMetadataSource();
+
+    void _ListFolder(_In_ PCWSTR folderPath, _In_reads_(count) PCWSTR* fileNames, _In_ UINT count, _Out_writes_(count) SYSTEMTIME* times, _Out_writes_(count) HRESULT* results);
+
+    long m_refCount = 0;
+};
@@ -0,0 +1,169 @@
+#include "pch.h"
+#include "PowerRenamePattern.h"
+#include <algorithm>
+
+CPowerRenamePattern::CPowerRenamePattern(_In_ PCWSTR searchTerm, _In_ PCWSTR replaceTerm, _In_ DWORD flags, _In_ bool useBoostLib) :
+    m_searchTerm(searchTerm ? searchTerm : L""),
+    m_literalMatcher(m_searchTerm.c_str(), (flags & CaseSensitive) != 0),
+    m_replaceTerm(replaceTerm ? replaceTerm : L""),
+    m_dateTemplate(m_replaceTerm.c_str()),
+    m_flags(flags),
+    m_useBoostLib(useBoostLib)
+{
+    m_usesFileTime = m_dateTemplate.UsesFileTime();
+
+    try
+    {
+        // Items without a file time use the replace term as typed.  When file time tokens
+        // are used, items with a file time have the term expanded and pre-processed in Replace.
+        m_formatTerm = _PreprocessReplaceTerm(m_replaceTerm);
+
+        if ((m_flags & UseRegularExpressions) && !m_searchTerm.empty())
+        {
+            if (m_useBoostLib)
+            {
+                m_boostPattern.emplace(m_searchTerm, (!(m_flags & CaseSensitive)) ? boost::regex::icase | boost::regex::ECMAScript : boost::regex::ECMAScript);
+            }
+            else
+            {
+                m_stdPattern.emplace(m_searchTerm, (!(m_flags & CaseSensitive)) ? std::regex_constants::icase | std::regex_constants::ECMAScript : std::regex_constants::ECMAScript);
+            }
+        }
+    }
+    catch (const std::regex_error&)
+    {
+        // The search term is most likely still being typed
+        m_compileResult = E_FAIL;
+    }
+    catch (const boost::regex_error&)
+    {
+        m_compileResult = E_FAIL;
+    }
+}
+
+HRESULT CPowerRenamePattern::Replace(_In_ PCWSTR source, _In_opt_ const SYSTEMTIME* fileTime, _Outptr_ PWSTR* result) const
+{
+    *result = nullptr;
+
+    HRESULT hr = S_OK;
+    if (m_searchTerm.empty() || !source || wcslen(source) == 0)
+    {
+        return hr;
+    }
+
+    if (FAILED(m_compileResult))
+    {
+        return m_compileResult;
+    }
+
+    try
+    {
+        std::wstring res;
+        if (fileTime && m_usesFileTime)
+        {
+            std::wstring replaceTerm = m_dateTemplate.Format(*fileTime);
+            if (replaceTerm.length() >= MAX_PATH)
+            {
+                // Too long to be used in a file name, keep the tokens as typed
+                replaceTerm = m_replaceTerm;
+            }
+
+            hr = _Replace(source, _PreprocessReplaceTerm(replaceTerm), res);
+        }
+        else
+        {
+            hr = _Replace(source, m_formatTerm, res);
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            hr = SHStrDup(res.c_str(), result);
+        }
+    }
+    catch (const std::regex_error&)
+    {
+        hr = E_FAIL;
+    }
+    catch (const boost::regex_error&)
+    {
+        hr = E_FAIL;
+    }
+
+    return hr;
+}
+
+std::wstring CPowerRenamePattern::_PreprocessReplaceTerm(_In_ const std::wstring& replaceTerm)
+{
+    // Compiled once, only ever used read-only afterwards
+    static const std::wregex zeroGroupPattern(L"(([^\\$]|^)(\\$\\$)*)\\$[0]");
+    static const std::wregex numberedGroupPattern(L"(([^\\$]|^)(\\$\\$)*)\\$([1-9])");
+
+    std::wstring res = std::regex_replace(replaceTerm, zeroGroupPattern, L"$1$$$0");
+    return std::regex_replace(res, numberedGroupPattern, L"$1$0$4");
+}
+
+HRESULT CPowerRenamePattern::_Replace(_In_ const std::wstring& source, _In_ const std::wstring& replaceTerm, _Out_ std::wstring& result) const
+{
+    if (m_flags & UseRegularExpressions)
+    {
+        if (m_boostPattern)
+        {
+            if (m_flags & MatchAllOccurences)
+            {
+                result = boost::regex_replace(source, *m_boostPattern, replaceTerm);
+            }
+            else
+            {
+                result = boost::regex_replace(source, *m_boostPattern, replaceTerm, boost::regex_constants::format_first_only);
+            }
+        }
+        else if (m_stdPattern)
+        {
+            if (m_flags & MatchAllOccurences)
+            {
+                result = std::regex_replace(source, *m_stdPattern, replaceTerm);
+            }
+            else
+            {
+                result = std::regex_replace(source, *m_stdPattern, replaceTerm, std::regex_constants::format_first_only);
+            }
+        }
+        else
+        {
+            return E_FAIL;
+        }
+    }
+    else
+    {
+        // Simple search and replace.  Occurrences are found in the source in a single
+        // pass and the result is built from the text between them.
+        result.clear();
+        result.reserve(source.length());
+        size_t start = 0;
+        size_t pos = m_literalMatcher.Find(source.c_str(), source.length(), 0);
+        while (pos != std::wstring::npos)
+        {
+            result.append(source, start, pos - start);
+            result.append(replaceTerm);
+            start = pos + m_literalMatcher.GetLength();
+
+            if (!(m_flags & MatchAllOccurences))
+            {
+                break;
+            }
+
+            pos = m_literalMatcher.Find(source.c_str(), source.length(), start);
+        }
+
+        result.append(source, start, std::wstring::npos);
+    }
+
+    return S_OK;
+}
+
+std::wstring CPowerRenamePattern::s_FoldCase(_In_ const std::wstring& text)
+{
+    std::wstring folded(text);
+    std::transform(folded.begin(), folded.end(), folded.begin(), CPowerRenameLiteralMatcher::s_FoldCase);
+    return folded;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "pch.h"
+#include <optional>
+#include <regex>
+#include <string>
+#include <boost/regex.hpp>
+
+#include "PowerRenameDateTemplate.h"
+#include "PowerRenameLiteralMatcher.h"
+#include "PowerRenameInterfaces.h"
+
+// Compiled form of the search term, replace term and flags of a CPowerRenameRegEx.
+// It is built once whenever one of them changes and is immutable afterwards so a
+// single instance can be shared by any number of threads running Replace.
+class CPowerRenamePattern
+{
+public:
+    CPowerRenamePattern(_In_ PCWSTR searchTerm, _In_ PCWSTR replaceTerm, _In_ DWORD flags, _In_ bool useBoostLib);
+
+    // Replace the search term in source.  fileTime is only used when the replace
+    // term contains date/time tokens ($YYYY, $MM, ...).
+    HRESULT Replace(_In_ PCWSTR source, _In_opt_ const SYSTEMTIME* fileTime, _Outptr_ PWSTR* result) const;
+
+    bool HasSearchTerm() const { return !m_searchTerm.empty(); }
+    bool UsesFileTime() const { return m_usesFileTime; }
+    DWORD GetFlags() const { return m_flags; }
+    HRESULT GetCompileResult() const { return m_compileResult; }
+
+    // Case folding used by the case insensitive literal search
+    static std::wstring s_FoldCase(_In_ const std::wstring& text);
+
+protected:
+    static std::wstring _PreprocessReplaceTerm(_In_ const std::wstring& replaceTerm);
+
+    HRESULT _Replace(_In_ const std::wstring& source, _In_ const std::wstring& replaceTerm, _Out_ std::wstring& result) const;
+
+    std::wstring m_searchTerm;
+    // Search term of a simple search and replace, folded once for all items
+    CPowerRenameLiteralMatcher m_literalMatcher;
+    // Replace term as typed by the user
+    std::wstring m_replaceTerm;
+    // File time tokens of the replace term, expanded for each item
+    CPowerRenameDateTemplate m_dateTemplate;
+    // Replace term with $0/$N already rewritten for the regex formatter
+    std::wstring m_formatTerm;
+
+    DWORD m_flags = 0;
+    bool m_useBoostLib = false;
+    bool m_usesFileTime = false;
+    HRESULT m_compileResult = S_OK;
+
+    std::optional<std::wregex> m_stdPattern;
+    std::optional<boost::wregex> m_boostPattern;
+};
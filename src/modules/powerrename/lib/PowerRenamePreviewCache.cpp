@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "PowerRenamePreviewCache.h"
+#include "PowerRenameInterfaces.h"
+#include "PowerRenamePattern.h"
+#include <algorithm>
+
+namespace
+{
+    // Flags that change which items a literal search term is found in
+    const DWORD MatchingFlags = CaseSensitive | NameOnly | ExtensionOnly | UseRegularExpressions;
+}
+
+std::shared_ptr<CPowerRenamePreviewCache::Results> CPowerRenamePreviewCache::GetResults(_In_ const PreviewKey& key, _In_ UINT itemCount)
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+
+    std::shared_ptr<Results> results;
+    auto it = std::find_if(m_results.begin(), m_results.end(), [&](const auto& cached) { return cached->key == key; });
+    if (it != m_results.end())
+    {
+        results = *it;
+        m_results.erase(it);
+    }
+    else
+    {
+        results = std::make_shared<Results>();
+        results->key = key;
+        if (m_results.size() >= MaxCachedResults)
+        {
+            m_results.pop_back();
+        }
+    }
+
+    // Items can still be added while the preview is computed
+    results->items.resize(itemCount);
+    m_results.insert(m_results.begin(), results);
+    return results;
+}
+
+std::shared_ptr<const CPowerRenamePreviewCache::Results> CPowerRenamePreviewCache::FindNarrowingResults(_In_ const PreviewKey& key)
+{
+    if (!s_IsLiteralSearch(key))
+    {
+        return nullptr;
+    }
+
+    const std::wstring matchingTerm = s_GetMatchingTerm(key);
+
+    CSRWSharedAutoLock lock(&m_lock);
+
+    std::shared_ptr<const Results> narrowing;
+    size_t narrowingLength = 0;
+    for (const auto& cached : m_results)
+    {
+        if (cached->key == key || !s_IsLiteralSearch(cached->key) || (cached->key.flags & MatchingFlags) != (key.flags & MatchingFlags))
+        {
+            continue;
+        }
+
+        // The longest contained term rules out the most items
+        const std::wstring cachedTerm = s_GetMatchingTerm(cached->key);
+        if (cachedTerm.length() > narrowingLength && matchingTerm.find(cachedTerm) != std::wstring::npos)
+        {
+            narrowing = cached;
+            narrowingLength = cachedTerm.length();
+        }
+    }
+
+    return narrowing;
+}
+
+void CPowerRenamePreviewCache::Clear()
+{
+    CSRWExclusiveAutoLock lock(&m_lock);
+    m_results.clear();
+}
+
+bool CPowerRenamePreviewCache::s_IsLiteralSearch(_In_ const PreviewKey& key)
+{
+    return !(key.flags & UseRegularExpressions) && !key.searchTerm.empty();
+}
+
+std::wstring CPowerRenamePreviewCache::s_GetMatchingTerm(_In_ const PreviewKey& key)
+{
+    return (key.flags & CaseSensitive) ? key.searchTerm : CPowerRenamePattern::s_FoldCase(key.searchTerm);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "pch.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include "srwlock.h"
+
+// Result of the regex worker for one item, before enumeration is applied
+struct PreviewItemResult
+{
+    int id = -1;
+    bool computed = false;
+    bool excluded = false;
+    bool hasNewName = false;
+    // Literal searches only: false when the source name doesn't contain the search term,
+    // in which case it can't contain a longer term that contains this one either.
+    bool mayMatch = true;
+    std::wstring newName;
+};
+
+// Search term, replace term and flags a preview was computed with
+struct PreviewKey
+{
+    std::wstring searchTerm;
+    std::wstring replaceTerm;
+    DWORD flags = 0;
+
+    bool operator==(const PreviewKey& other) const
+    {
+        return flags == other.flags && searchTerm == other.searchTerm && replaceTerm == other.replaceTerm;
+    }
+};
+
+// Per-item preview results of the last few search/replace terms.  Lets the regex worker
+// reuse results when a term is typed again (ex: backspace) and skip the search for items
+// that can't match when a literal search term is extended.
+// A set of results is only used by one regex worker at a time.
+class CPowerRenamePreviewCache
+{
+public:
+    struct Results
+    {
+        PreviewKey key;
+        // Indexed like the items of the manager
+        std::vector<PreviewItemResult> items;
+    };
+
+    // Results for key, sized to itemCount.  Empty if they were not cached yet.
+    std::shared_ptr<Results> GetResults(_In_ const PreviewKey& key, _In_ UINT itemCount);
+
+    // Cached results of a literal search with the same matching flags whose term is
+    // contained in the literal search term of key.  nullptr if there are none.
+    std::shared_ptr<const Results> FindNarrowingResults(_In_ const PreviewKey& key);
+
+    void Clear();
+
+    static bool s_IsLiteralSearch(_In_ const PreviewKey& key);
+    // Search term as it is compared with source names (case folded unless case sensitive)
+    static std::wstring s_GetMatchingTerm(_In_ const PreviewKey& key);
+
+private:
+    // Each set of results holds a name per item, keep only a few of them
+    static const size_t MaxCachedResults = 4;
+
+    CSRWLock m_lock;
+    // Most recently used first
+    _Guarded_by_(m_lock) std::vector<std::shared_ptr<Results>> m_results;
+};
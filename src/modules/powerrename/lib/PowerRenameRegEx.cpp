@@ -1,15 +1,9 @@
 #include "pch.h"
 #include "PowerRenameRegEx.h"
 #include "Settings.h"
-#include <regex>
 #include <string>
-#include <algorithm>
-#include <boost/regex.hpp>
 #include <helpers.h>
 
-using namespace std;
-using std::regex_error;
-
 IFACEMETHODIMP_(ULONG) CPowerRenameRegEx::AddRef()
 {
     return InterlockedIncrement(&m_refCount);
@@ -97,6 +91,7 @@ IFACEMETHODIMP CPowerRenameRegEx::PutSearchTerm(_In_ PCWSTR searchTerm)
             changed = true;
             CoTaskMemFree(m_searchTerm);
             hr = SHStrDup(searchTerm, &m_searchTerm);
+            _CompilePattern();
         }
     }
 
@@ -132,6 +127,7 @@ IFACEMETHODIMP CPowerRenameRegEx::PutReplaceTerm(_In_ PCWSTR replaceTerm)
             changed = true;
             CoTaskMemFree(m_replaceTerm);
             hr = SHStrDup(replaceTerm, &m_replaceTerm);
+            _CompilePattern();
         }
     }
 
@@ -153,7 +149,11 @@ IFACEMETHODIMP CPowerRenameRegEx::PutFlags(_In_ DWORD flags)
 {
     if (m_flags != flags)
     {
-        m_flags = flags;
+        {
+            CSRWExclusiveAutoLock lock(&m_lock);
+            m_flags = flags;
+            _CompilePattern();
+        }
         _OnFlagsChanged();
     }
     return S_OK;
@@ -175,8 +175,11 @@ IFACEMETHODIMP CPowerRenameRegEx::PutFileTime(_In_ SYSTEMTIME fileTime)
 
     if (ft2.ul.QuadPart != ft1.ul.QuadPart)
     {
-        m_fileTime = fileTime;
-        m_useFileTime = true;
+        {
+            CSRWExclusiveAutoLock lock(&m_lock);
+            m_fileTime = fileTime;
+            m_useFileTime = true;
+        }
         _OnFileTimeChanged();
     }
     return S_OK;
@@ -185,8 +188,11 @@ IFACEMETHODIMP CPowerRenameRegEx::PutFileTime(_In_ SYSTEMTIME fileTime)
 IFACEMETHODIMP CPowerRenameRegEx::ResetFileTime()
 {
     SYSTEMTIME ZERO = { 0 };
-    m_fileTime = ZERO;
-    m_useFileTime = false;
+    {
+        CSRWExclusiveAutoLock lock(&m_lock);
+        m_fileTime = ZERO;
+        m_useFileTime = false;
+    }
     _OnFileTimeChanged();
     return S_OK;
 }
@@ -213,6 +219,9 @@ CPowerRenameRegEx::CPowerRenameRegEx() :
     SHStrDup(L"", &m_replaceTerm);
 
     _useBoostLib = CSettingsInstance().GetUseBoostLib();
+
+    CSRWExclusiveAutoLock lock(&m_lock);
+    _CompilePattern();
 }
 
 CPowerRenameRegEx::~CPowerRenameRegEx()
@@ -225,106 +234,57 @@ HRESULT CPowerRenameRegEx::Replace(_In_ PCWSTR source, _Outptr_ PWSTR* result)
 {
     *result = nullptr;
 
-    CSRWSharedAutoLock lock(&m_lock);
-    HRESULT hr = S_OK;
-    if (!(m_searchTerm && wcslen(m_searchTerm) > 0 && source && wcslen(source) > 0))
+    std::shared_ptr<const CPowerRenamePattern> pattern;
+    SYSTEMTIME fileTime = { 0 };
+    bool useFileTime = false;
+    // Scope lock
     {
-        return hr;
+        CSRWSharedAutoLock lock(&m_lock);
+        pattern = m_pattern;
+        fileTime = m_fileTime;
+        useFileTime = m_useFileTime;
     }
-    wstring res = source;
-    try
-    {
-        // TODO: creating the regex could be costly.  May want to cache this.
-        wchar_t newReplaceTerm[MAX_PATH] = { 0 };
-        bool fileTimeErrorOccurred = false;
-        if (m_useFileTime)
-        {
-            if (FAILED(GetDatedFileName(newReplaceTerm, ARRAYSIZE(newReplaceTerm), m_replaceTerm, m_fileTime)))
-                fileTimeErrorOccurred = true;
-        }
 
-        std::wstring sourceToUse(source);
-        std::wstring searchTerm(m_searchTerm);
-        std::wstring replaceTerm(L"");
-        if (m_useFileTime && !fileTimeErrorOccurred)
-        {
-            replaceTerm = wstring(newReplaceTerm);
-        }
-        else if (m_replaceTerm)
-        {
-            replaceTerm = wstring(m_replaceTerm);
-        }
+    if (!pattern)
+    {
+        return E_FAIL;
+    }
 
-        replaceTerm = regex_replace(replaceTerm, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$[0]"), L"$1$$$0");
-        replaceTerm = regex_replace(replaceTerm, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$([1-9])"), L"$1$0$4");
+    // The compiled pattern is immutable so the lock does not need to be held while replacing
+    return pattern->Replace(source, useFileTime ? &fileTime : nullptr, result);
+}
 
-        if (m_flags & UseRegularExpressions)
-        {
-            if (_useBoostLib)
-            {
-                boost::wregex pattern(m_searchTerm, (!(m_flags & CaseSensitive)) ? boost::regex::icase | boost::regex::ECMAScript : boost::regex::ECMAScript);
-                if (m_flags & MatchAllOccurences)
-                {
-                    res = boost::regex_replace(wstring(source), pattern, replaceTerm);
-                }
-                else
-                {
-                    res = boost::regex_replace(wstring(source), pattern, replaceTerm, boost::regex_constants::format_first_only);
-                }
-            }
-            else
-            {
-                std::wregex pattern(m_searchTerm, (!(m_flags & CaseSensitive)) ? regex_constants::icase | regex_constants::ECMAScript : regex_constants::ECMAScript);
-                if (m_flags & MatchAllOccurences)
-                {
-                    res = regex_replace(wstring(source), pattern, replaceTerm);
-                }
-                else
-                {
-                    res = regex_replace(wstring(source), pattern, replaceTerm, regex_constants::format_first_only);
-                }
-            }
-        }
-        else
-        {
-            // Simple search and replace
-            size_t pos = 0;
-            do
-            {
-                pos = _Find(sourceToUse, searchTerm, (!(m_flags & CaseSensitive)), pos);
-                if (pos != std::string::npos)
-                {
-                    res = sourceToUse.replace(pos, searchTerm.length(), replaceTerm);
-                    pos += replaceTerm.length();
-                }
-
-                if (!(m_flags & MatchAllOccurences))
-                {
-                    break;
-                }
-            } while (pos != std::string::npos);
-        }
+// Same as Replace but uses the given file time instead of the one set with PutFileTime.
+// Does not modify any state so it can be called for many items concurrently.
+HRESULT CPowerRenameRegEx::ReplaceWithFileTime(_In_ PCWSTR source, _In_ SYSTEMTIME fileTime, _Outptr_ PWSTR* result)
+{
+    *result = nullptr;
 
-        hr = SHStrDup(res.c_str(), result);
+    std::shared_ptr<const CPowerRenamePattern> pattern;
+    // Scope lock
+    {
+        CSRWSharedAutoLock lock(&m_lock);
+        pattern = m_pattern;
     }
-    catch (regex_error e)
+
+    if (!pattern)
     {
-        hr = E_FAIL;
+        return E_FAIL;
     }
-    return hr;
+
+    return pattern->Replace(source, &fileTime, result);
 }
 
-size_t CPowerRenameRegEx::_Find(std::wstring data, std::wstring toSearch, bool caseInsensitive, size_t pos)
+void CPowerRenameRegEx::_CompilePattern()
 {
-    if (caseInsensitive)
+    try
     {
-        // Convert to lower
-        std::transform(data.begin(), data.end(), data.begin(), ::towlower);
-        std::transform(toSearch.begin(), toSearch.end(), toSearch.begin(), ::towlower);
+        m_pattern = std::make_shared<const CPowerRenamePattern>(m_searchTerm, m_replaceTerm, m_flags, _useBoostLib);
+    }
+    catch (const std::bad_alloc&)
+    {
+        m_pattern = nullptr;
     }
-
-    // Find sub string position in given string starting at position pos
-    return data.find(toSearch, pos);
 }
 
 void CPowerRenameRegEx::_OnSearchTermChanged()
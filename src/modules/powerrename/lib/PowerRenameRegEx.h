@@ -2,9 +2,11 @@
 #include "pch.h"
 #include <vector>
 #include <string>
+#include <memory>
 #include "srwlock.h"
 
 #include "PowerRenameInterfaces.h"
+#include "PowerRenamePattern.h"
 
 #define DEFAULT_FLAGS MatchAllOccurences
 
@@ -28,6 +30,7 @@ public:
     IFACEMETHODIMP PutFileTime(_In_ SYSTEMTIME fileTime);
     IFACEMETHODIMP ResetFileTime();
     IFACEMETHODIMP Replace(_In_ PCWSTR source, _Outptr_ PWSTR* result);
+    IFACEMETHODIMP ReplaceWithFileTime(_In_ PCWSTR source, _In_ SYSTEMTIME fileTime, _Outptr_ PWSTR* result);
 
     static HRESULT s_CreateInstance(_Outptr_ IPowerRenameRegEx **renameRegEx);
 
@@ -40,7 +43,8 @@ protected:
     void _OnFlagsChanged();
     void _OnFileTimeChanged();
 
-    size_t _Find(std::wstring data, std::wstring toSearch, bool caseInsensitive, size_t pos);
+    // Rebuild the compiled pattern.  Must be called with m_lock held exclusively.
+    void _CompilePattern();
 
     bool _useBoostLib = false;
     DWORD m_flags = DEFAULT_FLAGS;
@@ -53,6 +57,8 @@ protected:
     CSRWLock m_lock;
     CSRWLock m_lockEvents;
 
+    _Guarded_by_(m_lock) std::shared_ptr<const CPowerRenamePattern> m_pattern;
+
     DWORD m_cookie = 0;
 
     struct RENAME_REGEX_EVENT
@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "PowerRenameStringArena.h"
+
+PCWSTR CPowerRenameStringArena::Store(_In_reads_(length) PCWSTR source, _In_ size_t length)
+{
+    const size_t needed = length + 1;
+    wchar_t* dest = nullptr;
+
+    // Scope lock
+    {
+        CSRWExclusiveAutoLock lock(&m_lock);
+        if (needed <= m_available)
+        {
+            dest = m_next;
+            m_next += needed;
+            m_available -= needed;
+        }
+        else
+        {
+            // Strings that would waste much of a block get a block of their own and the
+            // current block stays in use
+            const bool ownBlock = needed > m_blockLength / 2;
+            const size_t blockLength = ownBlock ? needed : m_blockLength;
+            std::unique_ptr<wchar_t[]> block(new (std::nothrow) wchar_t[blockLength]);
+            if (!block)
+            {
+                return nullptr;
+            }
+
+            dest = block.get();
+            if (!ownBlock)
+            {
+                m_next = dest + needed;
+                m_available = blockLength - needed;
+            }
+
+            m_blocks.push_back(std::move(block));
+            m_size += blockLength * sizeof(wchar_t);
+        }
+    }
+
+    // The space is only ours so the copy needs no lock
+    wmemcpy(dest, source, length);
+    dest[length] = L'\0';
+    return dest;
+}
+
+size_t CPowerRenameStringArena::GetSize()
+{
+    CSRWSharedAutoLock lock(&m_lock);
+    return m_size;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "pch.h"
+#include <memory>
+#include <vector>
+#include "srwlock.h"
+
+// Strings of a rename session that live as long as the session.  Strings are copied
+// back to back into large blocks instead of being allocated one by one, and are only
+// freed, all at once, when the last item sharing the arena is released.
+// Strings can be stored from any number of threads.
+class CPowerRenameStringArena
+{
+public:
+    static const size_t s_defaultBlockLength = 64 * 1024;
+
+    // blockLength is the number of characters allocated at once.  0 allocates
+    // exactly what each string needs.
+    explicit CPowerRenameStringArena(_In_ size_t blockLength = s_defaultBlockLength) :
+        m_blockLength(blockLength)
+    {
+    }
+
+    CPowerRenameStringArena(const CPowerRenameStringArena&) = delete;
+    CPowerRenameStringArena& operator=(const CPowerRenameStringArena&) = delete;
+
+    // Null terminated copy of the string, nullptr if out of memory
+    PCWSTR Store(_In_reads_(length) PCWSTR source, _In_ size_t length);
+    PCWSTR Store(_In_ PCWSTR source) { return Store(source, wcslen(source)); }
+
+    // Bytes allocated by the arena
+    size_t GetSize();
+
+private:
+    CSRWLock m_lock;
+    std::vector<std::unique_ptr<wchar_t[]>> m_blocks;
+    const size_t m_blockLength;
+    wchar_t* m_next = nullptr;
+    size_t m_available = 0;
+    size_t m_size = 0;
+};
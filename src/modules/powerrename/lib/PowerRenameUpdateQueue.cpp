@@ -0,0 +1,49 @@
+#include "pch.h"
+#include "PowerRenameUpdateQueue.h"
+
+bool CPowerRenameUpdateQueue::Push(_In_ UINT index, _In_ int renameCountDelta)
+{
+    UINT first = m_first.load();
+    while (index < first && !m_first.compare_exchange_weak(first, index))
+    {
+    }
+
+    UINT last = m_last.load();
+    while (index > last && !m_last.compare_exchange_weak(last, index))
+    {
+    }
+
+    if (renameCountDelta != 0)
+    {
+        m_renameCountDelta += renameCountDelta;
+        m_renameStateChanged = true;
+    }
+
+    // Only the first change since the manager took the updates needs to be reported
+    return !m_pending.exchange(true);
+}
+
+bool CPowerRenameUpdateQueue::Take(_Out_ UINT* first, _Out_ UINT* last, _Out_ int* renameCountDelta, _Out_ bool* renameStateChanged)
+{
+    // No item changes while the updates are taken
+    CSRWExclusiveAutoLock lock(&m_itemLock);
+
+    *first = m_first.exchange(UINT_MAX);
+    *last = m_last.exchange(0);
+    *renameCountDelta = m_renameCountDelta.exchange(0);
+    *renameStateChanged = m_renameStateChanged.exchange(false);
+    m_pending = false;
+
+    return *first <= *last;
+}
+
+int CPowerRenameUpdateQueue::TakeRenameCountDelta()
+{
+    CSRWExclusiveAutoLock lock(&m_itemLock);
+    return m_renameCountDelta.exchange(0);
+}
+
+void CPowerRenameUpdateQueue::ClearRenameCountDelta()
+{
+    m_renameCountDelta = 0;
+}
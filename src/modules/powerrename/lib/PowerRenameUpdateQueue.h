@@ -0,0 +1,39 @@
+#pragma once
+#include "pch.h"
+#include <atomic>
+#include "srwlock.h"
+
+// Items changed by the regex workers that the manager thread hasn't reported yet.
+// Changes are merged into a single range of item indexes so the manager is told
+// once for any number of changed items instead of once per item.
+class CPowerRenameUpdateQueue
+{
+public:
+    // Held shared by the regex workers while they change an item and exclusive by the
+    // manager while it counts the items, so a count sees each change exactly once.
+    CSRWLock* GetItemLock() { return &m_itemLock; }
+
+    // Record a change of the item at index.  Called with the item lock held shared.
+    // Returns true when the manager has to be told there are pending updates.
+    bool Push(_In_ UINT index, _In_ int renameCountDelta);
+
+    // Take the pending updates.  renameStateChanged is true if an item changed from being
+    // renamed to not being renamed or back.  Returns false if there are none.
+    bool Take(_Out_ UINT* first, _Out_ UINT* last, _Out_ int* renameCountDelta, _Out_ bool* renameStateChanged);
+
+    // Take the pending change of the number of items to rename, leaving the changed
+    // items to be reported.
+    int TakeRenameCountDelta();
+
+    // Forget the pending changes of the number of items to rename.  Called with the
+    // item lock held exclusive by a count that already includes them.
+    void ClearRenameCountDelta();
+
+private:
+    CSRWLock m_itemLock;
+    std::atomic<bool> m_pending = false;
+    std::atomic<UINT> m_first = UINT_MAX;
+    std::atomic<UINT> m_last = 0;
+    std::atomic<int> m_renameCountDelta = 0;
+    std::atomic<bool> m_renameStateChanged = false;
+};
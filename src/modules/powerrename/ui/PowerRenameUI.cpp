@@ -14,6 +14,10 @@
 
 extern HINSTANCE g_hInst;
 
+// Items updated by the preview are redrawn at most once per frame
+#define TIMERID_REFRESHLIST 102
+#define REFRESH_LIST_INTERVAL 16
+
 enum
 {
     MATCHMODE_FULLNAME = 0,
@@ -167,7 +171,7 @@ IFACEMETHODIMP CPowerRenameUI::GetShowUI(_Out_ bool* showUI)
 }
 
 // IPowerRenameManagerEvents
-IFACEMETHODIMP CPowerRenameUI::OnItemAdded(_In_ IPowerRenameItem*)
+IFACEMETHODIMP CPowerRenameUI::OnItemAdded(_In_ IPowerRenameItem*, _In_ UINT)
 {
     // Check if the user canceled the enumeration from the progress dialog UI
     if (m_prpui.IsCanceled())
@@ -183,16 +187,20 @@ IFACEMETHODIMP CPowerRenameUI::OnItemAdded(_In_ IPowerRenameItem*)
     return S_OK;
 }
 
-IFACEMETHODIMP CPowerRenameUI::OnUpdate(_In_ IPowerRenameItem*)
+IFACEMETHODIMP CPowerRenameUI::OnUpdate(_In_ UINT firstIndex, _In_ UINT lastIndex)
 {
-    UINT visibleItemCount = 0;
-    if (m_spsrm)
+    if (m_hasDirtyItems)
     {
-        m_spsrm->GetVisibleItemCount(&visibleItemCount);
+        m_dirtyFirst = min(m_dirtyFirst, firstIndex);
+        m_dirtyLast = max(m_dirtyLast, lastIndex);
+    }
+    else
+    {
+        m_dirtyFirst = firstIndex;
+        m_dirtyLast = lastIndex;
+        m_hasDirtyItems = true;
+        SetTimer(m_hwnd, TIMERID_REFRESHLIST, REFRESH_LIST_INTERVAL, nullptr);
     }
-    m_listview.SetItemCount(visibleItemCount);
-    m_listview.RedrawItems(0, visibleItemCount);
-    _UpdateCounts();
     return S_OK;
 }
 
@@ -203,7 +211,6 @@ IFACEMETHODIMP CPowerRenameUI::OnError(_In_ IPowerRenameItem*)
 
 IFACEMETHODIMP CPowerRenameUI::OnRegExStarted(_In_ DWORD threadId)
 {
-    m_disableCountUpdate = true;
     m_currentRegExId = threadId;
     _UpdateCounts();
     return S_OK;
@@ -213,7 +220,7 @@ IFACEMETHODIMP CPowerRenameUI::OnRegExCanceled(_In_ DWORD threadId)
 {
     if (m_currentRegExId == threadId)
     {
-        m_disableCountUpdate = false;
+        _RefreshList();
         _UpdateCounts();
     }
 
@@ -222,10 +229,10 @@ IFACEMETHODIMP CPowerRenameUI::OnRegExCanceled(_In_ DWORD threadId)
 
 IFACEMETHODIMP CPowerRenameUI::OnRegExCompleted(_In_ DWORD threadId)
 {
-    // Enable list view
+    // Show the last updates now rather than on the next frame
     if (m_currentRegExId == threadId)
     {
-        m_disableCountUpdate = false;
+        _RefreshList();
         _UpdateCounts();
     }
     return S_OK;
@@ -392,8 +399,6 @@ HRESULT CPowerRenameUI::_EnumerateItems(_In_ IUnknown* pdtobj)
     // Enumerate the data object and populate the manager
     if (m_spsrm)
     {
-        m_disableCountUpdate = true;
-
         // Ensure we re-create the enumerator
         m_sppre = nullptr;
         hr = CPowerRenameEnum::s_CreateInstance(pdtobj, m_spsrm, IID_PPV_ARGS(&m_sppre));
@@ -404,8 +409,6 @@ HRESULT CPowerRenameUI::_EnumerateItems(_In_ IUnknown* pdtobj)
             m_prpui.Stop();
         }
 
-        m_disableCountUpdate = false;
-
         if (SUCCEEDED(hr))
         {
             UINT itemCount = 0;
@@ -610,6 +613,13 @@ INT_PTR CPowerRenameUI::_DlgProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
         _OnGetMinMaxInfo(lParam);
         break;
 
+    case WM_TIMER:
+        if (wParam == TIMERID_REFRESHLIST)
+        {
+            _RefreshList();
+        }
+        break;
+
     case WM_CLOSE:
         _OnCloseDlg();
         break;
@@ -820,6 +830,15 @@ BOOL CPowerRenameUI::_OnNotify(_In_ WPARAM wParam, _In_ LPARAM lParam)
             }
             break;
 
+        case LVN_ODCACHEHINT:
+            if (m_spsrm)
+            {
+                // Rows about to be displayed get their preview first on the next search
+                LPNMLVCACHEHINT cacheHint = (LPNMLVCACHEHINT)lParam;
+                m_spsrm->PutPreviewRange(cacheHint->iFrom, cacheHint->iTo);
+            }
+            break;
+
         case NM_CLICK:
         {
             if (m_spsrm)
@@ -1029,15 +1048,37 @@ void CPowerRenameUI::_ValidateFlagCheckbox(_In_ DWORD checkBoxId)
     }
 }
 
-void CPowerRenameUI::_UpdateCounts()
+void CPowerRenameUI::_RefreshList()
 {
-    // This method is CPU intensive.  We disable it during certain operations
-    // for performance reasons.
-    if (m_disableCountUpdate)
+    KillTimer(m_hwnd, TIMERID_REFRESHLIST);
+    if (!m_hasDirtyItems)
     {
         return;
     }
+    m_hasDirtyItems = false;
+
+    if (m_spsrm)
+    {
+        // The visible items are only built again if the updates changed which items are shown
+        UINT visibleItemCount = 0;
+        m_spsrm->GetVisibleItemCount(&visibleItemCount);
+        m_listview.SetItemCount(visibleItemCount);
+
+        // Updates are reported by item index, redraw the rows of those items that are scrolled into view
+        UINT firstRow = 0;
+        UINT lastRow = 0;
+        if (m_spsrm->GetVisibleRowRange(m_dirtyFirst, m_dirtyLast, &firstRow, &lastRow) == S_OK)
+        {
+            m_listview.RedrawVisibleItems(firstRow, lastRow);
+        }
+    }
+
+    _UpdateCounts();
+}
 
+void CPowerRenameUI::_UpdateCounts()
+{
+    // The counts are kept up to date by the manager so this is cheap
     UINT selectedCount = 0;
     UINT renamingCount = 0;
     if (m_spsrm)
@@ -1159,7 +1200,7 @@ void CPowerRenameListView::ToggleAll(_In_ IPowerRenameManager* psrm, _In_ bool s
             CComPtr<IPowerRenameItem> spItem;
             if (SUCCEEDED(psrm->GetItemByIndex(i, &spItem)))
             {
-                spItem->PutSelected(selected);
+                psrm->PutItemSelected(spItem, selected);
             }
         }
 
@@ -1176,7 +1217,7 @@ void CPowerRenameListView::ToggleItem(_In_ IPowerRenameManager* psrm, _In_ int i
     {
         bool selected = false;
         spItem->GetSelected(&selected);
-        spItem->PutSelected(!selected);
+        psrm->PutItemSelected(spItem, !selected);
 
         UINT visibleItemCount = 0;
         psrm->GetVisibleItemCount(&visibleItemCount);
@@ -1222,7 +1263,7 @@ void CPowerRenameListView::UpdateItemCheckState(_In_ IPowerRenameManager* psrm,
         if (SUCCEEDED(psrm->GetVisibleItemByIndex(iItem, &spItem)))
         {
             bool checked = ListView_GetCheckState(m_hwndLV, iItem);
-            spItem->PutSelected(checked);
+            psrm->PutItemSelected(spItem, checked);
 
             UINT uSelected = (checked) ? LVIS_SELECTED : 0;
             ListView_SetItemState(m_hwndLV, iItem, uSelected, LVIS_SELECTED);
@@ -1297,10 +1338,19 @@ void CPowerRenameListView::GetDisplayInfo(_In_ IPowerRenameManager* psrm, _Inout
 
         if (plvdi->item.mask & LVIF_TEXT)
         {
-            PWSTR subItemText = nullptr;
+            // Names are copied straight into the list view buffer
+            if (plvdi->item.cchTextMax > 0)
+            {
+                plvdi->item.pszText[0] = L'\0';
+            }
+
             if (plvdi->item.iSubItem == COL_ORIGINAL_NAME)
             {
-                renameItem->GetOriginalName(&subItemText);
+                PCWSTR originalName = nullptr;
+                if (SUCCEEDED(renameItem->GetOriginalNameView(&originalName)))
+                {
+                    StringCchCopy(plvdi->item.pszText, plvdi->item.cchTextMax, originalName);
+                }
             }
             else if (plvdi->item.iSubItem == COL_NEW_NAME)
             {
@@ -1309,13 +1359,9 @@ void CPowerRenameListView::GetDisplayInfo(_In_ IPowerRenameManager* psrm, _Inout
                 bool shouldRename = false;
                 if (SUCCEEDED(renameItem->ShouldRenameItem(flags, &shouldRename)) && shouldRename)
                 {
-                    renameItem->GetNewName(&subItemText);
+                    renameItem->CopyNewName(plvdi->item.pszText, plvdi->item.cchTextMax);
                 }
             }
-
-            StringCchCopy(plvdi->item.pszText, plvdi->item.cchTextMax, subItemText ? subItemText : L"");
-            CoTaskMemFree(subItemText);
-            subItemText = nullptr;
         }
     }
 }
@@ -1333,6 +1379,19 @@ void CPowerRenameListView::RedrawItems(_In_ int first, _In_ int last)
     ListView_RedrawItems(m_hwndLV, first, last);
 }
 
+void CPowerRenameListView::RedrawVisibleItems(_In_ UINT first, _In_ UINT last)
+{
+    // Rows scrolled out of view are drawn again when they are scrolled back in
+    const UINT top = static_cast<UINT>(ListView_GetTopIndex(m_hwndLV));
+    const UINT bottom = top + static_cast<UINT>(ListView_GetCountPerPage(m_hwndLV));
+    first = max(first, top);
+    last = min(last, bottom);
+    if (first <= last)
+    {
+        ListView_RedrawItems(m_hwndLV, first, last);
+    }
+}
+
 void CPowerRenameListView::SetItemCount(_In_ UINT itemCount)
 {
     if (m_itemCount != itemCount)
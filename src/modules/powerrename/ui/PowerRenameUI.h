@@ -17,6 +17,8 @@ public:
     void ToggleItem(_In_ IPowerRenameManager* psrm, _In_ int item);
     void UpdateItemCheckState(_In_ IPowerRenameManager* psrm, _In_ int iItem);
     void RedrawItems(_In_ int first, _In_ int last);
+    // Redraw the rows from first to last that are scrolled into view
+    void RedrawVisibleItems(_In_ UINT first, _In_ UINT last);
     void SetItemCount(_In_ UINT itemCount);
     void OnKeyDown(_In_ IPowerRenameManager* psrm, _In_ LV_KEYDOWN* lvKeyDown);
     void OnClickList(_In_ IPowerRenameManager* psrm, NM_LISTVIEW* pnmListView);
@@ -95,8 +97,8 @@ public:
     IFACEMETHODIMP GetShowUI(_Out_ bool* showUI);
 
     // IPowerRenameManagerEvents
-    IFACEMETHODIMP OnItemAdded(_In_ IPowerRenameItem* renameItem);
-    IFACEMETHODIMP OnUpdate(_In_ IPowerRenameItem* renameItem);
+    IFACEMETHODIMP OnItemAdded(_In_ IPowerRenameItem* renameItem, _In_ UINT count);
+    IFACEMETHODIMP OnUpdate(_In_ UINT firstIndex, _In_ UINT lastIndex);
     IFACEMETHODIMP OnError(_In_ IPowerRenameItem* renameItem);
     IFACEMETHODIMP OnRegExStarted(_In_ DWORD threadId);
     IFACEMETHODIMP OnRegExCanceled(_In_ DWORD threadId);
@@ -180,13 +182,15 @@ private:
 
     HRESULT _EnumerateItems(_In_ IUnknown* pdtobj);
     void _UpdateCounts();
+    // Redraw the rows of the items updated since the last refresh
+    void _RefreshList();
 
     void _CollectItemPosition(_In_ DWORD id);
 
     long m_refCount = 0;
     bool m_initialized = false;
     bool m_enableDragDrop = false;
-    bool m_disableCountUpdate = false;
+    bool m_hasDirtyItems = false;
     bool m_modeless = true;
     HWND m_hwnd = nullptr;
     HWND m_hwndLV = nullptr;
@@ -195,6 +199,9 @@ private:
     DWORD m_currentRegExId = 0;
     UINT m_selectedCount = 0;
     UINT m_renamingCount = 0;
+    // Range of item indexes updated since the list was last redrawn
+    UINT m_dirtyFirst = 0;
+    UINT m_dirtyLast = 0;
     UINT m_initialDPI = 0;
     DialogItemsPositioning m_itemsPositioning {};
     int m_initialWidth = 0;
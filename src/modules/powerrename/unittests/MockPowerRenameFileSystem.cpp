@@ -0,0 +1,141 @@
+#include "pch.h"
+#include "MockPowerRenameFileSystem.h"
+#include <PowerRenameCaseTransform.h>
+#include <PowerRenameExecutor.h>
+
+// IUnknown
+IFACEMETHODIMP CMockPowerRenameFileSystem::QueryInterface(__in REFIID riid, __deref_out void** ppv)
+{
+    static const QITAB qit[] = {
+        QITABENT(CMockPowerRenameFileSystem, IPowerRenameFileSystem),
+        { 0 },
+    };
+    return QISearch(this, qit, riid, ppv);
+}
+
+IFACEMETHODIMP_(ULONG)
+CMockPowerRenameFileSystem::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+IFACEMETHODIMP_(ULONG)
+CMockPowerRenameFileSystem::Release()
+{
+    long refCount = InterlockedDecrement(&m_refCount);
+    if (refCount == 0)
+    {
+        delete this;
+    }
+    return refCount;
+}
+
+// IPowerRenameFileSystem
+IFACEMETHODIMP CMockPowerRenameFileSystem::Exists(_In_ PCWSTR path, _Out_ bool* exists)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    *exists = m_files.find(CPowerRenameExecutor::s_FoldName(path)) != m_files.end();
+    return S_OK;
+}
+
+IFACEMETHODIMP CMockPowerRenameFileSystem::Rename(_In_ PCWSTR path, _In_ PCWSTR newName, _Out_ PowerRenameFileResult* result)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    result->hr = E_PENDING;
+    result->renamedTo[0] = L'\0';
+    m_queue.push_back({ path, newName, result });
+    return S_OK;
+}
+
+IFACEMETHODIMP CMockPowerRenameFileSystem::Commit(_In_opt_ HWND /*hwndParent*/)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_commitCount++;
+
+    std::vector<QueuedRename> queue;
+    queue.swap(m_queue);
+    if (FAILED(m_commitResult))
+    {
+        return m_commitResult;
+    }
+
+    std::vector<bool> found(queue.size());
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        found[i] = m_files.find(CPowerRenameExecutor::s_FoldName(queue[i].path.c_str())) != m_files.end();
+    }
+
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        std::wstring renamedTo;
+        queue[i].result->hr = found[i] ? _Rename(queue[i].path, queue[i].newName, renamedTo) : HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+        StringCchCopy(queue[i].result->renamedTo, ARRAYSIZE(queue[i].result->renamedTo), renamedTo.c_str());
+    }
+    return S_OK;
+}
+
+HRESULT CMockPowerRenameFileSystem::_Rename(_In_ const std::wstring& path, _In_ const std::wstring& newName, _Out_ std::wstring& renamedTo)
+{
+    renamedTo.clear();
+    auto it = m_files.find(CPowerRenameExecutor::s_FoldName(path.c_str()));
+    if (it == m_files.end())
+    {
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    std::wstring folderPath = path.substr(0, PathFindFileName(path.c_str()) - path.c_str());
+    std::wstring newPath = folderPath + newName;
+    std::wstring newKey = CPowerRenameExecutor::s_FoldName(newPath.c_str());
+    if (newKey != it->first && m_files.find(newKey) != m_files.end())
+    {
+        if (!m_renameOnCollision)
+        {
+            return HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS);
+        }
+
+        // Free "name (n).ext" name, like the shell gives
+        const size_t extension = CPowerRenameCaseTransform::s_FindExtension(newName.c_str(), newName.length());
+        for (UINT n = 2; m_files.find(newKey) != m_files.end(); n++)
+        {
+            renamedTo = newName.substr(0, extension) + L" (" + std::to_wstring(n) + L")" + newName.substr(extension);
+            newPath = folderPath + renamedTo;
+            newKey = CPowerRenameExecutor::s_FoldName(newPath.c_str());
+        }
+    }
+
+    // Items in a renamed folder move with it
+    std::wstring folderKey = it->first + L"\\";
+    std::map<std::wstring, std::wstring> files;
+    for (const auto& file : m_files)
+    {
+        if (file.first == it->first)
+        {
+            files[newKey] = newPath;
+        }
+        else if (file.first.compare(0, folderKey.length(), folderKey) == 0)
+        {
+            files[newKey + file.first.substr(it->first.length())] = newPath + file.second.substr(it->first.length());
+        }
+        else
+        {
+            files.insert(file);
+        }
+    }
+    m_files.swap(files);
+
+    m_renames.push_back(path + L">" + (renamedTo.empty() ? newName : renamedTo));
+    return S_OK;
+}
+
+void CMockPowerRenameFileSystem::AddFile(_In_ const std::wstring& path)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_files[CPowerRenameExecutor::s_FoldName(path.c_str())] = path;
+}
+
+std::wstring CMockPowerRenameFileSystem::GetPath(_In_ const std::wstring& path)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    auto it = m_files.find(CPowerRenameExecutor::s_FoldName(path.c_str()));
+    return it != m_files.end() ? it->second : std::wstring();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "pch.h"
+#include <PowerRenameInterfaces.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// In memory file system for IPowerRenameFileSystem.  Names are compared case insensitively
+// and a rename to a name that is taken fails, like on NTFS, unless m_renameOnCollision is
+// set.  Renames are only done on Commit and the items are looked up when it starts, like
+// the shell file system does.
+class CMockPowerRenameFileSystem :
+    public IPowerRenameFileSystem
+{
+public:
+    CMockPowerRenameFileSystem() :
+        m_refCount(1)
+    {
+    }
+
+    // IUnknown
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv);
+    IFACEMETHODIMP_(ULONG)
+    AddRef();
+    IFACEMETHODIMP_(ULONG)
+    Release();
+
+    // IPowerRenameFileSystem
+    IFACEMETHODIMP Exists(_In_ PCWSTR path, _Out_ bool* exists);
+    IFACEMETHODIMP Rename(_In_ PCWSTR path, _In_ PCWSTR newName, _Out_ PowerRenameFileResult* result);
+    IFACEMETHODIMP Commit(_In_opt_ HWND hwndParent);
+
+    void AddFile(_In_ const std::wstring& path);
+    // Path of the item as it is now, empty if there is none
+    std::wstring GetPath(_In_ const std::wstring& path);
+
+    struct QueuedRename
+    {
+        std::wstring path;
+        std::wstring newName;
+        PowerRenameFileResult* result = nullptr;
+    };
+
+    // Caller holds m_lock.  renamedTo is the name the item got when it isn't newName.
+    HRESULT _Rename(_In_ const std::wstring& path, _In_ const std::wstring& newName, _Out_ std::wstring& renamedTo);
+
+    std::mutex m_lock;
+    std::vector<QueuedRename> m_queue;
+    // Upper case path to path
+    std::map<std::wstring, std::wstring> m_files;
+    // Renames done, as "old path>new name"
+    std::vector<std::wstring> m_renames;
+    UINT m_commitCount = 0;
+    // Returned by Commit, which does none of the renames when it is a failure, ex: canceled
+    HRESULT m_commitResult = S_OK;
+    // Give a free name on collision, like the shell file system
+    bool m_renameOnCollision = false;
+    long m_refCount = 0;
+};
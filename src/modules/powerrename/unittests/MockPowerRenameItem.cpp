@@ -16,17 +16,25 @@ HRESULT CMockPowerRenameItem::CreateInstance(_In_opt_ PCWSTR path, _In_opt_ PCWS
     return hr;
 }
 
-void CMockPowerRenameItem::Init(_In_opt_ PCWSTR path, _In_opt_ PCWSTR originalName, _In_ UINT depth, _In_ bool isFolder, _In_ SYSTEMTIME time)
+HRESULT CMockPowerRenameItem::CreateInstanceWithoutTime(_In_opt_ PCWSTR path, _In_opt_ PCWSTR originalName, _In_ UINT depth, _In_ bool isFolder, _Outptr_ IPowerRenameItem** ppItem)
 {
-    if (path != nullptr)
+    *ppItem = nullptr;
+    CMockPowerRenameItem* newItem = new CMockPowerRenameItem();
+    HRESULT hr = E_OUTOFMEMORY;
+    if (newItem)
     {
-        SHStrDup(path, &m_path);
+        newItem->Init(path, originalName, depth, isFolder, SYSTEMTIME{ 0 });
+        newItem->m_isTimeParsed = false;
+        hr = newItem->QueryInterface(IID_PPV_ARGS(ppItem));
+        newItem->Release();
     }
 
-    if (originalName != nullptr)
-    {
-        SHStrDup(originalName, &m_originalName);
-    }
+    return hr;
+}
+
+void CMockPowerRenameItem::Init(_In_opt_ PCWSTR path, _In_opt_ PCWSTR originalName, _In_ UINT depth, _In_ bool isFolder, _In_ SYSTEMTIME time)
+{
+    _PutNames(path, originalName);
 
     m_depth = depth;
     m_isFolder = isFolder;
@@ -29,15 +29,25 @@ CMockPowerRenameManagerEvents::Release()
 }
 
 // IPowerRenameManagerEvents
-IFACEMETHODIMP CMockPowerRenameManagerEvents::OnItemAdded(_In_ IPowerRenameItem* pItem)
+IFACEMETHODIMP CMockPowerRenameManagerEvents::OnItemAdded(_In_ IPowerRenameItem* pItem, _In_ UINT count)
 {
     m_itemAdded = pItem;
+    m_itemAddedCount += count;
     return S_OK;
 }
 
-IFACEMETHODIMP CMockPowerRenameManagerEvents::OnUpdate(_In_ IPowerRenameItem* pItem)
+IFACEMETHODIMP CMockPowerRenameManagerEvents::OnUpdate(_In_ UINT firstIndex, _In_ UINT lastIndex)
 {
-    m_itemUpdated = pItem;
+    // Keep the range covering all the updates
+    if (m_updateCount == 0 || firstIndex < m_updatedFirst)
+    {
+        m_updatedFirst = firstIndex;
+    }
+    if (m_updateCount == 0 || lastIndex > m_updatedLast)
+    {
+        m_updatedLast = lastIndex;
+    }
+    m_updateCount++;
     return S_OK;
 }
 
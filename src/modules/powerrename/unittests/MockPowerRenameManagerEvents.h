@@ -18,8 +18,8 @@ public:
     Release();
 
     // IPowerRenameManagerEvents
-    IFACEMETHODIMP OnItemAdded(_In_ IPowerRenameItem* renameItem);
-    IFACEMETHODIMP OnUpdate(_In_ IPowerRenameItem* renameItem);
+    IFACEMETHODIMP OnItemAdded(_In_ IPowerRenameItem* renameItem, _In_ UINT count);
+    IFACEMETHODIMP OnUpdate(_In_ UINT firstIndex, _In_ UINT lastIndex);
     IFACEMETHODIMP OnError(_In_ IPowerRenameItem* renameItem);
     IFACEMETHODIMP OnRegExStarted(_In_ DWORD threadId);
     IFACEMETHODIMP OnRegExCanceled(_In_ DWORD threadId);
@@ -34,7 +34,11 @@ public:
     }
 
     CComPtr<IPowerRenameItem> m_itemAdded;
-    CComPtr<IPowerRenameItem> m_itemUpdated;
+    // Items added over all the notifications
+    UINT m_itemAddedCount = 0;
+    UINT m_updatedFirst = 0;
+    UINT m_updatedLast = 0;
+    UINT m_updateCount = 0;
     CComPtr<IPowerRenameItem> m_itemError;
     bool m_regExStarted = false;
     bool m_regExCanceled = false;
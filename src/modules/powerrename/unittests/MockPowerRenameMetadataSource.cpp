@@ -0,0 +1,50 @@
+#include "pch.h"
+#include "MockPowerRenameMetadataSource.h"
+
+// IUnknown
+IFACEMETHODIMP CMockPowerRenameMetadataSource::QueryInterface(__in REFIID riid, __deref_out void** ppv)
+{
+    static const QITAB qit[] = {
+        QITABENT(CMockPowerRenameMetadataSource, IPowerRenameMetadataSource),
+        { 0 },
+    };
+    return QISearch(this, qit, riid, ppv);
+}
+
+IFACEMETHODIMP_(ULONG)
+CMockPowerRenameMetadataSource::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+IFACEMETHODIMP_(ULONG)
+CMockPowerRenameMetadataSource::Release()
+{
+    long refCount = InterlockedDecrement(&m_refCount);
+    if (refCount == 0)
+    {
+        delete this;
+    }
+    return refCount;
+}
+
+// IPowerRenameMetadataSource
+IFACEMETHODIMP CMockPowerRenameMetadataSource::GetCreationTimes(_In_ PCWSTR folderPath, _In_reads_(count) PCWSTR* fileNames, _In_ UINT count, _Out_writes_(count) SYSTEMTIME* times, _Out_writes_(count) HRESULT* results)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_callCount++;
+    m_requestedCount += count;
+    for (UINT i = 0; i < count; i++)
+    {
+        auto it = m_files.find(std::wstring(folderPath) + fileNames[i]);
+        times[i] = (it != m_files.end()) ? it->second : SYSTEMTIME{ 0 };
+        results[i] = (it != m_files.end()) ? S_OK : HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+    return S_OK;
+}
+
+void CMockPowerRenameMetadataSource::AddFile(_In_ const std::wstring& path, _In_ SYSTEMTIME creationTime)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_files[path] = creationTime;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "pch.h"
+#include <PowerRenameInterfaces.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+// In memory file system for IPowerRenameMetadataSource.  Paths not added fail.
+class CMockPowerRenameMetadataSource :
+    public IPowerRenameMetadataSource
+{
+public:
+    CMockPowerRenameMetadataSource() :
+        m_refCount(1)
+    {
+    }
+
+    // IUnknown
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv);
+    IFACEMETHODIMP_(ULONG)
+    AddRef();
+    IFACEMETHODIMP_(ULONG)
+    Release();
+
+    // IPowerRenameMetadataSource
+    IFACEMETHODIMP GetCreationTimes(_In_ PCWSTR folderPath, _In_reads_(count) PCWSTR* fileNames, _In_ UINT count, _Out_writes_(count) SYSTEMTIME* times, _Out_writes_(count) HRESULT* results);
+
+    void AddFile(_In_ const std::wstring& path, _In_ SYSTEMTIME creationTime);
+
+    std::mutex m_lock;
+    std::map<std::wstring, SYSTEMTIME> m_files;
+    // Number of GetCreationTimes calls and of items they asked for
+    UINT m_callCount = 0;
+    UINT m_requestedCount = 0;
+    long m_refCount = 0;
+};
@@ -0,0 +1,300 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <PowerRenameCaseTransform.h>
+#include <PowerRenameInterfaces.h>
+#include "Helpers.h"
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace fs = std::filesystem;
+
+// Compares CPowerRenameCaseTransform against the fs::path and towupper/towlower based
+// GetTransformedFileName it replaced.
+namespace PowerRenameCaseTransformTests
+{
+    // GetTransformedFileName before the case transform engine.  It set the global locale
+    // to the user locale for towupper/towlower, this restores the previous one so the
+    // engine under test never runs with it.
+    HRESULT LegacyGetTransformedFileName(_Out_ PWSTR result, UINT cchMax, _In_ PCWSTR source, DWORD flags)
+    {
+        const std::locale previousLocale = std::locale::global(std::locale(""));
+        HRESULT hr = E_INVALIDARG;
+        if (source && flags)
+        {
+            if (flags & Uppercase)
+            {
+                if (flags & NameOnly)
+                {
+                    std::wstring stem = fs::path(source).stem().wstring();
+                    std::transform(stem.begin(), stem.end(), stem.begin(), ::towupper);
+                    hr = StringCchPrintf(result, cchMax, L"%s%s", stem.c_str(), fs::path(source).extension().c_str());
+                }
+                else if (flags & ExtensionOnly)
+                {
+                    std::wstring extension = fs::path(source).extension().wstring();
+                    if (!extension.empty())
+                    {
+                        std::transform(extension.begin(), extension.end(), extension.begin(), ::towupper);
+                        hr = StringCchPrintf(result, cchMax, L"%s%s", fs::path(source).stem().c_str(), extension.c_str());
+                    }
+                    else
+                    {
+                        hr = StringCchCopy(result, cchMax, source);
+                        if (SUCCEEDED(hr))
+                        {
+                            std::transform(result, result + wcslen(result), result, ::towupper);
+                        }
+                    }
+                }
+                else
+                {
+                    hr = StringCchCopy(result, cchMax, source);
+                    if (SUCCEEDED(hr))
+                    {
+                        std::transform(result, result + wcslen(result), result, ::towupper);
+                    }
+                }
+            }
+            else if (flags & Lowercase)
+            {
+                if (flags & NameOnly)
+                {
+                    std::wstring stem = fs::path(source).stem().wstring();
+                    std::transform(stem.begin(), stem.end(), stem.begin(), ::towlower);
+                    hr = StringCchPrintf(result, cchMax, L"%s%s", stem.c_str(), fs::path(source).extension().c_str());
+                }
+                else if (flags & ExtensionOnly)
+                {
+                    std::wstring extension = fs::path(source).extension().wstring();
+                    if (!extension.empty())
+                    {
+                        std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
+                        hr = StringCchPrintf(result, cchMax, L"%s%s", fs::path(source).stem().c_str(), extension.c_str());
+                    }
+                    else
+                    {
+                        hr = StringCchCopy(result, cchMax, source);
+                        if (SUCCEEDED(hr))
+                        {
+                            std::transform(result, result + wcslen(result), result, ::towlower);
+                        }
+                    }
+                }
+                else
+                {
+                    hr = StringCchCopy(result, cchMax, source);
+                    if (SUCCEEDED(hr))
+                    {
+                        std::transform(result, result + wcslen(result), result, ::towlower);
+                    }
+                }
+            }
+            else if (flags & Titlecase)
+            {
+                if (!(flags & ExtensionOnly))
+                {
+                    std::vector<std::wstring> exceptions = { L"a", L"an", L"to", L"the", L"at", L"by", L"for", L"in", L"of", L"on", L"up", L"and", L"as", L"but", L"or", L"nor" };
+                    std::wstring stem = fs::path(source).stem().wstring();
+                    std::wstring extension = fs::path(source).extension().wstring();
+
+                    size_t stemLength = stem.length();
+                    bool isFirstWord = true;
+
+                    while (stemLength > 0 && (iswspace(stem[stemLength - 1]) || iswpunct(stem[stemLength - 1])))
+                    {
+                        stemLength--;
+                    }
+
+                    for (size_t i = 0; i < stemLength; i++)
+                    {
+                        if (!i || iswspace(stem[i - 1]) || iswpunct(stem[i - 1]))
+                        {
+                            if (iswspace(stem[i]) || iswpunct(stem[i]))
+                            {
+                                continue;
+                            }
+                            size_t wordLength = 0;
+                            while (i + wordLength < stemLength && !iswspace(stem[i + wordLength]) && !iswpunct(stem[i + wordLength]))
+                            {
+                                wordLength++;
+                            }
+                            if (isFirstWord || i + wordLength == stemLength || std::find(exceptions.begin(), exceptions.end(), stem.substr(i, wordLength)) == exceptions.end())
+                            {
+                                stem[i] = towupper(stem[i]);
+                                isFirstWord = false;
+                            }
+                            else
+                            {
+                                stem[i] = towlower(stem[i]);
+                            }
+                        }
+                        else
+                        {
+                            stem[i] = towlower(stem[i]);
+                        }
+                    }
+                    hr = StringCchPrintf(result, cchMax, L"%s%s", stem.c_str(), extension.c_str());
+                }
+                else
+                {
+                    hr = StringCchCopy(result, cchMax, source);
+                }
+            } 
+            else if (flags & Capitalized)
+            {
+                if (!(flags & ExtensionOnly))
+                {
+                    std::wstring stem = fs::path(source).stem().wstring();
+                    std::wstring extension = fs::path(source).extension().wstring();
+
+                    size_t stemLength = stem.length();
+
+                    while (stemLength > 0 && (iswspace(stem[stemLength - 1]) || iswpunct(stem[stemLength - 1])))
+                    {
+                        stemLength--;
+                    }
+
+                    for (size_t i = 0; i < stemLength; i++)
+                    {
+                        if (!i || iswspace(stem[i - 1]) || iswpunct(stem[i - 1]))
+                        {
+                            if (iswspace(stem[i]) || iswpunct(stem[i]))
+                            {
+                                continue;
+                            }
+                            stem[i] = towupper(stem[i]);
+                        }
+                        else
+                        {
+                            stem[i] = towlower(stem[i]);
+                        }
+                    }
+                    hr = StringCchPrintf(result, cchMax, L"%s%s", stem.c_str(), extension.c_str());
+                }
+                else
+                {
+                    hr = StringCchCopy(result, cchMax, source);
+                }
+            }
+            else
+            {
+                hr = StringCchCopy(result, cchMax, source);
+            }
+        }
+
+        std::locale::global(previousLocale);
+        return hr;
+    }
+
+    const DWORD c_caseFlags[] = { Uppercase, Lowercase, Titlecase, Capitalized };
+    const DWORD c_partFlags[] = { 0, NameOnly, ExtensionOnly };
+
+    void VerifyTransform(_In_ PCWSTR source)
+    {
+        for (DWORD caseFlag : c_caseFlags)
+        {
+            for (DWORD partFlag : c_partFlags)
+            {
+                const DWORD flags = caseFlag | partFlag;
+                wchar_t expected[MAX_PATH] = { 0 };
+                wchar_t actual[MAX_PATH] = { 0 };
+                Assert::IsTrue(SUCCEEDED(LegacyGetTransformedFileName(expected, ARRAYSIZE(expected), source, flags)));
+                Assert::IsTrue(SUCCEEDED(GetTransformedFileName(actual, ARRAYSIZE(actual), source, flags)));
+                Assert::AreEqual(expected, actual);
+            }
+        }
+    }
+
+    TEST_CLASS(CaseTransformTests)
+    {
+    public:
+        TEST_METHOD(VerifyNames)
+        {
+            PCWSTR names[] = {
+                L"foo.txt",
+                L"FOO BAR.JPG",
+                L"the lord of the rings.mkv",
+                L"a tale of two cities and the war",
+                L"  leading and trailing spaces  .txt",
+                L"punctuation-(in)_the.middle!!.tar.gz",
+                L"IMG_20200703_221506 (copy).jpeg",
+                L".gitignore",
+                L"..",
+                L".",
+                L"no extension",
+                L"ends with dot.",
+                L"many...dots...txt",
+                L"caf\u00e9 na\u00efve \u00c9T\u00c9.doc",
+                L"\u03a3\u03bf\u03c6\u03af\u03b1 \u0394\u0397\u039c\u039f\u03a3.png",
+                L"\u0441\u0442\u0440\u043e\u043a\u0430 \u0422\u0415\u041a\u0421\u0422.pdf",
+                L"stra\u00dfe gro\u00df.txt",
+                L"\xd83d\xde00 emoji \xd83d\xde00.png",
+                L"",
+            };
+
+            for (PCWSTR name : names)
+            {
+                VerifyTransform(name);
+            }
+        }
+
+        TEST_METHOD(VerifyRandomNames)
+        {
+            // Long ASCII runs go through the fast path, the rest through the tables
+            const wchar_t alphabet[] = L"aAbBzZtThHeEoOfFnNdD .-_()'!0123456789\u00e9\u00c9\u00df\u03c3\u03a3\u0436\u0416";
+            std::mt19937 random(42);
+            for (int i = 0; i < 2000; i++)
+            {
+                std::wstring name;
+                const size_t length = random() % 60;
+                for (size_t j = 0; j < length; j++)
+                {
+                    name += alphabet[random() % (ARRAYSIZE(alphabet) - 1)];
+                }
+                VerifyTransform(name.c_str());
+            }
+        }
+
+        TEST_METHOD(VerifyTrimNonAsciiSpaces)
+        {
+            // Space characters outside ASCII are trimmed without changing the global locale
+            wchar_t result[MAX_PATH] = { 0 };
+            Assert::IsTrue(SUCCEEDED(GetTrimmedFileName(result, ARRAYSIZE(result), L"\u3000\u00a0foo bar\u2003.\u3000")));
+            Assert::AreEqual(L"foo bar", result);
+            Assert::IsTrue(CPowerRenameCaseTransform::s_IsSpace(L'\u3000'));
+            Assert::IsFalse(CPowerRenameCaseTransform::s_IsSpace(L'\u00e9'));
+        }
+
+        TEST_METHOD(VerifyFindExtension)
+        {
+            struct
+            {
+                PCWSTR name;
+                size_t extension;
+            } names[] = {
+                { L"foo.txt", 3 },
+                { L"foo.tar.gz", 7 },
+                { L"foo", 3 },
+                { L"foo.", 3 },
+                { L".gitignore", 10 },
+                { L"..", 2 },
+                { L".", 1 },
+                { L"", 0 },
+                { L"..foo", 1 },
+            };
+
+            for (const auto& name : names)
+            {
+                const size_t length = wcslen(name.name);
+                Assert::AreEqual(name.extension, CPowerRenameCaseTransform::s_FindExtension(name.name, length));
+                // Same split as fs::path
+                Assert::AreEqual(fs::path(name.name).stem().wstring(), std::wstring(name.name, name.extension));
+            }
+        }
+    };
+}
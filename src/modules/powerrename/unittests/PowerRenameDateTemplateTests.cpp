@@ -0,0 +1,151 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <PowerRenameDateTemplate.h>
+#include "Helpers.h"
+#include <regex>
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Compares CPowerRenameDateTemplate against the regex_replace cascade GetDatedFileName
+// used before the replace term was parsed once.
+namespace PowerRenameDateTemplateTests
+{
+    std::wstring FormatDateName(_In_ const SYSTEMTIME& fileTime, _In_ PCWSTR format)
+    {
+        wchar_t localeName[LOCALE_NAME_MAX_LENGTH];
+        if (GetUserDefaultLocaleName(localeName, LOCALE_NAME_MAX_LENGTH) == 0)
+        {
+            StringCchCopy(localeName, LOCALE_NAME_MAX_LENGTH, L"en_US");
+        }
+
+        wchar_t formattedDate[MAX_PATH] = { 0 };
+        GetDateFormatEx(localeName, NULL, &fileTime, format, formattedDate, MAX_PATH, NULL);
+        formattedDate[0] = std::toupper(formattedDate[0], std::locale(""));
+        return formattedDate;
+    }
+
+    std::wstring PadNumber(_In_ int value, _In_ int width)
+    {
+        wchar_t number[16] = { 0 };
+        StringCchPrintf(number, ARRAYSIZE(number), L"%0*d", width, value);
+        return number;
+    }
+
+    // Same replacements, in the same order, as the previous GetDatedFileName
+    std::wstring LegacyGetDatedFileName(_In_ const std::wstring& source, _In_ const SYSTEMTIME& fileTime)
+    {
+        struct
+        {
+            PCWSTR token;
+            std::wstring value;
+        } replacements[] = {
+            { L"YYYY", PadNumber(fileTime.wYear, 4) },
+            { L"YY", PadNumber(fileTime.wYear % 100, 2) },
+            { L"Y", PadNumber(fileTime.wYear % 10, 1) },
+            { L"MMMM", FormatDateName(fileTime, L"MMMM") },
+            { L"MMM", FormatDateName(fileTime, L"MMM") },
+            { L"MM", PadNumber(fileTime.wMonth, 2) },
+            { L"M", PadNumber(fileTime.wMonth, 1) },
+            { L"DDDD", FormatDateName(fileTime, L"dddd") },
+            { L"DDD", FormatDateName(fileTime, L"ddd") },
+            { L"DD", PadNumber(fileTime.wDay, 2) },
+            { L"D", PadNumber(fileTime.wDay, 1) },
+            { L"hh", PadNumber(fileTime.wHour, 2) },
+            { L"h", PadNumber(fileTime.wHour, 1) },
+            { L"mm", PadNumber(fileTime.wMinute, 2) },
+            { L"m", PadNumber(fileTime.wMinute, 1) },
+            { L"ss", PadNumber(fileTime.wSecond, 2) },
+            { L"s", PadNumber(fileTime.wSecond, 1) },
+            { L"fff", PadNumber(fileTime.wMilliseconds, 3) },
+            { L"ff", PadNumber(fileTime.wMilliseconds / 10, 2) },
+            { L"f", PadNumber(fileTime.wMilliseconds / 100, 1) },
+        };
+
+        std::wstring res(source);
+        for (const auto& replacement : replacements)
+        {
+            res = std::regex_replace(res, std::wregex(std::wstring(L"(([^\\$]|^)(\\$\\$)*)\\$") + replacement.token), L"$01" + replacement.value);
+        }
+        return res;
+    }
+
+    void VerifyTemplate(_In_ PCWSTR replaceTerm)
+    {
+        SYSTEMTIME fileTimes[] = {
+            { 2020, 7, 3, 22, 15, 6, 42, 453 },
+            { 2020, 1, 3, 1, 15, 6, 42, 453 },
+            { 1999, 12, 5, 31, 0, 0, 0, 7 },
+            { 2024, 2, 4, 29, 9, 5, 3, 40 },
+        };
+
+        CPowerRenameDateTemplate dateTemplate(replaceTerm);
+        for (const auto& fileTime : fileTimes)
+        {
+            std::wstring expected = LegacyGetDatedFileName(replaceTerm, fileTime);
+            std::wstring actual = dateTemplate.Format(fileTime);
+            Assert::AreEqual(expected, actual);
+        }
+    }
+
+    TEST_CLASS(DateTemplateTests){
+        public:
+TEST_METHOD(VerifyFileAttributesNoPadding)
+{
+    VerifyTemplate(L"bar$YY-$M-$D-$h-$m-$s-$f");
+}
+
+TEST_METHOD(VerifyFileAttributesPadding)
+{
+    VerifyTemplate(L"bar$YYYY-$MM-$DD-$hh-$mm-$ss-$fff");
+}
+
+TEST_METHOD(VerifyFileAttributesMonthandDayNames)
+{
+    VerifyTemplate(L"bar$MMM-$MMMM-$DDD-$DDDD");
+}
+
+TEST_METHOD(VerifyEscapedAndAdjacentTokens)
+{
+    PCWSTR replaceTerms[] = {
+        L"$$YYYY",
+        L"$$$YYYY",
+        L"$$$$YYYY_$fff$",
+        L"$YYYYY$MMMMM$DDDDD$ffff",
+        L"$Y$Y",
+        L"$YY$YY",
+        L"$D$$$D",
+        L"$hh$h$mm$m$ss$s",
+        L"a$Y$M$h$s$f",
+        L"$1_$YYYY$2",
+        L"no tokens",
+        L"$",
+    };
+
+    for (auto replaceTerm : replaceTerms)
+    {
+        VerifyTemplate(replaceTerm);
+    }
+}
+
+TEST_METHOD(VerifyFileTimeUsed)
+{
+    Assert::IsTrue(CPowerRenameDateTemplate(L"bar$YYYY").UsesFileTime());
+    Assert::IsTrue(CPowerRenameDateTemplate(L"$$$f").UsesFileTime());
+    Assert::IsTrue(isFileTimeUsed(L"foo$D"));
+    Assert::IsFalse(CPowerRenameDateTemplate(L"$$YYYY").UsesFileTime());
+    Assert::IsFalse(CPowerRenameDateTemplate(L"$1$2").UsesFileTime());
+    Assert::IsFalse(isFileTimeUsed(L"bar"));
+}
+
+TEST_METHOD(VerifyNamesAreNotExpandedAgain)
+{
+    // The regex cascade used to expand the $D in front of a month name starting with a
+    // token letter again (ex: "$D$MMM" in December).  Names are inserted as they are now.
+    SYSTEMTIME fileTime = { 1999, 12, 5, 31, 0, 0, 0, 7 };
+    std::wstring expected = L"31" + FormatDateName(fileTime, L"MMM");
+    Assert::AreEqual(expected, CPowerRenameDateTemplate(L"$D$MMM").Format(fileTime));
+}
+}
+;
+}
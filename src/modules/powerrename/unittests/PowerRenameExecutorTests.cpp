@@ -0,0 +1,226 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <PowerRenameExecutor.h>
+#include "MockPowerRenameFileSystem.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace PowerRenameExecutorTests
+{
+    struct ExecutorTest
+    {
+        ExecutorTest(std::initializer_list<PCWSTR> files)
+        {
+            fileSystem.Attach(new CMockPowerRenameFileSystem());
+            for (PCWSTR file : files)
+            {
+                fileSystem->AddFile(file);
+            }
+            journal = std::make_shared<CPowerRenameJournal>();
+        }
+
+        // A run is committed once, items moved out of the way take a second commit before
+        // they get their new name
+        void Run(CPowerRenameExecutor& executor, UINT commitCount = 1)
+        {
+            executor.Plan();
+            Assert::IsTrue(SUCCEEDED(executor.Execute(nullptr, failedIds)));
+            Assert::IsTrue(failedIds.empty());
+            Assert::AreEqual(commitCount, fileSystem->m_commitCount);
+        }
+
+        // Exact path of the item, names are compared case insensitively
+        std::wstring GetPath(PCWSTR path)
+        {
+            return fileSystem->GetPath(path);
+        }
+
+        CComPtr<CMockPowerRenameFileSystem> fileSystem;
+        std::shared_ptr<CPowerRenameJournal> journal;
+        std::vector<int> failedIds;
+    };
+
+    TEST_CLASS(ExecutorTests)
+    {
+    public:
+        TEST_METHOD(VerifyRenameWaitsForFreedName)
+        {
+            ExecutorTest test({ L"c:\\t\\a.txt", L"c:\\t\\b.txt" });
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\a.txt", L"b.txt");
+            executor.Add(2, L"c:\\t\\b.txt", L"c.txt");
+            test.Run(executor);
+
+            Assert::AreEqual(std::wstring(L"c:\\t\\b.txt>c.txt"), test.fileSystem->m_renames[0]);
+            Assert::AreEqual(std::wstring(L"c:\\t\\a.txt>b.txt"), test.fileSystem->m_renames[1]);
+            Assert::AreEqual(std::wstring(L"c:\\t\\b.txt"), test.GetPath(L"c:\\t\\b.txt"));
+            Assert::AreEqual(std::wstring(L"c:\\t\\c.txt"), test.GetPath(L"c:\\t\\c.txt"));
+            Assert::IsTrue(test.GetPath(L"c:\\t\\a.txt").empty());
+        }
+
+        TEST_METHOD(VerifySwap)
+        {
+            ExecutorTest test({ L"c:\\t\\a.txt", L"c:\\t\\b.txt" });
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\a.txt", L"b.txt");
+            executor.Add(2, L"c:\\t\\b.txt", L"a.txt");
+            test.Run(executor, 2);
+
+            // One of the items is moved out of the way first
+            Assert::AreEqual(size_t(3), test.fileSystem->m_renames.size());
+            Assert::AreEqual(std::wstring(L"b.txt"), std::wstring(executor.GetNewName(1)));
+            Assert::AreEqual(std::wstring(L"a.txt"), std::wstring(executor.GetNewName(2)));
+            Assert::AreEqual(size_t(2), test.fileSystem->m_files.size());
+        }
+
+        TEST_METHOD(VerifyExistingNameCollision)
+        {
+            ExecutorTest test({ L"c:\\t\\a.txt", L"c:\\t\\x.txt", L"c:\\t\\x (2).txt" });
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\a.txt", L"X.txt");
+            test.Run(executor);
+
+            Assert::AreEqual(std::wstring(L"X (3).txt"), std::wstring(executor.GetNewName(1)));
+            Assert::AreEqual(std::wstring(L"c:\\t\\X (3).txt"), test.GetPath(L"c:\\t\\x (3).txt"));
+        }
+
+        TEST_METHOD(VerifyDuplicateNewNames)
+        {
+            ExecutorTest test({ L"c:\\t\\a.txt", L"c:\\t\\b.txt", L"c:\\t\\c.txt" });
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\a.txt", L"new.txt");
+            executor.Add(2, L"c:\\t\\b.txt", L"NEW.txt");
+            executor.Add(3, L"c:\\t\\c.txt", L"new.txt");
+            test.Run(executor);
+
+            Assert::AreEqual(std::wstring(L"new.txt"), std::wstring(executor.GetNewName(1)));
+            Assert::AreEqual(std::wstring(L"NEW (2).txt"), std::wstring(executor.GetNewName(2)));
+            Assert::AreEqual(std::wstring(L"new (3).txt"), std::wstring(executor.GetNewName(3)));
+        }
+
+        TEST_METHOD(VerifyCaseOnlyRename)
+        {
+            ExecutorTest test({ L"c:\\t\\a.txt" });
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\a.txt", L"A.TXT");
+            executor.Add(2, L"c:\\t\\b.txt", L"b.txt");
+            test.Run(executor);
+
+            Assert::AreEqual(std::wstring(L"A.TXT"), std::wstring(executor.GetNewName(1)));
+            Assert::IsNull(executor.GetNewName(2));
+            Assert::AreEqual(std::wstring(L"c:\\t\\A.TXT"), test.GetPath(L"c:\\t\\a.txt"));
+        }
+
+        TEST_METHOD(VerifyChildrenRenamedFirst)
+        {
+            ExecutorTest test({ L"c:\\t\\folder", L"c:\\t\\folder\\sub", L"c:\\t\\folder\\sub\\a.txt" });
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\folder", L"folder2");
+            executor.Add(2, L"c:\\t\\folder\\sub", L"sub2");
+            executor.Add(3, L"c:\\t\\folder\\sub\\a.txt", L"b.txt");
+            test.Run(executor);
+
+            Assert::AreEqual(std::wstring(L"c:\\t\\folder\\sub\\a.txt>b.txt"), test.fileSystem->m_renames[0]);
+            Assert::AreEqual(std::wstring(L"c:\\t\\folder\\sub>sub2"), test.fileSystem->m_renames[1]);
+            Assert::AreEqual(std::wstring(L"c:\\t\\folder>folder2"), test.fileSystem->m_renames[2]);
+            Assert::AreEqual(std::wstring(L"c:\\t\\folder2\\sub2\\b.txt"), test.GetPath(L"c:\\t\\folder2\\sub2\\b.txt"));
+        }
+
+        TEST_METHOD(VerifyLoopsAtSeveralDepthsCommitTwice)
+        {
+            ExecutorTest test({ L"c:\\t\\x", L"c:\\t\\y", L"c:\\t\\x\\a.txt", L"c:\\t\\x\\b.txt" });
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\x", L"y");
+            executor.Add(2, L"c:\\t\\y", L"x");
+            executor.Add(3, L"c:\\t\\x\\a.txt", L"b.txt");
+            executor.Add(4, L"c:\\t\\x\\b.txt", L"a.txt");
+            test.Run(executor, 2);
+
+            Assert::AreEqual(size_t(4), test.fileSystem->m_files.size());
+            Assert::AreEqual(std::wstring(L"c:\\t\\x"), test.GetPath(L"c:\\t\\x"));
+            Assert::AreEqual(std::wstring(L"c:\\t\\y\\a.txt"), test.GetPath(L"c:\\t\\y\\a.txt"));
+            Assert::AreEqual(std::wstring(L"c:\\t\\y\\b.txt"), test.GetPath(L"c:\\t\\y\\b.txt"));
+
+            // The whole run is undone from the journal
+            Assert::IsTrue(SUCCEEDED(test.journal->Undo(test.fileSystem, nullptr)));
+            Assert::AreEqual(size_t(4), test.fileSystem->m_files.size());
+            Assert::AreEqual(std::wstring(L"c:\\t\\x\\a.txt"), test.GetPath(L"c:\\t\\x\\a.txt"));
+            Assert::AreEqual(std::wstring(L"c:\\t\\x\\b.txt"), test.GetPath(L"c:\\t\\x\\b.txt"));
+            Assert::AreEqual(std::wstring(L"c:\\t\\y"), test.GetPath(L"c:\\t\\y"));
+        }
+
+        TEST_METHOD(VerifyUnplannedCollisionRenamedByFileSystem)
+        {
+            ExecutorTest test({ L"c:\\t\\a.txt" });
+            test.fileSystem->m_renameOnCollision = true;
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\a.txt", L"b.txt");
+            executor.Plan();
+            // Created after the collisions were resolved
+            test.fileSystem->AddFile(L"c:\\t\\b.txt");
+            Assert::IsTrue(SUCCEEDED(executor.Execute(nullptr, test.failedIds)));
+
+            Assert::IsTrue(test.failedIds.empty());
+            Assert::AreEqual(std::wstring(L"b (2).txt"), std::wstring(executor.GetNewName(1)));
+            Assert::AreEqual(std::wstring(L"c:\\t\\b (2).txt"), test.GetPath(L"c:\\t\\b (2).txt"));
+            Assert::AreEqual(std::wstring(L"c:\\t\\b (2).txt"), test.journal->GetEntries()[0].newPath);
+
+            Assert::IsTrue(SUCCEEDED(test.journal->Undo(test.fileSystem, nullptr)));
+            Assert::AreEqual(std::wstring(L"c:\\t\\a.txt"), test.GetPath(L"c:\\t\\a.txt"));
+            Assert::AreEqual(std::wstring(L"c:\\t\\b.txt"), test.GetPath(L"c:\\t\\b.txt"));
+        }
+
+        TEST_METHOD(VerifyFailedRename)
+        {
+            ExecutorTest test({ L"c:\\t\\a.txt" });
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\a.txt", L"b.txt");
+            executor.Add(2, L"c:\\t\\missing.txt", L"c.txt");
+            executor.Plan();
+            Assert::IsTrue(SUCCEEDED(executor.Execute(nullptr, test.failedIds)));
+
+            Assert::AreEqual(size_t(1), test.failedIds.size());
+            Assert::AreEqual(2, test.failedIds[0]);
+            Assert::AreEqual(size_t(1), test.journal->GetEntries().size());
+        }
+
+        TEST_METHOD(VerifyCanceledCommit)
+        {
+            ExecutorTest test({ L"c:\\t\\a.txt", L"c:\\t\\b.txt" });
+            test.fileSystem->m_commitResult = HRESULT_FROM_WIN32(ERROR_CANCELLED);
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\a.txt", L"b.txt");
+            executor.Add(2, L"c:\\t\\b.txt", L"a.txt");
+            executor.Plan();
+            Assert::IsTrue(FAILED(executor.Execute(nullptr, test.failedIds)));
+
+            // Nothing was renamed so nothing is journaled and every item is reported
+            Assert::AreEqual(size_t(2), test.failedIds.size());
+            Assert::IsTrue(test.journal->IsEmpty());
+            Assert::IsTrue(test.fileSystem->m_renames.empty());
+        }
+
+        TEST_METHOD(VerifyUndo)
+        {
+            ExecutorTest test({ L"c:\\t\\folder", L"c:\\t\\folder\\a.txt", L"c:\\t\\folder\\b.txt", L"c:\\t\\c.txt" });
+            CPowerRenameExecutor executor(test.fileSystem, test.journal);
+            executor.Add(1, L"c:\\t\\folder", L"renamed");
+            executor.Add(2, L"c:\\t\\folder\\a.txt", L"b.txt");
+            executor.Add(3, L"c:\\t\\folder\\b.txt", L"a.txt");
+            executor.Add(4, L"c:\\t\\c.txt", L"C.txt");
+            test.Run(executor, 2);
+
+            Assert::IsFalse(test.journal->IsEmpty());
+            Assert::IsTrue(SUCCEEDED(test.journal->Undo(test.fileSystem, nullptr)));
+            Assert::IsTrue(test.journal->IsEmpty());
+
+            Assert::AreEqual(size_t(4), test.fileSystem->m_files.size());
+            Assert::AreEqual(std::wstring(L"c:\\t\\folder"), test.GetPath(L"c:\\t\\folder"));
+            Assert::AreEqual(std::wstring(L"c:\\t\\folder\\a.txt"), test.GetPath(L"c:\\t\\folder\\a.txt"));
+            Assert::AreEqual(std::wstring(L"c:\\t\\folder\\b.txt"), test.GetPath(L"c:\\t\\folder\\b.txt"));
+            Assert::AreEqual(std::wstring(L"c:\\t\\c.txt"), test.GetPath(L"c:\\t\\c.txt"));
+            // The items are renamed back before the items that get their paths back from them
+            Assert::AreEqual(4u, test.fileSystem->m_commitCount);
+        }
+    };
+}
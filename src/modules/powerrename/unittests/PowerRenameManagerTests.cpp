@@ -5,6 +5,7 @@
 #include <PowerRenameItem.h>
 #include "MockPowerRenameItem.h"
 #include "MockPowerRenameManagerEvents.h"
+#include "MockPowerRenameMetadataSource.h"
 #include "TestFileHelper.h"
 #include "Helpers.h"
 
@@ -32,7 +33,7 @@ namespace PowerRenameManagerTests
             int depth;
         };
 
-        void RenameHelper(_In_ rename_pairs * renamePairs, _In_ int numPairs, _In_ std::wstring searchTerm, _In_ std::wstring replaceTerm, SYSTEMTIME fileTime, _In_ DWORD flags)
+        void RenameHelper(_In_ rename_pairs * renamePairs, _In_ int numPairs, _In_ std::wstring searchTerm, _In_ std::wstring replaceTerm, SYSTEMTIME fileTime, _In_ DWORD flags, _In_ const std::vector<std::wstring>& previousSearchTerms = {})
         {
             // Create a single item (in a temp directory) and verify rename works as expected
             CTestFileHelper testFileHelper;
@@ -82,8 +83,13 @@ namespace PowerRenameManagerTests
             CComPtr<IPowerRenameRegEx> renRegEx;
             Assert::IsTrue(mgr->GetRenameRegEx(&renRegEx) == S_OK);
             renRegEx->PutFlags(flags);
-            renRegEx->PutSearchTerm(searchTerm.c_str());
             renRegEx->PutReplaceTerm(replaceTerm.c_str());
+            // Search terms typed before the final one, their previews get cached
+            for (const auto& previousSearchTerm : previousSearchTerms)
+            {
+                renRegEx->PutSearchTerm(previousSearchTerm.c_str());
+            }
+            renRegEx->PutSearchTerm(searchTerm.c_str());
 
             // Perform the rename
             bool replaceSuccess = false;
@@ -133,6 +139,205 @@ namespace PowerRenameManagerTests
             Assert::IsTrue(mgr->Shutdown() == S_OK);
         }
 
+        TEST_METHOD(VerifyItemIndexLookup)
+        {
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+            CComPtr<IPowerRenameItem> items[3];
+            for (int i = 0; i < ARRAYSIZE(items); i++)
+            {
+                CMockPowerRenameItem::CreateInstance(L"foo", L"foo", 0, false, SYSTEMTIME{ 0 }, &items[i]);
+            }
+
+            // Add out of id order, the store must still be ordered by id
+            Assert::IsTrue(mgr->AddItem(items[2]) == S_OK);
+            Assert::IsTrue(mgr->AddItem(items[0]) == S_OK);
+            Assert::IsTrue(mgr->AddItem(items[1]) == S_OK);
+            Assert::IsTrue(mgr->AddItem(items[1]) == E_FAIL);
+
+            UINT count = 0;
+            Assert::IsTrue(mgr->GetItemCount(&count) == S_OK);
+            Assert::IsTrue(count == ARRAYSIZE(items));
+            for (UINT i = 0; i < count; i++)
+            {
+                CComPtr<IPowerRenameItem> item;
+                Assert::IsTrue(mgr->GetItemByIndex(i, &item) == S_OK);
+                Assert::IsTrue(item == items[i]);
+
+                int id = 0;
+                items[i]->GetId(&id);
+                CComPtr<IPowerRenameItem> itemById;
+                Assert::IsTrue(mgr->GetItemById(id, &itemById) == S_OK);
+                Assert::IsTrue(itemById == items[i]);
+            }
+
+            // Only the selected items should be visible once filtering on selection is turned on
+            items[1]->PutSelected(false);
+            Assert::IsTrue(mgr->SwitchFilter(0) == S_OK);
+            Assert::IsTrue(mgr->GetVisibleItemCount(&count) == S_OK);
+            Assert::IsTrue(count == 2);
+            CComPtr<IPowerRenameItem> visibleItem;
+            Assert::IsTrue(mgr->GetVisibleItemByIndex(1, &visibleItem) == S_OK);
+            Assert::IsTrue(visibleItem == items[2]);
+
+            // Visible items are refreshed by the lookup itself after a selection change
+            Assert::IsTrue(mgr->PutItemSelected(items[1], true) == S_OK);
+            visibleItem = nullptr;
+            Assert::IsTrue(mgr->GetVisibleItemByIndex(1, &visibleItem) == S_OK);
+            Assert::IsTrue(visibleItem == items[1]);
+            Assert::IsTrue(mgr->GetVisibleItemCount(&count) == S_OK);
+            Assert::IsTrue(count == 3);
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+        }
+
+        TEST_METHOD(VerifyVisibleRowRange)
+        {
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+            CComPtr<IPowerRenameItem> items[4];
+            for (int i = 0; i < ARRAYSIZE(items); i++)
+            {
+                CMockPowerRenameItem::CreateInstance(L"foo", L"foo", 0, false, SYSTEMTIME{ 0 }, &items[i]);
+                Assert::IsTrue(mgr->AddItem(items[i]) == S_OK);
+            }
+
+            // Every row shows another item once filtering on selection is turned on
+            UINT firstRow = 0;
+            UINT lastRow = 0;
+            Assert::IsTrue(mgr->SwitchFilter(0) == S_OK);
+            Assert::IsTrue(mgr->GetVisibleRowRange(1, 2, &firstRow, &lastRow) == S_OK);
+            Assert::IsTrue(firstRow == 0 && lastRow == 3);
+
+            // Only the rows of the updated items afterwards
+            Assert::IsTrue(mgr->GetVisibleRowRange(1, 2, &firstRow, &lastRow) == S_OK);
+            Assert::IsTrue(firstRow == 1 && lastRow == 2);
+
+            // Hiding an item moves the rows after it up
+            Assert::IsTrue(mgr->PutItemSelected(items[1], false) == S_OK);
+            Assert::IsTrue(mgr->GetVisibleRowRange(3, 3, &firstRow, &lastRow) == S_OK);
+            Assert::IsTrue(firstRow == 1 && lastRow == 2);
+
+            // Hidden items have no row
+            Assert::IsTrue(mgr->GetVisibleRowRange(1, 1, &firstRow, &lastRow) == S_FALSE);
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+        }
+
+        TEST_METHOD(VerifyAddItemsBatch)
+        {
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+            CMockPowerRenameManagerEvents* mockMgrEvents = new CMockPowerRenameManagerEvents();
+            CComPtr<IPowerRenameManagerEvents> mgrEvents;
+            Assert::IsTrue(mockMgrEvents->QueryInterface(IID_PPV_ARGS(&mgrEvents)) == S_OK);
+            DWORD cookie = 0;
+            Assert::IsTrue(mgr->Advise(mgrEvents, &cookie) == S_OK);
+
+            CComPtr<IPowerRenameItem> items[4];
+            for (int i = 0; i < ARRAYSIZE(items); i++)
+            {
+                CMockPowerRenameItem::CreateInstance(L"foo", L"foo", 0, false, SYSTEMTIME{ 0 }, &items[i]);
+            }
+
+            IPowerRenameItem* batch[] = { items[0], items[1], items[3] };
+            Assert::IsTrue(mgr->AddItems(batch, ARRAYSIZE(batch)) == S_OK);
+            // A single notification with the last item and the count of the batch
+            Assert::IsTrue(mockMgrEvents->m_itemAdded == items[3]);
+            Assert::AreEqual(3u, mockMgrEvents->m_itemAddedCount);
+
+            // Items already added are skipped, the others still go in id order
+            IPowerRenameItem* secondBatch[] = { items[2], items[1] };
+            Assert::IsTrue(mgr->AddItems(secondBatch, ARRAYSIZE(secondBatch)) == E_FAIL);
+            Assert::IsTrue(mockMgrEvents->m_itemAdded == items[2]);
+            Assert::AreEqual(4u, mockMgrEvents->m_itemAddedCount);
+
+            UINT count = 0;
+            Assert::IsTrue(mgr->GetItemCount(&count) == S_OK);
+            Assert::IsTrue(count == ARRAYSIZE(items));
+            for (UINT i = 0; i < count; i++)
+            {
+                CComPtr<IPowerRenameItem> item;
+                Assert::IsTrue(mgr->GetItemByIndex(i, &item) == S_OK);
+                Assert::IsTrue(item == items[i]);
+            }
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+
+            mockMgrEvents->Release();
+        }
+
+        TEST_METHOD(VerifyUpdatesAndCounts)
+        {
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+            CMockPowerRenameManagerEvents* mockMgrEvents = new CMockPowerRenameManagerEvents();
+            CComPtr<IPowerRenameManagerEvents> mgrEvents;
+            Assert::IsTrue(mockMgrEvents->QueryInterface(IID_PPV_ARGS(&mgrEvents)) == S_OK);
+            DWORD cookie = 0;
+            Assert::IsTrue(mgr->Advise(mgrEvents, &cookie) == S_OK);
+
+            // Every other item matches, across several regex worker chunks
+            const UINT itemCount = 600;
+            const UINT matchCount = itemCount / 2;
+            std::vector<CComPtr<IPowerRenameItem>> items(itemCount);
+            for (UINT i = 0; i < itemCount; i++)
+            {
+                std::wstring name = ((i % 2) ? L"bar" : L"foo") + std::to_wstring(i) + L".txt";
+                CMockPowerRenameItem::CreateInstance(name.c_str(), name.c_str(), 0, false, SYSTEMTIME{ 0 }, &items[i]);
+                Assert::IsTrue(mgr->AddItem(items[i]) == S_OK);
+            }
+
+            UINT selectedCount = 0;
+            Assert::IsTrue(mgr->GetSelectedItemCount(&selectedCount) == S_OK);
+            Assert::IsTrue(selectedCount == itemCount);
+
+            CComPtr<IPowerRenameRegEx> renRegEx;
+            Assert::IsTrue(mgr->GetRenameRegEx(&renRegEx) == S_OK);
+            renRegEx->PutFlags(DEFAULT_FLAGS);
+            renRegEx->PutReplaceTerm(L"baz");
+            renRegEx->PutSearchTerm(L"foo");
+
+            // The count is up to date without the manager thread handling the updates
+            UINT renameCount = 0;
+            for (int step = 0; step < 500 && renameCount != matchCount; step++)
+            {
+                Sleep(10);
+                Assert::IsTrue(mgr->GetRenameItemCount(&renameCount) == S_OK);
+            }
+            Assert::IsTrue(renameCount == matchCount);
+
+            // Items renamed while the manager thread was busy are reported together
+            for (int step = 0; step < 500 && mockMgrEvents->m_updateCount == 0; step++)
+            {
+                MSG msg;
+                while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+                {
+                    TranslateMessage(&msg);
+                    DispatchMessage(&msg);
+                }
+                Sleep(10);
+            }
+            Assert::IsTrue(mockMgrEvents->m_updateCount > 0 && mockMgrEvents->m_updateCount < matchCount);
+            Assert::IsTrue(mockMgrEvents->m_updatedFirst == 0);
+            Assert::IsTrue(mockMgrEvents->m_updatedLast == itemCount - 2);
+
+            Assert::IsTrue(mgr->PutItemSelected(items[0], false) == S_OK);
+            Assert::IsTrue(mgr->GetSelectedItemCount(&selectedCount) == S_OK);
+            Assert::IsTrue(selectedCount == itemCount - 1);
+            Assert::IsTrue(mgr->GetRenameItemCount(&renameCount) == S_OK);
+            Assert::IsTrue(renameCount == matchCount - 1);
+
+            // Counted again when the flags change
+            renRegEx->PutFlags(DEFAULT_FLAGS | ExcludeFiles);
+            Assert::IsTrue(mgr->GetRenameItemCount(&renameCount) == S_OK);
+            Assert::IsTrue(renameCount == 0);
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+
+            mockMgrEvents->Release();
+        }
+
         TEST_METHOD(VerifyRenameManagerEvents)
         {
             CComPtr<IPowerRenameManager> mgr;
@@ -158,6 +363,71 @@ namespace PowerRenameManagerTests
             mockMgrEvents->Release();
         }
 
+        TEST_METHOD(VerifyItemNameViews)
+        {
+            CComPtr<IPowerRenameItem> item;
+            CMockPowerRenameItem::CreateInstance(L"C:\\foo\\bar.txt", L"bar.txt", 0, false, SYSTEMTIME{ 0 }, &item);
+
+            PCWSTR path = nullptr;
+            PCWSTR originalName = nullptr;
+            Assert::IsTrue(item->GetPathView(&path) == S_OK);
+            Assert::IsTrue(item->GetOriginalNameView(&originalName) == S_OK);
+            Assert::AreEqual(L"C:\\foo\\bar.txt", path);
+            Assert::AreEqual(L"bar.txt", originalName);
+
+            bool isEqual = false;
+            Assert::IsTrue(item->IsNewNameEqual(nullptr, &isEqual) == S_OK);
+            Assert::IsTrue(isEqual);
+
+            Assert::IsTrue(item->PutNewName(L"baz.txt") == S_OK);
+            Assert::IsTrue(item->IsNewNameEqual(L"baz.txt", &isEqual) == S_OK);
+            Assert::IsTrue(isEqual);
+            Assert::IsTrue(item->IsNewNameEqual(L"bar.txt", &isEqual) == S_OK);
+            Assert::IsFalse(isEqual);
+            Assert::IsTrue(item->IsNewNameEqual(nullptr, &isEqual) == S_OK);
+            Assert::IsFalse(isEqual);
+
+            wchar_t newName[MAX_PATH] = { 0 };
+            Assert::IsTrue(item->CopyNewName(newName, ARRAYSIZE(newName)) == S_OK);
+            Assert::AreEqual(L"baz.txt", newName);
+
+            // A shorter new name reuses the buffer of the previous one
+            Assert::IsTrue(item->PutNewName(L"b.txt") == S_OK);
+            Assert::IsTrue(item->CopyNewName(newName, ARRAYSIZE(newName)) == S_OK);
+            Assert::AreEqual(L"b.txt", newName);
+
+            // Views are unaffected by the new name
+            PCWSTR originalNameAfter = nullptr;
+            Assert::IsTrue(item->GetOriginalNameView(&originalNameAfter) == S_OK);
+            Assert::IsTrue(originalName == originalNameAfter);
+
+            Assert::IsTrue(item->Reset() == S_OK);
+            Assert::IsTrue(item->CopyNewName(newName, ARRAYSIZE(newName)) == S_OK);
+            Assert::AreEqual(L"", newName);
+        }
+
+        TEST_METHOD(VerifyStringArena)
+        {
+            // Small blocks so the strings span many of them
+            CPowerRenameStringArena arena(16);
+            std::vector<std::wstring> names;
+            std::vector<PCWSTR> stored;
+            for (int i = 0; i < 200; i++)
+            {
+                names.push_back(std::wstring(i % 12, L'a') + std::to_wstring(i));
+                stored.push_back(arena.Store(names.back().c_str()));
+                Assert::IsNotNull(stored.back());
+            }
+
+            // Strings stored earlier stay where they are
+            for (size_t i = 0; i < names.size(); i++)
+            {
+                Assert::AreEqual(names[i].c_str(), stored[i]);
+            }
+
+            Assert::IsTrue(arena.GetSize() >= 200 * sizeof(wchar_t));
+        }
+
         TEST_METHOD(VerifySingleRename)
         {
             // Create a single item and verify rename works as expected
@@ -183,6 +453,100 @@ namespace PowerRenameManagerTests
             RenameHelper(renamePairs, ARRAYSIZE(renamePairs), L"foo", L"bar", SYSTEMTIME{ 2020, 7, 3, 22, 15, 6, 42, 453 }, DEFAULT_FLAGS);
         }
 
+        TEST_METHOD(VerifyEnumerateItemsRenameAcrossChunks)
+        {
+            // Enough items for the regex worker to split them across several threads.
+            // Items that don't match must not take an enumeration number.
+            std::vector<rename_pairs> renamePairs;
+            unsigned long enumIndex = 1;
+            for (int i = 0; i < 1000; i++)
+            {
+                std::wstring index = std::to_wstring(i);
+                if (i % 7 == 0)
+                {
+                    renamePairs.push_back({ L"baz_" + index + L".txt", L"baz_" + index + L"_norename.txt", true, false, 0 });
+                }
+                else
+                {
+                    renamePairs.push_back({ L"foo_" + index + L".txt", L"bar_" + index + L" (" + std::to_wstring(enumIndex++) + L").txt", true, true, 0 });
+                }
+            }
+
+            RenameHelper(renamePairs.data(), static_cast<int>(renamePairs.size()), L"foo", L"bar", SYSTEMTIME{ 0 }, DEFAULT_FLAGS | EnumerateItems);
+        }
+
+        TEST_METHOD(VerifyRenameAfterRetypedSearchTerms)
+        {
+            // Previews cached for earlier search terms, or narrowed from them, must not
+            // change the result of the final one
+            rename_pairs renamePairs[] = {
+                { L"foo1.txt", L"bar1.txt", true, true, 0 },
+                { L"fOo2.txt", L"bar2.txt", true, true, 0 },
+                { L"fo3.txt", L"fo3_norename.txt", true, false, 0 },
+                { L"of4.txt", L"of4_norename.txt", true, false, 0 },
+                { L"baa.txt", L"baa_norename.txt", true, false, 0 }
+            };
+
+            RenameHelper(renamePairs, ARRAYSIZE(renamePairs), L"foo", L"bar", SYSTEMTIME{ 0 }, DEFAULT_FLAGS, { L"f", L"fo", L"foo", L"fooo", L"foo", L"o", L"oo" });
+        }
+
+        TEST_METHOD(VerifyFileTimesFromMetadataSource)
+        {
+            // Items without a time get it from the metadata source, one call per folder
+            CTestFileHelper testFileHelper;
+            Assert::IsTrue(testFileHelper.AddFolder(L"sub"));
+            std::wstring fileNames[] = { L"foo1.txt", L"foo2.txt", L"sub\\foo3.txt" };
+            SYSTEMTIME fileTimes[] = { { 2001, 1, 1, 1 }, { 2002, 2, 6, 2 }, { 2003, 3, 1, 3 } };
+            std::wstring newNames[] = { L"bar_2001-01-01.txt", L"bar_2002-02-02.txt", L"sub\\bar_2003-03-03.txt" };
+
+            CComPtr<IPowerRenameManager> mgr;
+            Assert::IsTrue(CPowerRenameManager::s_CreateInstance(&mgr) == S_OK);
+            CMockPowerRenameMetadataSource* mockMetadataSource = new CMockPowerRenameMetadataSource();
+            Assert::IsTrue(mgr->PutMetadataSource(mockMetadataSource) == S_OK);
+
+            for (int i = 0; i < ARRAYSIZE(fileNames); i++)
+            {
+                Assert::IsTrue(testFileHelper.AddFile(fileNames[i]));
+                std::wstring path = testFileHelper.GetFullPath(fileNames[i]).wstring();
+                mockMetadataSource->AddFile(path, fileTimes[i]);
+
+                CComPtr<IPowerRenameItem> item;
+                CMockPowerRenameItem::CreateInstanceWithoutTime(path.c_str(), PathFindFileName(path.c_str()), 0, false, &item);
+                Assert::IsTrue(mgr->AddItem(item) == S_OK);
+            }
+
+            CComPtr<IPowerRenameRegEx> renRegEx;
+            Assert::IsTrue(mgr->GetRenameRegEx(&renRegEx) == S_OK);
+            renRegEx->PutFlags(DEFAULT_FLAGS | UseRegularExpressions);
+            renRegEx->PutSearchTerm(L"foo\\d");
+            renRegEx->PutReplaceTerm(L"bar_$YYYY-$MM-$DD");
+
+            bool replaceSuccess = false;
+            for (int step = 0; step < 20; step++)
+            {
+                replaceSuccess = mgr->Rename(0) == S_OK;
+                if (replaceSuccess)
+                {
+                    break;
+                }
+                Sleep(10);
+            }
+            Assert::IsTrue(replaceSuccess);
+
+            for (int i = 0; i < ARRAYSIZE(fileNames); i++)
+            {
+                Assert::IsFalse(testFileHelper.PathExists(fileNames[i]));
+                Assert::IsTrue(testFileHelper.PathExists(newNames[i]));
+            }
+
+            // Times are read once, the later previews reuse them
+            Assert::IsTrue(mockMetadataSource->m_requestedCount == ARRAYSIZE(fileNames));
+            Assert::IsTrue(mockMetadataSource->m_callCount == 2);
+
+            Assert::IsTrue(mgr->Shutdown() == S_OK);
+            mockMetadataSource->Release();
+        }
+
         TEST_METHOD(VerifyFilesOnlyRename)
         {
             // Verify only files are renamed when folders match too
@@ -321,7 +685,7 @@ namespace PowerRenameManagerTests
 
         TEST_METHOD (VerifyFileAttributesMonthandDayNames)
         {
-            std::locale::global(std::locale(""));
+            const std::locale userLocale("");
             SYSTEMTIME fileTime = { 2020, 1, 3, 1, 15, 6, 42, 453 };
             wchar_t localeName[LOCALE_NAME_MAX_LENGTH];
             wchar_t result[MAX_PATH] = L"bar";
@@ -330,19 +694,19 @@ namespace PowerRenameManagerTests
                 StringCchCopy(localeName, LOCALE_NAME_MAX_LENGTH, L"en_US");
 
             GetDateFormatEx(localeName, NULL, &fileTime, L"MMM", formattedDate, MAX_PATH, NULL);
-            formattedDate[0] = towupper(formattedDate[0]);
+            formattedDate[0] = std::toupper(formattedDate[0], userLocale);
             StringCchPrintf(result, MAX_PATH, TEXT("%s%s"), result, formattedDate);
 
             GetDateFormatEx(localeName, NULL, &fileTime, L"MMMM", formattedDate, MAX_PATH, NULL);
-            formattedDate[0] = towupper(formattedDate[0]);
+            formattedDate[0] = std::toupper(formattedDate[0], userLocale);
             StringCchPrintf(result, MAX_PATH, TEXT("%s-%s"), result, formattedDate);
 
             GetDateFormatEx(localeName, NULL, &fileTime, L"ddd", formattedDate, MAX_PATH, NULL);
-            formattedDate[0] = towupper(formattedDate[0]);
+            formattedDate[0] = std::toupper(formattedDate[0], userLocale);
             StringCchPrintf(result, MAX_PATH, TEXT("%s-%s"), result, formattedDate);
 
             GetDateFormatEx(localeName, NULL, &fileTime, L"dddd", formattedDate, MAX_PATH, NULL);
-            formattedDate[0] = towupper(formattedDate[0]);
+            formattedDate[0] = std::toupper(formattedDate[0], userLocale);
             StringCchPrintf(result, MAX_PATH, TEXT("%s-%s"), result, formattedDate);
 
             rename_pairs renamePairs[] = {
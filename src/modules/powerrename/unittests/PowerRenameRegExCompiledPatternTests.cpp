@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "powerrename/lib/Settings.h"
+#include <PowerRenameInterfaces.h>
+#include <PowerRenameRegEx.h>
+#include <regex>
+#include <string>
+#include <vector>
+#include <boost/regex.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Compares the compiled pattern used by CPowerRenameRegEx::Replace against the previous
+// behavior of building the regular expressions again for every item.  The time both take
+// is measured by the regex modes of PowerRenameBenchmark.
+namespace PowerRenameRegExCompiledPatternTests
+{
+    const int ItemCount = 500;
+
+    std::vector<std::wstring> CreateItemNames(int count)
+    {
+        std::vector<std::wstring> names;
+        names.reserve(count);
+        for (int i = 0; i < count; i++)
+        {
+            names.push_back(L"IMG_" + std::to_wstring(i) + L"_holiday_foo.jpg");
+        }
+        return names;
+    }
+
+    // Mirrors what Replace used to do for every item before the pattern was cached
+    std::wstring UncachedReplace(const std::wstring& source, PCWSTR searchTerm, PCWSTR replaceTerm, bool useBoostLib)
+    {
+        std::wstring replace = std::regex_replace(std::wstring(replaceTerm), std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$[0]"), L"$1$$$0");
+        replace = std::regex_replace(replace, std::wregex(L"(([^\\$]|^)(\\$\\$)*)\\$([1-9])"), L"$1$0$4");
+
+        if (useBoostLib)
+        {
+            boost::wregex pattern(searchTerm, boost::regex::icase | boost::regex::ECMAScript);
+            return boost::regex_replace(source, pattern, replace);
+        }
+
+        std::wregex pattern(searchTerm, std::regex_constants::icase | std::regex_constants::ECMAScript);
+        return std::regex_replace(source, pattern, replace);
+    }
+
+    void VerifyCompiledPattern(bool useBoostLib)
+    {
+        PCWSTR searchTerm = L"(IMG)_(\\d+)_(.*)foo";
+        PCWSTR replaceTerm = L"$3$2_$1bar";
+        std::vector<std::wstring> names = CreateItemNames(ItemCount);
+
+        CSettingsInstance().SetUseBoostLib(useBoostLib);
+        CComPtr<IPowerRenameRegEx> renameRegEx;
+        Assert::IsTrue(CPowerRenameRegEx::s_CreateInstance(&renameRegEx) == S_OK);
+        Assert::IsTrue(renameRegEx->PutFlags(MatchAllOccurences | UseRegularExpressions) == S_OK);
+        Assert::IsTrue(renameRegEx->PutSearchTerm(searchTerm) == S_OK);
+        Assert::IsTrue(renameRegEx->PutReplaceTerm(replaceTerm) == S_OK);
+
+        for (const auto& name : names)
+        {
+            PWSTR result = nullptr;
+            Assert::IsTrue(renameRegEx->Replace(name.c_str(), &result) == S_OK);
+            Assert::AreEqual(UncachedReplace(name, searchTerm, replaceTerm, useBoostLib), std::wstring(result));
+            CoTaskMemFree(result);
+        }
+    }
+
+    TEST_CLASS(CompiledPatternTests){
+        public:
+TEST_CLASS_CLEANUP(ClassCleanup)
+{
+    CSettingsInstance().SetUseBoostLib(false);
+}
+
+TEST_METHOD(CompiledPatternStd)
+{
+    VerifyCompiledPattern(false);
+}
+
+TEST_METHOD(CompiledPatternBoost)
+{
+    VerifyCompiledPattern(true);
+}
+}
+;
+}
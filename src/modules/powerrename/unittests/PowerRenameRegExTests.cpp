@@ -188,6 +188,35 @@ TEST_METHOD(VerifyReplaceAllCaseInsensitive)
     }
 }
 
+TEST_METHOD(VerifyReplaceAllIgnoreCase)
+{
+    CComPtr<IPowerRenameRegEx> renameRegEx;
+    Assert::IsTrue(CPowerRenameRegEx::s_CreateInstance(&renameRegEx) == S_OK);
+    DWORD flags = MatchAllOccurences;
+    Assert::IsTrue(renameRegEx->PutFlags(flags) == S_OK);
+
+    SearchReplaceExpected sreTable[] = {
+        { L"b", L"x", L"AbABAb", L"AxAxAx" },
+        { L"aa", L"b", L"AaAaA", L"bbA" },
+        { L"Photo", L"Img", L"PHOTO_photo_PhOtO.jpg", L"Img_Img_Img.jpg" },
+        { L"abcab", L"x", L"ABCabCABcab", L"xCx" },
+        { L"notfound", L"x", L"not_found", L"not_found" },
+        { L"\u00e9t\u00e9", L"x", L"\u00c9T\u00c9_\u00e9t\u00e9_\u00c9t\u00e9", L"x_x_x" },
+        { L"\u0441\u0442\u0440\u043e\u043a\u0430", L"x", L"\u0421\u0422\u0420\u041e\u041a\u0410.txt", L"x.txt" },
+        { L"\u03c3\u03bf\u03c6\u03af\u03b1", L"x", L"\u03a3\u039f\u03a6\u038a\u0391", L"x" },
+    };
+
+    for (int i = 0; i < ARRAYSIZE(sreTable); i++)
+    {
+        PWSTR result = nullptr;
+        Assert::IsTrue(renameRegEx->PutSearchTerm(sreTable[i].search) == S_OK);
+        Assert::IsTrue(renameRegEx->PutReplaceTerm(sreTable[i].replace) == S_OK);
+        Assert::IsTrue(renameRegEx->Replace(sreTable[i].test, &result) == S_OK);
+        Assert::IsTrue(wcscmp(result, sreTable[i].expected) == 0);
+        CoTaskMemFree(result);
+    }
+}
+
 TEST_METHOD(VerifyReplaceFirstOnlyUseRegEx)
 {
     CComPtr<IPowerRenameRegEx> renameRegEx;
@@ -425,7 +454,7 @@ TEST_METHOD (VerifyFileAttributesMonthandDayNames)
     DWORD flags = MatchAllOccurences | UseRegularExpressions;
     Assert::IsTrue(renameRegEx->PutFlags(flags) == S_OK);
 
-    std::locale::global(std::locale(""));
+    const std::locale userLocale("");
     SYSTEMTIME fileTime = { 2020, 1, 3, 1, 15, 6, 42, 453 };
     wchar_t localeName[LOCALE_NAME_MAX_LENGTH];
     wchar_t result[MAX_PATH] = L"bar";
@@ -434,19 +463,19 @@ TEST_METHOD (VerifyFileAttributesMonthandDayNames)
         StringCchCopy(localeName, LOCALE_NAME_MAX_LENGTH, L"en_US");
 
     GetDateFormatEx(localeName, NULL, &fileTime, L"MMM", formattedDate, MAX_PATH, NULL);
-    formattedDate[0] = towupper(formattedDate[0]);
+    formattedDate[0] = std::toupper(formattedDate[0], userLocale);
     StringCchPrintf(result, MAX_PATH, TEXT("%s%s"), result, formattedDate);
 
     GetDateFormatEx(localeName, NULL, &fileTime, L"MMMM", formattedDate, MAX_PATH, NULL);
-    formattedDate[0] = towupper(formattedDate[0]);
+    formattedDate[0] = std::toupper(formattedDate[0], userLocale);
     StringCchPrintf(result, MAX_PATH, TEXT("%s-%s"), result, formattedDate);
 
     GetDateFormatEx(localeName, NULL, &fileTime, L"ddd", formattedDate, MAX_PATH, NULL);
-    formattedDate[0] = towupper(formattedDate[0]);
+    formattedDate[0] = std::toupper(formattedDate[0], userLocale);
     StringCchPrintf(result, MAX_PATH, TEXT("%s-%s"), result, formattedDate);
 
     GetDateFormatEx(localeName, NULL, &fileTime, L"dddd", formattedDate, MAX_PATH, NULL);
-    formattedDate[0] = towupper(formattedDate[0]);
+    formattedDate[0] = std::toupper(formattedDate[0], userLocale);
     StringCchPrintf(result, MAX_PATH, TEXT("%s-%s"), result, formattedDate);
 
     SearchReplaceExpected sreTable[] = {